@@ -0,0 +1,208 @@
+#include <fmt/core.h>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "../../headers/bench/load.hpp"
+#include "../../headers/bench/workload.hpp"
+
+static void print_usage(const char* argv0) {
+  fmt::print(
+    "Usage: {} gen  --dir PATH [--files N] [--size-min B] [--size-max B] [--seed N]\n"
+    "       {} http|shm|rdma [options]\n"
+    "  target:   [--host H] [--port N] [--shm.path PATH] [--rdma.host H] [--rdma.port N]\n"
+    "  workload: [--files N] [--zipf S] [--seed N]\n"
+    "  shape:    [--threads N] [--connections N] [--pipeline N] [--no-keepalive] [--batch N]\n"
+    "            [--duration S] [--warmup S] [--label TEXT]\n"
+    "  open loop: [--rate R] [--sweep START:STOP:STEP] [--knee-p99-us N]\n",
+    argv0, argv0
+  );
+}
+
+// For the user's --label inside a JSON string
+static std::string json_escape(const std::string& s) {
+  std::string out;
+  for (const char c : s) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      out += fmt::format("\\u{:04x}", static_cast<unsigned>(c));
+    } else {
+      out += c;
+    }
+  }
+  return out;
+}
+
+// Human summary on stderr, one JSON object per run on stdout so runs can be appended
+// to a file and compared. `latency_us` is measured from the intended start (equal to
+// the send time in closed loop), `service_us` from the actual send.
+static void report(const std::string& mode, const std::string& label,
+                   const LoadOptions& opt, const LoadResult& r) {
+  const double secs = r.elapsed_s > 0 ? r.elapsed_s : 1;
+  auto us = [](uint64_t ns) { return static_cast<double>(ns) / 1000.0; };
+  auto pct = [&](const LatencyHistogram& h) {
+    return fmt::format("{{\"mean\":{:.2f},\"p50\":{:.2f},\"p90\":{:.2f},\"p99\":{:.2f},"
+                       "\"p999\":{:.2f},\"max\":{:.2f}}}",
+                       h.mean() / 1000.0, us(h.percentile(0.50)), us(h.percentile(0.90)),
+                       us(h.percentile(0.99)), us(h.percentile(0.999)), us(h.max()));
+  };
+  const auto& h = r.latency_ns;
+
+  fmt::print(stderr,
+             "[bench] {} {}: {} req ({:.0f} req/s, {:.0f} ops/s, {:.1f} MB/s), {} errors\n"
+             "[bench] latency us: mean={:.1f} p50={:.1f} p90={:.1f} p99={:.1f} p99.9={:.1f} max={:.1f}\n",
+             mode, label, r.requests, static_cast<double>(r.requests) / secs,
+             static_cast<double>(r.ops) / secs, static_cast<double>(r.bytes) / secs / 1e6, r.errors,
+             h.mean() / 1000.0, us(h.percentile(0.50)), us(h.percentile(0.90)),
+             us(h.percentile(0.99)), us(h.percentile(0.999)), us(h.max()));
+  if (r.offered_rate > 0) {
+    fmt::print(stderr, "[bench] offered {:.0f} req/s; service us: p50={:.1f} p99={:.1f}\n",
+               r.offered_rate, us(r.service_ns.percentile(0.50)), us(r.service_ns.percentile(0.99)));
+  }
+
+  fmt::print("{{\"mode\":\"{}\",\"label\":\"{}\",\"threads\":{},\"connections\":{},\"pipeline\":{},"
+             "\"batch\":{},\"keepalive\":{},\"files\":{},\"zipf\":{},\"duration_s\":{},"
+             "\"offered_rate\":{:.1f},\"requests\":{},\"ops\":{},\"errors\":{},\"bytes\":{},"
+             "\"req_per_s\":{:.1f},\"ops_per_s\":{:.1f},\"mb_per_s\":{:.3f},"
+             "\"latency_us\":{},\"service_us\":{}}}\n",
+             mode, json_escape(label), opt.threads, opt.connections, opt.pipeline, opt.batch,
+             opt.keepalive ? "true" : "false", opt.files, opt.zipf, opt.duration_s,
+             r.offered_rate, r.requests, r.ops, r.errors, r.bytes,
+             static_cast<double>(r.requests) / secs, static_cast<double>(r.ops) / secs,
+             static_cast<double>(r.bytes) / secs / 1e6, pct(r.latency_ns), pct(r.service_ns));
+  std::fflush(stdout);
+}
+
+struct Sweep {
+  double start = 0, stop = 0, step = 0;
+  uint64_t knee_p99_us = 0;   // 0 = judge saturation on throughput alone
+};
+
+// A step is sustained when the server completed at least 95% of the offered rate
+// without errors and, if a latency objective is set, within it.
+static bool sustained(const LoadResult& r, const Sweep& sw) {
+  const double secs = r.elapsed_s > 0 ? r.elapsed_s : 1;
+  if (static_cast<double>(r.requests) / secs < 0.95 * r.offered_rate) return false;
+  if (r.errors > 0) return false;
+  return sw.knee_p99_us == 0 || r.latency_ns.percentile(0.99) <= sw.knee_p99_us * 1000;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    print_usage(argv[0]);
+    return 2;
+  }
+  const std::string mode = argv[1];
+  if (mode == "--help" || mode == "-h") {
+    print_usage(argv[0]);
+    return 0;
+  }
+
+  try {
+    LoadOptions opt;
+    DocRootSpec gen;
+    std::string label;
+    Sweep sweep;
+    for (int i = 2; i < argc; ++i) {
+      std::string arg = argv[i];
+      auto next = [&](int& i) -> std::string { return (i + 1 < argc) ? std::string(argv[++i]) : std::string(); };
+
+      if (arg == "--dir" && i + 1 < argc) gen.dir = next(i);
+      else if (arg == "--files" && i + 1 < argc) opt.files = gen.files = static_cast<std::size_t>(std::stoull(next(i)));
+      else if (arg == "--size-min" && i + 1 < argc) gen.size_min = static_cast<std::size_t>(std::stoull(next(i)));
+      else if (arg == "--size-max" && i + 1 < argc) gen.size_max = static_cast<std::size_t>(std::stoull(next(i)));
+      else if (arg == "--seed" && i + 1 < argc) opt.seed = gen.seed = std::stoull(next(i));
+      else if (arg == "--zipf" && i + 1 < argc) opt.zipf = std::stod(next(i));
+      else if (arg == "--host" && i + 1 < argc) opt.host = next(i);
+      else if (arg == "--port" && i + 1 < argc) opt.port = static_cast<unsigned short>(std::stoi(next(i)));
+      else if (arg == "--shm.path" && i + 1 < argc) opt.shm_path = next(i);
+      else if (arg == "--rdma.host" && i + 1 < argc) opt.rdma_host = next(i);
+      else if (arg == "--rdma.port" && i + 1 < argc) opt.rdma_port = static_cast<unsigned short>(std::stoi(next(i)));
+      else if (arg == "--threads" && i + 1 < argc) opt.threads = static_cast<unsigned>(std::stoul(next(i)));
+      else if (arg == "--connections" && i + 1 < argc) opt.connections = static_cast<unsigned>(std::stoul(next(i)));
+      else if (arg == "--pipeline" && i + 1 < argc) opt.pipeline = static_cast<unsigned>(std::stoul(next(i)));
+      else if (arg == "--no-keepalive") opt.keepalive = false;
+      else if (arg == "--batch" && i + 1 < argc) opt.batch = static_cast<unsigned>(std::stoul(next(i)));
+      else if (arg == "--duration" && i + 1 < argc) opt.duration_s = std::stod(next(i));
+      else if (arg == "--warmup" && i + 1 < argc) opt.warmup_s = std::stod(next(i));
+      else if (arg == "--label" && i + 1 < argc) label = next(i);
+      else if (arg == "--rate" && i + 1 < argc) opt.rate = std::stod(next(i));
+      else if (arg == "--knee-p99-us" && i + 1 < argc) sweep.knee_p99_us = std::stoull(next(i));
+      else if (arg == "--sweep" && i + 1 < argc) {
+        const std::string v = next(i);
+        const auto a = v.find(':'), b = v.find(':', a == std::string::npos ? a : a + 1);
+        if (a == std::string::npos || b == std::string::npos) {
+          fmt::print(stderr, "[bench] --sweep wants START:STOP:STEP\n");
+          return 2;
+        }
+        sweep.start = std::stod(v.substr(0, a));
+        sweep.stop = std::stod(v.substr(a + 1, b - a - 1));
+        sweep.step = std::stod(v.substr(b + 1));
+        // A rate of 0 would run closed loop, which every step "sustains"
+        if (sweep.start <= 0 || sweep.step <= 0) {
+          fmt::print(stderr, "[bench] --sweep wants START and STEP above 0\n");
+          return 2;
+        }
+      }
+      else {
+        fmt::print(stderr, "[bench] unknown option '{}'\n", arg);
+        return 2;
+      }
+    }
+
+    if (mode == "gen") {
+      if (gen.dir.empty()) {
+        fmt::print(stderr, "[bench] gen needs --dir\n");
+        return 2;
+      }
+      const uint64_t bytes = generate_doc_root(gen);
+      fmt::print(stderr, "[bench] wrote {} files ({:.1f} MB) under {}\n",
+                 gen.files, static_cast<double>(bytes) / 1e6, gen.dir);
+      return 0;
+    }
+
+    auto run = [&](const LoadOptions& o) {
+      if (mode == "shm") return run_fastpath_load(o, FastPathKind::Shm);
+      if (mode == "rdma") return run_fastpath_load(o, FastPathKind::Rdma);
+      return run_http_load(o);
+    };
+    if (mode != "http" && mode != "shm" && mode != "rdma") {
+      print_usage(argv[0]);
+      return 2;
+    }
+#ifndef ENABLE_RDMA
+    if (mode == "rdma") {
+      fmt::print(stderr, "[bench] built without ENABLE_RDMA\n");
+      return 2;
+    }
+#endif
+
+    if (sweep.step <= 0) {
+      const LoadResult r = run(opt);
+      report(mode, label, opt, r);
+      return r.requests > 0 ? 0 : 1;
+    }
+
+    // Rate sweep: step the offered load up until the server stops keeping up. The
+    // knee is the last rate it sustained.
+    double knee = 0;
+    for (double rate = sweep.start; rate <= sweep.stop; rate += sweep.step) {
+      LoadOptions o = opt;
+      o.rate = rate;
+      const LoadResult r = run(o);
+      report(mode, label, o, r);
+      if (!sustained(r, sweep)) break;
+      knee = rate;
+    }
+    fmt::print(stderr, "[bench] {} {}: saturation knee at {:.0f} req/s\n", mode, label, knee);
+    fmt::print("{{\"mode\":\"{}\",\"label\":\"{}\",\"threads\":{},\"connections\":{},"
+               "\"knee_p99_us\":{},\"knee_rate\":{:.1f}}}\n",
+               mode, json_escape(label), opt.threads, opt.connections, sweep.knee_p99_us, knee);
+    return knee > 0 ? 0 : 1;
+  } catch (const std::exception& ex) {
+    fmt::print(stderr, "[bench] {}\n", ex.what());
+    return 1;
+  }
+}
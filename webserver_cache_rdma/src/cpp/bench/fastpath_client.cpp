@@ -0,0 +1,207 @@
+#include "../../headers/bench/fastpath_client.hpp"
+#include "../../headers/rdma/shm_transport.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <stdexcept>
+
+#ifdef ENABLE_RDMA
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <infiniband/verbs.h>
+#include <rdma/rdma_cma.h>
+#endif
+
+namespace {
+
+class ShmFastPathClient : public FastPathClient {
+public:
+  bool connect(const std::string& path) { return c_.connect(path); }
+  bool send(const void* data, std::size_t n) override { return c_.send(data, n); }
+  bool recv(std::vector<uint8_t>& out, int timeout_ms) override { return c_.recv(out, timeout_ms); }
+
+private:
+  rdma_fast::ShmClient c_;
+};
+
+} // namespace
+
+std::unique_ptr<FastPathClient> connect_shm_client(const std::string& socket_path) {
+  auto c = std::make_unique<ShmFastPathClient>();
+  if (!c->connect(socket_path)) return nullptr;
+  return c;
+}
+
+#ifdef ENABLE_RDMA
+namespace {
+
+// Minimal blocking RC client: a ring of registered RECV buffers and a ring of SEND
+// slots, completions reaped by polling the CQ from the calling thread.
+class RdmaFastPathClient : public FastPathClient {
+public:
+  RdmaFastPathClient(std::size_t recv_size, int recv_bufs)
+    : recv_size_(recv_size), recv_bufs_(recv_bufs) {}
+
+  ~RdmaFastPathClient() override {
+    if (id_) rdma_disconnect(id_);
+    if (id_ && id_->qp) rdma_destroy_qp(id_);
+    if (recv_mr_) ibv_dereg_mr(recv_mr_);
+    if (send_mr_) ibv_dereg_mr(send_mr_);
+    if (cq_) ibv_destroy_cq(cq_);
+    if (pd_) ibv_dealloc_pd(pd_);
+    if (id_) rdma_destroy_id(id_);
+    if (ec_) rdma_destroy_event_channel(ec_);
+  }
+
+  bool connect(const std::string& host, uint16_t port) {
+    ec_ = rdma_create_event_channel();
+    if (!ec_ || rdma_create_id(ec_, &id_, nullptr, RDMA_PS_TCP)) return false;
+
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    addrinfo* res = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &res) || !res) return false;
+    const int rc = rdma_resolve_addr(id_, nullptr, res->ai_addr, 2000);
+    freeaddrinfo(res);
+    if (rc || !expect_(RDMA_CM_EVENT_ADDR_RESOLVED)) return false;
+    if (rdma_resolve_route(id_, 2000) || !expect_(RDMA_CM_EVENT_ROUTE_RESOLVED)) return false;
+
+    pd_ = ibv_alloc_pd(id_->verbs);
+    cq_ = pd_ ? ibv_create_cq(id_->verbs, recv_bufs_ + kSendSlots + 16, nullptr, nullptr, 0) : nullptr;
+    if (!cq_) return false;
+
+    ibv_qp_init_attr qp_attr{};
+    qp_attr.send_cq = cq_;
+    qp_attr.recv_cq = cq_;
+    qp_attr.qp_type = IBV_QPT_RC;
+    qp_attr.cap.max_send_wr = kSendSlots;
+    qp_attr.cap.max_recv_wr = static_cast<uint32_t>(recv_bufs_);
+    qp_attr.cap.max_send_sge = 1;
+    qp_attr.cap.max_recv_sge = 1;
+    if (rdma_create_qp(id_, pd_, &qp_attr)) return false;
+
+    recv_mem_.resize(recv_size_ * static_cast<std::size_t>(recv_bufs_));
+    send_mem_.resize(kSendSize * kSendSlots);
+    recv_mr_ = ibv_reg_mr(pd_, recv_mem_.data(), recv_mem_.size(), IBV_ACCESS_LOCAL_WRITE);
+    send_mr_ = ibv_reg_mr(pd_, send_mem_.data(), send_mem_.size(), 0);
+    if (!recv_mr_ || !send_mr_) return false;
+    for (int i = 0; i < recv_bufs_; ++i) {
+      if (!post_recv_(static_cast<std::size_t>(i))) return false;
+    }
+
+    rdma_conn_param param{};
+    param.initiator_depth = 1;
+    param.responder_resources = 1;
+    param.retry_count = 7;
+    param.rnr_retry_count = 7;
+    if (rdma_connect(id_, &param)) return false;
+    return expect_(RDMA_CM_EVENT_ESTABLISHED);
+  }
+
+  bool send(const void* data, std::size_t n) override {
+    if (n > kSendSize || failed_) return false;
+    while (sends_inflight_ >= static_cast<int>(kSendSlots)) {
+      if (!poll_()) return false;
+    }
+    char* slot = send_mem_.data() + next_slot_ * kSendSize;
+    next_slot_ = (next_slot_ + 1) % kSendSlots;
+    std::memcpy(slot, data, n);
+
+    ibv_sge sge{};
+    sge.addr = reinterpret_cast<uint64_t>(slot);
+    sge.length = static_cast<uint32_t>(n);
+    sge.lkey = send_mr_->lkey;
+    ibv_send_wr wr{}, *bad = nullptr;
+    wr.wr_id = kSendTag;
+    wr.sg_list = &sge;
+    wr.num_sge = 1;
+    wr.opcode = IBV_WR_SEND;
+    wr.send_flags = IBV_SEND_SIGNALED;
+    if (ibv_post_send(id_->qp, &wr, &bad)) return false;
+    ++sends_inflight_;
+    return true;
+  }
+
+  bool recv(std::vector<uint8_t>& out, int timeout_ms) override {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    while (ready_.empty()) {
+      if (!poll_()) return false;
+      if (timeout_ms >= 0 && std::chrono::steady_clock::now() > deadline) return false;
+    }
+    out = std::move(ready_.front());
+    ready_.pop_front();
+    return true;
+  }
+
+private:
+  static constexpr std::size_t kSendSlots = 64;
+  static constexpr std::size_t kSendSize = 4096;
+  static constexpr uint64_t kSendTag = ~0ull;
+
+  bool expect_(rdma_cm_event_type want) {
+    rdma_cm_event* ev = nullptr;
+    if (rdma_get_cm_event(ec_, &ev)) return false;
+    const bool ok = ev->event == want;
+    rdma_ack_cm_event(ev);
+    return ok;
+  }
+
+  bool post_recv_(std::size_t idx) {
+    ibv_sge sge{};
+    sge.addr = reinterpret_cast<uint64_t>(recv_mem_.data() + idx * recv_size_);
+    sge.length = static_cast<uint32_t>(recv_size_);
+    sge.lkey = recv_mr_->lkey;
+    ibv_recv_wr wr{}, *bad = nullptr;
+    wr.wr_id = idx;
+    wr.sg_list = &sge;
+    wr.num_sge = 1;
+    return ibv_post_recv(id_->qp, &wr, &bad) == 0;
+  }
+
+  bool poll_() {
+    ibv_wc wcs[16];
+    const int n = ibv_poll_cq(cq_, 16, wcs);
+    if (n < 0) failed_ = true;
+    for (int i = 0; i < n; ++i) {
+      const ibv_wc& wc = wcs[i];
+      if (wc.status != IBV_WC_SUCCESS) {
+        failed_ = true;
+        continue;
+      }
+      if (wc.wr_id == kSendTag) {
+        --sends_inflight_;
+      } else {
+        const char* p = recv_mem_.data() + wc.wr_id * recv_size_;
+        ready_.emplace_back(p, p + wc.byte_len);
+        if (!post_recv_(wc.wr_id)) failed_ = true;
+      }
+    }
+    return !failed_;
+  }
+
+  std::size_t recv_size_;
+  int recv_bufs_;
+  rdma_event_channel* ec_ = nullptr;
+  rdma_cm_id* id_ = nullptr;
+  ibv_pd* pd_ = nullptr;
+  ibv_cq* cq_ = nullptr;
+  std::vector<char> recv_mem_;
+  std::vector<char> send_mem_;
+  ibv_mr* recv_mr_ = nullptr;
+  ibv_mr* send_mr_ = nullptr;
+  std::size_t next_slot_ = 0;
+  int sends_inflight_ = 0;
+  bool failed_ = false;
+  std::deque<std::vector<uint8_t>> ready_;
+};
+
+} // namespace
+
+std::unique_ptr<FastPathClient> connect_rdma_client(const std::string& host, uint16_t port,
+                                                    std::size_t recv_size, int recv_bufs) {
+  auto c = std::make_unique<RdmaFastPathClient>(recv_size, recv_bufs);
+  if (!c->connect(host, port)) return nullptr;
+  return c;
+}
+#endif
@@ -0,0 +1,201 @@
+#include "../../headers/bench/load.hpp"
+#include "../../headers/bench/workload.hpp"
+#include "../../headers/bench/fastpath_client.hpp"
+#include "../../headers/rdma/protocol.hpp"
+
+#include <fmt/core.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <random>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+using namespace rdma_fast;
+
+namespace {
+
+constexpr int kRecvTimeoutMs = 5000;
+
+std::unique_ptr<FastPathClient> connect_client(const LoadOptions& opt, FastPathKind kind) {
+  if (kind == FastPathKind::Shm) return connect_shm_client(opt.shm_path);
+#ifdef ENABLE_RDMA
+  return connect_rdma_client(opt.rdma_host, opt.rdma_port);
+#else
+  return nullptr;
+#endif
+}
+
+// Reassembles one reply from its messages. Replies arrive in request order, so the
+// driver only has to track where the current one ends.
+struct ReplyReader {
+  std::size_t items = 1;          // MgetItem entries expected after the header (0 for GET)
+  std::vector<uint8_t> head;      // RespHeader + item table, possibly split across messages
+  uint64_t want = 0;              // total stream bytes, known once the header is in
+  uint64_t got = 0;
+  bool have_header = false;
+
+  void reset(std::size_t mget_items) {
+    items = mget_items;
+    head.clear();
+    want = got = 0;
+    have_header = false;
+  }
+
+  // Returns true once the reply is complete
+  bool feed(const std::vector<uint8_t>& msg) {
+    const std::size_t head_len = sizeof(RespHeader) + items * sizeof(MgetItem);
+    if (head.size() < head_len) {
+      const std::size_t take = std::min(head_len - head.size(), msg.size());
+      head.insert(head.end(), msg.begin(), msg.begin() + static_cast<std::ptrdiff_t>(take));
+    }
+    got += msg.size();
+    if (!have_header && head.size() >= sizeof(RespHeader)) {
+      RespHeader h{};
+      std::memcpy(&h, head.data(), sizeof(h));
+      want = sizeof(RespHeader) + h.content_len;
+      have_header = true;
+      if (h.status != 200 || h.content_len == 0) items = 0; // error replies carry no table
+    }
+    return have_header && got >= want;
+  }
+
+  uint16_t status() const {
+    RespHeader h{};
+    std::memcpy(&h, head.data(), sizeof(h));
+    return h.status;
+  }
+
+  // Items of an MGET reply that were not 200
+  uint64_t failed_items() const {
+    uint64_t n = 0;
+    for (std::size_t i = 0; i < items; ++i) {
+      MgetItem it{};
+      std::memcpy(&it, head.data() + sizeof(RespHeader) + i * sizeof(MgetItem), sizeof(it));
+      if (it.status != 200) ++n;
+    }
+    return n;
+  }
+};
+
+struct Pending {
+  Clock::time_point intended;
+  Clock::time_point actual;
+};
+
+// One client per thread with a window of opt.pipeline requests. Closed loop refills
+// the window as replies land; open loop sends on a fixed schedule of rate/threads per
+// second and polls for replies in between.
+void run_worker(const LoadOptions& opt, FastPathKind kind, const ZipfKeys& keys, unsigned t,
+                Clock::time_point start, Clock::time_point measure_from, Clock::time_point end,
+                LoadResult& result) {
+  auto client = connect_client(opt, kind);
+  if (!client) {
+    fmt::print(stderr, "[bench] thread {}: fast-path connect failed\n", t);
+    ++result.errors;
+    return;
+  }
+
+  const unsigned threads = std::max(1u, opt.threads);
+  const bool open_loop = opt.rate > 0;
+  const auto interval = open_loop
+    ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(threads / opt.rate))
+    : Clock::duration::zero();
+  Clock::time_point next_intended = start + interval * t / threads;
+
+  std::mt19937_64 rng(opt.seed * 7919 + t);
+  const unsigned batch = std::max(1u, opt.batch);
+  const unsigned window = std::max(1u, opt.pipeline);
+  std::deque<Pending> inflight;
+  std::vector<std::string> paths;
+  std::vector<uint8_t> msg;
+  ReplyReader reader;
+  reader.reset(batch > 1 ? batch : 0);
+
+  auto issue = [&](Clock::time_point intended) {
+    std::vector<uint8_t> req;
+    if (batch == 1) {
+      req = make_get_request(bench_key_path(keys.next(rng)));
+    } else {
+      paths.clear();
+      for (unsigned i = 0; i < batch; ++i) paths.push_back(bench_key_path(keys.next(rng)));
+      req = make_mget_request(paths);
+    }
+    if (!client->send(req.data(), req.size())) return false;
+    inflight.push_back({intended, Clock::now()});
+    return true;
+  };
+
+  bool stopping = false;
+  auto last_progress = Clock::now();
+  while (!inflight.empty() || !stopping) {
+    const auto now = Clock::now();
+    if (now >= end) stopping = true; // drain what is in flight, then leave
+    while (!stopping && inflight.size() < window) {
+      Clock::time_point intended = Clock::now();
+      if (open_loop) {
+        if (next_intended > intended) break;
+        intended = next_intended;
+        next_intended += interval;
+      }
+      if (!issue(intended)) {
+        ++result.errors;
+        return;
+      }
+    }
+
+    int timeout_ms = kRecvTimeoutMs;
+    if (open_loop && !stopping && inflight.size() < window) {
+      if (inflight.empty()) {
+        std::this_thread::sleep_until(std::min(next_intended, end));
+        continue;
+      }
+      timeout_ms = 0; // poll; the next slot may be due before the reply lands
+    }
+    if (!client->recv(msg, timeout_ms)) {
+      if (timeout_ms == 0 && Clock::now() - last_progress < std::chrono::milliseconds(kRecvTimeoutMs)) continue;
+      result.errors += inflight.size();
+      return;
+    }
+    last_progress = Clock::now();
+    if (!reader.feed(msg)) continue;
+
+    const auto done = Clock::now();
+    if (done >= measure_from && done < end) {
+      const uint16_t status = reader.status();
+      ++result.requests;
+      result.ops += batch;
+      result.bytes += reader.want - sizeof(RespHeader) - reader.items * sizeof(MgetItem);
+      if (status != 200) result.errors += batch;
+      else result.errors += reader.failed_items();
+      result.record(inflight.front().intended, inflight.front().actual, done);
+    }
+    inflight.pop_front();
+    reader.reset(batch > 1 ? batch : 0);
+  }
+}
+
+} // namespace
+
+LoadResult run_fastpath_load(const LoadOptions& opt, FastPathKind kind) {
+  ZipfKeys keys(opt.files, opt.zipf, opt.seed);
+  const unsigned threads = std::max(1u, opt.threads);
+  const auto start = Clock::now();
+  const auto measure_from = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(opt.warmup_s));
+  const auto end = measure_from + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(opt.duration_s));
+
+  std::vector<LoadResult> results(threads);
+  std::vector<std::thread> pool;
+  for (unsigned t = 0; t < threads; ++t) {
+    pool.emplace_back([&, t] { run_worker(opt, kind, keys, t, start, measure_from, end, results[t]); });
+  }
+  for (auto& th : pool) th.join();
+
+  LoadResult total;
+  for (auto& r : results) total.merge(r);
+  total.elapsed_s = opt.duration_s;
+  total.offered_rate = opt.rate;
+  return total;
+}
@@ -0,0 +1,296 @@
+#include "../../headers/bench/load.hpp"
+#include "../../headers/bench/workload.hpp"
+
+#include <boost/asio.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+using boost::asio::ip::tcp;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct Pending {
+  Clock::time_point intended;
+  Clock::time_point actual;
+};
+
+struct Worker {
+  boost::asio::io_context ioc;
+  tcp::endpoint ep;
+  const LoadOptions* opt = nullptr;
+  const ZipfKeys* keys = nullptr;
+  std::mt19937_64 rng;
+  Clock::time_point measure_from;
+  bool stopping = false;
+  LoadResult result;
+
+  void complete(const Pending& p, int status, uint64_t body_bytes) {
+    const auto now = Clock::now();
+    if (now < measure_from) return;
+    ++result.requests;
+    ++result.ops;
+    result.bytes += body_bytes;
+    if (status < 200 || status >= 300) ++result.errors;
+    result.record(p.intended, p.actual, now);
+  }
+  void failed(uint64_t n = 1) {
+    if (Clock::now() >= measure_from) result.errors += n;
+  }
+};
+
+// One client connection. Keeps opt.pipeline requests outstanding; with keep-alive off
+// it runs one request per connection and the measured time includes the connect.
+// In open loop the connection owns every interval-th slot of the schedule, starting
+// at `first`, and sends a request only once its slot is due.
+class HttpLoadConn : public std::enable_shared_from_this<HttpLoadConn> {
+public:
+  HttpLoadConn(Worker& w, Clock::duration interval, Clock::time_point first)
+    : w_(w), sock_(w.ioc), timer_(w.ioc), rbuf_(64 * 1024),
+      interval_(interval), next_intended_(first) {}
+
+  void start() {
+    if (w_.stopping) return;
+    connect_started_ = Clock::now();
+    auto self = shared_from_this();
+    sock_.async_connect(w_.ep, [self](boost::system::error_code ec) {
+      if (ec) {
+        self->w_.failed();
+        self->restart();
+        return;
+      }
+      boost::system::error_code ig;
+      self->sock_.set_option(tcp::no_delay(true), ig);
+      self->fill();
+      self->read();
+    });
+  }
+
+private:
+  void restart() {
+    ++gen_;
+    boost::system::error_code ig;
+    sock_.close(ig);
+    timer_.cancel();
+    inflight_.clear();
+    head_.clear();
+    in_body_ = false;
+    writing_ = false;
+    wbuf_.clear();
+    if (w_.stopping) return;
+    sock_ = tcp::socket(w_.ioc);
+    start();
+  }
+
+  bool open_loop() const { return interval_ != Clock::duration::zero(); }
+
+  void fill() {
+    const unsigned depth = w_.opt->keepalive ? std::max(1u, w_.opt->pipeline) : 1u;
+    const auto now = Clock::now();
+    while (inflight_.size() < depth && !w_.stopping) {
+      Pending p{now, w_.opt->keepalive ? now : connect_started_};
+      if (open_loop()) {
+        if (next_intended_ > now) break;
+        p.intended = next_intended_;
+        next_intended_ += interval_;
+      }
+      const auto key = bench_key_path(w_.keys->next(w_.rng));
+      wbuf_ += "GET " + key + " HTTP/1.1\r\nHost: bench\r\n";
+      wbuf_ += w_.opt->keepalive ? "\r\n" : "Connection: close\r\n\r\n";
+      inflight_.push_back(p);
+      if (!w_.opt->keepalive) break;
+    }
+    flush();
+    // Caught up with the schedule: wake up for the next slot. When all slots are busy
+    // the next response calls fill() instead, and the overdue requests go out then.
+    if (open_loop() && inflight_.size() < depth && !w_.stopping) arm_timer();
+  }
+
+  void arm_timer() {
+    timer_.expires_at(next_intended_);
+    auto self = shared_from_this();
+    timer_.async_wait([self, gen = gen_](boost::system::error_code ec) {
+      if (ec || gen != self->gen_) return;
+      self->fill();
+    });
+  }
+
+  void flush() {
+    if (writing_ || wbuf_.empty()) return;
+    writing_ = true;
+    out_.swap(wbuf_);
+    wbuf_.clear();
+    auto self = shared_from_this();
+    boost::asio::async_write(sock_, boost::asio::buffer(out_),
+      [self, gen = gen_](boost::system::error_code ec, std::size_t) {
+        if (gen != self->gen_) return;
+        self->writing_ = false;
+        if (ec) return; // the read side notices and reconnects
+        self->flush();
+      });
+  }
+
+  void read() {
+    auto self = shared_from_this();
+    sock_.async_read_some(boost::asio::buffer(rbuf_),
+      [self, gen = gen_](boost::system::error_code ec, std::size_t n) {
+        if (gen != self->gen_) return;
+        // Every request still outstanding is lost with the connection
+        if (ec) {
+          self->w_.failed(self->inflight_.size());
+          self->restart();
+          return;
+        }
+        if (!self->feed(self->rbuf_.data(), n)) {
+          self->w_.failed(std::max<std::size_t>(1, self->inflight_.size()));
+          self->restart();
+          return;
+        }
+        if (gen != self->gen_) return; // recycled while parsing (keep-alive off)
+        self->read();
+      });
+  }
+
+  // Incremental response parser: headers are buffered, bodies only counted.
+  bool feed(const char* p, std::size_t n) {
+    while (n > 0) {
+      if (in_body_) {
+        const std::size_t take = static_cast<std::size_t>(std::min<uint64_t>(n, body_left_));
+        body_left_ -= take;
+        p += take;
+        n -= take;
+        if (body_left_ == 0 && !on_response()) return true;
+        continue;
+      }
+
+      const std::size_t old = head_.size();
+      head_.append(p, n);
+      const auto pos = head_.find("\r\n\r\n", old >= 3 ? old - 3 : 0);
+      if (pos == std::string::npos) {
+        if (head_.size() > 64 * 1024) return false;
+        return true;
+      }
+      const std::size_t used = pos + 4 - old;
+      p += used;
+      n -= used;
+
+      status_ = 0;
+      if (head_.size() > 12) status_ = std::atoi(head_.c_str() + 9);
+      body_len_ = content_length(head_);
+      body_left_ = body_len_;
+      head_.clear();
+      in_body_ = true;
+      if (body_left_ == 0 && !on_response()) return true;
+    }
+    return true;
+  }
+
+  // Returns false when the connection has been recycled and parsing must stop
+  bool on_response() {
+    in_body_ = false;
+    if (inflight_.empty()) return true;
+    w_.complete(inflight_.front(), status_, body_len_);
+    inflight_.pop_front();
+    if (!w_.opt->keepalive) {
+      restart();
+      return false;
+    }
+    fill();
+    return true;
+  }
+
+  static uint64_t content_length(const std::string& head) {
+    static const char kName[] = "content-length:";
+    for (std::size_t i = 0; i + sizeof(kName) - 1 < head.size(); ++i) {
+      std::size_t k = 0;
+      while (k < sizeof(kName) - 1 &&
+             std::tolower(static_cast<unsigned char>(head[i + k])) == kName[k]) ++k;
+      if (k == sizeof(kName) - 1) return std::strtoull(head.c_str() + i + k, nullptr, 10);
+    }
+    return 0;
+  }
+
+  Worker& w_;
+  tcp::socket sock_;
+  boost::asio::steady_timer timer_;
+  unsigned gen_ = 0; // bumped per reconnect; stale handlers check it and bail
+  std::vector<char> rbuf_;
+  std::string wbuf_;
+  std::string out_;
+  bool writing_ = false;
+  std::deque<Pending> inflight_;
+  Clock::time_point connect_started_;
+  Clock::duration interval_;          // zero in closed loop
+  Clock::time_point next_intended_;
+
+  std::string head_;
+  bool in_body_ = false;
+  uint64_t body_len_ = 0;
+  uint64_t body_left_ = 0;
+  int status_ = 0;
+};
+
+} // namespace
+
+LoadResult run_http_load(const LoadOptions& opt) {
+  ZipfKeys keys(opt.files, opt.zipf, opt.seed);
+
+  boost::asio::io_context resolver_ctx;
+  tcp::resolver resolver(resolver_ctx);
+  const tcp::endpoint ep = *resolver.resolve(opt.host, std::to_string(opt.port)).begin();
+
+  const unsigned threads = std::max(1u, opt.threads);
+  const auto start = Clock::now();
+  const auto measure_from = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(opt.warmup_s));
+  const auto end = measure_from + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(opt.duration_s));
+
+  std::vector<std::unique_ptr<Worker>> workers;
+  for (unsigned t = 0; t < threads; ++t) {
+    auto w = std::make_unique<Worker>();
+    w->ep = ep;
+    w->opt = &opt;
+    w->keys = &keys;
+    w->rng.seed(opt.seed * 7919 + t);
+    w->measure_from = measure_from;
+    workers.push_back(std::move(w));
+  }
+  // Open loop: each connection carries rate/connections, phases staggered evenly
+  const unsigned conns = std::max(1u, opt.connections);
+  const auto interval = opt.rate > 0
+    ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(conns / opt.rate))
+    : Clock::duration::zero();
+  for (unsigned c = 0; c < conns; ++c) {
+    Worker& w = *workers[c % threads];
+    const auto first = start + interval * c / conns;
+    boost::asio::post(w.ioc, [&w, interval, first] {
+      std::make_shared<HttpLoadConn>(w, interval, first)->start();
+    });
+  }
+
+  std::vector<std::thread> pool;
+  for (auto& wp : workers) {
+    Worker* w = wp.get();
+    pool.emplace_back([w, end] {
+      boost::asio::steady_timer stop(w->ioc);
+      stop.expires_at(end);
+      stop.async_wait([w](boost::system::error_code) {
+        w->stopping = true;
+        w->ioc.stop();
+      });
+      w->ioc.run();
+    });
+  }
+  for (auto& t : pool) t.join();
+
+  LoadResult total;
+  for (auto& w : workers) total.merge(w->result);
+  total.elapsed_s = opt.duration_s;
+  total.offered_rate = opt.rate;
+  return total;
+}
@@ -0,0 +1,51 @@
+#include "../../headers/bench/workload.hpp"
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+std::string bench_key_path(std::size_t i) {
+  return "/bench/d" + std::to_string(i / 1000) + "/f" + std::to_string(i) + ".bin";
+}
+
+uint64_t generate_doc_root(const DocRootSpec& spec) {
+  std::mt19937_64 rng(spec.seed);
+  const double lmin = std::log(static_cast<double>(std::max<std::size_t>(1, spec.size_min)));
+  const double lmax = std::log(static_cast<double>(std::max(spec.size_min, spec.size_max)));
+  std::uniform_real_distribution<double> size_dist(lmin, lmax);
+
+  std::vector<char> buf;
+  uint64_t total = 0;
+  for (std::size_t i = 0; i < spec.files; ++i) {
+    const auto n = static_cast<std::size_t>(std::exp(size_dist(rng)));
+    buf.resize(n);
+    for (std::size_t k = 0; k < n; ++k) buf[k] = static_cast<char>('a' + (k + i) % 26);
+
+    fs::path p = fs::path(spec.dir) / bench_key_path(i).substr(1);
+    fs::create_directories(p.parent_path());
+    std::ofstream ofs(p, std::ios::binary | std::ios::trunc);
+    if (!ofs) throw std::runtime_error("cannot write " + p.string());
+    ofs.write(buf.data(), static_cast<std::streamsize>(n));
+    total += n;
+  }
+  return total;
+}
+
+ZipfKeys::ZipfKeys(std::size_t n, double s, uint64_t seed)
+  : cdf_(std::max<std::size_t>(1, n)), perm_(std::max<std::size_t>(1, n)) {
+  double sum = 0;
+  for (std::size_t i = 0; i < cdf_.size(); ++i) {
+    sum += 1.0 / std::pow(static_cast<double>(i + 1), s);
+    cdf_[i] = sum;
+  }
+  for (auto& c : cdf_) c /= sum;
+  cdf_.back() = 1.0;
+
+  std::iota(perm_.begin(), perm_.end(), std::size_t{0});
+  std::mt19937_64 rng(seed);
+  std::shuffle(perm_.begin(), perm_.end(), rng);
+}
@@ -0,0 +1,56 @@
+#include "../../headers/cache/cached_object.hpp"
+#include "../../headers/fs/file_reader.hpp"
+#include "../../headers/http/mime.hpp"
+#include "../../headers/http/response.hpp"
+#include "../../headers/util/numa.hpp"
+#include "../../headers/util/time.hpp"
+
+ObjectPtr make_cached_object(std::vector<uint8_t> body, std::time_t last_modified, std::string_view type_path,
+                             std::string etag) {
+  auto obj = std::make_shared<CachedObject>();
+  obj->storage = std::move(body);
+  obj->body = obj->storage.data();
+  obj->body_size = obj->storage.size();
+  obj->last_modified = last_modified;
+  obj->etag = etag.empty() ? make_etag(obj->body_size, last_modified) : std::move(etag);
+  obj->mime = mime_type(type_path);
+  obj->node = static_cast<int16_t>(numa::current_node());
+  render_object_headers(*obj);
+  return obj;
+}
+
+void render_object_headers(CachedObject& obj) {
+  char date[64];
+  const std::string_view last_modified(date, format_http_date(obj.last_modified, date, sizeof(date)));
+  constexpr std::string_view kLastModified = "Last-Modified";
+
+  auto& h = obj.headers;
+  h.clear();
+  h.reserve(160 + obj.mime.size() + obj.etag.size());
+  append_header(h, "Content-Type", obj.mime);
+  if (!obj.encoding.empty()) append_header(h, "Content-Encoding", obj.encoding);
+  append_header(h, "Content-Length", uint64_t{obj.body_size});
+  const std::size_t date_at = h.size() + kLastModified.size() + 2;   // past "Last-Modified: "
+  append_header(h, kLastModified, last_modified);
+  append_header(h, "ETag", obj.etag);
+  if (obj.vary) append_header(h, "Vary", "Accept-Encoding");
+  // Kept for the object's lifetime, so the slack is worth a copy
+  h.shrink_to_fit();
+  obj.last_modified_http = std::string_view(h).substr(date_at, last_modified.size());
+}
+
+std::size_t object_overhead(const CachedObject& obj) {
+  // make_shared puts the refcounts (two ints and a vtable pointer) in front of the object
+  std::size_t n = malloc_footprint(sizeof(CachedObject) + 2 * sizeof(void*));
+  if (!obj.storage.empty()) n += malloc_footprint(obj.storage.capacity()) - obj.body_size;
+  n += string_footprint(obj.etag) + string_footprint(obj.headers);
+  return n;
+}
+
+ObjectPtr make_text_object(std::string_view text) {
+  auto obj = std::make_shared<CachedObject>();
+  obj->storage.assign(text.begin(), text.end());
+  obj->body = obj->storage.data();
+  obj->body_size = obj->storage.size();
+  return obj;
+}
@@ -0,0 +1,303 @@
+#include "../../headers/cache/disk_cache.hpp"
+#include "../../headers/util/logging.hpp"
+#include "../../headers/util/metrics.hpp"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Record: header, key, etag, body. Only the body is read back (the index holds the
+// rest); the header keeps segments self-describing for inspection.
+constexpr uint32_t kRecordMagic = 0x4c325231; // "L2R1"
+constexpr std::size_t kRecordHeaderSize = 28;
+
+void put_u32(uint8_t* p, uint32_t v) { std::memcpy(p, &v, sizeof(v)); }
+void put_u64(uint8_t* p, uint64_t v) { std::memcpy(p, &v, sizeof(v)); }
+
+std::size_t segment_size(const DiskCache::Options& opt) {
+  if (opt.segment_bytes) return opt.segment_bytes;
+  const std::size_t s = opt.capacity_bytes / 16;
+  return s < (1u << 20) ? (1u << 20) : s;
+}
+
+DiskCache::Options normalized(DiskCache::Options opt) {
+  opt.segment_bytes = segment_size(opt);
+  return opt;
+}
+
+// A segment left by an earlier run: named seg-<pid>-<id>.l2 by a process that is no
+// longer alive (or by this pid, reused). A predecessor still draining after a
+// handoff keeps reading its own segments, so those stay until it has exited.
+bool stale_segment(const fs::path& path) {
+  const auto name = path.filename().string();
+  if (name.rfind("seg-", 0) != 0 || path.extension() != ".l2") return false;
+  char* end = nullptr;
+  errno = 0;
+  const long pid = std::strtol(name.c_str() + 4, &end, 10);
+  if (errno || end == name.c_str() + 4 || *end != '-' || pid <= 0) return false;
+  if (pid == static_cast<long>(::getpid())) return true;
+  return ::kill(static_cast<pid_t>(pid), 0) != 0 && errno == ESRCH;
+}
+
+} // namespace
+
+DiskCache::Segment::~Segment() {
+  if (fd >= 0) ::close(fd);
+}
+
+DiskCache::DiskCache(const Options& opt) : opt_(normalized(opt)) {
+  std::error_code ec;
+  fs::create_directories(opt_.dir, ec);
+  if (ec) throw std::runtime_error("l2: cannot create '" + opt_.dir + "': " + ec.message());
+
+  for (const auto& de : fs::directory_iterator(opt_.dir, ec)) {
+    if (stale_segment(de.path())) fs::remove(de.path(), ec);
+  }
+  if (ec) throw std::runtime_error("l2: cannot clear '" + opt_.dir + "': " + ec.message());
+
+  budget_tokens_ = static_cast<double>(opt_.write_bytes_per_sec);
+  budget_at_ = std::chrono::steady_clock::now();
+  Metrics::instance().cache_l2_capacity_bytes.fetch_add(opt_.capacity_bytes, std::memory_order_relaxed);
+
+  writer_ = std::thread([this] { writer_loop(); });
+}
+
+DiskCache::~DiskCache() {
+  {
+    std::lock_guard lock(qmtx_);
+    stop_ = true;
+  }
+  qcv_.notify_one();
+  if (writer_.joinable()) writer_.join();
+
+  // Take our share back out of the gauges
+  auto& m = Metrics::instance();
+  m.cache_l2_capacity_bytes.fetch_sub(opt_.capacity_bytes, std::memory_order_relaxed);
+  std::unique_lock lock(mtx_);
+  move_gauge(m.cache_l2_bytes, pub_bytes_, 0);
+  move_gauge(m.cache_l2_items, pub_items_, 0);
+}
+
+std::string DiskCache::segment_path(uint64_t id) const {
+  // The pid keeps a successor taking over the same directory clear of our files
+  return (fs::path(opt_.dir) / ("seg-" + std::to_string(::getpid()) + "-" + std::to_string(id) + ".l2")).string();
+}
+
+ObjectPtr DiskCache::get(std::string_view key) {
+  Location loc;
+  std::shared_ptr<Segment> seg;
+  {
+    std::shared_lock lock(mtx_);
+    auto it = index_.find(std::string(key));
+    if (it == index_.end()) return nullptr;
+    loc = it->second;
+    auto s = segments_.find(loc.segment);
+    if (s == segments_.end()) return nullptr;
+    seg = s->second;   // keeps the fd open even if the segment is dropped meanwhile
+  }
+
+  std::vector<uint8_t> body(loc.size);
+  std::size_t done = 0;
+  while (done < loc.size) {
+    const ssize_t n = ::pread(seg->fd, body.data() + done, loc.size - done,
+                              static_cast<off_t>(loc.offset + done));
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) {
+      Metrics::instance().cache_l2_read_errors.fetch_add(1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    done += static_cast<std::size_t>(n);
+  }
+
+  Metrics::instance().cache_l2_hits.fetch_add(1, std::memory_order_relaxed);
+  return make_cached_object(std::move(body), loc.last_modified, key, std::move(loc.etag));
+}
+
+void DiskCache::demote(std::string key, ObjectPtr obj) {
+  auto& m = Metrics::instance();
+  {
+    std::shared_lock lock(mtx_);
+    auto it = index_.find(key);
+    if (it != index_.end() && it->second.size == obj->size() && it->second.last_modified == obj->last_modified)
+      return;   // this version is already on disk
+  }
+  {
+    std::lock_guard lock(qmtx_);
+    if (queued_bytes_ + obj->size() > opt_.queue_bytes) {
+      m.cache_l2_dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    queued_bytes_ += obj->size();
+    queue_.emplace_back(std::move(key), std::move(obj));
+  }
+  qcv_.notify_one();
+}
+
+void DiskCache::writer_loop() {
+  for (;;) {
+    std::pair<std::string, ObjectPtr> item;
+    {
+      std::unique_lock lock(qmtx_);
+      qcv_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+      if (stop_) return;
+      item = std::move(queue_.front());
+      queue_.pop_front();
+      queued_bytes_ -= item.second->size();
+    }
+    append(item.first, *item.second);
+  }
+}
+
+bool DiskCache::take_budget(std::size_t bytes) {
+  if (opt_.write_bytes_per_sec == 0) return true;
+  const auto now = std::chrono::steady_clock::now();
+  const double rate = static_cast<double>(opt_.write_bytes_per_sec);
+  const double elapsed = std::chrono::duration<double>(now - budget_at_).count();
+  budget_at_ = now;
+  budget_tokens_ = std::min(rate, budget_tokens_ + elapsed * rate);   // one second of burst
+  if (budget_tokens_ < static_cast<double>(bytes)) return false;
+  budget_tokens_ -= static_cast<double>(bytes);
+  return true;
+}
+
+void DiskCache::append(const std::string& key, const CachedObject& e) {
+  auto& m = Metrics::instance();
+  const std::size_t record = kRecordHeaderSize + key.size() + e.etag.size() + e.size();
+  if (record > opt_.segment_bytes || !take_budget(record)) {
+    m.cache_l2_dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  if ((current_id_ == 0 || current_size_ + record > opt_.segment_bytes) && !open_segment()) {
+    m.cache_l2_dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  uint8_t hdr[kRecordHeaderSize];
+  put_u32(hdr, kRecordMagic);
+  put_u32(hdr + 4, static_cast<uint32_t>(key.size()));
+  put_u32(hdr + 8, static_cast<uint32_t>(e.etag.size()));
+  put_u64(hdr + 12, e.size());
+  put_u64(hdr + 20, static_cast<uint64_t>(e.last_modified));
+
+  iovec iov[4] = {
+    {hdr, sizeof(hdr)},
+    {const_cast<char*>(key.data()), key.size()},
+    {const_cast<char*>(e.etag.data()), e.etag.size()},
+    {const_cast<uint8_t*>(e.data()), e.size()},
+  };
+
+  std::shared_ptr<Segment> seg;
+  {
+    std::shared_lock lock(mtx_);
+    seg = segments_.at(current_id_);
+  }
+  std::size_t done = 0;
+  int first = 0;
+  while (done < record) {
+    const ssize_t n = ::pwritev(seg->fd, iov + first, 4 - first, static_cast<off_t>(current_size_ + done));
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) {
+      log_warn("l2: write to {} failed: {}", segment_path(current_id_), std::strerror(errno));
+      m.cache_l2_dropped.fetch_add(1, std::memory_order_relaxed);
+      // The partial record is dead space; later appends start after it
+      current_size_ += done;
+      logs_[current_id_].bytes += done;
+      std::unique_lock lock(mtx_);
+      used_bytes_ += done;
+      return;
+    }
+    done += static_cast<std::size_t>(n);
+    // Skip fully written iovecs and trim the partially written one
+    std::size_t left = static_cast<std::size_t>(n);
+    while (first < 4 && left >= iov[first].iov_len) left -= iov[first++].iov_len;
+    if (first < 4) {
+      iov[first].iov_base = static_cast<uint8_t*>(iov[first].iov_base) + left;
+      iov[first].iov_len -= left;
+    }
+  }
+
+  const uint64_t body_offset = current_size_ + kRecordHeaderSize + key.size() + e.etag.size();
+  current_size_ += record;
+  auto& log = logs_[current_id_];
+  log.keys.push_back(key);
+  log.bytes += record;
+  {
+    std::unique_lock lock(mtx_);
+    index_[key] = Location{current_id_, body_offset, e.size(), e.last_modified, e.etag};
+    used_bytes_ += record;
+    publish();
+  }
+  m.cache_l2_demotions.fetch_add(1, std::memory_order_relaxed);
+  m.cache_l2_bytes_written.fetch_add(record, std::memory_order_relaxed);
+}
+
+bool DiskCache::open_segment() {
+  const std::size_t max_segments = std::max<std::size_t>(2, opt_.capacity_bytes / opt_.segment_bytes);
+  for (;;) {
+    std::size_t count;
+    {
+      std::shared_lock lock(mtx_);
+      count = segments_.size();
+    }
+    if (count < max_segments) break;
+    drop_oldest_segment();
+  }
+
+  const uint64_t id = current_id_ + 1;
+  const std::string path = segment_path(id);
+  const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+  if (fd < 0) {
+    log_warn("l2: cannot open {}: {}", path, std::strerror(errno));
+    return false;
+  }
+  auto seg = std::make_shared<Segment>();
+  seg->fd = fd;
+  {
+    std::unique_lock lock(mtx_);
+    segments_.emplace(id, std::move(seg));
+  }
+  current_id_ = id;
+  current_size_ = 0;
+  return true;
+}
+
+void DiskCache::drop_oldest_segment() {
+  uint64_t id;
+  std::size_t evicted = 0;
+  {
+    std::unique_lock lock(mtx_);
+    if (segments_.empty()) return;
+    id = segments_.begin()->first;
+    const auto& log = logs_[id];
+    for (const auto& key : log.keys) {
+      auto it = index_.find(key);
+      if (it == index_.end() || it->second.segment != id) continue;
+      index_.erase(it);
+      ++evicted;
+    }
+    segments_.erase(segments_.begin());   // readers still holding it keep the fd
+    used_bytes_ -= log.bytes;
+    publish();
+  }
+  logs_.erase(id);
+  std::error_code ec;
+  fs::remove(segment_path(id), ec);
+  Metrics::instance().cache_l2_evictions.fetch_add(evicted, std::memory_order_relaxed);
+}
+
+void DiskCache::publish() const {
+  auto& m = Metrics::instance();
+  move_gauge(m.cache_l2_bytes, pub_bytes_, used_bytes_);
+  move_gauge(m.cache_l2_items, pub_items_, index_.size());
+}
@@ -1,47 +1,586 @@
 #include "../../headers/cache/lru_cache.hpp"
+#include "../../headers/cache/disk_cache.hpp"
+#include "../../headers/util/metrics.hpp"
+#include "../../headers/util/numa.hpp"
+#include "../../headers/util/time.hpp"
 
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <functional>
 #include <mutex>
+#include <new>
+#include <string_view>
+#include <thread>
 
-bool LRUCache::get(const std::string& key, Entry& out) {
-  std::unique_lock lock(mtx_);
-  auto it = map_.find(key);
-  if (it == map_.end()) return false;
-  lru_.splice(lru_.begin(), lru_, it->second);
-  out = it->second->value;
-  return true;
+namespace {
+
+LRUCache::Options with_capacity(std::size_t capacity_bytes) {
+  LRUCache::Options opt;
+  opt.capacity_bytes = capacity_bytes;
+  return opt;
+}
+
+std::size_t small_budget(const LRUCache::Options& opt) {
+  const std::size_t small = opt.small_capacity_bytes ? opt.small_capacity_bytes : opt.capacity_bytes / 8;
+  return small < opt.capacity_bytes ? small : opt.capacity_bytes;
+}
+
+constexpr std::size_t kInitialSlots = 64;
+constexpr std::size_t kInitialBuckets = 64;
+
+} // namespace
+
+struct LRUCache::Revalidator {
+  int64_t after_ms = 0;
+  Reload reload;
+  std::size_t capacity = 0;
+
+  std::mutex mtx;
+  std::condition_variable cv;
+  std::deque<std::pair<std::string, ObjectPtr>> queue;
+  bool stop = false;
+  std::thread worker;
+};
+
+LRUCache::LRUCache(std::size_t capacity_bytes) : LRUCache(with_capacity(capacity_bytes)) {}
+
+LRUCache::LRUCache(const Options& opt)
+  : small_max_object_(opt.small_max_object),
+    small_capacity_(small_budget(opt)),
+    large_capacity_(opt.capacity_bytes - small_budget(opt)),
+    pin_keys_(opt.pinned),
+    slots_(kInitialSlots),
+    buckets_(kInitialBuckets, nullptr),
+    node_(opt.node) {
+  for (const auto& key : pin_keys_) pinned_.emplace(key, nullptr);
+
+  auto& m = Metrics::instance();
+  m.cache_small_capacity_bytes.fetch_add(small_capacity_, std::memory_order_relaxed);
+  m.cache_large_capacity_bytes.fetch_add(large_capacity_, std::memory_order_relaxed);
+  publish_small();
+  publish_large();
+
+  if (!opt.l2_dir.empty()) {
+    DiskCache::Options l2;
+    l2.dir = opt.l2_dir;
+    l2.capacity_bytes = opt.l2_capacity_bytes;
+    l2.write_bytes_per_sec = opt.l2_write_bytes_per_sec;
+    l2_ = std::make_unique<DiskCache>(l2);
+  }
+
+  if (opt.negative_ttl.count() > 0)
+    negative_ = std::make_unique<NegativeCache>(opt.negative_ttl.count(), opt.negative_max);
+
+  if (opt.revalidate_after.count() > 0 && opt.reload) {
+    revalidator_ = std::make_unique<Revalidator>();
+    revalidator_->after_ms = opt.revalidate_after.count();
+    revalidator_->reload = opt.reload;
+    revalidator_->capacity = opt.revalidate_queue ? opt.revalidate_queue : 1;
+    revalidator_->worker = std::thread([this] {
+      if (node_ >= 0) numa::bind_thread(static_cast<std::size_t>(node_));   // reloads land on our node
+      revalidate_loop();
+    });
+  }
+}
+
+LRUCache::~LRUCache() {
+  // The worker calls back into the tiers, so it goes before they do
+  if (revalidator_) {
+    {
+      std::lock_guard lock(revalidator_->mtx);
+      revalidator_->stop = true;
+    }
+    revalidator_->cv.notify_one();
+    revalidator_->worker.join();
+    revalidator_.reset();
+  }
+  while (oldest_) large_erase(oldest_);
+
+  // Take our share back out of the gauges
+  auto& m = Metrics::instance();
+  m.cache_small_capacity_bytes.fetch_sub(small_capacity_, std::memory_order_relaxed);
+  m.cache_large_capacity_bytes.fetch_sub(large_capacity_, std::memory_order_relaxed);
+  move_gauge(m.cache_small_bytes, small_pub_.bytes, 0);
+  move_gauge(m.cache_small_items, small_pub_.items, 0);
+  move_gauge(m.cache_small_overhead_bytes, small_pub_.overhead, 0);
+  move_gauge(m.cache_large_bytes, large_pub_.bytes, 0);
+  move_gauge(m.cache_large_items, large_pub_.items, 0);
+  move_gauge(m.cache_large_overhead_bytes, large_pub_.overhead, 0);
+  move_gauge(m.cache_pinned_bytes, pinned_pub_.bytes, 0);
+  move_gauge(m.cache_pinned_items, pinned_pub_.items, 0);
+  move_gauge(m.cache_pinned_overhead_bytes, pinned_pub_.overhead, 0);
 }
 
-void LRUCache::put(const std::string& key, const Entry& e) {
-  std::unique_lock lock(mtx_);
-  auto it = map_.find(key);
-  if (it != map_.end()) {
-    used_bytes_ -= it->second->value.size;
-    it->second->value = e;
-    used_bytes_ += e.size;
-    lru_.splice(lru_.begin(), lru_, it->second);
+std::size_t LRUCache::hash_key(std::string_view key) {
+  const std::size_t h = std::hash<std::string_view>{}(key);
+  return h ? h : 1;
+}
+
+ObjectPtr LRUCache::get(std::string_view key) {
+  auto& m = Metrics::instance();
+
+  if (!pinned_.empty()) {
+    auto it = pinned_.find(key);
+    if (it != pinned_.end()) {
+      ObjectPtr obj;
+      {
+        std::shared_lock lock(pinned_mtx_);
+        obj = it->second;
+      }
+      if (obj) {
+        m.cache_pinned_hits.fetch_add(1, std::memory_order_relaxed);
+        numa::record_hit(obj->node);
+        check_stale(key, obj);
+      }
+      return obj;
+    }
+  }
+
+  ObjectPtr obj;
+  {
+    std::shared_lock lock(small_mtx_);
+    const std::size_t i = small_find(hash_key(key), key);
+    if (i != slots_.size()) {
+      slots_[i].referenced.store(true, std::memory_order_relaxed);
+      slots_[i].hit.store(true, std::memory_order_relaxed);
+      m.cache_small_hits.fetch_add(1, std::memory_order_relaxed);
+      obj = slots_[i].value;
+    }
+  }
+
+  if (!obj) {
+    std::unique_lock lock(large_mtx_);
+    if (LargeEntry* e = large_find(hash_key(key), key)) {
+      large_touch(e);
+      e->hit = true;
+      m.cache_large_hits.fetch_add(1, std::memory_order_relaxed);
+      obj = e->value;
+    }
+  }
+
+  if (obj) {
+    numa::record_hit(obj->node);
+    check_stale(key, obj);
+    return obj;
+  }
+
+  // Promote from L2; the disk copy stays until its segment is dropped
+  if (l2_) {
+    if (auto obj = l2_->get(key)) {
+      put(key, obj);
+      return obj;
+    }
+  }
+  return nullptr;
+}
+
+void LRUCache::put(std::string_view key, ObjectPtr obj) {
+  const std::size_t size = obj->size();
+  if (revalidator_) obj->checked_ms.store(coarse_now_ms(), std::memory_order_relaxed);
+
+  if (!pinned_.empty()) {
+    auto it = pinned_.find(key);
+    if (it != pinned_.end()) {
+      std::unique_lock lock(pinned_mtx_);
+      if (it->second) {
+        pinned_bytes_ -= it->second->size();
+        pinned_overhead_ -= object_overhead(*it->second);
+      } else {
+        ++pinned_items_;
+      }
+      pinned_overhead_ += object_overhead(*obj);
+      it->second = std::move(obj);
+      pinned_bytes_ += size;
+      publish_pinned();
+      return;
+    }
+  }
+
+  // An object whose size moved it across the threshold must leave its old tier
+  Victims victims;
+  if (size <= small_max_object_) {
+    large_remove(key);
+    std::unique_lock lock(small_mtx_);
+    const std::size_t hash = hash_key(key);
+    const std::size_t i = small_find(hash, key);
+    if (i != slots_.size()) {
+      small_bytes_ -= slots_[i].value->size();
+      small_overhead_ -= object_overhead(*slots_[i].value);
+      small_overhead_ += object_overhead(*obj);
+      slots_[i].value = std::move(obj);
+      small_bytes_ += size;
+      slots_[i].referenced.store(true, std::memory_order_relaxed);
+    } else {
+      small_insert(hash, key, std::move(obj));
+    }
+    small_evict(victims);
+    publish_small();
   } else {
-    lru_.push_front(Node{key, e});
-    map_[key] = lru_.begin();
-    used_bytes_ += e.size;
+    small_remove(key);
+    std::unique_lock lock(large_mtx_);
+    const std::size_t hash = hash_key(key);
+    if (LargeEntry* e = large_find(hash, key)) {
+      const std::size_t entry = e->overhead - object_overhead(*e->value);
+      large_bytes_ -= e->value->size();
+      large_overhead_ -= e->overhead;
+      e->overhead = entry + object_overhead(*obj);
+      e->value = std::move(obj);
+      large_bytes_ += size;
+      large_overhead_ += e->overhead;
+      large_touch(e);
+    } else {
+      large_insert(hash, key, std::move(obj));
+    }
+    large_evict(victims);
+    publish_large();
   }
-  evict_if_needed();
+  demote(victims);
 }
 
-void LRUCache::evict_if_needed() {
-  while (used_bytes_ > capacity_bytes_ && !lru_.empty()) {
-    auto it = --lru_.end();
-    used_bytes_ -= it->value.size;
-    map_.erase(it->key);
-    lru_.erase(it);
+// ---- revalidation ----
+
+void LRUCache::check_stale(std::string_view key, const ObjectPtr& obj) {
+  if (!revalidator_) return;
+  Revalidator& r = *revalidator_;
+  if (coarse_now_ms() - obj->checked_ms.load(std::memory_order_relaxed) < r.after_ms) return;
+  if (obj->revalidating.exchange(true, std::memory_order_acq_rel)) return;   // already queued
+  {
+    std::lock_guard lock(r.mtx);
+    if (r.queue.size() < r.capacity) {
+      r.queue.emplace_back(std::string(key), obj);
+      r.cv.notify_one();
+      return;
+    }
   }
+  // Full: the next hit after the worker catches up tries again
+  obj->revalidating.store(false, std::memory_order_release);
+  Metrics::instance().cache_revalidations_dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+void LRUCache::revalidate_loop() {
+  Revalidator& r = *revalidator_;
+  auto& m = Metrics::instance();
+  for (;;) {
+    std::pair<std::string, ObjectPtr> item;
+    {
+      std::unique_lock lock(r.mtx);
+      r.cv.wait(lock, [&r] { return r.stop || !r.queue.empty(); });
+      if (r.stop) return;
+      item = std::move(r.queue.front());
+      r.queue.pop_front();
+    }
+    const auto& [key, old] = item;
+
+    ObjectPtr fresh = r.reload(key, old);
+    m.cache_revalidations.fetch_add(1, std::memory_order_relaxed);
+    // Only the version that was checked is replaced: a put() since then is newer,
+    // and an evicted key is not brought back
+    if (fresh == old) {
+      old->checked_ms.store(coarse_now_ms(), std::memory_order_relaxed);
+    } else if (peek(key) == old) {
+      if (fresh) {
+        put(key, std::move(fresh));
+        m.cache_revalidation_reloads.fetch_add(1, std::memory_order_relaxed);
+      } else {
+        erase(key);
+        m.cache_revalidation_removals.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+    old->revalidating.store(false, std::memory_order_release);
+  }
+}
+
+ObjectPtr LRUCache::peek(std::string_view key) const {
+  if (!pinned_.empty()) {
+    auto it = pinned_.find(key);
+    if (it != pinned_.end()) {
+      std::shared_lock lock(pinned_mtx_);
+      return it->second;
+    }
+  }
+  {
+    std::shared_lock lock(small_mtx_);
+    const std::size_t i = small_find(hash_key(key), key);
+    if (i != slots_.size()) return slots_[i].value;
+  }
+  std::shared_lock lock(large_mtx_);
+  const LargeEntry* e = large_find(hash_key(key), key);
+  return e ? e->value : nullptr;
+}
+
+void LRUCache::erase(std::string_view key) {
+  if (!pinned_.empty()) {
+    auto it = pinned_.find(key);
+    if (it != pinned_.end()) {
+      // The slot stays (the map never changes shape); an empty one is a miss
+      std::unique_lock lock(pinned_mtx_);
+      if (it->second) {
+        pinned_bytes_ -= it->second->size();
+        pinned_overhead_ -= object_overhead(*it->second);
+        --pinned_items_;
+        it->second = nullptr;
+        publish_pinned();
+      }
+      return;
+    }
+  }
+  if (!small_remove(key)) large_remove(key);
+}
+
+void LRUCache::demote(Victims& victims) {
+  if (!l2_) return;
+  for (auto& v : victims) l2_->demote(std::move(v.first), std::move(v.second));
+}
+
+// ---- small tier ----
+
+std::size_t LRUCache::small_find(std::size_t hash, std::string_view key) const {
+  const std::size_t mask = slots_.size() - 1;
+  for (std::size_t i = hash & mask;; i = (i + 1) & mask) {
+    const SmallSlot& s = slots_[i];
+    if (s.hash == 0) return slots_.size();
+    if (s.hash == hash && s.key == key) return i;
+  }
+}
+
+void LRUCache::small_insert(std::size_t hash, std::string_view key, ObjectPtr obj) {
+  // Keep the load factor under 0.7 so probe runs stay short
+  if ((small_items_ + 1) * 10 > slots_.size() * 7) small_grow();
+
+  const std::size_t mask = slots_.size() - 1;
+  std::size_t i = hash & mask;
+  while (slots_[i].hash != 0) i = (i + 1) & mask;
+
+  SmallSlot& s = slots_[i];
+  s.hash = hash;
+  s.key.assign(key.data(), key.size());
+  small_bytes_ += obj->size();
+  small_overhead_ += string_footprint(s.key) + object_overhead(*obj);
+  s.value = std::move(obj);
+  s.referenced.store(true, std::memory_order_relaxed);   // survives one sweep
+  s.hit.store(false, std::memory_order_relaxed);
+  ++small_items_;
+}
+
+// Backward-shift deletion: later members of the probe run move up so lookups never
+// need tombstones
+void LRUCache::small_erase(std::size_t index) {
+  const std::size_t mask = slots_.size() - 1;
+  small_bytes_ -= slots_[index].value->size();
+  small_overhead_ -= string_footprint(slots_[index].key) + object_overhead(*slots_[index].value);
+  --small_items_;
+
+  std::size_t hole = index;
+  for (std::size_t j = (hole + 1) & mask; slots_[j].hash != 0; j = (j + 1) & mask) {
+    const std::size_t home = slots_[j].hash & mask;
+    // Move j into the hole unless its home lies cyclically in (hole, j]
+    const bool stays = hole <= j ? (home > hole && home <= j) : (home > hole || home <= j);
+    if (!stays) {
+      slots_[hole] = std::move(slots_[j]);
+      hole = j;
+    }
+  }
+  SmallSlot& s = slots_[hole];
+  s.hash = 0;
+  s.key.clear();
+  s.value.reset();
+}
+
+void LRUCache::small_grow() {
+  std::vector<SmallSlot> old(slots_.size() * 2);
+  old.swap(slots_);
+  const std::size_t mask = slots_.size() - 1;
+  for (auto& s : old) {
+    if (s.hash == 0) continue;
+    std::size_t i = s.hash & mask;
+    while (slots_[i].hash != 0) i = (i + 1) & mask;
+    slots_[i] = std::move(s);
+  }
+  clock_hand_ = 0;
+}
+
+// CLOCK: sweep the table, clearing reference bits, and evict the first slot found
+// unreferenced. Erasing may shift the next slot into the hand's position, so the hand
+// only advances past slots it skipped.
+void LRUCache::small_evict(Victims& victims) {
+  const std::size_t mask = slots_.size() - 1;
+  while (small_bytes_ + small_overhead_ + small_table_bytes() > small_capacity_ && small_items_ > 0) {
+    SmallSlot& s = slots_[clock_hand_];
+    if (s.hash != 0 && !s.referenced.exchange(false, std::memory_order_relaxed)) {
+      if (l2_ && s.hit.load(std::memory_order_relaxed)) victims.emplace_back(s.key, s.value);
+      small_erase(clock_hand_);
+      Metrics::instance().cache_small_evictions.fetch_add(1, std::memory_order_relaxed);
+      continue;
+    }
+    clock_hand_ = (clock_hand_ + 1) & mask;
+  }
+}
+
+bool LRUCache::small_remove(std::string_view key) {
+  std::unique_lock lock(small_mtx_);
+  const std::size_t i = small_find(hash_key(key), key);
+  if (i == slots_.size()) return false;
+  small_erase(i);
+  publish_small();
+  return true;
+}
+
+// ---- large tier ----
+
+LRUCache::LargeEntry* LRUCache::large_find(std::size_t hash, std::string_view key) const {
+  for (LargeEntry* e = buckets_[hash & (buckets_.size() - 1)]; e; e = e->chain) {
+    if (e->hash == hash && e->key() == key) return e;
+  }
+  return nullptr;
+}
+
+void LRUCache::large_insert(std::size_t hash, std::string_view key, ObjectPtr obj) {
+  if (large_items_ + 1 > buckets_.size()) large_grow();
+
+  const std::size_t bytes = sizeof(LargeEntry) + key.size();
+  auto* e = new (::operator new(bytes)) LargeEntry;
+  std::memcpy(reinterpret_cast<char*>(e + 1), key.data(), key.size());
+  e->key_len = static_cast<uint32_t>(key.size());
+  e->hash = hash;
+  e->overhead = malloc_footprint(bytes) + object_overhead(*obj);
+  large_bytes_ += obj->size();
+  large_overhead_ += e->overhead;
+  e->value = std::move(obj);
+
+  LargeEntry*& head = buckets_[hash & (buckets_.size() - 1)];
+  e->chain = head;
+  head = e;
+  e->older = newest_;
+  if (newest_) newest_->newer = e;
+  newest_ = e;
+  if (!oldest_) oldest_ = e;
+  ++large_items_;
+}
+
+void LRUCache::large_erase(LargeEntry* e) {
+  LargeEntry** link = &buckets_[e->hash & (buckets_.size() - 1)];
+  while (*link != e) link = &(*link)->chain;
+  *link = e->chain;
+  (e->newer ? e->newer->older : oldest_) = e->older;
+  (e->older ? e->older->newer : newest_) = e->newer;
+  large_bytes_ -= e->value->size();
+  large_overhead_ -= e->overhead;
+  --large_items_;
+  e->~LargeEntry();
+  ::operator delete(e);
+}
+
+void LRUCache::large_touch(LargeEntry* e) {
+  if (e == newest_) return;
+  // Not the newest, so e->newer is set
+  e->newer->older = e->older;
+  (e->older ? e->older->newer : oldest_) = e->newer;
+  e->newer = nullptr;
+  e->older = newest_;
+  newest_->newer = e;
+  newest_ = e;
+}
+
+void LRUCache::large_grow() {
+  std::vector<LargeEntry*> old(buckets_.size() * 2, nullptr);
+  old.swap(buckets_);
+  const std::size_t mask = buckets_.size() - 1;
+  for (LargeEntry* head : old) {
+    while (head) {
+      LargeEntry* next = head->chain;
+      head->chain = buckets_[head->hash & mask];
+      buckets_[head->hash & mask] = head;
+      head = next;
+    }
+  }
+}
+
+void LRUCache::large_evict(Victims& victims) {
+  while (large_bytes_ + large_overhead_ + large_table_bytes() > large_capacity_ && oldest_) {
+    LargeEntry* e = oldest_;
+    if (l2_ && e->hit) victims.emplace_back(std::string(e->key()), e->value);
+    large_erase(e);
+    Metrics::instance().cache_large_evictions.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+bool LRUCache::large_remove(std::string_view key) {
+  std::unique_lock lock(large_mtx_);
+  LargeEntry* e = large_find(hash_key(key), key);
+  if (!e) return false;
+  large_erase(e);
+  publish_large();
+  return true;
+}
+
+std::vector<std::pair<std::string, ObjectPtr>> LRUCache::snapshot(std::size_t max_bytes) const {
+  std::vector<std::pair<std::string, ObjectPtr>> out;
+  std::size_t bytes = 0;
+  auto take = [&](std::string_view key, const ObjectPtr& obj) {
+    if (bytes + obj->size() > max_bytes) return;
+    bytes += obj->size();
+    out.emplace_back(std::string(key), obj);
+  };
+
+  std::vector<const SmallSlot*> cold;
+  std::shared_lock small_lock(small_mtx_);
+  for (const auto& s : slots_) {
+    if (s.hash == 0) continue;
+    if (s.referenced.load(std::memory_order_relaxed)) take(s.key, s.value);
+    else cold.push_back(&s);
+  }
+  {
+    std::shared_lock lock(large_mtx_);
+    for (const LargeEntry* e = newest_; e; e = e->older) take(e->key(), e->value);
+  }
+  for (const auto* s : cold) take(s->key, s->value);
+  return out;
+}
+
+// ---- stats ----
+
+void LRUCache::publish_small() const {
+  auto& m = Metrics::instance();
+  move_gauge(m.cache_small_bytes, small_pub_.bytes, small_bytes_);
+  move_gauge(m.cache_small_items, small_pub_.items, small_items_);
+  move_gauge(m.cache_small_overhead_bytes, small_pub_.overhead, small_overhead_ + small_table_bytes());
+}
+
+void LRUCache::publish_large() const {
+  auto& m = Metrics::instance();
+  move_gauge(m.cache_large_bytes, large_pub_.bytes, large_bytes_);
+  move_gauge(m.cache_large_items, large_pub_.items, large_items_);
+  move_gauge(m.cache_large_overhead_bytes, large_pub_.overhead, large_overhead_ + large_table_bytes());
+}
+
+void LRUCache::publish_pinned() const {
+  auto& m = Metrics::instance();
+  move_gauge(m.cache_pinned_bytes, pinned_pub_.bytes, pinned_bytes_);
+  move_gauge(m.cache_pinned_items, pinned_pub_.items, pinned_items_);
+  move_gauge(m.cache_pinned_overhead_bytes, pinned_pub_.overhead, pinned_overhead_);
 }
 
 std::size_t LRUCache::size_bytes() const {
-  std::shared_lock lock(mtx_);
-  return used_bytes_;
+  std::size_t total = 0;
+  { std::shared_lock lock(small_mtx_); total += small_bytes_; }
+  { std::shared_lock lock(large_mtx_); total += large_bytes_; }
+  { std::shared_lock lock(pinned_mtx_); total += pinned_bytes_; }
+  return total;
+}
+
+std::size_t LRUCache::overhead_bytes() const {
+  std::size_t total = 0;
+  { std::shared_lock lock(small_mtx_); total += small_overhead_ + small_table_bytes(); }
+  { std::shared_lock lock(large_mtx_); total += large_overhead_ + large_table_bytes(); }
+  { std::shared_lock lock(pinned_mtx_); total += pinned_overhead_; }
+  return total;
 }
 
 std::size_t LRUCache::items() const {
-  std::shared_lock lock(mtx_);
-  return map_.size();
-}
\ No newline at end of file
+  std::size_t total = 0;
+  { std::shared_lock lock(small_mtx_); total += small_items_; }
+  { std::shared_lock lock(large_mtx_); total += large_items_; }
+  { std::shared_lock lock(pinned_mtx_); total += pinned_items_; }
+  return total;
+}
@@ -0,0 +1,59 @@
+#include "../../headers/cache/negative_cache.hpp"
+#include "../../headers/util/metrics.hpp"
+#include "../../headers/util/time.hpp"
+
+#include <algorithm>
+#include <functional>
+
+NegativeCache::NegativeCache(int64_t ttl_ms, std::size_t max_entries)
+  : ttl_ms_(ttl_ms),
+    shard_max_(std::max<std::size_t>(1, max_entries / kShards)) {}
+
+NegativeCache::~NegativeCache() {
+  Metrics::instance().cache_negative_items.fetch_sub(items(), std::memory_order_relaxed);
+}
+
+int NegativeCache::find(std::string_view target) const {
+  const std::size_t hash = std::hash<std::string_view>{}(target);
+  Shard& s = shard_for(hash);
+  std::lock_guard<std::mutex> lk(s.mtx);
+  const auto it = s.map.find(hash);
+  if (it == s.map.end() || it->second.key != target || it->second.expires_ms <= coarse_now_ms()) return 0;
+  return it->second.status;
+}
+
+void NegativeCache::insert(std::string_view target, int status) {
+  const std::size_t hash = std::hash<std::string_view>{}(target);
+  const int64_t now = coarse_now_ms();
+  Shard& s = shard_for(hash);
+  std::size_t before, after;
+  {
+    std::lock_guard<std::mutex> lk(s.mtx);
+    before = s.map.size();
+    if (before >= shard_max_ && s.map.find(hash) == s.map.end()) {
+      for (auto it = s.map.begin(); it != s.map.end();) {
+        it = it->second.expires_ms <= now ? s.map.erase(it) : std::next(it);
+      }
+      // Every entry still live: a scan of distinct missing paths, which a fresh
+      // table serves as well as any eviction order would
+      if (s.map.size() >= shard_max_) s.map.clear();
+    }
+    Entry& e = s.map[hash];
+    e.key.assign(target.data(), target.size());
+    e.expires_ms = now + ttl_ms_;
+    e.status = status;
+    after = s.map.size();
+  }
+  auto& items = Metrics::instance().cache_negative_items;
+  if (after >= before) items.fetch_add(after - before, std::memory_order_relaxed);
+  else items.fetch_sub(before - after, std::memory_order_relaxed);
+}
+
+std::size_t NegativeCache::items() const {
+  std::size_t n = 0;
+  for (const auto& s : shards_) {
+    std::lock_guard<std::mutex> lk(s.mtx);
+    n += s.map.size();
+  }
+  return n;
+}
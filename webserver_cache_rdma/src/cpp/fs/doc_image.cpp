@@ -0,0 +1,309 @@
+#include "../../headers/fs/doc_image.hpp"
+#include "../../headers/fs/path_utils.hpp"
+#include "../../headers/util/time.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace doc_image {
+namespace {
+
+constexpr uint32_t kBucketSize = 4;     // average keys per bucket
+constexpr uint32_t kMaxSeed = 1u << 24;
+
+uint64_t align_up(uint64_t v, uint64_t a) {
+  return (v + a - 1) / a * a;
+}
+
+// Where a body of `size` bytes goes if the previous one ended at `at`
+uint64_t place_body(uint64_t at, uint64_t size) {
+  return align_up(at, size >= kBodyAlign ? kBodyAlign : kSmallBodyAlign);
+}
+
+// Assigns every path a slot of its own. Buckets are placed largest first, each with
+// the first seed that sends all of its keys to distinct free slots.
+void build_index(const std::vector<Input>& inputs, uint32_t bucket_count, uint32_t table_size,
+                 std::vector<uint32_t>& seeds, std::vector<uint32_t>& slots) {
+  std::vector<std::vector<uint32_t>> buckets(bucket_count);
+  for (uint32_t i = 0; i < inputs.size(); ++i)
+    buckets[hash(inputs[i].path, 0) % bucket_count].push_back(i);
+
+  std::vector<uint32_t> order(bucket_count);
+  for (uint32_t b = 0; b < bucket_count; ++b) order[b] = b;
+  std::stable_sort(order.begin(), order.end(),
+                   [&](uint32_t a, uint32_t b) { return buckets[a].size() > buckets[b].size(); });
+
+  seeds.assign(bucket_count, 0);
+  slots.assign(table_size, kNoEntry);
+  std::vector<uint32_t> pos;
+  for (const uint32_t b : order) {
+    const auto& keys = buckets[b];
+    if (keys.empty()) break;
+    uint32_t seed = 1;
+    for (;; ++seed) {
+      if (seed == kMaxSeed) throw std::runtime_error("doc_image: no seed places bucket of " + inputs[keys[0]].path);
+      pos.clear();
+      bool ok = true;
+      for (const uint32_t k : keys) {
+        const uint32_t p = hash(inputs[k].path, seed) % table_size;
+        if (slots[p] != kNoEntry || std::find(pos.begin(), pos.end(), p) != pos.end()) {
+          ok = false;
+          break;
+        }
+        pos.push_back(p);
+      }
+      if (ok) break;
+    }
+    seeds[b] = seed;
+    for (std::size_t i = 0; i < keys.size(); ++i) slots[pos[i]] = keys[i];
+  }
+}
+
+void write_padding(std::ofstream& out, uint64_t& at, uint64_t to) {
+  static const char zeros[kBodyAlign] = {};
+  while (at < to) {
+    const auto n = std::min<uint64_t>(to - at, sizeof(zeros));
+    out.write(zeros, static_cast<std::streamsize>(n));
+    at += n;
+  }
+}
+
+} // namespace
+
+void write(const std::string& out_path, std::vector<Input> inputs) {
+  std::sort(inputs.begin(), inputs.end(), [](const Input& a, const Input& b) { return a.path < b.path; });
+  for (std::size_t i = 0; i < inputs.size(); ++i) {
+    const auto& in = inputs[i];
+    if (i > 0 && inputs[i - 1].path == in.path) throw std::runtime_error("doc_image: duplicate path " + in.path);
+    if (in.path.size() > 0xffff || in.mime.size() > 0xffff || in.etag.size() > 0xffff)
+      throw std::runtime_error("doc_image: path, MIME type or ETag too long: " + in.path.substr(0, 256));
+  }
+
+  const auto count = static_cast<uint32_t>(inputs.size());
+  const uint32_t bucket_count = std::max<uint32_t>(1, (count + kBucketSize - 1) / kBucketSize);
+  const uint32_t table_size = std::max<uint32_t>(1, count + count / 4);
+  std::vector<uint32_t> seeds, slots;
+  build_index(inputs, bucket_count, table_size, seeds, slots);
+
+  Header h{};
+  std::memcpy(h.magic, kMagic, sizeof(kMagic));
+  h.version = kVersion;
+  h.count = count;
+  h.bucket_count = bucket_count;
+  h.table_size = table_size;
+  h.seeds_offset = sizeof(Header);
+  h.slots_offset = h.seeds_offset + uint64_t{bucket_count} * sizeof(uint32_t);
+  h.entries_offset = align_up(h.slots_offset + uint64_t{table_size} * sizeof(uint32_t), alignof(Entry));
+
+  std::vector<Entry> entries(count);
+  std::string strings;
+  const uint64_t strings_offset = h.entries_offset + uint64_t{count} * sizeof(Entry);
+  for (uint32_t i = 0; i < count; ++i) {
+    const auto& in = inputs[i];
+    auto& e = entries[i];
+    e.strings_offset = strings_offset + strings.size();
+    e.path_len = static_cast<uint16_t>(in.path.size());
+    e.mime_len = static_cast<uint16_t>(in.mime.size());
+    e.etag_len = static_cast<uint16_t>(in.etag.size());
+    e.last_modified = static_cast<int64_t>(in.last_modified);
+    strings += in.path;
+    strings += in.mime;
+    strings += in.etag;
+  }
+
+  uint64_t at = align_up(strings_offset + strings.size(), kBodyAlign);
+  for (uint32_t i = 0; i < count; ++i) {
+    auto& e = entries[i];
+    e.body_size = inputs[i].body.size();
+    e.body_offset = place_body(at, e.body_size);
+    at = e.body_offset + e.body_size;
+    e.gzip_size = inputs[i].gzip.size();
+    e.gzip_offset = e.gzip_size ? place_body(at, e.gzip_size) : at;
+    at = e.gzip_offset + e.gzip_size;
+  }
+  h.file_size = align_up(at, kBodyAlign);
+
+  const std::string tmp = out_path + ".tmp";
+  std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+  if (!out) throw std::runtime_error("doc_image: cannot create " + tmp + ": " + std::strerror(errno));
+  uint64_t written = 0;
+  auto put = [&](const void* p, std::size_t n) {
+    out.write(static_cast<const char*>(p), static_cast<std::streamsize>(n));
+    written += n;
+  };
+  put(&h, sizeof(h));
+  put(seeds.data(), seeds.size() * sizeof(uint32_t));
+  put(slots.data(), slots.size() * sizeof(uint32_t));
+  write_padding(out, written, h.entries_offset);
+  put(entries.data(), entries.size() * sizeof(Entry));
+  put(strings.data(), strings.size());
+  for (uint32_t i = 0; i < count; ++i) {
+    write_padding(out, written, entries[i].body_offset);
+    put(inputs[i].body.data(), inputs[i].body.size());
+    if (entries[i].gzip_size) {
+      write_padding(out, written, entries[i].gzip_offset);
+      put(inputs[i].gzip.data(), inputs[i].gzip.size());
+    }
+  }
+  write_padding(out, written, h.file_size);
+  out.close();
+  if (!out) {
+    std::remove(tmp.c_str());
+    throw std::runtime_error("doc_image: write to " + tmp + " failed");
+  }
+  if (std::rename(tmp.c_str(), out_path.c_str()) != 0) {
+    const std::string err = std::strerror(errno);
+    std::remove(tmp.c_str());
+    throw std::runtime_error("doc_image: cannot rename " + tmp + ": " + err);
+  }
+}
+
+} // namespace doc_image
+
+std::shared_ptr<DocImage> DocImage::open(const std::string& path) {
+  using namespace doc_image;
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) throw std::runtime_error("image: cannot open " + path + ": " + std::strerror(errno));
+  struct stat st{};
+  if (::fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(Header)) {
+    ::close(fd);
+    throw std::runtime_error("image: " + path + " is too small");
+  }
+
+  std::shared_ptr<DocImage> img(new DocImage());
+  img->size_ = static_cast<std::size_t>(st.st_size);
+  img->map_ = ::mmap(nullptr, img->size_, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (img->map_ == MAP_FAILED) {
+    img->map_ = nullptr;
+    throw std::runtime_error("image: cannot map " + path + ": " + std::strerror(errno));
+  }
+  img->base_ = static_cast<const uint8_t*>(img->map_);
+
+  const auto bad = [&path](const char* why) { return std::runtime_error("image: " + path + ": " + why); };
+  const auto& h = *reinterpret_cast<const Header*>(img->base_);
+  const uint64_t size = img->size_;
+  // Offsets come from the file: `off + len` could wrap, so the length is compared
+  // with what is left after the offset
+  const auto fits = [size](uint64_t off, uint64_t len) { return off <= size && len <= size - off; };
+  if (std::memcmp(h.magic, kMagic, sizeof(kMagic)) != 0) throw bad("not a docpack image");
+  if (h.version != kVersion) throw bad("unsupported version");
+  if (h.file_size != size) throw bad("truncated");
+  if (h.bucket_count == 0 || h.table_size < h.count ||
+      !fits(h.seeds_offset, uint64_t{h.bucket_count} * 4) || h.seeds_offset % 4 ||
+      !fits(h.slots_offset, uint64_t{h.table_size} * 4) || h.slots_offset % 4 ||
+      !fits(h.entries_offset, uint64_t{h.count} * sizeof(Entry)) || h.entries_offset % alignof(Entry))
+    throw bad("index out of bounds");
+
+  img->count_ = h.count;
+  img->bucket_count_ = h.bucket_count;
+  img->table_size_ = h.table_size;
+  img->seeds_ = reinterpret_cast<const uint32_t*>(img->base_ + h.seeds_offset);
+  img->slots_ = reinterpret_cast<const uint32_t*>(img->base_ + h.slots_offset);
+  img->entries_ = reinterpret_cast<const Entry*>(img->base_ + h.entries_offset);
+
+  for (uint32_t i = 0; i < h.table_size; ++i)
+    if (img->slots_[i] != kNoEntry && img->slots_[i] >= h.count) throw bad("slot out of bounds");
+  for (uint32_t i = 0; i < h.count; ++i) {
+    const auto& e = img->entries_[i];
+    const uint64_t strings = uint64_t{e.path_len} + e.mime_len + e.etag_len;
+    if (!fits(e.strings_offset, strings) || !fits(e.body_offset, e.body_size) || !fits(e.gzip_offset, e.gzip_size))
+      throw bad("entry out of bounds");
+  }
+
+  img->objects_ = std::make_unique<std::atomic<const CachedObject*>[]>(std::size_t{h.count} * 2);
+  return img;
+}
+
+DocImage::~DocImage() {
+  if (objects_) {
+    for (std::size_t i = 0; i < std::size_t{count_} * 2; ++i) delete objects_[i].load(std::memory_order_relaxed);
+  }
+  if (map_) ::munmap(map_, size_);
+}
+
+ObjectPtr DocImage::find(std::string_view key, bool gzip) const {
+  if (count_ == 0) return {};
+  const uint32_t seed = seeds_[doc_image::hash(key, 0) % bucket_count_];
+  const uint32_t index = slots_[doc_image::hash(key, seed) % table_size_];
+  if (index == doc_image::kNoEntry) return {};
+  const auto& e = entries_[index];
+  if (key != std::string_view(reinterpret_cast<const char*>(base_ + e.strings_offset), e.path_len)) return {};
+  return ObjectPtr(shared_from_this(), object(index, gzip && e.gzip_size > 0));
+}
+
+ObjectPtr DocImage::find_target(const std::string& target, bool gzip) const {
+  if (const auto key = direct_cache_key(target); !key.empty()) return find(key, gzip);
+  return find(url_cache_key(target), gzip);
+}
+
+// Objects are built on first use so opening an image does no per-file work; two
+// threads racing on the same entry both build one and the loser discards its copy
+const CachedObject* DocImage::object(uint32_t index, bool gzip) const {
+  auto& slot = objects_[std::size_t{index} * 2 + (gzip ? 1 : 0)];
+  if (const CachedObject* obj = slot.load(std::memory_order_acquire)) return obj;
+
+  const auto& e = entries_[index];
+  const char* strings = reinterpret_cast<const char*>(base_ + e.strings_offset);
+  auto* obj = new CachedObject();
+  obj->body = base_ + (gzip ? e.gzip_offset : e.body_offset);
+  obj->body_size = static_cast<std::size_t>(gzip ? e.gzip_size : e.body_size);
+  obj->last_modified = static_cast<std::time_t>(e.last_modified);
+  obj->mime = std::string_view(strings + e.path_len, e.mime_len);
+  obj->etag.assign(strings + e.path_len + e.mime_len, e.etag_len);
+  // The compressed representation needs a validator of its own
+  if (gzip) obj->etag.insert(obj->etag.empty() || obj->etag.back() != '"' ? obj->etag.size() : obj->etag.size() - 1, "-gz");
+  obj->encoding = gzip ? "gzip" : "";
+  obj->vary = e.gzip_size > 0;
+  render_object_headers(*obj);
+
+  const CachedObject* expected = nullptr;
+  if (!slot.compare_exchange_strong(expected, obj, std::memory_order_acq_rel, std::memory_order_acquire)) {
+    delete obj;
+    return expected;
+  }
+  return obj;
+}
+
+bool accepts_gzip(std::string_view accept_encoding) {
+  bool star = false;
+  std::size_t i = 0;
+  while (i < accept_encoding.size()) {
+    auto end = accept_encoding.find(',', i);
+    if (end == std::string_view::npos) end = accept_encoding.size();
+    auto item = accept_encoding.substr(i, end - i);
+    i = end + 1;
+
+    const auto semi = item.find(';');
+    auto name = item.substr(0, semi);
+    while (!name.empty() && (name.front() == ' ' || name.front() == '\t')) name.remove_prefix(1);
+    while (!name.empty() && (name.back() == ' ' || name.back() == '\t')) name.remove_suffix(1);
+
+    // q=0, q=0.0, q=0.00 ... refuse the coding
+    bool refused = false;
+    if (semi != std::string_view::npos) {
+      auto params = item.substr(semi + 1);
+      const auto q = params.find("q=");
+      if (q != std::string_view::npos) {
+        auto v = params.substr(q + 2);
+        v = v.substr(0, v.find_first_of(" \t;"));
+        refused = !v.empty() && v[0] == '0' && v.find_first_not_of("0.") == std::string_view::npos;
+      }
+    }
+
+    if (name.size() == 4 && (name[0] | 0x20) == 'g' && (name[1] | 0x20) == 'z' && (name[2] | 0x20) == 'i' &&
+        (name[3] | 0x20) == 'p')
+      return !refused;
+    if (name == "*") star = !refused;
+  }
+  return star;
+}
@@ -1,36 +1,54 @@
 #include "../../headers/fs/file_reader.hpp"
-#include <filesystem>
-#include <fstream>
-
-namespace fs = std::filesystem;
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
+// Size, mtime and bytes all come from the one open descriptor, so a file replaced
+// meanwhile is reported as the version that was read. The mtime is st_mtime: Unix
+// seconds, as Last-Modified and the ETag expect.
 FileReadResult read_file(const std::string& path) {
   FileReadResult r;
 
-  try {
-    fs::path p(path);
-    if (!fs::exists(p) || !fs::is_regular_file(p)) {
-      r.ok = false; r.error = "File not found";
-      return r;
-    }
-    auto fsize = fs::file_size(p);
-    r.data.resize(static_cast<std::size_t>(fsize));
-
-    std::ifstream ifs(path, std::ios::binary);
-    if (!ifs) { r.ok = false; r.error = "Open failed"; return r; }
-    if (!r.data.empty()) {
-      ifs.read(reinterpret_cast<char*>(r.data.data()), static_cast<std::streamsize>(r.data.size()));
-      if (!ifs) { r.ok = false; r.error = "Read failed"; return r; }
-    }
-
-    auto ftime = fs::last_write_time(p).time_since_epoch();
-    auto secs = std::chrono::duration_cast<std::chrono::seconds>(ftime).count();
-    r.last_modified = static_cast<std::time_t>(secs);
-
-    r.ok = true;
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    r.error = errno == ENOENT || errno == ENOTDIR ? "File not found" : "Open failed";
     return r;
-  } catch (const std::exception& ex) {
-    r.ok = false; r.error = ex.what();
+  }
+  struct stat st {};
+  if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+    ::close(fd);
+    r.error = "File not found";
     return r;
   }
-}
\ No newline at end of file
+
+  r.data.resize(static_cast<std::size_t>(st.st_size));
+  std::size_t done = 0;
+  while (done < r.data.size()) {
+    const ssize_t n = ::read(fd, r.data.data() + done, r.data.size() - done);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) break;
+    done += static_cast<std::size_t>(n);
+  }
+  ::close(fd);
+  if (done != r.data.size()) {
+    r.data.clear();
+    r.error = "Read failed";
+    return r;
+  }
+
+  r.last_modified = st.st_mtime;
+  r.ok = true;
+  return r;
+}
+
+FileStat stat_file(const std::string& path) {
+  FileStat s;
+  struct stat st {};
+  if (::stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) return s;
+  s.ok = true;
+  s.size = static_cast<std::size_t>(st.st_size);
+  s.last_modified = st.st_mtime;
+  return s;
+}
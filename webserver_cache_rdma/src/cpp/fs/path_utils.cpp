@@ -49,7 +49,7 @@ PathMapResult map_url_to_fs(const std::string& doc_root, const std::string& url_
 
     auto canon_root = root;
     if (canon.string().compare(0, canon_root.string().size(), canon_root.string()) != 0) {
-      r.ok = false; r.exists = false; r.error = "Path traversal"; return r;
+      r.ok = false; r.exists = false; r.outside_root = true; r.error = "Path traversal"; return r;
     }
 
     r.ok = true;
@@ -62,4 +62,23 @@ PathMapResult map_url_to_fs(const std::string& doc_root, const std::string& url_
     r.ok = false; r.exists = false; r.error = ex.what();
     return r;
   }
-}
\ No newline at end of file
+}
+
+std::string_view direct_cache_key(std::string_view url_path) {
+  if (url_path.size() < 2 || url_path[0] != '/' || url_path.back() == '/') return {};
+  std::size_t seg = 1;
+  for (std::size_t i = 1; i <= url_path.size(); ++i) {
+    const char c = i < url_path.size() ? url_path[i] : '/';
+    if (c == '?' || c == '#') return {};
+    if (c != '/') continue;
+    const auto part = url_path.substr(seg, i - seg);
+    if (part.empty() || part == "." || part == "..") return {};
+    seg = i + 1;
+  }
+  return url_path;
+}
+
+std::string url_cache_key(const std::string& url_path) {
+  auto key = sanitize(url_path);
+  return key == "/" ? "/index.html" : key;
+}
@@ -0,0 +1,299 @@
+#include "../headers/handoff.hpp"
+#include "../headers/server.hpp"
+#include "../headers/util/logging.hpp"
+
+#include <cerrno>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include <spawn.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+extern char** environ;
+
+namespace handoff {
+namespace {
+
+// Wire format on the Unix socket (host byte order; both ends are the same binary
+// family on the same host):
+//   successor -> predecessor  'H' u32 version
+//   predecessor -> successor  'L' + SCM_RIGHTS(HTTP listening socket [, TLS listening socket])
+//                             'C' u32 key_len, u32 etag_len, u64 size, i64 mtime, key, etag, body  (repeated,
+//                                 coldest first, so the successor's inserts leave the hottest newest)
+//                             'E'
+//   successor -> predecessor  'R'   (accepting on the inherited socket)
+constexpr uint32_t kVersion = 1;
+constexpr uint8_t kHello = 'H';
+constexpr uint8_t kListener = 'L';
+constexpr uint8_t kObject = 'C';
+constexpr uint8_t kEnd = 'E';
+constexpr uint8_t kReady = 'R';
+
+constexpr int kIoTimeoutSec = 30;
+
+#pragma pack(push, 1)
+struct ObjectHeader {
+  uint32_t key_len;
+  uint32_t etag_len;
+  uint64_t size;
+  int64_t last_modified;
+};
+#pragma pack(pop)
+
+bool write_all(int fd, const void* p, std::size_t n) {
+  auto* c = static_cast<const char*>(p);
+  while (n) {
+    const ssize_t w = ::send(fd, c, n, MSG_NOSIGNAL);
+    if (w < 0 && errno == EINTR) continue;
+    if (w <= 0) return false;
+    c += w;
+    n -= static_cast<std::size_t>(w);
+  }
+  return true;
+}
+
+bool read_all(int fd, void* p, std::size_t n) {
+  auto* c = static_cast<char*>(p);
+  while (n) {
+    const ssize_t r = ::recv(fd, c, n, 0);
+    if (r < 0 && errno == EINTR) continue;
+    if (r <= 0) return false;
+    c += r;
+    n -= static_cast<std::size_t>(r);
+  }
+  return true;
+}
+
+void set_timeouts(int fd) {
+  timeval tv{};
+  tv.tv_sec = kIoTimeoutSec;
+  ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
+constexpr std::size_t kMaxListeners = 2;
+
+bool send_listeners(int sock, const int* fds, std::size_t count) {
+  uint8_t tag = kListener;
+  iovec iov{&tag, 1};
+  alignas(cmsghdr) char ctrl[CMSG_SPACE(sizeof(int) * kMaxListeners)]{};
+  msghdr msg{};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = ctrl;
+  msg.msg_controllen = CMSG_SPACE(sizeof(int) * count);
+  cmsghdr* cm = CMSG_FIRSTHDR(&msg);
+  cm->cmsg_level = SOL_SOCKET;
+  cm->cmsg_type = SCM_RIGHTS;
+  cm->cmsg_len = CMSG_LEN(sizeof(int) * count);
+  std::memcpy(CMSG_DATA(cm), fds, sizeof(int) * count);
+  return ::sendmsg(sock, &msg, MSG_NOSIGNAL) == 1;
+}
+
+// Fills `fds` (unused entries stay -1); false if the message is not a listener handoff
+bool recv_listeners(int sock, int (&fds)[kMaxListeners]) {
+  uint8_t tag = 0;
+  iovec iov{&tag, 1};
+  alignas(cmsghdr) char ctrl[CMSG_SPACE(sizeof(int) * kMaxListeners)]{};
+  msghdr msg{};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = ctrl;
+  msg.msg_controllen = sizeof(ctrl);
+  if (::recvmsg(sock, &msg, MSG_CMSG_CLOEXEC) != 1 || tag != kListener) return false;
+  cmsghdr* cm = CMSG_FIRSTHDR(&msg);
+  if (!cm || cm->cmsg_type != SCM_RIGHTS || cm->cmsg_len < CMSG_LEN(sizeof(int))) return false;
+  const std::size_t count = (cm->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+  std::memcpy(fds, CMSG_DATA(cm), sizeof(int) * std::min(count, kMaxListeners));
+  return true;
+}
+
+bool fill_addr(const std::string& path, sockaddr_un& addr) {
+  addr = sockaddr_un{};
+  addr.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(addr.sun_path)) return false;
+  std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+  return true;
+}
+
+} // namespace
+
+Inherited inherit(const std::string& path, LRUCache& cache) {
+  Inherited in;
+  sockaddr_un addr;
+  if (!fill_addr(path, addr)) throw std::runtime_error("handoff: path too long: " + path);
+
+  const int sock = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (sock < 0) throw std::runtime_error(std::string("handoff: socket: ") + std::strerror(errno));
+  if (::connect(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+    ::close(sock);   // nobody to take over from
+    return in;
+  }
+  set_timeouts(sock);
+
+  auto fail = [&](const char* what) {
+    if (in.listen_fd >= 0) ::close(in.listen_fd);
+    if (in.tls_listen_fd >= 0) ::close(in.tls_listen_fd);
+    ::close(sock);
+    return std::runtime_error(std::string("handoff: ") + what);
+  };
+
+  uint8_t hello[1 + sizeof(uint32_t)] = {kHello};
+  std::memcpy(hello + 1, &kVersion, sizeof(kVersion));
+  if (!write_all(sock, hello, sizeof(hello))) throw fail("hello not sent");
+
+  int fds[kMaxListeners] = {-1, -1};
+  const bool got = recv_listeners(sock, fds);
+  in.listen_fd = fds[0];
+  in.tls_listen_fd = fds[1];
+  if (!got || in.listen_fd < 0) throw fail("no listening socket received");
+
+  for (;;) {
+    uint8_t tag = 0;
+    if (!read_all(sock, &tag, 1)) throw fail("cache stream cut off");
+    if (tag == kEnd) break;
+    if (tag != kObject) throw fail("unexpected message in cache stream");
+
+    ObjectHeader oh;
+    if (!read_all(sock, &oh, sizeof(oh))) throw fail("cache stream cut off");
+    std::string key(oh.key_len, '\0');
+    std::string etag(oh.etag_len, '\0');
+    std::vector<uint8_t> body(static_cast<std::size_t>(oh.size));
+    if (!read_all(sock, key.data(), key.size()) || !read_all(sock, etag.data(), etag.size()) ||
+        !read_all(sock, body.data(), body.size())) {
+      throw fail("cache stream cut off");
+    }
+    in.bytes += body.size();
+    ++in.objects;
+    cache.put(key, make_cached_object(std::move(body), static_cast<std::time_t>(oh.last_modified), key,
+                                      std::move(etag)));
+  }
+
+  in.channel = sock;
+  return in;
+}
+
+void ready(Inherited& inherited) {
+  if (inherited.channel < 0) return;
+  const uint8_t tag = kReady;
+  if (!write_all(inherited.channel, &tag, 1)) log_warn("handoff: could not signal ready to the old process");
+  ::close(inherited.channel);
+  inherited.channel = -1;
+}
+
+bool spawn_successor(char** argv) {
+  // Only stdio is passed on: an inherited client socket would stay open in the
+  // successor after we close it, and the listener comes over the handoff socket
+  posix_spawn_file_actions_t actions;
+  ::posix_spawn_file_actions_init(&actions);
+  ::posix_spawn_file_actions_addclosefrom_np(&actions, 3);
+  pid_t pid = 0;
+  const int rc = ::posix_spawnp(&pid, argv[0], &actions, nullptr, argv, environ);
+  ::posix_spawn_file_actions_destroy(&actions);
+  if (rc != 0) {
+    log_warn("handoff: could not start {}: {}", argv[0], std::strerror(rc));
+    return false;
+  }
+  log_info("handoff: started successor pid {}", pid);
+  return true;
+}
+
+Listener::Listener(boost::asio::io_context& ioc, Server& server, std::string path,
+                   std::size_t cache_bytes, std::chrono::milliseconds drain_timeout)
+  : ioc_(ioc),
+    server_(server),
+    path_(std::move(path)),
+    cache_bytes_(cache_bytes),
+    drain_timeout_(drain_timeout),
+    acceptor_(ioc) {}
+
+Listener::~Listener() {
+  boost::system::error_code ig;
+  acceptor_.close(ig);
+  if (worker_.joinable()) worker_.join();
+}
+
+void Listener::start() {
+  // A predecessor's socket file is stale once we run; take the path over
+  ::unlink(path_.c_str());
+  boost::asio::local::stream_protocol::endpoint ep(path_);
+  acceptor_.open(ep.protocol());
+  acceptor_.bind(ep);
+  acceptor_.listen(1);
+  log_info("handoff: successors can take over via {}", path_);
+  do_accept();
+}
+
+void Listener::do_accept() {
+  acceptor_.async_accept([this](boost::system::error_code ec, boost::asio::local::stream_protocol::socket s) {
+    if (ec == boost::asio::error::operation_aborted) return;
+    if (!ec) {
+      if (busy_.exchange(true)) {
+        log_warn("handoff: already handing over; rejecting another successor");
+      } else {
+        if (worker_.joinable()) worker_.join();
+        boost::system::error_code ig;
+        const int fd = s.release(ig);
+        worker_ = std::thread([this, fd] { serve(fd); });
+      }
+    }
+    do_accept();
+  });
+}
+
+// Runs on its own thread: the cache stream can be large and the socket is blocking
+void Listener::serve(int fd) {
+  set_timeouts(fd);
+  bool handed_over = false;
+
+  uint8_t hello[1 + sizeof(uint32_t)];
+  uint32_t version = 0;
+  if (read_all(fd, hello, sizeof(hello)) && hello[0] == kHello) std::memcpy(&version, hello + 1, sizeof(version));
+
+  if (version != kVersion) {
+    log_warn("handoff: successor speaks version {}, expected {}", version, kVersion);
+  } else if (const int fds[] = {server_.listen_handle(), server_.tls_listen_handle()};
+             !send_listeners(fd, fds, fds[1] >= 0 ? 2 : 1)) {
+    log_warn("handoff: could not pass the listening socket: {}", std::strerror(errno));
+  } else {
+    std::size_t objects = 0, bytes = 0;
+    bool ok = true;
+    const auto hot = server_.cache()->snapshot(cache_bytes_);
+    for (auto it = hot.rbegin(); it != hot.rend(); ++it) {
+      const auto& [key, obj] = *it;
+      const uint8_t tag = kObject;
+      ObjectHeader oh{static_cast<uint32_t>(key.size()), static_cast<uint32_t>(obj->etag.size()),
+                      static_cast<uint64_t>(obj->size()), static_cast<int64_t>(obj->last_modified)};
+      ok = write_all(fd, &tag, 1) && write_all(fd, &oh, sizeof(oh)) && write_all(fd, key.data(), key.size()) &&
+           write_all(fd, obj->etag.data(), obj->etag.size()) && write_all(fd, obj->data(), obj->size());
+      if (!ok) break;
+      ++objects;
+      bytes += obj->size();
+    }
+    const uint8_t end = kEnd;
+    uint8_t reply = 0;
+    if (ok && write_all(fd, &end, 1) && read_all(fd, &reply, 1) && reply == kReady) {
+      log_info("handoff: successor is accepting ({} cached objects, {} bytes sent); draining", objects, bytes);
+      handed_over = true;
+    } else {
+      log_warn("handoff: successor went away before taking over; still serving");
+    }
+  }
+  ::close(fd);
+
+  if (handed_over) {
+    boost::asio::post(ioc_, [this] {
+      boost::system::error_code ig;
+      acceptor_.close(ig);
+      server_.drain(drain_timeout_, [this] { ioc_.stop(); });
+    });
+  } else {
+    busy_ = false;
+  }
+}
+
+} // namespace handoff
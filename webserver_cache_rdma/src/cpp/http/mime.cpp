@@ -1,34 +1,31 @@
 #include "../../headers/http/mime.hpp"
-#include <string>
-#include <unordered_map>
-
-static std::string ext_of(const std::string& path) {
-  auto pos = path.find_last_of('.');
-  if (pos == std::string::npos) return {};
-  std::string ext = path.substr(pos + 1);
-  for (auto& c : ext) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
-  return ext;
-}
+#include "../../headers/util/perfect_hash.hpp"
+
+#include <array>
+
+namespace {
+
+constexpr std::array<std::string_view, 14> kExtensions = {
+  "html", "htm", "css", "js", "json", "png", "jpg",
+  "jpeg", "gif", "svg", "txt", "xml", "pdf", "wasm"
+};
+
+constexpr std::array<std::string_view, 14> kTypes = {
+  "text/html; charset=utf-8", "text/html; charset=utf-8", "text/css", "application/javascript",
+  "application/json", "image/png", "image/jpeg", "image/jpeg", "image/gif", "image/svg+xml",
+  "text/plain; charset=utf-8", "application/xml", "application/pdf", "application/wasm"
+};
 
-std::string mime_type(const std::string& path) {
-  static const std::unordered_map<std::string, std::string> m = {
-    {"html","text/html; charset=utf-8"},
-    {"htm","text/html; charset=utf-8"},
-    {"css","text/css"},
-    {"js","application/javascript"},
-    {"json","application/json"},
-    {"png","image/png"},
-    {"jpg","image/jpeg"},
-    {"jpeg","image/jpeg"},
-    {"gif","image/gif"},
-    {"svg","image/svg+xml"},
-    {"txt","text/plain; charset=utf-8"},
-    {"xml","application/xml"},
-    {"pdf","application/pdf"},
-    {"wasm","application/wasm"}
-  };
-  auto ext = ext_of(path);
-  auto it = m.find(ext);
-  if (it != m.end()) return it->second;
-  return "application/octet-stream";
-}
\ No newline at end of file
+constexpr auto kTable = make_perfect_hash<32>(kExtensions);
+static_assert(kTable.seed != 0, "no perfect hash seed for the MIME extensions");
+
+constexpr std::string_view kDefaultType = "application/octet-stream";
+
+} // namespace
+
+std::string_view mime_type(std::string_view path) {
+  const auto pos = path.find_last_of('.');
+  if (pos == std::string_view::npos) return kDefaultType;
+  const int i = kTable.find(kExtensions, path.substr(pos + 1));
+  return i < 0 ? kDefaultType : kTypes[static_cast<std::size_t>(i)];
+}
@@ -1,95 +1,87 @@
 #include "../../headers/http/parser.hpp"
 #include "../../headers/http/headers.hpp"
-#include <cctype>
 #include <algorithm>
-
-void HttpParser::reset() {
-  buf_.clear();
-}
-
-ParseResult HttpParser::parse(const char *data, std::size_t n) {
-  buf_.append(data, n);
-
-  if (buf_.size() > (max_start_line_ + max_headers_bytes_ + 4)) {
-    return {ParseState::BadRequest, {}};
-  }
-
-  HttpRequest req;
-  if (!try_parse(req)) {
-    if (buf_.size() > (max_start_line_ + max_headers_bytes_ + 4)) {
-      return {ParseState::BadRequest, {}};
-    }
+#include <cctype>
+#include <string>
+#include <unordered_map>
+
+ParseResult HttpParser::parse(const char* data, std::size_t n, std::size_t& consumed) {
+  consumed = 0;
+  const std::string_view in(data, std::min(n, max_head_bytes()));
+
+  // Empty lines before a request line are ignored (RFC 9112 section 2.2)
+  std::size_t lead = 0;
+  while (in.substr(lead, 2) == "\r\n") lead += 2;
+
+  // Only the last three bytes already searched can start the terminator
+  const auto end = in.find("\r\n\r\n", std::max(lead, scanned_ > 3 ? scanned_ - 3 : 0));
+  if (end == std::string_view::npos) {
+    scanned_ = in.size();
+    if (n >= max_head_bytes()) return {ParseState::BadRequest, {}};
     return {ParseState::Incomplete, {}};
   }
-  return {ParseState::Done, req};
+  scanned_ = 0;
+  consumed = end + 4;
+
+  ParseResult res{ParseState::Done, {}};
+  if (!parse_head(in.substr(lead, end - lead), res.request)) res.state = ParseState::BadRequest;
+  return res;
 }
 
 static bool is_token_char(char c) {
-  static const std::string tspecials = "()<>@,;:\\\"/[]?={} \t";
-  return c > 31 && c < 127 && tspecials.find(c) == std::string::npos;
+  static constexpr std::string_view tspecials = "()<>@,;:\\\"/[]?={} \t";
+  return c > 31 && c < 127 && tspecials.find(c) == std::string_view::npos;
 }
 
-bool HttpParser::try_parse(HttpRequest &out) {
-  auto pos = buf_.find("\r\n\r\n");
-  if (pos == std::string::npos) return false;
-
-  std::string head = buf_.substr(0, pos);
-  buf_.erase(0, pos + 4);
-
-  std::vector<std::string> lines;
-  std::size_t start = 0;
-  while (true) {
-    auto e = head.find("\r\n", start);
-    if (e == std::string::npos) {
-      lines.push_back(head.substr(start));
-      break;
-    }
-    lines.push_back(head.substr(start, e - start));
-    start = e + 2;
-  }
-  if (lines.empty()) return false;
+static std::string_view trim(std::string_view s) {
+  while (!s.empty() && std::isspace(static_cast<unsigned char>(s.front()))) s.remove_prefix(1);
+  while (!s.empty() && std::isspace(static_cast<unsigned char>(s.back()))) s.remove_suffix(1);
+  return s;
+}
 
-  const std::string &rl = lines[0];
+bool HttpParser::parse_head(std::string_view head, HttpRequest& out) const {
+  auto eol = head.find("\r\n");
+  const std::string_view rl = head.substr(0, eol);
   if (rl.size() > max_start_line_) return false;
 
-  auto s1 = rl.find(' ');
-  auto s2 = rl.find(' ', s1 == std::string::npos ? 0 : s1 + 1);
-  if (s1 == std::string::npos || s2 == std::string::npos) return false;
-
-  out.method = rl.substr(0, s1);
-  out.target = rl.substr(s1 + 1, s2 - s1 - 1);
-  out.version = rl.substr(s2 + 1);
+  const auto s1 = rl.find(' ');
+  const auto s2 = s1 == std::string_view::npos ? s1 : rl.find(' ', s1 + 1);
+  if (s2 == std::string_view::npos) return false;
 
-  if (out.method.empty() || out.target.empty() || out.version.find("HTTP/") != 0) return false;
-  for (char c: out.method) if (!is_token_char(c)) return false;
+  const auto method = rl.substr(0, s1);
+  const auto target = rl.substr(s1 + 1, s2 - s1 - 1);
+  const auto version = rl.substr(s2 + 1);
+  if (method.empty() || target.empty() || version.substr(0, 5) != "HTTP/") return false;
+  if (!std::all_of(method.begin(), method.end(), is_token_char)) return false;
+  out.method.assign(method.data(), method.size());
+  out.target.assign(target.data(), target.size());
+  out.version.assign(version.data(), version.size());
 
   std::unordered_map<std::string, std::string> headers;
   std::size_t total_bytes = 0;
-  for (std::size_t i = 1; i < lines.size(); ++i) {
-    const std::string &line = lines[i];
+  while (eol != std::string_view::npos) {
+    const auto start = eol + 2;
+    eol = head.find("\r\n", start);
+    const std::string_view line = head.substr(start, eol == std::string_view::npos ? eol : eol - start);
     total_bytes += line.size();
     if (total_bytes > max_headers_bytes_) return false;
 
     if (line.empty()) continue;
-    auto colon = line.find(':');
-    if (colon == std::string::npos) return false;
-
-    std::string name = line.substr(0, colon);
-    std::string value = line.substr(colon + 1);
-    auto ltrim = [](std::string &s) {
-      s.erase(s.begin(), std::find_if(s.begin(), s.end(), [](unsigned char ch) { return !std::isspace(ch); }));
-    };
-    auto rtrim = [](std::string &s) {
-      s.erase(std::find_if(s.rbegin(), s.rend(), [](unsigned char ch) { return !std::isspace(ch); }).base(), s.end());
-    };
-    ltrim(value);
-    rtrim(value);
-    std::string lname = header_lower(name);
-    headers[lname] = value;
+    const auto colon = line.find(':');
+    if (colon == std::string_view::npos) return false;
+
+    const std::string_view name = line.substr(0, colon);
+    const std::string_view value = trim(line.substr(colon + 1));
+    const HeaderId id = header_id(name);
+    if (id != HeaderId::Other) {
+      out.known[static_cast<std::size_t>(id)].assign(value.data(), value.size());
+    } else {
+      headers[header_lower(std::string(name))] = std::string(value);
+    }
   }
   out.headers = std::move(headers);
 
-  auto conn = out.header("connection");
+  const auto& conn = out.header(HeaderId::Connection);
   if (out.version == "HTTP/1.1") {
     out.keep_alive = !(conn == "close" || conn == "Close");
   } else {
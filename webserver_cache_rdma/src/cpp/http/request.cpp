@@ -2,7 +2,9 @@
 #include "../../headers/http/headers.hpp"
 
 std::string HttpRequest::header(const std::string& name) const {
+  const HeaderId id = header_id(name);
+  if (id != HeaderId::Other) return header(id);
   auto it = headers.find(header_lower(name));
   if (it != headers.end()) return it->second;
   return {};
-}
\ No newline at end of file
+}
@@ -0,0 +1,604 @@
+#include "../../headers/http2/h2_session.hpp"
+#include <fmt/core.h>
+#include <algorithm>
+#include "../../headers/fs/path_utils.hpp"
+#include "../../headers/fs/file_reader.hpp"
+#include "../../headers/util/time.hpp"
+#include "../../headers/util/metrics.hpp"
+#include "../../headers/util/access_trace.hpp"
+#include "../../headers/util/logging.hpp"
+
+using namespace h2;
+
+namespace {
+
+// One gathered write carries the pending control frames plus at most this much
+// DATA, so a single large body cannot starve the other streams' turns
+constexpr std::size_t kWriteBatchBytes = 256 * 1024;
+constexpr std::size_t kMaxDataFramesPerWrite = 64;
+
+// Reading stops while this much control output (PING and SETTINGS acks, RST_STREAM,
+// HEADERS) waits behind a write in flight; a peer that floods PINGs without reading
+// the acks is then held back by TCP rather than by our memory
+constexpr std::size_t kMaxPendingCtrlBytes = 64 * 1024;
+
+void put_setting(uint8_t* p, Setting id, uint32_t value) {
+  p[0] = static_cast<uint8_t>(static_cast<uint16_t>(id) >> 8);
+  p[1] = static_cast<uint8_t>(static_cast<uint16_t>(id));
+  write_u32(p + 2, value);
+}
+
+} // namespace
+
+H2Session::H2Session(SessionSocket socket, std::shared_ptr<const Config> cfg, std::shared_ptr<LRUCache> cache,
+                     std::shared_ptr<const DocImage> image, std::shared_ptr<const LoadMonitor> monitor, std::shared_ptr<TimerWheel> wheel)
+  : socket_(std::move(socket)),
+    cfg_(std::move(cfg)),
+    cache_(std::move(cache)),
+    image_(std::move(image)),
+    monitor_(std::move(monitor)),
+    wheel_(std::move(wheel)),
+    inbuf_(16384)
+{
+  Metrics::instance().active_connections.fetch_add(1, std::memory_order_relaxed);
+  deadline_.on_expire = &H2Session::on_deadline;
+}
+
+H2Session::~H2Session() {
+  wheel_->cancel(deadline_);
+  Metrics::instance().active_connections.fetch_sub(1, std::memory_order_relaxed);
+}
+
+bool H2Session::decode_settings_header(std::string_view b64, std::string& payload) {
+  // base64url without padding (RFC 7540 section 3.2.1); plain base64 is accepted too
+  payload.clear();
+  uint32_t acc = 0;
+  int bits = 0;
+  for (char c : b64) {
+    int v;
+    if (c >= 'A' && c <= 'Z') v = c - 'A';
+    else if (c >= 'a' && c <= 'z') v = c - 'a' + 26;
+    else if (c >= '0' && c <= '9') v = c - '0' + 52;
+    else if (c == '-' || c == '+') v = 62;
+    else if (c == '_' || c == '/') v = 63;
+    else if (c == '=') break;
+    else return false;
+    acc = (acc << 6) | static_cast<uint32_t>(v);
+    bits += 6;
+    if (bits >= 8) {
+      bits -= 8;
+      payload += static_cast<char>((acc >> bits) & 0xff);
+    }
+  }
+  return payload.size() % 6 == 0;
+}
+
+void H2Session::begin() {
+  Metrics::instance().h2_connections.fetch_add(1, std::memory_order_relaxed);
+  deadline_.owner = shared_from_this();
+
+  // Our connection preface: the server's first frame is SETTINGS
+  uint8_t s[12];
+  put_setting(s, Setting::MaxConcurrentStreams, static_cast<uint32_t>(std::max(1, cfg_->http2_max_streams)));
+  put_setting(s + 6, Setting::MaxHeaderListSize, static_cast<uint32_t>(cfg_->max_header_bytes));
+  append_frame(ctrl_, FrameType::Settings, 0, 0, s, sizeof(s));
+}
+
+void H2Session::start(std::string_view early) {
+  begin();
+  rx_.assign(early.data(), early.size());
+  if (process_input()) start_read();
+  flush();
+}
+
+void H2Session::start_upgraded(const HttpRequest& upgrade, const std::string& settings, std::string_view early) {
+  begin();
+  if (!apply_settings(reinterpret_cast<const uint8_t*>(settings.data()), settings.size())) {
+    flush();
+    return;
+  }
+  // The upgrade request becomes stream 1, already half-closed by the client
+  last_stream_id_ = 1;
+  respond(1, upgrade.method, upgrade.target);
+  rx_.assign(early.data(), early.size());
+  if (process_input()) start_read();
+  flush();
+}
+
+void H2Session::start_read() {
+  if (closed_ || closing_ || reading_ || ctrl_.size() > kMaxPendingCtrlBytes) return;
+  reading_ = true;
+  auto self = shared_from_this();
+  socket_.async_read_some(boost::asio::buffer(inbuf_),
+    make_custom_alloc_handler(read_mem_,
+    [self](boost::system::error_code ec, std::size_t n) {
+      self->on_read(ec, n);
+    })
+  );
+}
+
+void H2Session::on_read(boost::system::error_code ec, std::size_t n) {
+  reading_ = false;
+  if (ec) {
+    close();
+    return;
+  }
+  rx_.append(reinterpret_cast<const char*>(inbuf_.data()), n);
+  if (process_input()) start_read();
+  flush();
+}
+
+// Consumes the preface and every complete frame in rx_. False once the connection
+// is being torn down.
+bool H2Session::process_input() {
+  std::size_t off = 0;
+  if (!preface_done_) {
+    const std::size_t n = std::min(rx_.size(), kClientPreface.size());
+    if (rx_.compare(0, n, kClientPreface.data(), n) != 0) {
+      close();
+      return false;
+    }
+    if (n < kClientPreface.size()) return true;
+    off = n;
+    preface_done_ = true;
+  }
+
+  bool ok = true;
+  while (ok && rx_.size() - off >= kFrameHeaderSize) {
+    const auto* base = reinterpret_cast<const uint8_t*>(rx_.data()) + off;
+    const FrameHeader h = read_frame_header(base);
+    if (h.length > kDefaultMaxFrame) {
+      ok = connection_error(ErrorCode::FrameSizeError);
+      break;
+    }
+    if (rx_.size() - off < kFrameHeaderSize + h.length) break;
+    ok = handle_frame(h, base + kFrameHeaderSize);
+    off += kFrameHeaderSize + h.length;
+  }
+  rx_.erase(0, off);
+  return ok;
+}
+
+bool H2Session::handle_frame(const FrameHeader& h, const uint8_t* p) {
+  // A header block must be finished by CONTINUATIONs before anything else
+  if (hblock_stream_ && (h.type != FrameType::Continuation || h.stream_id != hblock_stream_)) {
+    return connection_error(ErrorCode::ProtocolError);
+  }
+
+  switch (h.type) {
+    case FrameType::Data: {
+      if (h.stream_id == 0 || h.stream_id > last_stream_id_) return connection_error(ErrorCode::ProtocolError);
+      // Request bodies are not used; hand the flow-control credit straight back
+      if (h.length) {
+        send_window_update(0, h.length);
+        if (!(h.flags & flags::EndStream)) send_window_update(h.stream_id, h.length);
+      }
+      return true;
+    }
+
+    case FrameType::Headers: {
+      if (h.stream_id == 0 || h.stream_id % 2 == 0) return connection_error(ErrorCode::ProtocolError);
+      std::size_t len = h.length;
+      std::size_t pad = 0;
+      if (h.flags & flags::Padded) {
+        if (len < 1) return connection_error(ErrorCode::ProtocolError);
+        pad = *p++;
+        --len;
+      }
+      if (h.flags & flags::Priority) {
+        if (len < 5) return connection_error(ErrorCode::ProtocolError);
+        p += 5;
+        len -= 5;
+      }
+      if (pad > len) return connection_error(ErrorCode::ProtocolError);
+      hblock_.assign(reinterpret_cast<const char*>(p), len - pad);
+      hblock_stream_ = h.stream_id;
+      if (h.flags & flags::EndHeaders) return on_header_block();
+      return true;
+    }
+
+    case FrameType::Continuation: {
+      if (!hblock_stream_) return connection_error(ErrorCode::ProtocolError);
+      hblock_.append(reinterpret_cast<const char*>(p), h.length);
+      if (hblock_.size() > cfg_->max_header_bytes) return connection_error(ErrorCode::ProtocolError);
+      if (h.flags & flags::EndHeaders) return on_header_block();
+      return true;
+    }
+
+    case FrameType::Priority:
+      if (h.stream_id == 0) return connection_error(ErrorCode::ProtocolError);
+      if (h.length != 5) reset_stream(h.stream_id, ErrorCode::FrameSizeError);
+      return true;
+
+    case FrameType::RstStream:
+      if (h.stream_id == 0 || h.stream_id > last_stream_id_) return connection_error(ErrorCode::ProtocolError);
+      if (h.length != 4) return connection_error(ErrorCode::FrameSizeError);
+      // Frames already handed to the socket keep their body alive through wbodies_
+      streams_.erase(h.stream_id);
+      return true;
+
+    case FrameType::Settings:
+      if (h.stream_id != 0) return connection_error(ErrorCode::ProtocolError);
+      if (h.flags & flags::Ack) {
+        return h.length == 0 || connection_error(ErrorCode::FrameSizeError);
+      }
+      if (h.length % 6) return connection_error(ErrorCode::FrameSizeError);
+      if (!apply_settings(p, h.length)) return false;
+      append_frame(ctrl_, FrameType::Settings, flags::Ack, 0, nullptr, 0);
+      return true;
+
+    case FrameType::PushPromise:
+      return connection_error(ErrorCode::ProtocolError);
+
+    case FrameType::Ping:
+      if (h.stream_id != 0) return connection_error(ErrorCode::ProtocolError);
+      if (h.length != 8) return connection_error(ErrorCode::FrameSizeError);
+      if (!(h.flags & flags::Ack)) append_frame(ctrl_, FrameType::Ping, flags::Ack, 0, p, 8);
+      return true;
+
+    case FrameType::GoAway:
+      if (h.stream_id != 0) return connection_error(ErrorCode::ProtocolError);
+      peer_goaway_ = true;   // finish what is in flight, then close
+      return true;
+
+    case FrameType::WindowUpdate: {
+      if (h.length != 4) return connection_error(ErrorCode::FrameSizeError);
+      const uint32_t inc = read_u32(p) & 0x7fffffffu;
+      if (h.stream_id == 0) {
+        if (inc == 0) return connection_error(ErrorCode::ProtocolError);
+        conn_send_window_ += inc;
+        if (conn_send_window_ > kMaxWindow) return connection_error(ErrorCode::FlowControlError);
+        return true;
+      }
+      if (inc == 0) {
+        reset_stream(h.stream_id, ErrorCode::ProtocolError);
+        return true;
+      }
+      auto it = streams_.find(h.stream_id);
+      if (it == streams_.end()) return true;   // already finished or reset
+      it->second.send_window += inc;
+      if (it->second.send_window > kMaxWindow) reset_stream(h.stream_id, ErrorCode::FlowControlError);
+      else enqueue_ready(h.stream_id);
+      return true;
+    }
+
+    default:
+      return true;   // unknown frame types are ignored (section 4.1)
+  }
+}
+
+bool H2Session::apply_settings(const uint8_t* p, std::size_t n) {
+  for (std::size_t i = 0; i + 6 <= n; i += 6) {
+    const auto id = static_cast<Setting>((p[i] << 8) | p[i + 1]);
+    const uint32_t v = read_u32(p + i + 2);
+    switch (id) {
+      case Setting::EnablePush:
+        if (v > 1) return connection_error(ErrorCode::ProtocolError);
+        break;
+      case Setting::InitialWindowSize: {
+        if (v > kMaxWindow) return connection_error(ErrorCode::FlowControlError);
+        // Applies retroactively to every open stream (section 6.9.2)
+        const int64_t delta = int64_t{v} - peer_initial_window_;
+        peer_initial_window_ = v;
+        for (auto& [stream_id, s] : streams_) {
+          s.send_window += delta;
+          if (s.send_window > kMaxWindow) return connection_error(ErrorCode::FlowControlError);
+          enqueue_ready(stream_id);
+        }
+        break;
+      }
+      case Setting::MaxFrameSize:
+        if (v < kDefaultMaxFrame || v > 0xffffffu) return connection_error(ErrorCode::ProtocolError);
+        peer_max_frame_ = v;
+        break;
+      default:
+        // The peer's header table size only limits an encoder's dynamic table,
+        // which ours does not use; unknown settings are ignored
+        break;
+    }
+  }
+  return true;
+}
+
+bool H2Session::on_header_block() {
+  const uint32_t id = hblock_stream_;
+  hblock_stream_ = 0;
+  std::vector<HeaderField> fields;
+  // Every block is decoded, even ones we ignore, to keep the HPACK table in step
+  if (!hpack_.decode(reinterpret_cast<const uint8_t*>(hblock_.data()), hblock_.size(),
+                     cfg_->max_header_bytes, fields)) {
+    return connection_error(ErrorCode::CompressionError);
+  }
+  hblock_.clear();
+
+  if (id <= last_stream_id_) return true;  // trailers of a request already answered
+  last_stream_id_ = id;
+  if (peer_goaway_ || draining_ || closing_) return true;
+  if (streams_.size() >= static_cast<std::size_t>(std::max(1, cfg_->http2_max_streams))) {
+    reset_stream(id, ErrorCode::RefusedStream);
+    return true;
+  }
+
+  const std::string* method = nullptr;
+  const std::string* path = nullptr;
+  for (const auto& f : fields) {
+    if (f.name == ":method") method = &f.value;
+    else if (f.name == ":path") path = &f.value;
+  }
+  if (!method || !path || method->empty() || path->empty()) {
+    reset_stream(id, ErrorCode::ProtocolError);
+    return true;
+  }
+  respond(id, *method, *path);
+  return true;
+}
+
+int H2Session::lookup(const std::string& path, ObjectPtr& obj, std::string& error) {
+  // Map and serve, same as the HTTP/1.1 path
+  auto& m = Metrics::instance();
+  if (image_) {
+    obj = image_->find_target(path, false);
+    (obj ? m.image_hits : m.image_misses).fetch_add(1, std::memory_order_relaxed);
+    error = "Not Found";
+    return obj ? 200 : 404;
+  }
+  if (const auto key = direct_cache_key(path); !key.empty() && (obj = cache_->get(key))) {
+    m.cache_hits.fetch_add(1, std::memory_order_relaxed);
+    access_trace::record(key, obj->size(), true, access_trace::Source::H2);
+    return 200;
+  }
+  if (const int status = cache_->negative(path)) {
+    m.cache_negative_hits.fetch_add(1, std::memory_order_relaxed);
+    error = status == 404 ? "Not Found" : "Path traversal";
+    return status;
+  }
+  auto mapped = map_url_to_fs(cfg_->doc_root, path);
+  if (!mapped.ok) {
+    if (mapped.outside_root) cache_->put_negative(path, 400);
+    error = mapped.error;
+    return 400;
+  }
+  if (!mapped.exists) {
+    cache_->put_negative(path, 404);
+    error = "Not Found";
+    return 404;
+  }
+
+  if ((obj = cache_->get(mapped.cache_key))) {
+    m.cache_hits.fetch_add(1, std::memory_order_relaxed);
+    access_trace::record(mapped.cache_key, obj->size(), true, access_trace::Source::H2);
+    return 200;
+  }
+  m.cache_misses.fetch_add(1, std::memory_order_relaxed);
+
+  auto fr = read_file(mapped.fs_path);
+  if (!fr.ok) {
+    error = fr.error;
+    return 500;
+  }
+  obj = make_cached_object(std::move(fr.data), fr.last_modified, mapped.fs_path);
+  cache_->put(mapped.cache_key, obj);
+  access_trace::record(mapped.cache_key, obj->size(), false, access_trace::Source::H2);
+  return 200;
+}
+
+void H2Session::respond(uint32_t stream_id, std::string_view method, const std::string& path) {
+  Metrics::instance().h2_streams.fetch_add(1, std::memory_order_relaxed);
+
+  int status = 200;
+  std::string error;
+  std::string_view mime;
+  ObjectPtr obj;
+  ObjectPtr body;
+  bool file = false;
+
+  if (method == "GET" && path == "/metrics") {
+    const auto text = Metrics::instance().render_text();
+    body = make_text_object(text);
+    mime = "text/plain; charset=utf-8";
+  } else if (monitor_ && monitor_->shedding()) {
+    status = 503;
+    Metrics::instance().connections_shed.fetch_add(1, std::memory_order_relaxed);
+  } else if (method != "GET" && method != "HEAD") {
+    status = 405;
+    error = "Method Not Allowed";
+  } else {
+    status = lookup(path, obj, error);
+    file = status == 200;
+  }
+
+  if (file) {
+    body = obj;
+    mime = obj->mime;
+  } else if (status != 200 && status != 503) {
+    const auto text = fmt::format("{} {}\n", status, error);
+    body = make_text_object(text);
+    mime = "text/plain; charset=utf-8";
+  }
+
+  if (status >= 500) Metrics::instance().responses_5xx.fetch_add(1, std::memory_order_relaxed);
+  else if (status >= 400) Metrics::instance().responses_4xx.fetch_add(1, std::memory_order_relaxed);
+  else Metrics::instance().responses_2xx.fetch_add(1, std::memory_order_relaxed);
+
+  const std::size_t length = body ? body->size() : 0;
+  std::string block;
+  hpack::encode_status(block, status);
+  if (!mime.empty()) hpack::encode_header(block, hpack::Name::ContentType, mime);
+  hpack::encode_header(block, hpack::Name::ContentLength, std::to_string(length));
+  hpack::encode_header(block, hpack::Name::Date, cached_http_date());
+  if (file) {
+    hpack::encode_header(block, hpack::Name::LastModified, obj->last_modified_http);
+    hpack::encode_header(block, hpack::Name::ETag, obj->etag);
+  }
+  if (status == 503) hpack::encode_header(block, hpack::Name::RetryAfter, "1");
+
+  const bool has_data = length > 0 && method != "HEAD";
+  append_frame(ctrl_, FrameType::Headers, flags::EndHeaders | (has_data ? 0 : flags::EndStream),
+               stream_id, block.data(), block.size());
+  if (!has_data) return;
+
+  Metrics::instance().bytes_served.fetch_add(length, std::memory_order_relaxed);
+  Stream& s = streams_[stream_id];
+  s.send_window = peer_initial_window_;
+  s.body = std::move(body);
+  enqueue_ready(stream_id);
+}
+
+void H2Session::send_window_update(uint32_t stream_id, uint32_t increment) {
+  uint8_t p[4];
+  write_u32(p, increment);
+  append_frame(ctrl_, FrameType::WindowUpdate, 0, stream_id, p, sizeof(p));
+}
+
+void H2Session::reset_stream(uint32_t stream_id, ErrorCode code) {
+  uint8_t p[4];
+  write_u32(p, static_cast<uint32_t>(code));
+  append_frame(ctrl_, FrameType::RstStream, 0, stream_id, p, sizeof(p));
+  streams_.erase(stream_id);
+}
+
+// Queues GOAWAY and stops taking input; the socket closes once it is written
+bool H2Session::connection_error(ErrorCode code) {
+  if (!closing_) {
+    log_debug("h2 connection error {}, last stream {}", static_cast<uint32_t>(code), last_stream_id_);
+    uint8_t p[8];
+    write_u32(p, last_stream_id_);
+    write_u32(p + 4, static_cast<uint32_t>(code));
+    append_frame(ctrl_, FrameType::GoAway, 0, 0, p, sizeof(p));
+    closing_ = true;
+    streams_.clear();
+    ready_.clear();
+  }
+  return false;
+}
+
+void H2Session::enqueue_ready(uint32_t stream_id) {
+  auto it = streams_.find(stream_id);
+  if (it == streams_.end()) return;
+  Stream& s = it->second;
+  if (!s.queued && s.send_window > 0 && s.offset < s.body->size()) {
+    s.queued = true;
+    ready_.push_back(stream_id);
+  }
+}
+
+// Gathers the queued control frames and, round-robin across ready streams, one
+// DATA frame per turn into a single write. DATA payloads are slices of the cached
+// bodies; only the 9-byte frame headers are built here.
+void H2Session::flush() {
+  if (writing_ || closed_) return;
+
+  // A draining process sends GOAWAY once, then finishes the streams it has taken
+  if (!draining_ && !closing_ && monitor_ && monitor_->draining()) {
+    draining_ = true;
+    uint8_t p[8];
+    write_u32(p, last_stream_id_);
+    write_u32(p + 4, static_cast<uint32_t>(ErrorCode::NoError));
+    append_frame(ctrl_, FrameType::GoAway, 0, 0, p, sizeof(p));
+  }
+
+  wctrl_.swap(ctrl_);
+  ctrl_.clear();
+  wbufs_.clear();
+  wdata_hdrs_.clear();
+  wdata_hdrs_.reserve(kMaxDataFramesPerWrite); // wbufs_ points into it
+  if (!wctrl_.empty()) wbufs_.push_back(boost::asio::buffer(wctrl_));
+
+  std::size_t budget = kWriteBatchBytes;
+  while (!ready_.empty() && conn_send_window_ > 0 && budget > 0 &&
+         wdata_hdrs_.size() < kMaxDataFramesPerWrite) {
+    const uint32_t id = ready_.front();
+    ready_.pop_front();
+    auto it = streams_.find(id);
+    if (it == streams_.end()) continue;
+    Stream& s = it->second;
+    s.queued = false;
+    if (s.send_window <= 0) continue;   // requeued by its next WINDOW_UPDATE
+
+    const std::size_t remaining = s.body->size() - s.offset;
+    const auto len = static_cast<std::size_t>(std::min<int64_t>(
+      {static_cast<int64_t>(remaining), int64_t{peer_max_frame_}, s.send_window, conn_send_window_,
+       static_cast<int64_t>(budget)}));
+    const bool last = len == remaining;
+
+    wdata_hdrs_.emplace_back();
+    write_frame_header(wdata_hdrs_.back().data(), static_cast<uint32_t>(len), FrameType::Data,
+                       last ? flags::EndStream : 0, id);
+    wbufs_.push_back(boost::asio::buffer(wdata_hdrs_.back()));
+    wbufs_.push_back(boost::asio::buffer(s.body->data() + s.offset, len));
+    wbodies_.push_back(s.body);
+
+    s.offset += len;
+    s.send_window -= static_cast<int64_t>(len);
+    conn_send_window_ -= static_cast<int64_t>(len);
+    budget -= len;
+    if (last) streams_.erase(it);
+    else enqueue_ready(id);
+  }
+
+  if (wbufs_.empty()) {
+    if (closing_ || ((peer_goaway_ || draining_) && streams_.empty())) close();
+    else update_deadline();
+    return;
+  }
+
+  writing_ = true;
+  update_deadline();
+  auto self = shared_from_this();
+  boost::asio::async_write(socket_, wbufs_,
+    make_custom_alloc_handler(write_mem_,
+    [self](boost::system::error_code ec, std::size_t /*n*/) {
+      self->on_write(ec);
+    })
+  );
+}
+
+void H2Session::on_write(boost::system::error_code ec) {
+  writing_ = false;
+  wctrl_.clear();
+  wbodies_.clear();
+  if (ec) {
+    close();
+    return;
+  }
+  flush();
+  // Resumes input paused on a control-frame backlog, now moved into this write
+  start_read();
+}
+
+// Idle between requests, Read while the preface, a frame or a header block is
+// incomplete, Write while responses are pending (including streams waiting for
+// window)
+void H2Session::update_deadline() {
+  if (closed_) return;
+  Deadline kind = Deadline::Idle;
+  if (writing_ || !streams_.empty()) kind = Deadline::Write;
+  else if (!preface_done_ || hblock_stream_ || !rx_.empty()) kind = Deadline::Read;
+
+  int ms = cfg_->keepalive_timeout_ms;
+  if (kind == Deadline::Write) ms = cfg_->write_timeout_ms;
+  else if (kind == Deadline::Read) ms = cfg_->read_timeout_ms;
+  deadline_kind_ = kind;
+  wheel_->schedule(deadline_, std::chrono::milliseconds(ms));
+}
+
+// Runs on the wheel's strand; hops to the connection's strand before touching it
+void H2Session::on_deadline(const std::shared_ptr<void>& owner, uint64_t generation) {
+  auto self = std::static_pointer_cast<H2Session>(owner);
+  boost::asio::post(self->socket_.get_executor(), [self, generation] {
+    if (self->closed_ || self->wheel_->generation_of(self->deadline_) != generation) return;
+    static const char* const kNames[] = {"read", "write", "idle"};
+    Metrics::instance().connection_timeouts.fetch_add(1, std::memory_order_relaxed);
+    log_debug("h2 {} timeout, closing connection", kNames[static_cast<int>(self->deadline_kind_)]);
+    self->close();
+  });
+}
+
+void H2Session::close() {
+  if (closed_) return;
+  closed_ = true;
+  wheel_->cancel(deadline_);
+  boost::system::error_code ig;
+  socket_.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ig);
+  socket_.close(ig);
+}
@@ -0,0 +1,314 @@
+#include "../../headers/http2/hpack.hpp"
+#include <array>
+#include <charconv>
+
+namespace h2 {
+namespace {
+
+struct StaticEntry {
+  std::string_view name;
+  std::string_view value;
+};
+
+// RFC 7541 Appendix A; index 1 is kStaticTable[0]
+constexpr StaticEntry kStaticTable[] = {
+  {":authority", ""}, {":method", "GET"}, {":method", "POST"}, {":path", "/"},
+  {":path", "/index.html"}, {":scheme", "http"}, {":scheme", "https"}, {":status", "200"},
+  {":status", "204"}, {":status", "206"}, {":status", "304"}, {":status", "400"},
+  {":status", "404"}, {":status", "500"}, {"accept-charset", ""}, {"accept-encoding", "gzip, deflate"},
+  {"accept-language", ""}, {"accept-ranges", ""}, {"accept", ""}, {"access-control-allow-origin", ""},
+  {"age", ""}, {"allow", ""}, {"authorization", ""}, {"cache-control", ""},
+  {"content-disposition", ""}, {"content-encoding", ""}, {"content-language", ""}, {"content-length", ""},
+  {"content-location", ""}, {"content-range", ""}, {"content-type", ""}, {"cookie", ""},
+  {"date", ""}, {"etag", ""}, {"expect", ""}, {"expires", ""},
+  {"from", ""}, {"host", ""}, {"if-match", ""}, {"if-modified-since", ""},
+  {"if-none-match", ""}, {"if-range", ""}, {"if-unmodified-since", ""}, {"last-modified", ""},
+  {"link", ""}, {"location", ""}, {"max-forwards", ""}, {"proxy-authenticate", ""},
+  {"proxy-authorization", ""}, {"range", ""}, {"referer", ""}, {"refresh", ""},
+  {"retry-after", ""}, {"server", ""}, {"set-cookie", ""}, {"strict-transport-security", ""},
+  {"transfer-encoding", ""}, {"user-agent", ""}, {"vary", ""}, {"via", ""},
+  {"www-authenticate", ""},
+};
+constexpr uint64_t kStaticSize = sizeof(kStaticTable) / sizeof(kStaticTable[0]);
+
+struct HuffCode {
+  uint32_t code;
+  uint8_t bits;
+};
+
+// RFC 7541 Appendix B, symbols 0..255 plus EOS (256)
+constexpr HuffCode kHuffman[257] = {
+  {0x1ff8, 13}, {0x7fffd8, 23}, {0xfffffe2, 28}, {0xfffffe3, 28}, {0xfffffe4, 28}, {0xfffffe5, 28},
+  {0xfffffe6, 28}, {0xfffffe7, 28}, {0xfffffe8, 28}, {0xffffea, 24}, {0x3ffffffc, 30}, {0xfffffe9, 28},
+  {0xfffffea, 28}, {0x3ffffffd, 30}, {0xfffffeb, 28}, {0xfffffec, 28}, {0xfffffed, 28}, {0xfffffee, 28},
+  {0xfffffef, 28}, {0xffffff0, 28}, {0xffffff1, 28}, {0xffffff2, 28}, {0x3ffffffe, 30}, {0xffffff3, 28},
+  {0xffffff4, 28}, {0xffffff5, 28}, {0xffffff6, 28}, {0xffffff7, 28}, {0xffffff8, 28}, {0xffffff9, 28},
+  {0xffffffa, 28}, {0xffffffb, 28}, {0x14, 6}, {0x3f8, 10}, {0x3f9, 10}, {0xffa, 12},
+  {0x1ff9, 13}, {0x15, 6}, {0xf8, 8}, {0x7fa, 11}, {0x3fa, 10}, {0x3fb, 10},
+  {0xf9, 8}, {0x7fb, 11}, {0xfa, 8}, {0x16, 6}, {0x17, 6}, {0x18, 6},
+  {0x0, 5}, {0x1, 5}, {0x2, 5}, {0x19, 6}, {0x1a, 6}, {0x1b, 6},
+  {0x1c, 6}, {0x1d, 6}, {0x1e, 6}, {0x1f, 6}, {0x5c, 7}, {0xfb, 8},
+  {0x7ffc, 15}, {0x20, 6}, {0xffb, 12}, {0x3fc, 10}, {0x1ffa, 13}, {0x21, 6},
+  {0x5d, 7}, {0x5e, 7}, {0x5f, 7}, {0x60, 7}, {0x61, 7}, {0x62, 7},
+  {0x63, 7}, {0x64, 7}, {0x65, 7}, {0x66, 7}, {0x67, 7}, {0x68, 7},
+  {0x69, 7}, {0x6a, 7}, {0x6b, 7}, {0x6c, 7}, {0x6d, 7}, {0x6e, 7},
+  {0x6f, 7}, {0x70, 7}, {0x71, 7}, {0x72, 7}, {0xfc, 8}, {0x73, 7},
+  {0xfd, 8}, {0x1ffb, 13}, {0x7fff0, 19}, {0x1ffc, 13}, {0x3ffc, 14}, {0x22, 6},
+  {0x7ffd, 15}, {0x3, 5}, {0x23, 6}, {0x4, 5}, {0x24, 6}, {0x5, 5},
+  {0x25, 6}, {0x26, 6}, {0x27, 6}, {0x6, 5}, {0x74, 7}, {0x75, 7},
+  {0x28, 6}, {0x29, 6}, {0x2a, 6}, {0x7, 5}, {0x2b, 6}, {0x76, 7},
+  {0x2c, 6}, {0x8, 5}, {0x9, 5}, {0x2d, 6}, {0x77, 7}, {0x78, 7},
+  {0x79, 7}, {0x7a, 7}, {0x7b, 7}, {0x7ffe, 15}, {0x7fc, 11}, {0x3ffd, 14},
+  {0x1ffd, 13}, {0xffffffc, 28}, {0xfffe6, 20}, {0x3fffd2, 22}, {0xfffe7, 20}, {0xfffe8, 20},
+  {0x3fffd3, 22}, {0x3fffd4, 22}, {0x3fffd5, 22}, {0x7fffd9, 23}, {0x3fffd6, 22}, {0x7fffda, 23},
+  {0x7fffdb, 23}, {0x7fffdc, 23}, {0x7fffdd, 23}, {0x7fffde, 23}, {0xffffeb, 24}, {0x7fffdf, 23},
+  {0xffffec, 24}, {0xffffed, 24}, {0x3fffd7, 22}, {0x7fffe0, 23}, {0xffffee, 24}, {0x7fffe1, 23},
+  {0x7fffe2, 23}, {0x7fffe3, 23}, {0x7fffe4, 23}, {0x1fffdc, 21}, {0x3fffd8, 22}, {0x7fffe5, 23},
+  {0x3fffd9, 22}, {0x7fffe6, 23}, {0x7fffe7, 23}, {0xffffef, 24}, {0x3fffda, 22}, {0x1fffdd, 21},
+  {0xfffe9, 20}, {0x3fffdb, 22}, {0x3fffdc, 22}, {0x7fffe8, 23}, {0x7fffe9, 23}, {0x1fffde, 21},
+  {0x7fffea, 23}, {0x3fffdd, 22}, {0x3fffde, 22}, {0xfffff0, 24}, {0x1fffdf, 21}, {0x3fffdf, 22},
+  {0x7fffeb, 23}, {0x7fffec, 23}, {0x1fffe0, 21}, {0x1fffe1, 21}, {0x3fffe0, 22}, {0x1fffe2, 21},
+  {0x7fffed, 23}, {0x3fffe1, 22}, {0x7fffee, 23}, {0x7fffef, 23}, {0xfffea, 20}, {0x3fffe2, 22},
+  {0x3fffe3, 22}, {0x3fffe4, 22}, {0x7ffff0, 23}, {0x3fffe5, 22}, {0x3fffe6, 22}, {0x7ffff1, 23},
+  {0x3ffffe0, 26}, {0x3ffffe1, 26}, {0xfffeb, 20}, {0x7fff1, 19}, {0x3fffe7, 22}, {0x7ffff2, 23},
+  {0x3fffe8, 22}, {0x1ffffec, 25}, {0x3ffffe2, 26}, {0x3ffffe3, 26}, {0x3ffffe4, 26}, {0x7ffffde, 27},
+  {0x7ffffdf, 27}, {0x3ffffe5, 26}, {0xfffff1, 24}, {0x1ffffed, 25}, {0x7fff2, 19}, {0x1fffe3, 21},
+  {0x3ffffe6, 26}, {0x7ffffe0, 27}, {0x7ffffe1, 27}, {0x3ffffe7, 26}, {0x7ffffe2, 27}, {0xfffff2, 24},
+  {0x1fffe4, 21}, {0x1fffe5, 21}, {0x3ffffe8, 26}, {0x3ffffe9, 26}, {0xffffffd, 28}, {0x7ffffe3, 27},
+  {0x7ffffe4, 27}, {0x7ffffe5, 27}, {0xfffec, 20}, {0xfffff3, 24}, {0xfffed, 20}, {0x1fffe6, 21},
+  {0x3fffe9, 22}, {0x1fffe7, 21}, {0x1fffe8, 21}, {0x7ffff3, 23}, {0x3fffea, 22}, {0x3fffeb, 22},
+  {0x1ffffee, 25}, {0x1ffffef, 25}, {0xfffff4, 24}, {0xfffff5, 24}, {0x3ffffea, 26}, {0x7ffff4, 23},
+  {0x3ffffeb, 26}, {0x7ffffe6, 27}, {0x3ffffec, 26}, {0x3ffffed, 26}, {0x7ffffe7, 27}, {0x7ffffe8, 27},
+  {0x7ffffe9, 27}, {0x7ffffea, 27}, {0x7ffffeb, 27}, {0xffffffe, 28}, {0x7ffffec, 27}, {0x7ffffed, 27},
+  {0x7ffffee, 27}, {0x7ffffef, 27}, {0x7fffff0, 27}, {0x3ffffee, 26}, {0x3fffffff, 30}
+};
+
+constexpr uint16_t kEos = 256;
+
+// Binary decoding tree built from kHuffman on first use. Leaves carry the symbol;
+// inner nodes the indices of their children (0 = absent, the root is never a child).
+class HuffmanTree {
+public:
+  static const HuffmanTree& instance() {
+    static const HuffmanTree t;
+    return t;
+  }
+
+  struct Node {
+    uint16_t child[2] = {0, 0};
+    int16_t sym = -1;
+  };
+
+  const Node& node(uint16_t i) const { return nodes_[i]; }
+
+private:
+  HuffmanTree() {
+    nodes_.reserve(2 * 257);
+    nodes_.emplace_back();
+    for (uint16_t sym = 0; sym <= kEos; ++sym) {
+      uint16_t cur = 0;
+      for (int b = kHuffman[sym].bits - 1; b >= 0; --b) {
+        const unsigned bit = (kHuffman[sym].code >> b) & 1u;
+        if (!nodes_[cur].child[bit]) {
+          nodes_[cur].child[bit] = static_cast<uint16_t>(nodes_.size());
+          nodes_.emplace_back();
+        }
+        cur = nodes_[cur].child[bit];
+      }
+      nodes_[cur].sym = static_cast<int16_t>(sym);
+    }
+  }
+
+  std::vector<Node> nodes_;
+};
+
+bool decode_int(const uint8_t*& p, const uint8_t* end, unsigned prefix_bits, uint64_t& out) {
+  if (p == end) return false;
+  const uint8_t mask = static_cast<uint8_t>((1u << prefix_bits) - 1);
+  out = *p++ & mask;
+  if (out < mask) return true;
+  for (unsigned shift = 0; p < end && shift <= 28; shift += 7) {
+    const uint8_t b = *p++;
+    out += uint64_t{b & 0x7fu} << shift;
+    if (!(b & 0x80)) return true;
+  }
+  return false;
+}
+
+bool decode_string(const uint8_t*& p, const uint8_t* end, std::string& out) {
+  if (p == end) return false;
+  const bool huffman = (*p & 0x80) != 0;
+  uint64_t len = 0;
+  if (!decode_int(p, end, 7, len) || len > static_cast<uint64_t>(end - p)) return false;
+  out.clear();
+  if (huffman) {
+    if (!hpack::huffman_decode(p, static_cast<std::size_t>(len), out)) return false;
+  } else {
+    out.assign(reinterpret_cast<const char*>(p), static_cast<std::size_t>(len));
+  }
+  p += len;
+  return true;
+}
+
+void encode_int(std::string& out, uint64_t v, unsigned prefix_bits, uint8_t first) {
+  const uint64_t mask = (1u << prefix_bits) - 1;
+  if (v < mask) {
+    out += static_cast<char>(first | v);
+    return;
+  }
+  out += static_cast<char>(first | mask);
+  v -= mask;
+  while (v >= 0x80) {
+    out += static_cast<char>((v & 0x7f) | 0x80);
+    v >>= 7;
+  }
+  out += static_cast<char>(v);
+}
+
+// Literal header field without indexing, indexed name (RFC 7541 section 6.2.2)
+void encode_literal(std::string& out, uint64_t name_index, std::string_view value) {
+  encode_int(out, name_index, 4, 0x00);
+  encode_int(out, value.size(), 7, 0x00);
+  out.append(value.data(), value.size());
+}
+
+} // namespace
+
+bool HpackDecoder::field_at(uint64_t index, const HeaderField*& out) const {
+  if (index == 0) return false;
+  if (index <= kStaticSize) return false; // static entries are handled by the caller
+  const uint64_t d = index - kStaticSize - 1;
+  if (d >= dynamic_.size()) return false;
+  out = &dynamic_[static_cast<std::size_t>(d)];
+  return true;
+}
+
+void HpackDecoder::evict_to(std::size_t size) {
+  while (size_ > size && !dynamic_.empty()) {
+    size_ -= dynamic_.back().name.size() + dynamic_.back().value.size() + 32;
+    dynamic_.pop_back();
+  }
+}
+
+void HpackDecoder::insert(HeaderField f) {
+  const std::size_t entry = f.name.size() + f.value.size() + 32;
+  if (entry > max_size_) {
+    // Larger than the whole table: empties it and is not added (section 4.4)
+    evict_to(0);
+    return;
+  }
+  evict_to(max_size_ - entry);
+  size_ += entry;
+  dynamic_.push_front(std::move(f));
+}
+
+bool HpackDecoder::decode(const uint8_t* p, std::size_t n, std::size_t max_list_bytes,
+                          std::vector<HeaderField>& out) {
+  const uint8_t* end = p + n;
+  std::size_t list_bytes = 0;
+  bool seen_field = false;
+
+  while (p < end) {
+    const uint8_t b = *p;
+    HeaderField f;
+
+    if (b & 0x80) {
+      // Indexed header field
+      uint64_t index = 0;
+      if (!decode_int(p, end, 7, index) || index == 0) return false;
+      if (index <= kStaticSize) {
+        f.name = kStaticTable[index - 1].name;
+        f.value = kStaticTable[index - 1].value;
+      } else {
+        const HeaderField* e = nullptr;
+        if (!field_at(index, e)) return false;
+        f = *e;
+      }
+    } else if ((b & 0xe0) == 0x20) {
+      // Dynamic table size update; only before the first field of a block
+      uint64_t size = 0;
+      if (seen_field || !decode_int(p, end, 5, size) || size > limit_) return false;
+      max_size_ = static_cast<std::size_t>(size);
+      evict_to(max_size_);
+      continue;
+    } else {
+      // Literal: with incremental indexing (01), without (0000) or never indexed (0001)
+      const bool index_it = (b & 0xc0) == 0x40;
+      uint64_t name_index = 0;
+      if (!decode_int(p, end, index_it ? 6 : 4, name_index)) return false;
+      if (name_index == 0) {
+        if (!decode_string(p, end, f.name)) return false;
+      } else if (name_index <= kStaticSize) {
+        f.name = kStaticTable[name_index - 1].name;
+      } else {
+        const HeaderField* e = nullptr;
+        if (!field_at(name_index, e)) return false;
+        f.name = e->name;
+      }
+      if (!decode_string(p, end, f.value)) return false;
+      if (index_it) insert(f);
+    }
+
+    seen_field = true;
+    list_bytes += f.name.size() + f.value.size() + 32;
+    if (list_bytes > max_list_bytes) return false;
+    out.push_back(std::move(f));
+  }
+  return true;
+}
+
+namespace hpack {
+
+void encode_status(std::string& out, int status) {
+  uint8_t index = 0;
+  switch (status) {
+    case 200: index = 8; break;
+    case 204: index = 9; break;
+    case 206: index = 10; break;
+    case 304: index = 11; break;
+    case 400: index = 12; break;
+    case 404: index = 13; break;
+    case 500: index = 14; break;
+    default: break;
+  }
+  if (index) {
+    out += static_cast<char>(0x80 | index);
+    return;
+  }
+  char num[12];
+  const auto res = std::to_chars(num, num + sizeof(num), status);
+  encode_literal(out, 8, std::string_view(num, static_cast<std::size_t>(res.ptr - num)));
+}
+
+void encode_header(std::string& out, Name name, std::string_view value) {
+  encode_literal(out, static_cast<uint8_t>(name), value);
+}
+
+bool huffman_decode(const uint8_t* p, std::size_t n, std::string& out) {
+  const HuffmanTree& tree = HuffmanTree::instance();
+  uint16_t cur = 0;
+  unsigned pending_bits = 0;   // bits read since the last complete symbol
+  bool pending_ones = true;    // ...and whether they were all 1s (valid padding)
+  for (std::size_t i = 0; i < n; ++i) {
+    for (int b = 7; b >= 0; --b) {
+      const unsigned bit = (p[i] >> b) & 1u;
+      cur = tree.node(cur).child[bit];
+      if (!cur) return false;
+      ++pending_bits;
+      pending_ones = pending_ones && bit;
+      const int16_t sym = tree.node(cur).sym;
+      if (sym >= 0) {
+        if (sym == kEos) return false;
+        out += static_cast<char>(sym);
+        cur = 0;
+        pending_bits = 0;
+        pending_ones = true;
+      }
+    }
+  }
+  // Padding: at most 7 bits, all taken from the EOS prefix
+  return pending_bits <= 7 && pending_ones;
+}
+
+} // namespace hpack
+} // namespace h2
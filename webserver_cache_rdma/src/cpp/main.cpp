@@ -1,20 +1,55 @@
 #include <boost/asio.hpp>
 #include <fmt/core.h>
+#include <algorithm>
+#include <chrono>
 #include <thread>
 #include <vector>
 #include <string>
 #include <cstdlib>
+#include <stdexcept>
+#include <unistd.h>
 
 #include "../headers/server.hpp"
+#include "../headers/handoff.hpp"
 #include "../headers/signals.hpp"
 #include "../headers/util/config.hpp"
 #include "../headers/util/metrics.hpp"
+#include "../headers/util/logging.hpp"
+#include "../headers/util/access_trace.hpp"
+#include "../headers/util/tracing.hpp"
+#include "../headers/util/numa.hpp"
 #include "../headers/cache/lru_cache.hpp"
+#include "../headers/fs/file_reader.hpp"
+#include "../headers/fs/path_utils.hpp"
+#include "../headers/fs/doc_image.hpp"
+#include "../headers/rdma/shm_transport.hpp"
 
 #ifdef ENABLE_RDMA
 #include "../headers/rdma/rdma_server.hpp"
 #endif
 
+namespace {
+
+// The cache's reload hook for doc_root: a stat when nothing changed, a read when
+// size or mtime did. Identical bytes under a new mtime (a touch) keep the old ETag,
+// so clients and proxies holding it still see the same representation.
+ObjectPtr reload_from_doc_root(const std::string& doc_root, std::string_view key, const ObjectPtr& current) {
+  auto mapped = map_url_to_fs(doc_root, std::string(key));
+  if (!mapped.ok || !mapped.exists) return nullptr;
+  const FileStat st = stat_file(mapped.fs_path);
+  if (!st.ok) return nullptr;
+  if (st.size == current->size() && st.last_modified == current->last_modified) return current;
+
+  auto fr = read_file(mapped.fs_path);
+  if (!fr.ok) return current;   // keep serving it; the next stale hit tries again
+  const bool same = fr.data.size() == current->size() &&
+                    std::equal(fr.data.begin(), fr.data.end(), current->data());
+  return make_cached_object(std::move(fr.data), fr.last_modified, mapped.fs_path,
+                            same ? current->etag : std::string{});
+}
+
+} // namespace
+
 int main(int argc, char** argv) {
   try {
     Config cfg = parse_args(argc, argv);
@@ -22,15 +57,136 @@ int main(int argc, char** argv) {
       cfg.threads = std::max(1u, std::thread::hardware_concurrency());
     }
 
-    fmt::print("[info] Starting webserver port={}, threads={}, doc_root='{}', mem_cache={} MB, timeouts: read={}ms write={}ms keepalive={}ms\n",
-               cfg.port, cfg.threads, cfg.doc_root, cfg.cache_mem_mb,
-               cfg.read_timeout_ms, cfg.write_timeout_ms, cfg.keepalive_timeout_ms);
+    LogOptions log_opt;
+    if (!parse_log_level(cfg.log_level, log_opt.level)) {
+      throw std::runtime_error("invalid --log.level '" + cfg.log_level + "'");
+    }
+    if (cfg.log_format == "json") log_opt.format = LogFormat::Json;
+    else if (cfg.log_format != "text") throw std::runtime_error("invalid --log.format '" + cfg.log_format + "'");
+    log_init(log_opt);
+
+    log_info("Starting webserver port={}, threads={}, doc_root='{}', mem_cache={} MB, timeouts: read={}ms write={}ms keepalive={}ms",
+             cfg.port, cfg.threads, cfg.doc_root, cfg.cache_mem_mb,
+             cfg.read_timeout_ms, cfg.write_timeout_ms, cfg.keepalive_timeout_ms);
 #ifdef ENABLE_RDMA
-    fmt::print("[info] RDMA: enabled={}, bind={}, port={}, pollers={}\n",
-               (cfg.rdma_enable ? "true" : "false"), cfg.rdma_bind, cfg.rdma_port, cfg.rdma_pollers);
+    log_info("RDMA: enabled={}, bind={}, port={}, pollers={}",
+             (cfg.rdma_enable ? "true" : "false"), cfg.rdma_bind, cfg.rdma_port, cfg.rdma_pollers);
 #endif
 
-    auto shared_cache = std::make_shared<LRUCache>(static_cast<std::size_t>(cfg.cache_mem_mb) * 1024ull * 1024ull);
+    // Before the cache is built: it publishes its tier budgets into the metrics
+    Metrics::instance().reset();
+
+    // Read even without --numa: the local/remote hit counters use it
+    const numa::Topology topo = numa::Topology::detect();
+    numa::init(topo);
+    if (cfg.numa && !cfg.handoff_path.empty()) {
+      log_warn("numa: ignored with --handoff.path (a successor inherits a single listener)");
+      cfg.numa = false;
+    }
+    const std::size_t shards = cfg.numa ? topo.nodes.size() : 1;
+
+    if (!cfg.trace_path.empty()) {
+      access_trace::Options trace_opt;
+      trace_opt.path = cfg.trace_path;
+      trace_opt.sample = cfg.trace_sample;
+      access_trace::init(trace_opt);
+      log_info("trace: recording cache lookups to {} (1 in {} keys)", cfg.trace_path, std::max(1u, cfg.trace_sample));
+    }
+    if (cfg.tracing_sample > 0) {
+      tracing::configure({cfg.tracing_sample, cfg.tracing_slow_us, cfg.tracing_ring});
+      log_info("tracing: 1 in {} requests, keeping spans over {} us at /debug/traces", cfg.tracing_sample, cfg.tracing_slow_us);
+    }
+
+    // A packed image stands in for doc_root on every endpoint
+    std::shared_ptr<const DocImage> image;
+    if (!cfg.image_path.empty()) {
+      const auto t0 = std::chrono::steady_clock::now();
+      auto img = DocImage::open(cfg.image_path);
+      const auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - t0);
+      Metrics::instance().image_entries = img->count();
+      Metrics::instance().image_bytes = img->size_bytes();
+      log_info("image: {} ({} files, {} bytes) mapped in {} us; doc_root is not used", cfg.image_path,
+               img->count(), img->size_bytes(), us.count());
+      if (!cfg.cache_pin.empty()) log_warn("cache.pin: ignored with --image");
+      image = std::move(img);
+    }
+
+    LRUCache::Options cache_opt;
+    cache_opt.capacity_bytes = static_cast<std::size_t>(cfg.cache_mem_mb) * 1024ull * 1024ull;
+    cache_opt.small_capacity_bytes = static_cast<std::size_t>(cfg.cache_small_mb) * 1024ull * 1024ull;
+    cache_opt.small_max_object = static_cast<std::size_t>(cfg.cache_small_max_kb) * 1024ull;
+    cache_opt.l2_dir = cfg.l2_path;
+    cache_opt.l2_capacity_bytes = static_cast<std::size_t>(cfg.l2_capacity_mb) * 1024ull * 1024ull;
+    cache_opt.l2_write_bytes_per_sec = static_cast<std::size_t>(cfg.l2_write_mb_s) * 1024ull * 1024ull;
+    if (cfg.cache_revalidate_ms > 0 && !image) {
+      cache_opt.revalidate_after = std::chrono::milliseconds(cfg.cache_revalidate_ms);
+      cache_opt.reload = [doc_root = cfg.doc_root](std::string_view key, const ObjectPtr& current) {
+        return reload_from_doc_root(doc_root, key, current);
+      };
+      log_info("cache: re-checking hits older than {} ms in the background", cfg.cache_revalidate_ms);
+    }
+    cache_opt.negative_ttl = std::chrono::milliseconds(cfg.cache_negative_ms);
+    cache_opt.negative_max = cfg.cache_negative_max;
+    std::vector<PathMapResult> pins;
+    for (const auto& url : image ? std::vector<std::string>{} : cfg.cache_pin) {
+      auto mapped = map_url_to_fs(cfg.doc_root, url);
+      if (!mapped.ok || !mapped.exists) {
+        log_warn("cache.pin: skipping '{}' ({})", url, mapped.ok ? "not found" : mapped.error);
+        continue;
+      }
+      cache_opt.pinned.push_back(mapped.cache_key);
+      pins.push_back(std::move(mapped));
+    }
+    // With --numa, one shard per node splits the budgets; each has its own L2 directory
+    std::vector<std::shared_ptr<LRUCache>> caches;
+    for (std::size_t n = 0; n < shards; ++n) {
+      LRUCache::Options opt = cache_opt;
+      if (cfg.numa) {
+        opt.capacity_bytes /= shards;
+        opt.small_capacity_bytes /= shards;
+        opt.l2_capacity_bytes /= shards;
+        opt.l2_write_bytes_per_sec /= shards;
+        if (!opt.l2_dir.empty() && shards > 1) opt.l2_dir += "/node" + std::to_string(topo.nodes[n].id);
+        opt.node = static_cast<int>(n);
+      }
+      caches.push_back(std::make_shared<LRUCache>(opt));
+    }
+    const auto& shared_cache = caches.front();   // RDMA, shared memory and handoff use the first
+    if (!cfg.l2_path.empty()) {
+      log_info("l2: {} ({} MB, writes up to {} MB/s)", cfg.l2_path, cfg.l2_capacity_mb, cfg.l2_write_mb_s);
+    }
+
+    // Each shard reads its pins on its own node, so the bodies are allocated there
+    std::size_t pinned = 0;
+    for (std::size_t n = 0; n < shards; ++n) {
+      std::thread([&, n] {
+        if (cfg.numa) numa::bind_thread(n);
+        for (const auto& pin : pins) {
+          auto fr = read_file(pin.fs_path);
+          if (!fr.ok) {
+            log_warn("cache.pin: cannot load '{}': {}", pin.cache_key, fr.error);
+            continue;
+          }
+          caches[n]->put(pin.cache_key, make_cached_object(std::move(fr.data), fr.last_modified, pin.fs_path));
+          if (n == 0) ++pinned;
+        }
+      }).join();
+    }
+    if (pinned) log_info("cache.pin: {} objects pinned", pinned);
+
+    // A predecessor on the handoff path passes us its listener and hot cache
+    handoff::Inherited inherited;
+    if (!cfg.handoff_path.empty()) {
+      inherited = handoff::inherit(cfg.handoff_path, *shared_cache);
+      if (inherited.listen_fd >= 0) {
+        log_info("handoff: took over the listener; {} cached objects ({} bytes) inherited",
+                 inherited.objects, inherited.bytes);
+      }
+      if (inherited.tls_listen_fd >= 0 && cfg.tls_port == 0) {
+        ::close(inherited.tls_listen_fd);   // TLS is off in this configuration
+        inherited.tls_listen_fd = -1;
+      }
+    }
 
 #ifdef ENABLE_RDMA
     std::unique_ptr<rdma_fast::RDMAServer> rdma_srv;
@@ -40,27 +196,79 @@ int main(int argc, char** argv) {
       rc.port = cfg.rdma_port;
       rc.cq_depth = 512;
       rc.poller_threads = cfg.rdma_pollers;
-      rdma_srv = std::make_unique<rdma_fast::RDMAServer>(rc, cfg, shared_cache);
+      rc.poll_batch = cfg.rdma_poll_batch;
+      rc.busy_poll_us = cfg.rdma_busy_poll_us;
+      rdma_srv = std::make_unique<rdma_fast::RDMAServer>(rc, cfg, shared_cache, image);
       rdma_srv->start();
     }
 #endif
 
-    boost::asio::io_context ioc;
+    std::unique_ptr<rdma_fast::ShmServer> shm_srv;
+    if (cfg.shm_enable) {
+      shm_srv = std::make_unique<rdma_fast::ShmServer>(cfg, shared_cache, image);
+      // A successor replaces its predecessor's socket; anyone else must not
+      shm_srv->start(inherited.listen_fd >= 0);
+    }
+
+    // One io_context and Server per shard; the first also handles signals and handoff
+    std::vector<std::unique_ptr<boost::asio::io_context>> iocs;
+    for (std::size_t n = 0; n < shards; ++n) iocs.push_back(std::make_unique<boost::asio::io_context>());
+    boost::asio::io_context& ioc = *iocs.front();
 
     SignalHandler sigs{ioc};
     sigs.register_signals();
+    sigs.on_shutdown([&iocs] {
+      for (auto& c : iocs) c->stop();
+    });
 
-    Metrics::instance().reset();
+    const auto shared_cfg = std::make_shared<const Config>(cfg);
+    std::vector<std::unique_ptr<Server>> servers;
+    for (std::size_t n = 0; n < shards; ++n) {
+      servers.push_back(std::make_unique<Server>(*iocs[n], shared_cfg, caches[n], image,
+                                                 n == 0 ? inherited.listen_fd : -1,
+                                                 n == 0 ? inherited.tls_listen_fd : -1));
+    }
+    if (servers.size() > 1) {
+      std::vector<int> http_fds, tls_fds;
+      for (auto& srv : servers) {
+        http_fds.push_back(srv->listen_handle());
+        tls_fds.push_back(srv->tls_listen_handle());
+      }
+      std::string err;
+      if (!numa::steer_listeners(topo, http_fds, err) ||
+          (cfg.tls_port != 0 && !numa::steer_listeners(topo, tls_fds, err))) {
+        log_warn("numa: cannot steer connections by receiving CPU ({}); the kernel spreads them by hash", err);
+      }
+    }
+    for (auto& srv : servers) srv->start();
+    Server& server = *servers.front();
 
-    Server server{ioc, cfg, shared_cache};
-    server.start();
+    // Declared after the server so it is torn down first
+    std::unique_ptr<handoff::Listener> handoff_listener;
+    if (!cfg.handoff_path.empty()) {
+      handoff::ready(inherited);
+      handoff_listener = std::make_unique<handoff::Listener>(
+        ioc, server, cfg.handoff_path, static_cast<std::size_t>(cfg.handoff_cache_mb) * 1024ull * 1024ull,
+        std::chrono::milliseconds(cfg.handoff_drain_ms));
+      handoff_listener->start();
+      sigs.on_reload([argv] { handoff::spawn_successor(argv); });
+    }
 
+    // Threads are split between nodes by their share of the CPUs, at least one each
     std::vector<std::thread> workers;
-    workers.reserve(cfg.threads);
-    for (unsigned i = 0; i < cfg.threads; ++i) {
-      workers.emplace_back([&ioc] {
-        ioc.run();
-      });
+    workers.reserve(cfg.threads + shards);
+    for (std::size_t n = 0; n < shards; ++n) {
+      std::size_t count = cfg.threads;
+      if (cfg.numa) {
+        count = std::max<std::size_t>(1, (cfg.threads * topo.nodes[n].cpus.size() + topo.cpus() / 2) / topo.cpus());
+        log_info("numa: node {} runs {} threads on {} CPUs", topo.nodes[n].id, count, topo.nodes[n].cpus.size());
+      }
+      for (std::size_t i = 0; i < count; ++i) {
+        workers.emplace_back([&cfg, &ioc = *iocs[n], n] {
+          if (cfg.numa && !numa::bind_thread(n)) log_warn("numa: cannot pin a worker to node {}", n);
+          ioc.run();
+        });
+      }
     }
 
     for (auto& t : workers) t.join();
@@ -68,10 +276,15 @@ int main(int argc, char** argv) {
 #ifdef ENABLE_RDMA
     if (rdma_srv) rdma_srv->stop();
 #endif
+    if (shm_srv) shm_srv->stop();
 
-    fmt::print("[info] Webserver stopped\n");
+    log_info("Webserver stopped");
+    access_trace::shutdown();
+    log_shutdown();
     return 0;
   } catch (const std::exception& ex) {
+    // Flush what the logger holds first, so the reason comes last
+    log_shutdown();
     fmt::print(stderr, "[fatal] {}\n", ex.what());
     return 1;
   }
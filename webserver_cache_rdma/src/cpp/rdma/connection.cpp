@@ -2,15 +2,14 @@
 #include "../../headers/rdma/connection.hpp"
 #include "../../headers/rdma/protocol.hpp"
 #include "../../headers/rdma/rdma_server.hpp"
-#include "../../headers/fs/path_utils.hpp"
-#include "../../headers/fs/file_reader.hpp"
-#include "../../headers/util/metrics.hpp"
+#include <algorithm>
 #include <cstring>
-#include <fmt/core.h>
+#include <utility>
 #include <infiniband/verbs.h>
 
 #include "../../headers/cache/lru_cache.hpp"
 #include "../../headers/util/config.hpp"
+#include "../../headers/util/logging.hpp"
 
 namespace rdma_fast {
 
@@ -35,8 +34,10 @@ Connection::Connection(RDMAServer* srv,
                        ibv_pd* pd,
                        ibv_cq* cq,
                        const Config& cfg,
-                       std::shared_ptr<LRUCache> cache)
-  : server_(srv), id_(id), pd_(pd), cq_(cq), cfg_(cfg), cache_(std::move(cache)) {}
+                       std::shared_ptr<LRUCache> cache,
+                       std::shared_ptr<const DocImage> image)
+  : server_(srv), id_(id), pd_(pd), cq_(cq), cfg_(cfg), session_(*this, cfg, std::move(cache), std::move(image)),
+    send_buf_size_(static_cast<std::size_t>(std::max(cfg.rdma_send_chunk, static_cast<int>(sizeof(RespHeader))))) {}
 
 Connection::~Connection() {
   close();
@@ -44,13 +45,14 @@ Connection::~Connection() {
 
 bool Connection::init() {
   std::lock_guard<std::mutex> g(mtx_);
+  arrived_.assign(static_cast<std::size_t>(std::max(1, cfg_.rdma_recv_bufs_per_conn)), nullptr);
   try {
     recv_pool_.reserve(cfg_.rdma_recv_bufs_per_conn);
     for (int i = 0; i < cfg_.rdma_recv_bufs_per_conn; ++i) {
       recv_pool_.push_back(std::make_unique<Buffer>(pd_, static_cast<size_t>(cfg_.rdma_recv_buf_size)));
     }
   } catch (const std::exception& ex) {
-    fmt::print(stderr, "[rdma] recv pool alloc failed: {}\n", ex.what());
+    log_warn("rdma: recv pool alloc failed: {}", ex.what());
     return false;
   }
   return post_recvs(cfg_.rdma_recv_bufs_per_conn);
@@ -73,6 +75,7 @@ bool Connection::post_recvs(int count) {
     sge.lkey = b->mr->lkey;
 
     auto work = new RecvWork(shared_from_this(), b);
+    work->seq = next_post_seq_;
 
     ibv_recv_wr wr{}, *bad = nullptr;
     wr.sg_list = &sge;
@@ -85,6 +88,7 @@ bool Connection::post_recvs(int count) {
       delete work;
       break;
     } else {
+      ++next_post_seq_;
       ++recv_inflight_;
       ++posted;
     }
@@ -92,100 +96,81 @@ bool Connection::post_recvs(int count) {
   return posted > 0;
 }
 
-void Connection::on_recv_complete(RecvWork* w, uint32_t byte_len) {
+void Connection::on_recv_complete(RecvWork* w, uint32_t byte_len, bool ok) {
+  w->len = byte_len;
+  w->ok = ok;
+  {
+    std::lock_guard<std::mutex> g(order_mtx_);
+    arrived_[w->seq % arrived_.size()] = w;
+    if (serving_) return;   // the poller serving this connection will get to it
+    serving_ = true;
+  }
+  while (true) {
+    RecvWork* next = nullptr;
+    {
+      std::lock_guard<std::mutex> g(order_mtx_);
+      auto& slot = arrived_[next_serve_seq_ % arrived_.size()];
+      if (!slot) {
+        serving_ = false;
+        return;
+      }
+      next = std::exchange(slot, nullptr);
+      ++next_serve_seq_;
+    }
+    serve_recv_(next);
+  }
+}
+
+void Connection::serve_recv_(RecvWork* w) {
   std::unique_ptr<RecvWork> work(w); // auto free
   Buffer* buf = work->buf;
 
-  // Parse request (can be less than buffer size)
-  Request req;
-  bool ok = parse_request(buf->data, byte_len, req);
-  if (!ok) {
-    // Malformed -> send error header with status 400 and no body
-    send_header(400, 0, 0);
-  } else {
-    Metrics::instance().rdma_reqs.fetch_add(1, std::memory_order_relaxed);
-    if (req.op == Op::PING) {
-      handle_ping();
-    } else if (req.op == Op::GET) {
-      handle_get(req.path);
-    } else {
-      send_header(400, 0, 0);
-    }
-  }
+  // Parse and serve in place (request can be less than buffer size)
+  if (work->ok) session_.on_message(buf->data, work->len);
 
-  // Reuse buffer: repost RECV
+  // Reuse buffer: repost RECV, unless the QP has failed or responses are backed up
   {
     std::lock_guard<std::mutex> g(mtx_);
     recv_pool_.push_back(std::unique_ptr<Buffer>(buf));
     --recv_inflight_;
-    post_recvs(1);
+    if (!work->ok) return;
+    if (session_.backlogged()) ++recv_deferred_;
+    else post_recvs(1);
   }
 }
 
-void Connection::handle_ping() {
-  send_header(200, 0, 0);
-  Metrics::instance().rdma_ok.fetch_add(1, std::memory_order_relaxed);
-}
-
-void Connection::handle_get(const std::string& url_path) {
-  // Map and serve, same as HTTP path
-  auto mapped = map_url_to_fs(cfg_.doc_root, url_path);
-  if (!mapped.ok) {
-    send_header(400, 0, 0);
-    Metrics::instance().rdma_err.fetch_add(1, std::memory_order_relaxed);
-    return;
-  }
-  if (!mapped.exists) {
-    send_header(404, 0, 0);
-    Metrics::instance().rdma_err.fetch_add(1, std::memory_order_relaxed);
-    return;
-  }
-
-  const std::string cache_key = mapped.cache_key;
-  LRUCache::Entry entry;
-  if (!cache_->get(cache_key, entry)) {
-    auto fr = read_file(mapped.fs_path);
-    if (!fr.ok) {
-      send_header(500, 0, 0);
-      Metrics::instance().rdma_err.fetch_add(1, std::memory_order_relaxed);
-      return;
+SendStatus Connection::try_send(const ConstBuf* bufs, std::size_t count) {
+  std::lock_guard<std::mutex> g(mtx_);
+  if (closed_) return SendStatus::Closed;
+  // Flow control: limit outstanding sends
+  if (sends_inflight_ >= cfg_.rdma_max_outstanding_sends) return SendStatus::WouldBlock;
+
+  Buffer* b = nullptr;
+  if (!send_free_.empty()) {
+    b = send_free_.back();
+    send_free_.pop_back();
+  } else {
+    try {
+      send_bufs_.push_back(std::make_unique<Buffer>(pd_, send_buf_size_));
+    } catch (const std::exception& ex) {
+      log_warn("rdma: send buffer alloc failed: {}", ex.what());
+      return SendStatus::Closed;
     }
-    LRUCache::Entry ne;
-    ne.body = std::make_shared<std::vector<uint8_t>>(std::move(fr.data));
-    ne.size = ne.body->size();
-    ne.last_modified = fr.last_modified;
-    ne.etag = make_etag(ne.size, ne.last_modified);
-    cache_->put(cache_key, ne);
-    entry = std::move(ne);
+    b = send_bufs_.back().get();
   }
 
-  uint64_t total = entry.body->size();
-  uint32_t chunk = static_cast<uint32_t>(std::max(1, std::min(cfg_.rdma_send_chunk, static_cast<int>(total))));
-  if (!send_header(200, total, chunk)) {
-    Metrics::instance().rdma_err.fetch_add(1, std::memory_order_relaxed);
-    return;
+  std::size_t len = 0;
+  for (std::size_t i = 0; i < count; ++i) {
+    std::memcpy(b->data + len, bufs[i].data, bufs[i].size);
+    len += bufs[i].size;
   }
-  if (total > 0) {
-    if (!send_body_chunks(entry.body, chunk)) {
-      Metrics::instance().rdma_err.fetch_add(1, std::memory_order_relaxed);
-      return;
-    }
-  }
-  Metrics::instance().rdma_ok.fetch_add(1, std::memory_order_relaxed);
-  Metrics::instance().rdma_bytes.fetch_add(total, std::memory_order_relaxed);
-}
-
-bool Connection::send_header(uint16_t status, uint64_t content_len, uint32_t chunk) {
-  auto header_bytes = make_resp_header(status, content_len, chunk);
-  auto b = std::make_unique<Buffer>(pd_, header_bytes.size());
-  std::memcpy(b->data, header_bytes.data(), header_bytes.size());
 
   ibv_sge sge{};
   sge.addr = reinterpret_cast<uint64_t>(b->data);
-  sge.length = static_cast<uint32_t>(header_bytes.size());
+  sge.length = static_cast<uint32_t>(len);
   sge.lkey = b->mr->lkey;
 
-  auto work = new SendWork(shared_from_this(), b.get());
+  auto work = new SendWork(shared_from_this(), b);
 
   ibv_send_wr wr{}, *bad=nullptr;
   wr.sg_list = &sge;
@@ -194,92 +179,36 @@ bool Connection::send_header(uint16_t status, uint64_t content_len, uint32_t chu
   wr.send_flags = IBV_SEND_SIGNALED;
   wr.wr_id = reinterpret_cast<uint64_t>(work);
 
-  {
-    std::lock_guard<std::mutex> g(mtx_);
-    if (ibv_post_send(id_->qp, &wr, &bad)) {
-      delete work;
-      return false;
-    }
-    ++sends_inflight_;
-    // transfer ownership to inflight queue (reclaimed on send complete)
-    send_queue_.push_back(SendItem{std::move(b)});
-  }
-  return true;
-}
-
-bool Connection::send_body_chunks(const std::shared_ptr<std::vector<uint8_t>>& body, uint32_t chunk) {
-  std::lock_guard<std::mutex> g(mtx_);
-  size_t off = 0;
-  const size_t total = body->size();
-
-  while (off < total) {
-    const size_t n = std::min(static_cast<size_t>(chunk), total - off);
-
-    auto b = std::make_unique<Buffer>(pd_, n);
-    std::memcpy(b->data, body->data() + off, n);
-
-    ibv_sge sge{};
-    sge.addr = reinterpret_cast<uint64_t>(b->data);
-    sge.length = static_cast<uint32_t>(n);
-    sge.lkey = b->mr->lkey;
-
-    auto work = new SendWork(shared_from_this(), b.get());
-
-    ibv_send_wr wr{}, *bad=nullptr;
-    wr.sg_list = &sge;
-    wr.num_sge = 1;
-    wr.opcode = IBV_WR_SEND;
-    wr.send_flags = IBV_SEND_SIGNALED;
-    wr.wr_id = reinterpret_cast<uint64_t>(work);
-
-    // Flow control: limit outstanding sends
-    if (sends_inflight_ >= cfg_.rdma_max_outstanding_sends) {
-      // Stop posting more now; queue buffer and let on_send_complete post later
-      send_queue_.push_back(SendItem{std::move(b)});
-      // Store wr details by re-creating when dequeued; to keep simple, we post immediately but rely on HCA queue.
-      // Simpler approach: post and rely on HCA; still enforce a high watermark.
-    }
-
-    if (ibv_post_send(id_->qp, &wr, &bad)) {
-      delete work;
-      return false;
-    }
-    ++sends_inflight_;
-    send_queue_.push_back(SendItem{std::move(b)});
-
-    off += n;
+  if (ibv_post_send(id_->qp, &wr, &bad)) {
+    delete work;
+    send_free_.push_back(b);
+    return SendStatus::Closed;
   }
-  return true;
+  ++sends_inflight_;
+  return SendStatus::Ok;
 }
 
-void Connection::try_post_more_sends_locked() {
-  // This placeholder can be extended to post deferred sends if you implement a separate queue of not-yet-posted WRs.
-}
-
-void Connection::on_send_complete(SendWork* w) {
+void Connection::on_send_complete(SendWork* w, bool ok) {
   std::unique_ptr<SendWork> work(w);
-  Buffer* buf = work->buf;
-
+  {
+    std::lock_guard<std::mutex> g(mtx_);
+    send_free_.push_back(work->buf);
+    --sends_inflight_;
+    if (sends_inflight_ < 0) sends_inflight_ = 0;
+  }
+  // The QP is in error after a failed send; nothing more will go out on it
+  if (!ok) return;
+  // Credit freed: let the protocol post deferred chunks
+  session_.on_writable();
+  // Checked under mtx_, as serve_recv_ does: whichever runs second sees the drain
   std::lock_guard<std::mutex> g(mtx_);
-  // Find and reclaim the matching buffer from send_queue_
-  // For simplicity we reclaim from front if matches pointer.
-  if (!send_queue_.empty() && send_queue_.front().buf.get() == buf) {
-    send_queue_.pop_front(); // unique_ptr will delete buffer
-  } else {
-    // Fallback: search (shouldn't happen in order)
-    for (auto it = send_queue_.begin(); it != send_queue_.end(); ++it) {
-      if (it->buf.get() == buf) {
-        send_queue_.erase(it);
-        break;
-      }
-    }
+  if (recv_deferred_ && !closed_ && !session_.backlogged()) {
+    post_recvs(std::exchange(recv_deferred_, 0));
   }
-  --sends_inflight_;
-  if (sends_inflight_ < 0) sends_inflight_ = 0;
-  try_post_more_sends_locked();
 }
 
 void Connection::close() {
+  session_.close();
   std::lock_guard<std::mutex> g(mtx_);
   if (closed_) return;
   closed_ = true;
@@ -287,4 +216,4 @@ void Connection::close() {
 }
 
 } // namespace rdma_fast
-#endif
\ No newline at end of file
+#endif
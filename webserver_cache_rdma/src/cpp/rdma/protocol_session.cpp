@@ -0,0 +1,289 @@
+#include "../../headers/rdma/protocol_session.hpp"
+#include "../../headers/fs/path_utils.hpp"
+#include "../../headers/fs/file_reader.hpp"
+#include "../../headers/util/metrics.hpp"
+#include "../../headers/util/access_trace.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace rdma_fast {
+
+namespace {
+// Queued responses (a GET is two: header and body) beyond which input is paused
+constexpr std::size_t kMaxQueuedOutputs = 64;
+}
+
+ProtocolSession::ProtocolSession(Transport& t, const Config& cfg, std::shared_ptr<LRUCache> cache,
+                                 std::shared_ptr<const DocImage> image)
+  : t_(t), cfg_(cfg), cache_(std::move(cache)), image_(std::move(image)) {}
+
+void ProtocolSession::on_message(const char* data, std::size_t len) {
+  Request req;
+  if (!parse_request(data, len, req)) {
+    // Malformed -> send error header with status 400 and no body
+    std::lock_guard<std::mutex> g(mtx_);
+    queue_header(400, 0, 0);
+    pump_locked();
+    return;
+  }
+
+  Metrics::instance().rdma_reqs.fetch_add(1, std::memory_order_relaxed);
+  if (req.op == Op::PING) {
+    handle_ping();
+  } else if (req.op == Op::GET) {
+    handle_get(req.path);
+  } else if (req.op == Op::MGET) {
+    handle_mget(req.paths);
+  } else {
+    std::lock_guard<std::mutex> g(mtx_);
+    queue_header(400, 0, 0);
+    pump_locked();
+  }
+}
+
+void ProtocolSession::handle_ping() {
+  {
+    std::lock_guard<std::mutex> g(mtx_);
+    queue_header(200, 0, 0);
+    pump_locked();
+  }
+  Metrics::instance().rdma_ok.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint16_t ProtocolSession::lookup(const std::string& url_path, ObjectPtr& body) {
+  // Map and serve, same as HTTP path
+  if (image_) {
+    body = image_->find_target(url_path, false);
+    (body ? Metrics::instance().image_hits : Metrics::instance().image_misses).fetch_add(1, std::memory_order_relaxed);
+    return body ? 200 : 404;
+  }
+  ObjectPtr obj;
+  if (const auto key = direct_cache_key(url_path); !key.empty()) {
+    obj = cache_->get(key);
+    if (obj) access_trace::record(key, obj->size(), true, access_trace::Source::FastPath);
+  }
+  if (!obj) {
+    if (const int status = cache_->negative(url_path)) {
+      Metrics::instance().cache_negative_hits.fetch_add(1, std::memory_order_relaxed);
+      return static_cast<uint16_t>(status);
+    }
+    auto mapped = map_url_to_fs(cfg_.doc_root, url_path);
+    if (!mapped.ok) {
+      if (mapped.outside_root) cache_->put_negative(url_path, 400);
+      return 400;
+    }
+    if (!mapped.exists) {
+      cache_->put_negative(url_path, 404);
+      return 404;
+    }
+
+    obj = cache_->get(mapped.cache_key);
+    const bool hit = obj != nullptr;
+    if (!obj) {
+      auto fr = read_file(mapped.fs_path);
+      if (!fr.ok) return 500;
+      obj = make_cached_object(std::move(fr.data), fr.last_modified, mapped.fs_path);
+      cache_->put(mapped.cache_key, obj);
+    }
+    access_trace::record(mapped.cache_key, obj->size(), hit, access_trace::Source::FastPath);
+  }
+  body = obj;
+  return 200;
+}
+
+uint32_t ProtocolSession::chunk_for(uint64_t total) const {
+  const std::size_t max_chunk = std::min(static_cast<std::size_t>(std::max(1, cfg_.rdma_send_chunk)), t_.max_message());
+  return static_cast<uint32_t>(std::max<uint64_t>(1, std::min<uint64_t>(max_chunk, total)));
+}
+
+void ProtocolSession::handle_get(const std::string& url_path) {
+  ObjectPtr body;
+  const uint16_t status = lookup(url_path, body);
+  if (status != 200) {
+    std::lock_guard<std::mutex> g(mtx_);
+    queue_header(status, 0, 0);
+    pump_locked();
+    Metrics::instance().rdma_err.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  const uint64_t total = body->size();
+  const uint32_t chunk = chunk_for(total);
+  {
+    std::lock_guard<std::mutex> g(mtx_);
+    queue_header(200, total, chunk);
+    if (total > 0) queue_body(std::move(body), chunk);
+    pump_locked();
+  }
+  Metrics::instance().rdma_ok.fetch_add(1, std::memory_order_relaxed);
+  Metrics::instance().rdma_bytes.fetch_add(total, std::memory_order_relaxed);
+}
+
+// One reply for the whole batch: header, per-item table and all bodies are streamed
+// as a single byte sequence, so small objects share SENDs instead of costing two each.
+void ProtocolSession::handle_mget(const std::vector<std::string>& paths) {
+  auto& m = Metrics::instance();
+  if (paths.empty() || static_cast<int>(paths.size()) > cfg_.rdma_max_batch) {
+    std::lock_guard<std::mutex> g(mtx_);
+    queue_header(400, 0, 0);
+    pump_locked();
+    m.rdma_err.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  Out o;
+  o.kind = OutKind::Batch;
+  o.parts.resize(paths.size());
+  o.prefix.resize(sizeof(RespHeader) + paths.size() * sizeof(MgetItem));
+
+  uint64_t content_len = paths.size() * sizeof(MgetItem);
+  uint64_t bytes = 0;
+  auto* items = o.prefix.data() + sizeof(RespHeader);
+  for (std::size_t i = 0; i < paths.size(); ++i) {
+    MgetItem it{};
+    it.status = lookup(paths[i], o.parts[i]);
+    it.len = it.status == 200 ? o.parts[i]->size() : 0;
+    if (it.status != 200) o.parts[i].reset();
+    std::memcpy(items + i * sizeof(MgetItem), &it, sizeof(it));
+    bytes += it.len;
+  }
+  content_len += bytes;
+
+  // The header shares the first message, so chunk counts from the start of the stream
+  RespHeader h{};
+  h.status = 200;
+  h.content_len = content_len;
+  h.chunk_size = chunk_for(sizeof(RespHeader) + content_len);
+  std::memcpy(o.prefix.data(), &h, sizeof(h));
+  o.chunk = h.chunk_size;
+
+  {
+    std::lock_guard<std::mutex> g(mtx_);
+    if (!closed_) out_.push_back(std::move(o));
+    pump_locked();
+  }
+  m.rdma_ok.fetch_add(1, std::memory_order_relaxed);
+  m.rdma_batch_items.fetch_add(paths.size(), std::memory_order_relaxed);
+  m.rdma_bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void ProtocolSession::queue_header(uint16_t status, uint64_t content_len, uint32_t chunk) {
+  if (closed_) return;
+  Out o;
+  o.kind = OutKind::Head;
+  o.head.status = status;
+  o.head.content_len = content_len;
+  o.head.chunk_size = chunk;
+  out_.push_back(std::move(o));
+}
+
+void ProtocolSession::queue_body(ObjectPtr body, uint32_t chunk) {
+  if (closed_) return;
+  Out o;
+  o.kind = OutKind::Body;
+  o.end = body->size();
+  o.body = std::move(body);
+  o.chunk = chunk;
+  out_.push_back(std::move(o));
+}
+
+// Fills one message of up to o.chunk bytes from wherever the batch stream left off,
+// gathering across segment boundaries.
+SendStatus ProtocolSession::send_batch_part(Out& o) {
+  constexpr std::size_t kMaxGather = 256;
+  ConstBuf bufs[kMaxGather];
+  std::size_t nb = 0;
+  std::size_t room = o.chunk;
+  std::size_t seg = o.seg;
+  std::size_t off = o.off;
+
+  auto seg_data = [&o](std::size_t i, std::size_t& len) -> const uint8_t* {
+    if (i == 0) {
+      len = o.prefix.size();
+      return o.prefix.data();
+    }
+    const auto& p = o.parts[i - 1];
+    len = p ? p->size() : 0;
+    return p ? p->data() : nullptr;
+  };
+
+  while (seg <= o.parts.size() && nb < kMaxGather) {
+    std::size_t len = 0;
+    const uint8_t* base = seg_data(seg, len);
+    if (off < len) {
+      if (room == 0) break;
+      const std::size_t take = std::min(room, len - off);
+      bufs[nb++] = ConstBuf{base + off, take};
+      room -= take;
+      off += take;
+    }
+    if (off == len) {
+      ++seg;
+      off = 0;
+    }
+  }
+
+  SendStatus st = nb ? t_.try_send(bufs, nb) : SendStatus::Ok;
+  if (st == SendStatus::Ok) {
+    o.seg = seg;
+    o.off = off;
+  }
+  return st;
+}
+
+// Hands queued output to the transport until it runs out of credit. Body chunks are
+// only materialized once they can be sent, so a large file never sits fully copied in
+// transport buffers.
+void ProtocolSession::pump_locked() {
+  pump_queue_locked();
+  backlogged_.store(out_.size() > kMaxQueuedOutputs, std::memory_order_release);
+}
+
+void ProtocolSession::pump_queue_locked() {
+  while (!out_.empty() && !closed_) {
+    Out& o = out_.front();
+    SendStatus st;
+    if (o.kind == OutKind::Head) {
+      ConstBuf b{&o.head, sizeof(RespHeader)};
+      st = t_.try_send(&b, 1);
+      if (st == SendStatus::Ok) {
+        out_.pop_front();
+        continue;
+      }
+    } else if (o.kind == OutKind::Body) {
+      const std::size_t n = std::min<std::size_t>(o.chunk, o.end - o.off);
+      ConstBuf b{o.body->data() + o.off, n};
+      st = t_.try_send(&b, 1);
+      if (st == SendStatus::Ok) {
+        o.off += n;
+        if (o.off >= o.end) out_.pop_front();
+        continue;
+      }
+    } else {
+      st = send_batch_part(o);
+      if (st == SendStatus::Ok) {
+        if (o.seg > o.parts.size()) out_.pop_front();
+        continue;
+      }
+    }
+    if (st == SendStatus::Closed) {
+      closed_ = true;
+      out_.clear();
+    }
+    return; // WouldBlock: resumed from on_writable()
+  }
+}
+
+void ProtocolSession::on_writable() {
+  std::lock_guard<std::mutex> g(mtx_);
+  pump_locked();
+}
+
+void ProtocolSession::close() {
+  std::lock_guard<std::mutex> g(mtx_);
+  closed_ = true;
+  out_.clear();
+  backlogged_.store(false, std::memory_order_release);
+}
+
+} // namespace rdma_fast
@@ -9,11 +9,15 @@
 #include <stdexcept>
 #include <chrono>
 #include <thread>
+#include <fcntl.h>
+#include <poll.h>
 #include <fmt/format.h>
 
 
 #include "../../headers/util/config.hpp"
 #include "../../headers/cache/lru_cache.hpp"
+#include "../../headers/util/metrics.hpp"
+#include "../../headers/util/logging.hpp"
 
 template <>
 struct fmt::formatter<ibv_wc_status> : fmt::formatter<int> {
@@ -31,8 +35,9 @@ namespace rdma_fast {
     return addr;
   }
 
-  RDMAServer::RDMAServer(const RDMAConfig &cfg, const Config &app_cfg, std::shared_ptr<LRUCache> cache)
-    : cfg_(cfg), app_cfg_(app_cfg), cache_(std::move(cache)) {
+  RDMAServer::RDMAServer(const RDMAConfig &cfg, const Config &app_cfg, std::shared_ptr<LRUCache> cache,
+                         std::shared_ptr<const DocImage> image)
+    : cfg_(cfg), app_cfg_(app_cfg), cache_(std::move(cache)), image_(std::move(image)) {
   }
 
   RDMAServer::~RDMAServer() {
@@ -54,8 +59,9 @@ namespace rdma_fast {
     if (rdma_listen(listen_id_, 64))
       throw std::runtime_error("rdma_listen failed");
 
-    fmt::print("[rdma] Listening on {}:{} (cq_depth={}, pollers={})\n",
-               cfg_.bind_addr, cfg_.port, cfg_.cq_depth, cfg_.poller_threads);
+    log_info("rdma: listening on {}:{} (cq_depth={}, pollers={}, poll_batch={}, busy_poll_us={})",
+             cfg_.bind_addr, cfg_.port, cfg_.cq_depth, cfg_.poller_threads,
+             cfg_.poll_batch, cfg_.busy_poll_us);
 
     cm_thread_ = std::thread([this] { cm_event_loop_(); });
     for (int i = 0; i < cfg_.poller_threads; ++i)
@@ -74,6 +80,7 @@ namespace rdma_fast {
       conns_.clear();
     }
 
+    cq_ready_ = false;
     if (cq_) {
       ibv_destroy_cq(cq_);
       cq_ = nullptr;
@@ -96,7 +103,7 @@ namespace rdma_fast {
       ec_ = nullptr;
     }
 
-    fmt::print("[rdma] Stopped\n");
+    log_info("rdma: stopped");
   }
 
   void RDMAServer::cm_event_loop_() {
@@ -116,23 +123,26 @@ namespace rdma_fast {
           ibv_context *ctx = id->verbs;
           pd_ = ibv_alloc_pd(ctx);
           if (!pd_) {
-            fmt::print(stderr, "[rdma] ibv_alloc_pd failed\n");
+            log_warn("rdma: ibv_alloc_pd failed");
             rdma_reject(id, nullptr, 0);
             continue;
           }
           comp_ch_ = ibv_create_comp_channel(ctx);
           if (!comp_ch_) {
-            fmt::print(stderr, "[rdma] ibv_create_comp_channel failed\n");
+            log_warn("rdma: ibv_create_comp_channel failed");
             rdma_reject(id, nullptr, 0);
             continue;
           }
+          // Pollers wait on the channel fd with poll(2) so they can notice stop()
+          int flags = fcntl(comp_ch_->fd, F_GETFL);
+          fcntl(comp_ch_->fd, F_SETFL, flags | O_NONBLOCK);
           cq_ = ibv_create_cq(ctx, cfg_.cq_depth, nullptr, comp_ch_, 0);
           if (!cq_) {
-            fmt::print(stderr, "[rdma] ibv_create_cq failed\n");
+            log_warn("rdma: ibv_create_cq failed");
             rdma_reject(id, nullptr, 0);
             continue;
           }
-          ibv_req_notify_cq(cq_, 0);
+          cq_ready_ = true;
         }
 
         ibv_qp_init_attr qp_attr{};
@@ -145,14 +155,14 @@ namespace rdma_fast {
         qp_attr.cap.max_recv_sge = 1;
 
         if (rdma_create_qp(id, pd_, &qp_attr)) {
-          fmt::print(stderr, "[rdma] rdma_create_qp failed\n");
+          log_warn("rdma: rdma_create_qp failed");
           rdma_reject(id, nullptr, 0);
           continue;
         }
 
-        auto conn = std::make_shared<Connection>(this, id, pd_, cq_, app_cfg_, cache_);
+        auto conn = std::make_shared<Connection>(this, id, pd_, cq_, app_cfg_, cache_, image_);
         if (!conn->init()) {
-          fmt::print(stderr, "[rdma] connection init failed\n");
+          log_warn("rdma: connection init failed");
           rdma_destroy_qp(id);
           rdma_reject(id, nullptr, 0);
           continue;
@@ -164,7 +174,7 @@ namespace rdma_fast {
         param.rnr_retry_count = 7;
 
         if (rdma_accept(id, &param)) {
-          fmt::print(stderr, "[rdma] rdma_accept failed\n");
+          log_warn("rdma: rdma_accept failed");
           rdma_destroy_qp(id);
           continue;
         }
@@ -174,7 +184,7 @@ namespace rdma_fast {
           conns_.insert(conn);
         }
 
-        fmt::print("[rdma] Accepted connection qp_num={}\n", conn->qp_num());
+        log_debug("rdma: accepted connection qp_num={}", conn->qp_num());
       } else if (event == RDMA_CM_EVENT_DISCONNECTED) {
         // Find and remove the connection (shared_ptr will clean up)
         std::lock_guard<std::mutex> g(conns_mtx_);
@@ -188,53 +198,123 @@ namespace rdma_fast {
         }
         if (id->qp) rdma_destroy_qp(id);
         rdma_destroy_id(id);
-        fmt::print("[rdma] Disconnected\n");
+        log_debug("rdma: disconnected");
       }
     }
   }
 
+  // Hybrid poller: drain the CQ in batches and keep spinning for busy_poll_us after the
+  // last completion; once the CQ has been quiet that long, arm notification and sleep
+  // on the completion channel. busy_poll_us = 0 gives a purely event-driven poller.
   void RDMAServer::cq_poller_loop_() {
+    auto &m = Metrics::instance();
+    std::vector<ibv_wc> wcs(static_cast<size_t>(std::max(1, cfg_.poll_batch)));
+    const auto budget = std::chrono::microseconds(std::max(0, cfg_.busy_poll_us));
+
+    auto last_activity = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point woke_at{};
+    bool woken = false;
+
     while (running_) {
-      ibv_cq *cq = nullptr;
-      void *cq_ctx = nullptr;
-      int rc = ibv_get_cq_event(comp_ch_, &cq, &cq_ctx);
-      if (rc) {
-        if (!running_) break;
+      if (!cq_ready_) {
         std::this_thread::sleep_for(std::chrono::milliseconds(1));
         continue;
       }
-      ibv_ack_cq_events(cq, 1);
-      ibv_req_notify_cq(cq, 0);
-
-      while (running_) {
-        ibv_wc wc{};
-        int n = ibv_poll_cq(cq, 32, &wc);
-        if (n < 0) {
-          fmt::print(stderr, "[rdma] ibv_poll_cq error\n");
-          break;
-        }
-        if (n == 0) break;
 
-        if (wc.status != IBV_WC_SUCCESS) {
-          fmt::print(stderr, "[rdma] CQE status {} wr_id {}\n", wc.status, wc.wr_id);
-          // Free work item if present
-          auto *base = reinterpret_cast<WorkBase *>(wc.wr_id);
-          delete base;
-          continue;
+      int n = drain_cq_(wcs);
+      if (n < 0) break;
+      auto now = std::chrono::steady_clock::now();
+      if (n > 0) {
+        if (woken) {
+          m.rdma_cq_wakeup_ns.fetch_add(static_cast<unsigned long long>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(now - woke_at).count()),
+            std::memory_order_relaxed);
+          woken = false;
         }
+        last_activity = now;
+        continue;
+      }
+      if (now - last_activity < budget) continue;
+
+      // Quiet for the whole budget: arm, then re-poll to close the race with
+      // completions that landed before the notification was armed.
+      ibv_req_notify_cq(cq_, 0);
+      n = drain_cq_(wcs);
+      if (n < 0) break;
+      if (n > 0) {
+        last_activity = std::chrono::steady_clock::now();
+        continue;
+      }
+      if (wait_cq_event_()) {
+        woke_at = std::chrono::steady_clock::now();
+        woken = true;
+        last_activity = woke_at;
+        m.rdma_cq_wakeups.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+  }
 
-        if (wc.opcode == IBV_WC_RECV) {
-          auto *w = reinterpret_cast<RecvWork *>(wc.wr_id);
-          w->conn->on_recv_complete(w, wc.byte_len);
-        } else if (wc.opcode == IBV_WC_SEND) {
-          auto *w = reinterpret_cast<SendWork *>(wc.wr_id);
-          w->conn->on_send_complete(w);
-        } else {
-          // Ignore other opcodes for this protocol
-          auto *base = reinterpret_cast<WorkBase *>(wc.wr_id);
-          delete base;
-        }
+  int RDMAServer::drain_cq_(std::vector<ibv_wc> &wcs) {
+    auto &m = Metrics::instance();
+    int n = ibv_poll_cq(cq_, static_cast<int>(wcs.size()), wcs.data());
+    if (n < 0) {
+      log_warn("rdma: ibv_poll_cq error");
+      return n;
+    }
+    m.rdma_cq_polls.fetch_add(1, std::memory_order_relaxed);
+    if (n == 0) {
+      m.rdma_cq_empty_polls.fetch_add(1, std::memory_order_relaxed);
+      return 0;
+    }
+    m.rdma_cq_completions.fetch_add(static_cast<unsigned long long>(n), std::memory_order_relaxed);
+    for (int i = 0; i < n; ++i) handle_wc(wcs[static_cast<size_t>(i)]);
+    return n;
+  }
+
+  // Sleeps on the completion channel; returns true if a CQ event was consumed.
+  bool RDMAServer::wait_cq_event_() {
+    pollfd pfd{};
+    pfd.fd = comp_ch_->fd;
+    pfd.events = POLLIN;
+    if (::poll(&pfd, 1, 100) <= 0) return false;
+
+    ibv_cq *cq = nullptr;
+    void *cq_ctx = nullptr;
+    if (ibv_get_cq_event(comp_ch_, &cq, &cq_ctx)) return false;
+    ibv_ack_cq_events(cq, 1);
+    return true;
+  }
+
+  void RDMAServer::handle_wc(const ibv_wc &wc) {
+    if (wc.status != IBV_WC_SUCCESS) {
+      // Flushed receives show up here at every disconnect: count them, log only at debug
+      Metrics::instance().rdma_cq_errors.fetch_add(1, std::memory_order_relaxed);
+      log_debug("rdma: CQE status {} wr_id {}", wc.status, wc.wr_id);
+      auto *base = reinterpret_cast<WorkBase *>(wc.wr_id);
+      // A receive keeps its place in the connection's order and a send returns its
+      // buffer and credit; only unknown work is freed here
+      if (auto *w = dynamic_cast<RecvWork *>(base)) {
+        w->conn->on_recv_complete(w, 0, false);
+        return;
+      }
+      if (auto *w = dynamic_cast<SendWork *>(base)) {
+        w->conn->on_send_complete(w, false);
+        return;
       }
+      delete base;
+      return;
+    }
+
+    if (wc.opcode == IBV_WC_RECV) {
+      auto *w = reinterpret_cast<RecvWork *>(wc.wr_id);
+      w->conn->on_recv_complete(w, wc.byte_len);
+    } else if (wc.opcode == IBV_WC_SEND) {
+      auto *w = reinterpret_cast<SendWork *>(wc.wr_id);
+      w->conn->on_send_complete(w);
+    } else {
+      // Ignore other opcodes for this protocol
+      auto *base = reinterpret_cast<WorkBase *>(wc.wr_id);
+      delete base;
     }
   }
 } // namespace rdma_fast
@@ -0,0 +1,140 @@
+#include "../../headers/rdma/shm_transport.hpp"
+
+#include <chrono>
+#include <cstring>
+
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace rdma_fast {
+
+ShmClient::~ShmClient() {
+  close();
+}
+
+bool ShmClient::connect(const std::string& socket_path) {
+  close();
+  sock_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (sock_ < 0) return false;
+
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  if (socket_path.size() >= sizeof(addr.sun_path)) return false;
+  std::memcpy(addr.sun_path, socket_path.c_str(), socket_path.size() + 1);
+  if (::connect(sock_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr))) {
+    close();
+    return false;
+  }
+
+  shm::Hello hello{};
+  int fds[3] = {-1, -1, -1};
+  iovec iov{&hello, sizeof(hello)};
+  alignas(cmsghdr) char ctrl[CMSG_SPACE(sizeof(fds))]{};
+  msghdr msg{};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = ctrl;
+  msg.msg_controllen = sizeof(ctrl);
+  if (::recvmsg(sock_, &msg, MSG_CMSG_CLOEXEC) != static_cast<ssize_t>(sizeof(hello))) {
+    close();
+    return false;
+  }
+  cmsghdr* cm = CMSG_FIRSTHDR(&msg);
+  if (!cm || cm->cmsg_type != SCM_RIGHTS || cm->cmsg_len != CMSG_LEN(sizeof(fds))) {
+    close();
+    return false;
+  }
+  std::memcpy(fds, CMSG_DATA(cm), sizeof(fds));
+  memfd_ = fds[0];
+  server_efd_ = fds[1];
+  client_efd_ = fds[2];
+  if (hello.magic != shm::kHelloMagic) {
+    close();
+    return false;
+  }
+
+  const std::size_t fp = shm::Ring::footprint(hello.ring_capacity);
+  map_len_ = 2 * fp;
+  base_ = ::mmap(nullptr, map_len_, PROT_READ | PROT_WRITE, MAP_SHARED, memfd_, 0);
+  if (base_ == MAP_FAILED) {
+    base_ = nullptr;
+    close();
+    return false;
+  }
+  req_ = shm::Ring(base_, hello.ring_capacity);
+  resp_ = shm::Ring(static_cast<char*>(base_) + fp, hello.ring_capacity);
+  return true;
+}
+
+void ShmClient::close() {
+  if (base_) ::munmap(base_, map_len_);
+  base_ = nullptr;
+  for (int* fd : {&memfd_, &server_efd_, &client_efd_, &sock_}) {
+    if (*fd >= 0) ::close(*fd);
+    *fd = -1;
+  }
+}
+
+bool ShmClient::wait_(int timeout_ms) {
+  pollfd pfds[2]{};
+  pfds[0].fd = client_efd_;
+  pfds[0].events = POLLIN;
+  pfds[1].fd = sock_;
+  pfds[1].events = POLLIN | POLLRDHUP;
+  if (::poll(pfds, 2, timeout_ms) <= 0) return false;
+  if (pfds[1].revents) return false; // server went away
+  shm::drain_eventfd(client_efd_);
+  return true;
+}
+
+bool ShmClient::send(const void* data, std::size_t n) {
+  if (!base_) return false;
+  ConstBuf b{data, n};
+  auto* h = req_.header();
+  while (true) {
+    if (req_.try_write(&b, 1)) {
+      shm::notify_if_waiting(h->consumer_waiting, server_efd_);
+      return true;
+    }
+    if (n > req_.max_message()) return false;
+    if (shm::arm_wait(h->producer_waiting, [&] { return req_.try_write(&b, 1); })) {
+      if (!wait_(-1)) return false;
+    } else {
+      shm::notify_if_waiting(h->consumer_waiting, server_efd_);
+      return true;
+    }
+  }
+}
+
+bool ShmClient::recv(std::vector<uint8_t>& out, int timeout_ms) {
+  if (!base_) return false;
+  auto* h = resp_.header();
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+  while (true) {
+    const char* data = nullptr;
+    std::size_t len = 0;
+    // Spin briefly before paying for a doorbell round trip
+    for (int spin = 0; spin < 2000; ++spin) {
+      if (resp_.peek(data, len)) {
+        out.assign(data, data + len);
+        resp_.pop();
+        shm::notify_if_waiting(h->producer_waiting, server_efd_);
+        return true;
+      }
+    }
+    if (!shm::arm_wait(h->consumer_waiting, [this] { return !resp_.empty(); })) continue;
+
+    int wait_ms = -1;
+    if (timeout_ms >= 0) {
+      auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+      if (left <= 0) return false;
+      wait_ms = static_cast<int>(left);
+    }
+    if (!wait_(wait_ms)) return false;
+  }
+}
+
+} // namespace rdma_fast
@@ -0,0 +1,129 @@
+#include "../../headers/rdma/shm_transport.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+#include <unistd.h>
+
+namespace rdma_fast {
+namespace shm {
+
+static constexpr std::size_t align_up(std::size_t n, std::size_t a) { return (n + a - 1) & ~(a - 1); }
+
+Ring::Ring(void* base, uint64_t capacity)
+  : hdr_(static_cast<RingHeader*>(base)),
+    data_(static_cast<char*>(base) + align_up(sizeof(RingHeader), 64)),
+    cap_(capacity),
+    mask_(capacity - 1) {}
+
+std::size_t Ring::footprint(uint64_t capacity) {
+  return align_up(sizeof(RingHeader), 64) + static_cast<std::size_t>(capacity);
+}
+
+void Ring::init(uint64_t capacity) {
+  new (hdr_) RingHeader{};
+  hdr_->capacity = capacity;
+}
+
+bool Ring::try_write(const ConstBuf* bufs, std::size_t count) {
+  std::size_t len = 0;
+  for (std::size_t i = 0; i < count; ++i) len += bufs[i].size;
+  if (len > max_message()) return false;
+
+  const uint64_t cap = cap_;
+  const uint64_t need = 8 + align_up(len, 8);
+  uint64_t tail = tail_;
+  const uint64_t head = hdr_->head.load(std::memory_order_acquire);
+  if (tail - head > cap) return false;   // a head we never reached: treat as full
+  uint64_t pos = tail & mask_;
+  const uint64_t skip = (pos + need > cap) ? cap - pos : 0;
+  if (cap - (tail - head) < skip + need) return false;
+
+  if (skip) {
+    const uint32_t wrap = kWrap;
+    std::memcpy(data_ + pos, &wrap, sizeof(wrap));
+    tail += skip;
+    pos = 0;
+  }
+
+  char* p = data_ + pos;
+  const uint32_t l = static_cast<uint32_t>(len);
+  std::memcpy(p, &l, sizeof(l));
+  std::size_t off = 8;
+  for (std::size_t i = 0; i < count; ++i) {
+    std::memcpy(p + off, bufs[i].data, bufs[i].size);
+    off += bufs[i].size;
+  }
+  tail_ = tail + need;
+  hdr_->tail.store(tail_, std::memory_order_release);
+  return true;
+}
+
+bool Ring::peek(const char*& data, std::size_t& len) {
+  if (corrupt_) return false;
+  while (true) {
+    const uint64_t avail = hdr_->tail.load(std::memory_order_acquire) - head_;
+    if (avail == 0) return false;
+    // head_ only moves in multiples of 8, so a record header always fits before the end
+    const uint64_t pos = head_ & mask_;
+    if (avail > cap_ || avail < 8) {
+      corrupt_ = true;
+      return false;
+    }
+    uint32_t l = 0;
+    std::memcpy(&l, data_ + pos, sizeof(l));
+    if (l == kWrap) {
+      if (cap_ - pos > avail) {
+        corrupt_ = true;
+        return false;
+      }
+      head_ += cap_ - pos;
+      hdr_->head.store(head_, std::memory_order_release);
+      continue;
+    }
+    const uint64_t need = 8 + align_up(l, 8);
+    if (l > max_message() || need > avail || need > cap_ - pos) {
+      corrupt_ = true;
+      return false;
+    }
+    data = data_ + pos + 8;
+    len = l;
+    peeked_ = need;
+    return true;
+  }
+}
+
+void Ring::pop() {
+  head_ += peeked_;
+  hdr_->head.store(head_, std::memory_order_release);
+  peeked_ = 0;
+}
+
+bool Ring::empty() const {
+  return corrupt_ || head_ == hdr_->tail.load(std::memory_order_acquire);
+}
+
+void notify_if_waiting(std::atomic<uint32_t>& waiting, int efd) {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (waiting.load(std::memory_order_relaxed) && waiting.exchange(0)) {
+    const uint64_t one = 1;
+    [[maybe_unused]] auto r = ::write(efd, &one, sizeof(one));
+  }
+}
+
+void drain_eventfd(int efd) {
+  uint64_t v = 0;
+  while (::read(efd, &v, sizeof(v)) == static_cast<ssize_t>(sizeof(v))) {}
+}
+
+uint64_t ring_capacity_for(int kb) {
+  uint64_t want = static_cast<uint64_t>(std::max(64, kb)) * 1024ull;
+  uint64_t cap = 1;
+  while (cap < want) cap <<= 1;
+  return cap;
+}
+
+} // namespace shm
+
+} // namespace rdma_fast
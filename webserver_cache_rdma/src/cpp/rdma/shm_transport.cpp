@@ -0,0 +1,290 @@
+#include "../../headers/rdma/shm_transport.hpp"
+#include "../../headers/util/logging.hpp"
+#include "../../headers/util/metrics.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace rdma_fast {
+
+// ---------------------------------------------------------------------------
+// ShmConnection
+
+ShmConnection::ShmConnection(int sock, int memfd, void* base, std::size_t map_len, uint64_t ring_capacity,
+                             int server_efd, int client_efd,
+                             const Config& cfg, std::shared_ptr<LRUCache> cache,
+                             std::shared_ptr<const DocImage> image)
+  : sock_(sock), memfd_(memfd), base_(base), map_len_(map_len),
+    server_efd_(server_efd), client_efd_(client_efd),
+    req_(base, ring_capacity),
+    resp_(static_cast<char*>(base) + shm::Ring::footprint(ring_capacity), ring_capacity),
+    session_(*this, cfg, std::move(cache), std::move(image)) {}
+
+ShmConnection::~ShmConnection() {
+  session_.close();
+  if (base_) ::munmap(base_, map_len_);
+  if (memfd_ >= 0) ::close(memfd_);
+  if (server_efd_ >= 0) ::close(server_efd_);
+  if (client_efd_ >= 0) ::close(client_efd_);
+  if (sock_ >= 0) ::close(sock_);
+}
+
+bool ShmConnection::service() {
+  bool worked = false;
+  while (true) {
+    const char* data = nullptr;
+    std::size_t len = 0;
+    while (!session_.backlogged() && req_.peek(data, len)) {
+      // Served straight out of the ring; the slot is released afterwards
+      session_.on_message(data, len);
+      req_.pop();
+      shm::notify_if_waiting(req_.header()->producer_waiting, client_efd_);
+      worked = true;
+    }
+    if (req_.corrupt()) return worked;
+    session_.on_writable();
+    // Requests stay in the ring until the client reads responses; try_send left
+    // producer_waiting set, so its next read rings our doorbell
+    if (session_.backlogged()) break;
+    if (shm::arm_wait(req_.header()->consumer_waiting, [this] { return !req_.empty(); })) break;
+  }
+  return worked;
+}
+
+SendStatus ShmConnection::try_send(const ConstBuf* bufs, std::size_t count) {
+  auto* h = resp_.header();
+  if (resp_.try_write(bufs, count)) {
+    shm::notify_if_waiting(h->consumer_waiting, client_efd_);
+    return SendStatus::Ok;
+  }
+  // Ring full: the client rings our doorbell once it has consumed something
+  h->producer_waiting.store(1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (resp_.try_write(bufs, count)) {
+    h->producer_waiting.store(0, std::memory_order_relaxed);
+    shm::notify_if_waiting(h->consumer_waiting, client_efd_);
+    return SendStatus::Ok;
+  }
+  return SendStatus::WouldBlock;
+}
+
+// ---------------------------------------------------------------------------
+// ShmServer
+
+ShmServer::ShmServer(const Config& cfg, std::shared_ptr<LRUCache> cache, std::shared_ptr<const DocImage> image)
+  : cfg_(cfg), cache_(std::move(cache)), image_(std::move(image)), ring_capacity_(shm::ring_capacity_for(cfg.shm_ring_kb)) {}
+
+ShmServer::~ShmServer() {
+  stop();
+}
+
+void ShmServer::start(bool take_over) {
+  if (running_) return;
+
+  listen_fd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+  if (listen_fd_ < 0) throw std::runtime_error("shm: socket failed");
+
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  if (cfg_.shm_path.size() >= sizeof(addr.sun_path)) throw std::runtime_error("shm: socket path too long");
+  std::memcpy(addr.sun_path, cfg_.shm_path.c_str(), cfg_.shm_path.size() + 1);
+
+  // A socket that still answers belongs to a live server; only a stale one is removed
+  struct stat st{};
+  if (::lstat(cfg_.shm_path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) {
+    const int probe = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (probe < 0) throw std::runtime_error("shm: socket failed");
+    const bool live = ::connect(probe, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0;
+    const int err = errno;
+    ::close(probe);
+    if (live && !take_over) throw std::runtime_error("shm: a server is already listening on " + cfg_.shm_path);
+    if (live || err == ECONNREFUSED) ::unlink(cfg_.shm_path.c_str());
+  }
+  if (::bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)))
+    throw std::runtime_error("shm: bind failed for " + cfg_.shm_path);
+  if (::stat(cfg_.shm_path.c_str(), &st) == 0) {
+    bound_dev_ = static_cast<uint64_t>(st.st_dev);
+    bound_ino_ = static_cast<uint64_t>(st.st_ino);
+  }
+  // Connecting needs write permission on the path; set it before anyone can connect
+  if (::chmod(cfg_.shm_path.c_str(), static_cast<mode_t>(cfg_.shm_mode)))
+    throw std::runtime_error("shm: chmod failed for " + cfg_.shm_path);
+  if (::listen(listen_fd_, 64))
+    throw std::runtime_error("shm: listen failed");
+
+  epoll_fd_ = ::epoll_create1(EPOLL_CLOEXEC);
+  stop_efd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (epoll_fd_ < 0 || stop_efd_ < 0) throw std::runtime_error("shm: epoll/eventfd failed");
+
+  epoll_event ev{};
+  ev.events = EPOLLIN;
+  ev.data.fd = listen_fd_;
+  ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_fd_, &ev);
+  ev.data.fd = stop_efd_;
+  ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, stop_efd_, &ev);
+
+  log_info("shm: listening on {} (ring={} KiB, busy_poll_us={})",
+           cfg_.shm_path, ring_capacity_ / 1024, cfg_.shm_busy_poll_us);
+
+  running_ = true;   // only now does stop() have anything to undo
+  thread_ = std::thread([this] { loop_(); });
+}
+
+void ShmServer::stop() {
+  if (!running_.exchange(false)) return;
+
+  const uint64_t one = 1;
+  [[maybe_unused]] auto r = ::write(stop_efd_, &one, sizeof(one));
+  if (thread_.joinable()) thread_.join();
+
+  conns_.clear();
+  ::close(listen_fd_);
+  ::close(epoll_fd_);
+  ::close(stop_efd_);
+  listen_fd_ = epoll_fd_ = stop_efd_ = -1;
+  // A handoff successor may have bound the path since; its socket stays
+  struct stat st{};
+  if (::stat(cfg_.shm_path.c_str(), &st) == 0 && static_cast<uint64_t>(st.st_dev) == bound_dev_ &&
+      static_cast<uint64_t>(st.st_ino) == bound_ino_) {
+    ::unlink(cfg_.shm_path.c_str());
+  }
+
+  log_info("shm: stopped");
+}
+
+// Single service thread: sleeps in epoll on every client's doorbell, and keeps
+// sweeping all rings without sleeping for shm_busy_poll_us after the last request.
+void ShmServer::loop_() {
+  const auto budget = std::chrono::microseconds(std::max(0, cfg_.shm_busy_poll_us));
+  auto last_activity = std::chrono::steady_clock::now() - budget;
+  std::vector<epoll_event> evs(64);
+  std::vector<std::shared_ptr<ShmConnection>> live;
+
+  while (running_) {
+    const bool spinning = std::chrono::steady_clock::now() - last_activity < budget;
+    int n = ::epoll_wait(epoll_fd_, evs.data(), static_cast<int>(evs.size()), spinning ? 0 : 100);
+    bool worked = false;
+
+    for (int i = 0; i < n; ++i) {
+      const int fd = evs[static_cast<size_t>(i)].data.fd;
+      if (fd == stop_efd_) continue;
+      if (fd == listen_fd_) {
+        accept_();
+        continue;
+      }
+      auto it = conns_.find(fd);
+      if (it == conns_.end()) continue;
+      auto conn = it->second;
+      if (fd == conn->sock()) {
+        // Clients never write after the handshake: readable means EOF
+        drop_(fd);
+        continue;
+      }
+      shm::drain_eventfd(fd);
+      worked |= conn->service();
+      if (conn->broken()) drop_broken_(conn);
+    }
+
+    if (spinning) {
+      live.clear();
+      for (auto& kv : conns_) if (kv.first == kv.second->sock()) live.push_back(kv.second);
+      for (auto& c : live) {
+        worked |= c->service();
+        if (c->broken()) drop_broken_(c);
+      }
+    }
+    if (worked) last_activity = std::chrono::steady_clock::now();
+  }
+}
+
+void ShmServer::accept_() {
+  while (true) {
+    int s = ::accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK);
+    if (s < 0) return;
+
+    const std::size_t fp = shm::Ring::footprint(ring_capacity_);
+    const std::size_t map_len = 2 * fp;
+    int memfd = ::memfd_create("webserver-shm", MFD_CLOEXEC);
+    void* base = MAP_FAILED;
+    if (memfd >= 0 && ::ftruncate(memfd, static_cast<off_t>(map_len)) == 0)
+      base = ::mmap(nullptr, map_len, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+    int server_efd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    int client_efd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (base == MAP_FAILED || server_efd < 0 || client_efd < 0) {
+      log_warn("shm: connection setup failed");
+      if (base != MAP_FAILED) ::munmap(base, map_len);
+      for (int fd : {memfd, server_efd, client_efd, s}) if (fd >= 0) ::close(fd);
+      continue;
+    }
+
+    auto conn = std::make_shared<ShmConnection>(s, memfd, base, map_len, ring_capacity_,
+                                                server_efd, client_efd, cfg_, cache_, image_);
+    shm::Ring(base, ring_capacity_).init(ring_capacity_);
+    shm::Ring(static_cast<char*>(base) + fp, ring_capacity_).init(ring_capacity_);
+    // Start with the doorbell armed: the first request must wake us
+    shm::Ring(base, ring_capacity_).header()->consumer_waiting.store(1);
+
+    shm::Hello hello{shm::kHelloMagic, 1, ring_capacity_};
+    int fds[3] = {memfd, server_efd, client_efd};
+    iovec iov{&hello, sizeof(hello)};
+    alignas(cmsghdr) char ctrl[CMSG_SPACE(sizeof(fds))]{};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = ctrl;
+    msg.msg_controllen = sizeof(ctrl);
+    cmsghdr* cm = CMSG_FIRSTHDR(&msg);
+    cm->cmsg_level = SOL_SOCKET;
+    cm->cmsg_type = SCM_RIGHTS;
+    cm->cmsg_len = CMSG_LEN(sizeof(fds));
+    std::memcpy(CMSG_DATA(cm), fds, sizeof(fds));
+    if (::sendmsg(s, &msg, MSG_NOSIGNAL) != static_cast<ssize_t>(sizeof(hello))) {
+      // A peer that hangs up first is usually a server probing the path at startup
+      if (errno == EPIPE || errno == ECONNRESET) log_debug("shm: client left before the handshake");
+      else log_warn("shm: handshake failed");
+      continue; // conn owns and closes the fds
+    }
+
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLRDHUP;
+    ev.data.fd = s;
+    ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, s, &ev);
+    ev.events = EPOLLIN;
+    ev.data.fd = server_efd;
+    ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, server_efd, &ev);
+    conns_[s] = conn;
+    conns_[server_efd] = conn;
+
+    Metrics::instance().shm_accepted.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void ShmServer::drop_broken_(const std::shared_ptr<ShmConnection>& conn) {
+  Metrics::instance().shm_rejected.fetch_add(1, std::memory_order_relaxed);
+  log_warn("shm: dropping a client that corrupted its request ring");
+  drop_(conn->sock());
+}
+
+void ShmServer::drop_(int sock) {
+  auto it = conns_.find(sock);
+  if (it == conns_.end()) return;
+  auto conn = it->second;
+  ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, conn->sock(), nullptr);
+  ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, conn->server_efd(), nullptr);
+  conns_.erase(conn->sock());
+  conns_.erase(conn->server_efd());
+}
+
+} // namespace rdma_fast
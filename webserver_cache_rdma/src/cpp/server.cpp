@@ -1,44 +1,175 @@
 #include "../headers/server.hpp"
 #include "../headers/session.hpp"
+#include "../headers/util/metrics.hpp"
 #include <fmt/core.h>
+#include <algorithm>
+#include <stdexcept>
 
 using boost::asio::ip::tcp;
 
-Server::Server(boost::asio::io_context& ioc, const Config& cfg, std::shared_ptr<LRUCache> cache)
+namespace {
+
+// --sched.* into scheduler options; throws std::runtime_error on a malformed class
+SendScheduler::Options sched_options(const Config& cfg) {
+  SendScheduler::Options opt;
+  opt.slice_bytes = static_cast<std::size_t>(cfg.sched_slice_kb) * 1024;
+  opt.slots = cfg.sched_slots ? cfg.sched_slots : std::max(1u, cfg.threads / 2);
+  for (const auto& spec : cfg.sched_classes) {
+    const auto eq = spec.rfind('=');
+    SendScheduler::Class c;
+    c.prefix = spec.substr(0, eq);
+    try {
+      if (eq == std::string::npos || c.prefix.empty() || c.prefix[0] != '/') throw std::invalid_argument(spec);
+      c.weight = static_cast<uint32_t>(std::stoul(spec.substr(eq + 1)));
+    } catch (const std::exception&) {
+      throw std::runtime_error("invalid --sched.class '" + spec + "' (expected /PREFIX=WEIGHT)");
+    }
+    opt.classes.push_back(std::move(c));
+  }
+  return opt;
+}
+
+} // namespace
+
+Server::Server(boost::asio::io_context& ioc, std::shared_ptr<const Config> cfg, std::shared_ptr<LRUCache> cache,
+               std::shared_ptr<const DocImage> image, int listen_fd, int tls_listen_fd)
   : ioc_(ioc),
-    acceptor_(ioc),
-    cfg_(cfg),
-    cache_(std::move(cache)) {
+    http_(ioc),
+    cfg_(std::move(cfg)),
+    cache_(std::move(cache)),
+    image_(std::move(image)),
+    monitor_(std::make_shared<LoadMonitor>(ioc, std::chrono::milliseconds(10))),
+    wheel_(std::make_shared<TimerWheel>(ioc, std::chrono::milliseconds(cfg_->timer_tick_ms))),
+    sched_(std::make_shared<SendScheduler>(sched_options(*cfg_))),
+    sessions_(std::make_shared<SessionPool>(cfg_, cache_, image_, monitor_, wheel_, sched_,
+                                            static_cast<std::size_t>(std::max(0, cfg_->session_pool)))),
+    accept_log_(static_cast<uint64_t>(std::max(1, cfg_->log_accept_every))),
+    drain_timer_(ioc) {
+  open_listener(http_, cfg_->port, listen_fd, cfg_->numa);
 
-  tcp::endpoint ep(tcp::v4(), cfg.port);
+  if (cfg_->tls_port != 0) {
+    tls_ = std::make_unique<tls::Context>(cfg_->tls_cert, cfg_->tls_key, cfg_->tls_ktls);
+    https_ = std::make_unique<Listener>(ioc);
+    https_->tls = true;
+    open_listener(*https_, cfg_->tls_port, tls_listen_fd, cfg_->numa);
+  }
+}
+
+void Server::open_listener(Listener& l, unsigned short port, int inherited_fd, bool reuse_port) {
   boost::system::error_code ec;
-  acceptor_.open(ep.protocol(), ec);
+  if (inherited_fd >= 0) {
+    l.acceptor.assign(tcp::v4(), inherited_fd, ec);
+    if (ec) throw std::runtime_error("adopting inherited listener failed: " + ec.message());
+    return;
+  }
+
+  tcp::endpoint ep(tcp::v4(), port);
+  l.acceptor.open(ep.protocol(), ec);
   if (ec) throw std::runtime_error("acceptor open failed: " + ec.message());
-  acceptor_.set_option(tcp::acceptor::reuse_address(true), ec);
-  acceptor_.bind(ep, ec);
+  l.acceptor.set_option(tcp::acceptor::reuse_address(true), ec);
+  if (reuse_port) {
+    l.acceptor.set_option(boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>(true), ec);
+    if (ec) throw std::runtime_error("SO_REUSEPORT failed: " + ec.message());
+  }
+  l.acceptor.bind(ep, ec);
   if (ec) throw std::runtime_error("bind failed: " + ec.message());
-  acceptor_.listen(boost::asio::socket_base::max_listen_connections, ec);
+  l.acceptor.listen(boost::asio::socket_base::max_listen_connections, ec);
   if (ec) throw std::runtime_error("listen failed: " + ec.message());
 }
 
 void Server::start() {
-  fmt::print("[info] Listening on 0.0.0.0:{}\n", cfg_.port);
-  do_accept();
+  log_info("Listening on 0.0.0.0:{} (max connections {})", port(), cfg_->max_connections);
+  if (https_) log_info("TLS on 0.0.0.0:{} (kTLS {})", tls_port(), cfg_->tls_ktls ? "when available" : "off");
+  monitor_->set_shed_target(std::chrono::milliseconds(cfg_->shed_latency_ms));
+  monitor_->start([this] { on_monitor_tick(); });
+  wheel_->start();
+  boost::asio::post(monitor_->strand(), [this] {
+    do_accept(http_);
+    if (https_) do_accept(*https_);
+  });
+}
+
+// Backpressure: past the connection limit, or while handlers queue up behind busy
+// workers, new connections wait in the kernel backlog instead of adding sessions.
+bool Server::should_pause_accept() const {
+  const auto active = Metrics::instance().active_connections.load(std::memory_order_relaxed);
+  if (cfg_->max_connections > 0 && active >= static_cast<unsigned long long>(cfg_->max_connections)) return true;
+  return cfg_->accept_lag_ms > 0 && monitor_->lag_us() > int64_t{cfg_->accept_lag_ms} * 1000;
+}
+
+void Server::on_monitor_tick() {
+  if (draining_ || should_pause_accept()) return;
+  if (!http_.accepting) do_accept(http_);
+  if (https_ && !https_->accepting) do_accept(*https_);
+}
+
+void Server::drain(std::chrono::milliseconds timeout, std::function<void()> done) {
+  boost::asio::post(monitor_->strand(), [this, timeout, done = std::move(done)]() mutable {
+    draining_ = true;
+    monitor_->set_draining();
+    boost::system::error_code ig;
+    http_.acceptor.close(ig);   // the successor holds its own descriptor for the same socket
+    if (https_) https_->acceptor.close(ig);
+    log_info("Draining {} connections (up to {} ms)",
+             Metrics::instance().active_connections.load(std::memory_order_relaxed), timeout.count());
+    check_drained(std::chrono::steady_clock::now() + timeout, std::move(done));
+  });
 }
 
-void Server::do_accept() {
-  acceptor_.async_accept(
-    [this](boost::system::error_code ec, tcp::socket socket) {
+void Server::check_drained(std::chrono::steady_clock::time_point deadline, std::function<void()> done) {
+  const auto active = Metrics::instance().active_connections.load(std::memory_order_relaxed);
+  if (active == 0 || std::chrono::steady_clock::now() >= deadline) {
+    if (active) log_warn("Drain timeout with {} connections still open", active);
+    done();
+    return;
+  }
+  drain_timer_.expires_after(std::chrono::milliseconds(50));
+  drain_timer_.async_wait(boost::asio::bind_executor(monitor_->strand(),
+    [this, deadline, done = std::move(done)](boost::system::error_code ec) mutable {
+      if (!ec) check_drained(deadline, std::move(done));
+    }));
+}
+
+void Server::do_accept(Listener& l) {
+  if (draining_) {
+    l.accepting = false;
+    return;
+  }
+  if (should_pause_accept()) {
+    if (l.accepting) Metrics::instance().accept_pauses.fetch_add(1, std::memory_order_relaxed);
+    l.accepting = false;
+    return;
+  }
+  l.accepting = true;
+
+  // Each session gets its own strand: the io_context is run by several threads and a
+  // session's read, write and timer handlers must not run concurrently.
+  l.acceptor.async_accept(boost::asio::make_strand(ioc_),
+    boost::asio::bind_executor(monitor_->strand(),
+    [this, &l](boost::system::error_code ec, SessionSocket socket) {
       if (!ec) {
-        try {
-          auto ep = socket.remote_endpoint();
-          fmt::print("[info] Accepted {}:{}\n", ep.address().to_string(), ep.port());
-        } catch (...) {}
-        std::make_shared<Session>(std::move(socket), cfg_, cache_)->start();
+        if (accept_log_.sample()) {
+          boost::system::error_code ep_ec;
+          auto ep = socket.remote_endpoint(ep_ec);
+          if (!ep_ec) {
+            log_info("Accepted {}:{} (1 in {} logged, {} active)", ep.address().to_string(), ep.port(),
+                     accept_log_.every(), Metrics::instance().active_connections.load(std::memory_order_relaxed));
+          }
+        }
+        // Responses go out as one gathered write; Nagle would hold the tail of a large
+        // body until the client's next request carries the ACK.
+        boost::system::error_code ig;
+        socket.set_option(tcp::no_delay(true), ig);
+        auto session = sessions_->acquire(std::move(socket));
+        if (l.tls) session->start_tls(*tls_);
+        else session->start();
+      } else if (ec == boost::asio::error::operation_aborted) {
+        l.accepting = false;
+        return;
       } else {
-        fmt::print(stderr, "[warn] accept error: {}\n", ec.message());
+        log_warn("accept error: {}", ec.message());
       }
-      do_accept();
-    }
+      do_accept(l);
+    })
   );
 }
\ No newline at end of file
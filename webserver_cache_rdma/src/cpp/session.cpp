@@ -1,52 +1,312 @@
 #include "../headers/session.hpp"
 #include <fmt/core.h>
+#include <fmt/format.h>
 #include <boost/asio/buffer.hpp>
 #include <boost/asio/write.hpp>
+#include <algorithm>
+#include <cstring>
 #include <filesystem>
+#include <iterator>
 #include "../headers/fs/path_utils.hpp"
 #include "../headers/fs/file_reader.hpp"
-#include "../headers/http/mime.hpp"
 #include "../headers/http/response.hpp"
+#include "../headers/http/headers.hpp"
+#include "../headers/http2/h2_session.hpp"
 #include "../headers/util/time.hpp"
 #include "../headers/util/metrics.hpp"
+#include "../headers/util/access_trace.hpp"
+#include "../headers/util/tracing.hpp"
+#include "../headers/util/logging.hpp"
 
 using boost::asio::ip::tcp;
 
-Session::Session(tcp::socket socket, const Config& cfg, std::shared_ptr<LRUCache> cache)
+namespace {
+
+// Heads are built with reserve() up front so the string grows at most once in the
+// arena (a monotonic resource never reuses what a reallocation gives back)
+constexpr std::size_t kHeadReserve = 512;
+
+// Case-insensitive search for `token` in a comma-separated header value
+bool has_token(const std::string& value, std::string_view token) {
+  const std::string v = header_lower(value);
+  std::size_t pos = 0;
+  while (pos <= v.size()) {
+    std::size_t end = v.find(',', pos);
+    if (end == std::string::npos) end = v.size();
+    std::size_t b = pos, e = end;
+    while (b < e && (v[b] == ' ' || v[b] == '\t')) ++b;
+    while (e > b && (v[e - 1] == ' ' || v[e - 1] == '\t')) --e;
+    if (std::string_view(v).substr(b, e - b) == token) return true;
+    pos = end + 1;
+  }
+  return false;
+}
+
+bool is_h2_preface(const HttpRequest& req) {
+  return req.method == "PRI" && req.target == "*" && req.version == "HTTP/2.0";
+}
+
+std::string_view connection_value(bool keep_alive) {
+  return keep_alive ? "keep-alive" : "close";
+}
+
+boost::asio::socket_base::wait_type wait_for(tls::Status st) {
+  return st == tls::Status::WantRead ? boost::asio::socket_base::wait_read : boost::asio::socket_base::wait_write;
+}
+
+boost::system::error_code error_of(tls::Status st) {
+  if (st == tls::Status::Closed) return boost::asio::error::eof;
+  return boost::system::errc::make_error_code(boost::system::errc::protocol_error);
+}
+
+void append_file_headers(std::pmr::string& h, const CachedObject& obj, bool keep_alive) {
+  h.append(obj.headers);
+  append_header(h, "Connection", connection_value(keep_alive));
+  h.append("\r\n", 2);
+}
+
+// Everything after the status line of an error reply: headers and a short text body
+template <typename String>
+void append_error(String& h, int status, std::string_view message, bool keep_alive) {
+  append_header(h, "Content-Type", "text/plain; charset=utf-8");
+  append_header(h, "Content-Length", uint64_t{fmt::formatted_size("{} {}\n", status, message)});
+  append_header(h, "Connection", connection_value(keep_alive));
+  h.append("\r\n", 2);
+  fmt::format_to(std::back_inserter(h), "{} {}\n", status, message);
+}
+
+struct CannedError {
+  int status;
+  std::string_view message;
+};
+
+constexpr CannedError kCannedErrors[] = {
+  {400, "Bad Request"},
+  {400, "Path traversal"},
+  {404, "Not Found"},
+  {405, "Method Not Allowed"},
+};
+constexpr std::size_t kCannedCount = sizeof(kCannedErrors) / sizeof(kCannedErrors[0]);
+
+// The whole reply for one of the error replies sent most often, empty for any other.
+// Each thread serializes them again when the Date value changes, so most calls only
+// compare the date; the view stays valid until the thread's next call.
+std::string_view canned_error(int status, std::string_view message, bool keep_alive) {
+  std::size_t i = 0;
+  while (i < kCannedCount && (kCannedErrors[i].status != status || kCannedErrors[i].message != message)) ++i;
+  if (i == kCannedCount) return {};
+
+  thread_local std::string built_for;                 // Date value the replies carry
+  thread_local std::string replies[kCannedCount][2];  // [error][keep_alive]
+  const auto date = cached_http_date();
+  if (date != built_for) {
+    built_for.assign(date.data(), date.size());
+    for (std::size_t k = 0; k < kCannedCount; ++k) {
+      for (int ka = 0; ka < 2; ++ka) {
+        auto& r = replies[k][ka];
+        r.clear();
+        append_status_line(r, kCannedErrors[k].status);
+        append_error(r, kCannedErrors[k].status, kCannedErrors[k].message, ka == 1);
+      }
+    }
+  }
+  return replies[i][keep_alive ? 1 : 0];
+}
+
+} // namespace
+
+Session::Session(SessionSocket socket, std::shared_ptr<const Config> cfg, std::shared_ptr<LRUCache> cache,
+                 std::shared_ptr<const DocImage> image, std::shared_ptr<const LoadMonitor> monitor, std::shared_ptr<TimerWheel> wheel,
+                 std::shared_ptr<SendScheduler> sched)
   : socket_(std::move(socket)),
-    cfg_(cfg),
+    cfg_(std::move(cfg)),
     cache_(std::move(cache)),
-    inbuf_(8192),
-    parser_(cfg.max_request_line, cfg.max_header_bytes),
-    read_timer_(socket_.get_executor()),
-    write_timer_(socket_.get_executor()),
-    idle_timer_(socket_.get_executor())
-{}
+    image_(std::move(image)),
+    monitor_(std::move(monitor)),
+    wheel_(std::move(wheel)),
+    sched_(std::move(sched)),
+    parser_(cfg_->max_request_line, cfg_->max_header_bytes)
+{
+  deadline_.on_expire = &Session::on_deadline;
+  turn_.on_turn = &Session::on_turn;
+}
+
+Session::~Session() {
+  wheel_->cancel(deadline_);
+  sched_->cancel(turn_);
+}
 
 void Session::start() {
-  arm_idle_timer();
+  Metrics::instance().active_connections.fetch_add(1, std::memory_order_relaxed);
+  deadline_.owner = shared_from_this();
+  turn_.owner = deadline_.owner;
+  set_deadline(Deadline::Read);
   start_read();
 }
 
+void Session::start_tls(const tls::Context& ctx) {
+  Metrics::instance().active_connections.fetch_add(1, std::memory_order_relaxed);
+  deadline_.owner = shared_from_this();
+  turn_.owner = deadline_.owner;
+  set_deadline(Deadline::Read);
+  // OpenSSL works on the descriptor directly, so it must not block
+  boost::system::error_code ec;
+  socket_.non_blocking(true, ec);
+  tls_ = std::make_unique<tls::Connection>(ctx, socket_.native_handle());
+  tls_handshake();
+}
+
+void Session::reuse(SessionSocket socket) {
+  // Move-assigning also adopts the new connection's strand
+  socket_ = std::move(socket);
+}
+
+void Session::recycle() {
+  wheel_->cancel(deadline_);
+  deadline_.owner.reset();
+  sched_->cancel(turn_);
+  turn_.owner.reset();
+  sent_ = 0;
+  deadline_kind_ = Deadline::Read;
+  boost::system::error_code ig;
+  socket_.close(ig);
+  parser_.reset();
+  rbuf_.reset();
+  rlen_ = 0;
+  pending_.clear();
+  reading_ = writing_ = closing_after_ = bad_request_ = closed_ = false;
+  h2_upgrade_.reset();
+  head_.reset();
+  body_.reset();
+  tls_.reset();
+  span_.cancel();
+  read_at_ = 0;
+  Metrics::instance().active_connections.fetch_sub(1, std::memory_order_relaxed);
+}
+
 void Session::start_read() {
-  if (closing_after_) return;
+  // on_read re-arms the read while a response is still being written, so on_write
+  // may find one already outstanding
+  if (closing_after_ || reading_) return;
+  reading_ = true;
+  if (tls_) {
+    tls_read();
+    return;
+  }
+  read_socket();
+}
+
+void Session::read_socket() {
   auto self = shared_from_this();
-  read_timer_.expires_after(std::chrono::milliseconds(cfg_.read_timeout_ms));
-  read_timer_.async_wait([self](const boost::system::error_code& ec) {
-    if (!ec) {
-      fmt::print("[info] read timeout, closing connection\n");
-      self->close();
-    }
-  });
+  boost::system::error_code ec;
+  if (!socket_.non_blocking()) socket_.non_blocking(true, ec);
+  std::size_t n = 0;
+  if (!ec) {
+    reserve_input();
+    n = socket_.read_some(boost::asio::buffer(rbuf_.data() + rlen_, rbuf_.capacity() - rlen_), ec);
+  }
+  if (ec == boost::asio::error::would_block || ec == boost::asio::error::try_again) {
+    if (rlen_ == 0) rbuf_.reset();
+    socket_.async_wait(boost::asio::socket_base::wait_read, make_custom_alloc_handler(read_mem_,
+      [self](boost::system::error_code ec) {
+        if (ec) self->on_read(ec, 0);
+        else self->read_socket();
+      }));
+    return;
+  }
+  // on_read may start the next read itself, so it runs as its own handler
+  boost::asio::post(socket_.get_executor(), make_custom_alloc_handler(read_mem_,
+    [self, ec, n] { self->on_read(ec, n); }));
+}
+
+void Session::reserve_input() {
+  if (!rbuf_) rbuf_.acquire();
+  else if (rlen_ == rbuf_.capacity()) rbuf_.grow(rlen_, std::min(rbuf_.capacity() * 2, parser_.max_head_bytes()));
+}
+
+void Session::consume_input(std::size_t n) {
+  if (n == 0) return;
+  rlen_ -= n;
+  if (rlen_ == 0) rbuf_.reset();
+  else std::memmove(rbuf_.data(), rbuf_.data() + n, rlen_);
+}
+
+void Session::tls_handshake() {
+  const auto st = tls_->handshake();
+  if (st == tls::Status::WantRead || st == tls::Status::WantWrite) {
+    auto self = shared_from_this();
+    socket_.async_wait(wait_for(st), make_custom_alloc_handler(read_mem_,
+      [self](boost::system::error_code ec) {
+        if (ec) self->close();
+        else self->tls_handshake();
+      }));
+    return;
+  }
+
+  auto& m = Metrics::instance();
+  if (st != tls::Status::Done) {
+    m.tls_handshake_errors.fetch_add(1, std::memory_order_relaxed);
+    log_debug("tls handshake failed: {}", tls_->error());
+    close();
+    return;
+  }
+  m.tls_handshakes.fetch_add(1, std::memory_order_relaxed);
+  if (tls_->ktls_send()) m.tls_ktls_send.fetch_add(1, std::memory_order_relaxed);
+  if (tls_->ktls_recv()) m.tls_ktls_recv.fetch_add(1, std::memory_order_relaxed);
+  start_read();
+}
+
+void Session::tls_read() {
+  auto self = shared_from_this();
+  std::size_t n = 0;
+  reserve_input();
+  const auto st = tls_->read(rbuf_.data() + rlen_, rbuf_.capacity() - rlen_, n);
+  if (st == tls::Status::WantRead || st == tls::Status::WantWrite) {
+    if (rlen_ == 0) rbuf_.reset();
+    socket_.async_wait(wait_for(st), make_custom_alloc_handler(read_mem_,
+      [self](boost::system::error_code ec) {
+        if (ec) self->on_read(ec, 0);
+        else self->tls_read();
+      }));
+    return;
+  }
+  const auto ec = st == tls::Status::Done ? boost::system::error_code{} : error_of(st);
+  if (st == tls::Status::Error) log_debug("tls read failed: {}", tls_->error());
+  // on_read may start the next read itself, so it runs as its own handler
+  boost::asio::post(socket_.get_executor(), make_custom_alloc_handler(read_mem_,
+    [self, ec, n] { self->on_read(ec, n); }));
+}
 
-  socket_.async_read_some(boost::asio::buffer(inbuf_),
-    [self](boost::system::error_code ec, std::size_t n) {
-      self->on_read(ec, n);
+void Session::tls_write(bool keep_alive) {
+  auto self = shared_from_this();
+  for (auto& b : tls_out_) {
+    while (b.size() > 0) {
+      std::size_t n = 0;
+      const auto st = tls_->write(b.data(), b.size(), n);
+      if (st == tls::Status::Done) {
+        b += n;
+        continue;
+      }
+      if (st == tls::Status::WantRead || st == tls::Status::WantWrite) {
+        socket_.async_wait(wait_for(st), make_custom_alloc_handler(write_mem_,
+          [self, keep_alive](boost::system::error_code ec) {
+            if (ec) self->on_write(keep_alive, ec);
+            else self->tls_write(keep_alive);
+          }));
+        return;
+      }
+      if (st == tls::Status::Error) log_debug("tls write failed: {}", tls_->error());
+      boost::asio::post(socket_.get_executor(), make_custom_alloc_handler(write_mem_,
+        [self, keep_alive, ec = error_of(st)] { self->on_write(keep_alive, ec); }));
+      return;
     }
-  );
+  }
+  boost::asio::post(socket_.get_executor(), make_custom_alloc_handler(write_mem_,
+    [self, keep_alive] { self->on_write(keep_alive, {}); }));
 }
 
 void Session::on_read(boost::system::error_code ec, std::size_t n) {
+  reading_ = false;
   if (ec) {
     if (ec != boost::asio::error::operation_aborted) {
       // client closed or error
@@ -55,28 +315,42 @@ void Session::on_read(boost::system::error_code ec, std::size_t n) {
     return;
   }
 
-  boost::system::error_code ignore;
-  read_timer_.cancel(ignore);
-  idle_timer_.expires_after(std::chrono::milliseconds(cfg_.keepalive_timeout_ms));
-
-  auto res = parser_.parse(inbuf_.data(), n);
+  if (!read_at_ && tracing::sampled()) read_at_ = tracing::now();
+  rlen_ += n;
+  // Requests are parsed where they landed; whatever is left of a partial head
+  // moves to the front of the buffer afterwards
+  std::size_t parsed = 0;
   while (true) {
+    std::size_t used = 0;
+    auto res = parser_.parse(rbuf_.data() + parsed, rlen_ - parsed, used);
+    parsed += used;
     if (res.state == ParseState::BadRequest) {
       pending_.clear();
       closing_after_ = true;
-      respond_with_error(400, "Bad Request", false);
+      // The head of an in-flight response must stay put; answer once it is out
+      if (writing_) bad_request_ = true;
+      else respond_with_error(400, "Bad Request", false);
       return;
     } else if (res.state == ParseState::Incomplete) {
       break;
+    } else if (cfg_->http2_enable && !tls_ && is_h2_preface(res.request) && pending_.empty() && !writing_) {
+      // The rest of the preface ("SM\r\n\r\n") is still in the buffer
+      consume_input(parsed);
+      switch_to_h2();
+      return;
     } else {
       pending_.push_back(std::move(res.request));
-      res = parser_.parse("", 0);
     }
   }
+  consume_input(parsed);
 
   if (!writing_) {
     handle_next_in_queue();
   }
+  if (!writing_) {
+    // Nothing to answer yet: either mid-request or an idle keep-alive connection
+    set_deadline(rlen_ > 0 ? Deadline::Read : Deadline::Idle);
+  }
 
   if (!closing_after_) {
     start_read();
@@ -92,161 +366,236 @@ void Session::handle_next_in_queue() {
 
 void Session::handle_request_and_respond(const HttpRequest& req) {
   writing_ = true;
-  bool keep_alive = req.keep_alive;
+  // A draining process closes each connection after its current response
+  bool keep_alive = req.keep_alive && !(monitor_ && monitor_->draining());
   if (!keep_alive) {
     closing_after_ = true;
     pending_.clear();
   }
 
+  if (read_at_) {
+    span_.begin(read_at_, req.target);
+    read_at_ = 0;
+  }
+  if (sched_->has_classes()) turn_.cls = sched_->classify(req.target);
+
+  if (try_h2c_upgrade(req)) return;
+
   if (req.method == "GET" && req.target == "/metrics") {
-    auto body_str = Metrics::instance().render_text();
-    auto body = std::make_shared<std::vector<uint8_t>>(body_str.begin(), body_str.end());
-
-    HttpResponse resp;
-    resp.status = 200;
-    resp.reason = "OK";
-    resp.headers["Content-Type"] = "text/plain; charset=utf-8";
-    resp.headers["Content-Length"] = std::to_string(body->size());
-    resp.headers["Connection"] = keep_alive ? "keep-alive" : "close";
-    auto head = std::make_unique<std::string>(resp.serialize_headers());
-    write_response(std::move(head), body, keep_alive);
+    const auto body = Metrics::instance().render_text();
+    auto& h = begin_head(200);
+    append_header(h, "Content-Type", "text/plain; charset=utf-8");
+    append_header(h, "Content-Length", uint64_t{body.size()});
+    append_header(h, "Connection", connection_value(keep_alive));
+    h.append("\r\n", 2);
+    h.append(body.data(), body.size());
+    write_response(nullptr, keep_alive);
     return;
   }
 
-  if (!(req.method == "GET" || req.method == "HEAD")) {
-    respond_with_error(405, "Method Not Allowed", keep_alive);
+  if (req.method == "GET" && req.target == "/debug/traces") {
+    const auto body = tracing::render_json();
+    auto& h = begin_head(200);
+    append_header(h, "Content-Type", "application/json");
+    append_header(h, "Content-Length", uint64_t{body.size()});
+    append_header(h, "Connection", connection_value(keep_alive));
+    h.append("\r\n", 2);
+    h.append(body.data(), body.size());
+    write_response(nullptr, keep_alive);
     return;
   }
 
-  auto mapped = map_url_to_fs(cfg_.doc_root, req.target);
-  if (!mapped.ok) {
-    respond_with_error(400, mapped.error, keep_alive);
+  if (monitor_ && monitor_->shedding()) {
+    respond_shed(keep_alive);
     return;
   }
-  if (!mapped.exists) {
-    respond_with_error(404, "Not Found", keep_alive);
+
+  if (!(req.method == "GET" || req.method == "HEAD")) {
+    respond_with_error(405, "Method Not Allowed", keep_alive);
     return;
   }
 
-  const std::string& fs_path = mapped.fs_path;
-  const std::string cache_key = mapped.cache_key;
-
-  LRUCache::Entry entry;
-  if (cache_->get(cache_key, entry)) {
-    Metrics::instance().cache_hits.fetch_add(1, std::memory_order_relaxed);
+  const bool head_only = req.method == "HEAD";
 
-    HttpResponse resp;
-    resp.status = 200;
-    resp.reason = "OK";
-    resp.headers["Content-Type"] = mime_type(fs_path);
-    resp.headers["Content-Length"] = std::to_string(entry.body->size());
-    resp.headers["Connection"] = keep_alive ? "keep-alive" : "close";
-    resp.headers["Last-Modified"] = format_http_date(entry.last_modified);
-    resp.headers["ETag"] = entry.etag;
+  auto& m = Metrics::instance();
 
-    auto head = std::make_unique<std::string>(resp.serialize_headers());
-    auto body = (req.method == "HEAD") ? std::make_shared<std::vector<uint8_t>>() : entry.body;
-
-    Metrics::instance().responses_2xx.fetch_add(1, std::memory_order_relaxed);
-    Metrics::instance().bytes_served.fetch_add(body->size(), std::memory_order_relaxed);
-    write_response(std::move(head), body, keep_alive);
+  // A packed image is the whole document root: no cache, no filesystem
+  if (image_) {
+    const bool gzip = accepts_gzip(req.header(HeaderId::AcceptEncoding));
+    ObjectPtr obj = image_->find_target(req.target, gzip);
+    span_.mark(tracing::Stage::Lookup);
+    if (!obj) {
+      m.image_misses.fetch_add(1, std::memory_order_relaxed);
+      respond_with_error(404, "Not Found", keep_alive);
+      return;
+    }
+    m.image_hits.fetch_add(1, std::memory_order_relaxed);
+    if (!obj->encoding.empty()) m.image_gzip_hits.fetch_add(1, std::memory_order_relaxed);
+    append_file_headers(begin_head(200), *obj, keep_alive);
+    m.responses_2xx.fetch_add(1, std::memory_order_relaxed);
+    m.bytes_served.fetch_add(head_only ? 0 : obj->size(), std::memory_order_relaxed);
+    write_response(head_only ? nullptr : std::move(obj), keep_alive);
     return;
   }
-  Metrics::instance().cache_misses.fetch_add(1, std::memory_order_relaxed);
 
-  auto fr = read_file(fs_path);
-  if (!fr.ok) {
-    respond_with_error(500, fr.error, keep_alive);
-    return;
+  // A target already in canonical form is its own cache key, so a hit costs no
+  // path mapping and no filesystem calls
+  ObjectPtr obj;
+  bool missed = false;
+  if (const auto key = direct_cache_key(req.target); !key.empty()) {
+    span_.mark(tracing::Stage::Map);
+    obj = cache_->get(key);
+    span_.mark(tracing::Stage::Lookup);
+    if (obj) access_trace::record(key, obj->size(), true, access_trace::Source::Http);
   }
 
-  LRUCache::Entry new_entry;
-  new_entry.body = std::make_shared<std::vector<uint8_t>>(std::move(fr.data));
-  new_entry.size = new_entry.body->size();
-  new_entry.last_modified = fr.last_modified;
-  new_entry.etag = make_etag(new_entry.size, new_entry.last_modified);
-
-  cache_->put(cache_key, new_entry);
-
-  HttpResponse resp;
-  resp.status = 200;
-  resp.reason = "OK";
-  resp.headers["Content-Type"] = mime_type(fs_path);
-  resp.headers["Content-Length"] = std::to_string(new_entry.size);
-  resp.headers["Connection"] = keep_alive ? "keep-alive" : "close";
-  resp.headers["Last-Modified"] = format_http_date(new_entry.last_modified);
-  resp.headers["ETag"] = new_entry.etag;
+  if (!obj) {
+    // A target that recently mapped to no file gets the same answer without the
+    // filesystem
+    if (const int status = cache_->negative(req.target)) {
+      m.cache_negative_hits.fetch_add(1, std::memory_order_relaxed);
+      span_.mark(tracing::Stage::Lookup);
+      respond_with_error(status, status == 404 ? "Not Found" : "Path traversal", keep_alive);
+      return;
+    }
+    auto mapped = map_url_to_fs(cfg_->doc_root, req.target);
+    span_.mark(tracing::Stage::Map);
+    if (!mapped.ok) {
+      if (mapped.outside_root) cache_->put_negative(req.target, 400);
+      respond_with_error(400, mapped.error, keep_alive);
+      return;
+    }
+    if (!mapped.exists) {
+      cache_->put_negative(req.target, 404);
+      respond_with_error(404, "Not Found", keep_alive);
+      return;
+    }
+    obj = cache_->get(mapped.cache_key);
+    span_.mark(tracing::Stage::Lookup);
+    if (!obj) {
+      missed = true;
+      auto fr = read_file(mapped.fs_path);
+      if (!fr.ok) {
+        respond_with_error(500, fr.error, keep_alive);
+        return;
+      }
+      obj = make_cached_object(std::move(fr.data), fr.last_modified, mapped.fs_path);
+      cache_->put(mapped.cache_key, obj);
+      span_.mark(tracing::Stage::Read);
+    }
+    access_trace::record(mapped.cache_key, obj->size(), !missed, access_trace::Source::Http);
+  }
+  (missed ? m.cache_misses : m.cache_hits).fetch_add(1, std::memory_order_relaxed);
 
-  auto head = std::make_unique<std::string>(resp.serialize_headers());
-  auto body = (req.method == "HEAD") ? std::make_shared<std::vector<uint8_t>>() : new_entry.body;
+  append_file_headers(begin_head(200), *obj, keep_alive);
 
-  Metrics::instance().responses_2xx.fetch_add(1, std::memory_order_relaxed);
-  Metrics::instance().bytes_served.fetch_add(body->size(), std::memory_order_relaxed);
-  write_response(std::move(head), body, keep_alive);
+  m.responses_2xx.fetch_add(1, std::memory_order_relaxed);
+  m.bytes_served.fetch_add(head_only ? 0 : obj->size(), std::memory_order_relaxed);
+  write_response(head_only ? nullptr : obj, keep_alive);
 }
 
-void Session::respond_with_error(int status, const std::string& message, bool keep_alive) {
-  HttpResponse resp;
-  resp.status = status;
-  switch (status) {
-    case 400: resp.reason = "Bad Request"; break;
-    case 404: resp.reason = "Not Found"; break;
-    case 405: resp.reason = "Method Not Allowed"; break;
-    default: resp.reason = "Internal Server Error"; break;
-  }
-  std::string payload = fmt::format("{} {}\n", status, message);
-  auto body = std::make_shared<std::vector<uint8_t>>(payload.begin(), payload.end());
-  resp.headers["Content-Type"] = "text/plain; charset=utf-8";
-  resp.headers["Content-Length"] = std::to_string(body->size());
-  resp.headers["Connection"] = keep_alive ? "keep-alive" : "close";
-
+void Session::respond_with_error(int status, std::string_view message, bool keep_alive) {
   if (status >= 500)
     Metrics::instance().responses_5xx.fetch_add(1, std::memory_order_relaxed);
   else
     Metrics::instance().responses_4xx.fetch_add(1, std::memory_order_relaxed);
 
-  auto head = std::make_unique<std::string>(resp.serialize_headers());
-  write_response(std::move(head), body, keep_alive);
+  // The short text body goes into the arena right behind the head
+  if (const auto canned = canned_error(status, message, keep_alive); !canned.empty()) {
+    begin_raw(status).append(canned.data(), canned.size());
+  } else {
+    append_error(begin_head(status), status, message, keep_alive);
+  }
+  write_response(nullptr, keep_alive);
 }
 
-void Session::write_response(std::unique_ptr<std::string> head,
-                             std::shared_ptr<const std::vector<uint8_t>> body,
-                             bool keep_alive) {
-  auto self = shared_from_this();
+// Overload reply: no cache or filesystem work, and the client is told when to come
+// back.
+void Session::respond_shed(bool keep_alive) {
+  Metrics::instance().connections_shed.fetch_add(1, std::memory_order_relaxed);
+  Metrics::instance().responses_5xx.fetch_add(1, std::memory_order_relaxed);
+  auto& h = begin_head(503);
+  append_header(h, "Retry-After", "1");
+  append_header(h, "Content-Length", "0");
+  append_header(h, "Connection", connection_value(keep_alive));
+  h.append("\r\n", 2);
+  write_response(nullptr, keep_alive);
+}
 
-  write_timer_.expires_after(std::chrono::milliseconds(cfg_.write_timeout_ms));
-  write_timer_.async_wait([self](const boost::system::error_code& ec) {
-    if (!ec) {
-      fmt::print("[info] write timeout, closing connection\n");
-      self->close();
-    }
-  });
+std::pmr::string& Session::begin_head(int status) {
+  auto& h = begin_raw(status);
+  append_status_line(h, status);
+  return h;
+}
+
+std::pmr::string& Session::begin_raw(int status) {
+  auto& h = head_.begin(kHeadReserve);
+  span_.set_status(status);
+  return h;
+}
+
+void Session::write_response(ObjectPtr body, bool keep_alive) {
+  auto self = shared_from_this();
+  set_deadline(Deadline::Write);
+  body_ = std::move(body);
+  span_.mark(tracing::Stage::Headers);
+  span_.set_bytes(body_ ? body_->size() : 0);
 
   std::array<boost::asio::const_buffer, 2> bufs {
-    boost::asio::buffer(*head),
-    body->empty() ? boost::asio::const_buffer{} : boost::asio::buffer(body->data(), body->size())
+    boost::asio::buffer(head_->data(), head_->size()),
+    (!body_ || body_->size() == 0) ? boost::asio::const_buffer{} : boost::asio::buffer(body_->data(), body_->size())
   };
 
-  boost::asio::async_write(socket_, bufs,
-    [self, head = std::move(head), body, keep_alive]
-    (boost::system::error_code ec, std::size_t /*n*/) mutable {
-      self->on_write(std::move(head), body, keep_alive, ec, 0);
+  // With kTLS the kernel encrypts whatever is written to the socket, so the gathered
+  // write below stands; otherwise OpenSSL encrypts a copy in userspace
+  if (tls_ && !tls_->ktls_send()) {
+    tls_out_ = bufs;
+    tls_write(keep_alive);
+    return;
+  }
+
+  if (sched_->enabled() && body_ && body_->size() > sched_->slice_bytes()) {
+    Metrics::instance().sched_bulk_responses.fetch_add(1, std::memory_order_relaxed);
+    sent_ = 0;
+    turn_keep_alive_ = keep_alive;
+    boost::system::error_code ec;
+    if (!socket_.non_blocking()) socket_.non_blocking(true, ec);
+    if (ec) {
+      on_write(keep_alive, ec);
+      return;
     }
+    sched_->wait(turn_);
+    return;
+  }
+
+  boost::asio::async_write(socket_, bufs,
+    make_custom_alloc_handler(write_mem_,
+    [self, keep_alive](boost::system::error_code ec, std::size_t /*n*/) {
+      self->on_write(keep_alive, ec);
+    })
   );
 }
 
-void Session::on_write(std::unique_ptr<std::string> /*head*/,
-                       std::shared_ptr<const std::vector<uint8_t>> /*body*/,
-                       bool keep_alive,
-                       boost::system::error_code ec,
-                       std::size_t /*n*/) {
-  boost::system::error_code ignore;
-  write_timer_.cancel(ignore);
-
+void Session::on_write(bool keep_alive, boost::system::error_code ec) {
+  head_.reset();
+  body_.reset();
   if (ec) {
+    span_.cancel();
     close();
     return;
   }
+  span_.finish();
+
+  if (h2_upgrade_) {
+    switch_to_h2();
+    return;
+  }
+
+  if (bad_request_) {
+    bad_request_ = false;
+    respond_with_error(400, "Bad Request", false);
+    return;
+  }
 
   if (!keep_alive || closing_after_) {
     close();
@@ -257,32 +606,133 @@ void Session::on_write(std::unique_ptr<std::string> /*head*/,
   if (!pending_.empty()) {
     handle_next_in_queue();
   } else {
+    set_deadline(rlen_ > 0 ? Deadline::Read : Deadline::Idle);
     start_read();
   }
 }
 
-void Session::arm_idle_timer() {
+void Session::wait_writable() {
   auto self = shared_from_this();
-  idle_timer_.expires_after(std::chrono::milliseconds(cfg_.keepalive_timeout_ms));
-  idle_timer_.async_wait([self](const boost::system::error_code& ec){
-    if (!ec) {
-      fmt::print("[info] idle timeout, closing connection\n");
-      self->close();
-    }
-  });
+  socket_.async_wait(boost::asio::socket_base::wait_write, make_custom_alloc_handler(write_mem_,
+    [self](boost::system::error_code ec) {
+      if (ec) self->on_write(self->turn_keep_alive_, ec);
+      else self->sched_->wait(self->turn_);
+    }));
 }
 
-void Session::cancel_timers() {
-  boost::system::error_code ig;
-  read_timer_.cancel(ig);
-  write_timer_.cancel(ig);
-  idle_timer_.cancel(ig);
+// Runs on whichever thread ended the previous turn; the write itself happens on the
+// session's strand
+void Session::on_turn(const std::shared_ptr<void>& owner, std::size_t budget) {
+  auto self = std::static_pointer_cast<Session>(owner);
+  boost::asio::post(self->socket_.get_executor(), make_custom_alloc_handler(self->write_mem_,
+    [self, budget] { self->write_turn(budget); }));
+}
+
+void Session::write_turn(std::size_t budget) {
+  if (closed_) {
+    sched_->done();
+    return;
+  }
+  const std::size_t head = head_->size();
+  const std::size_t total = head + body_->size();
+  std::array<boost::asio::const_buffer, 2> bufs{};
+  std::size_t want = 0;
+  if (sent_ < head) {
+    bufs[0] = boost::asio::buffer(head_->data() + sent_, std::min(head - sent_, budget));
+    want = bufs[0].size();
+  }
+  const std::size_t body_at = sent_ > head ? sent_ - head : 0;
+  bufs[1] = boost::asio::buffer(body_->data() + body_at, std::min(body_->size() - body_at, budget - want));
+  want += bufs[1].size();
+
+  boost::system::error_code ec;
+  const std::size_t n = socket_.write_some(bufs, ec);
+  sched_->done();
+  if (ec == boost::asio::error::would_block || ec == boost::asio::error::try_again) {
+    wait_writable();
+    return;
+  }
+  if (ec) {
+    on_write(turn_keep_alive_, ec);
+    return;
+  }
+
+  sent_ += n;
+  if (sent_ == total) on_write(turn_keep_alive_, {});
+  else if (n < want) wait_writable();   // the socket buffer is full
+  else sched_->wait(turn_);
+}
+
+// RFC 7540 section 3.2. Only taken when nothing else is queued or being read, so the
+// socket can change hands as soon as the 101 is out; otherwise the request is just
+// served over HTTP/1.1, which the Upgrade header allows.
+bool Session::try_h2c_upgrade(const HttpRequest& req) {
+  if (!cfg_->http2_enable || tls_ || !req.keep_alive || reading_ || !pending_.empty()) return false;
+  if (req.method != "GET" && req.method != "HEAD") return false;
+  const auto& up = req.header(HeaderId::Upgrade);
+  if (up.empty() || !has_token(up, "h2c")) return false;
+  const auto& hs = req.header(HeaderId::Http2Settings);
+  if (hs.empty()) return false;
+
+  auto upgrade = std::make_unique<H2Upgrade>();
+  if (!H2Session::decode_settings_header(hs, upgrade->settings)) return false;
+  upgrade->request = req;
+  h2_upgrade_ = std::move(upgrade);
+  closing_after_ = true;   // no further HTTP/1.1 reads
+
+  auto& h = begin_head(101);
+  append_header(h, "Connection", "Upgrade");
+  append_header(h, "Upgrade", "h2c");
+  h.append("\r\n", 2);
+  write_response(nullptr, true);
+  return true;
+}
+
+void Session::switch_to_h2() {
+  std::string early;
+  if (!h2_upgrade_) early.assign(h2::kClientPreface.substr(0, h2::kClientPreface.find("SM")));
+  early.append(rbuf_.data(), rlen_);
+  consume_input(rlen_);
+
+  wheel_->cancel(deadline_);
+  closed_ = true;
+  auto h2s = std::make_shared<H2Session>(std::move(socket_), cfg_, cache_, image_, monitor_, wheel_);
+  if (h2_upgrade_) {
+    auto upgrade = std::move(h2_upgrade_);
+    h2s->start_upgraded(upgrade->request, upgrade->settings, early);
+  } else {
+    h2s->start(early);
+  }
+}
+
+// One wheel deadline per session, covering whichever phase it is in: reading a
+// request, writing a response, or idling between keep-alive requests.
+void Session::set_deadline(Deadline kind) {
+  int ms = cfg_->read_timeout_ms;
+  if (kind == Deadline::Write) ms = cfg_->write_timeout_ms;
+  else if (kind == Deadline::Idle) ms = cfg_->keepalive_timeout_ms;
+  deadline_kind_ = kind;
+  wheel_->schedule(deadline_, std::chrono::milliseconds(ms));
+}
+
+// Runs on the wheel's strand; hops to the session's strand before touching it
+void Session::on_deadline(const std::shared_ptr<void>& owner, uint64_t generation) {
+  auto self = std::static_pointer_cast<Session>(owner);
+  boost::asio::post(self->socket_.get_executor(), [self, generation] {
+    if (self->closed_ || self->wheel_->generation_of(self->deadline_) != generation) return;
+    static const char* const kNames[] = {"read", "write", "idle"};
+    Metrics::instance().connection_timeouts.fetch_add(1, std::memory_order_relaxed);
+    log_debug("{} timeout, closing connection", kNames[static_cast<int>(self->deadline_kind_)]);
+    self->close();
+  });
 }
 
 void Session::close() {
   if (closed_) return;
   closed_ = true;
-  cancel_timers();
+  wheel_->cancel(deadline_);
+  sched_->cancel(turn_);
+  if (tls_) tls_->shutdown();
   boost::system::error_code ig;
   socket_.shutdown(tcp::socket::shutdown_both, ig);
   socket_.close(ig);
@@ -0,0 +1,58 @@
+#include "../headers/session_pool.hpp"
+#include "../headers/util/metrics.hpp"
+
+SessionPool::SessionPool(std::shared_ptr<const Config> cfg, std::shared_ptr<LRUCache> cache,
+                         std::shared_ptr<const DocImage> image, std::shared_ptr<const LoadMonitor> monitor, std::shared_ptr<TimerWheel> wheel,
+                         std::shared_ptr<SendScheduler> sched, std::size_t max_idle)
+  : cfg_(std::move(cfg)),
+    cache_(std::move(cache)),
+    image_(std::move(image)),
+    monitor_(std::move(monitor)),
+    wheel_(std::move(wheel)),
+    sched_(std::move(sched)),
+    max_idle_(max_idle) {
+  idle_.reserve(max_idle_);
+}
+
+SessionPool::~SessionPool() {
+  for (Session* s : idle_) delete s;
+}
+
+std::shared_ptr<Session> SessionPool::acquire(SessionSocket socket) {
+  Session* s = nullptr;
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    if (!idle_.empty()) {
+      s = idle_.back();
+      idle_.pop_back();
+    }
+  }
+  if (s) {
+    s->reuse(std::move(socket));
+    Metrics::instance().sessions_reused.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    s = new Session(std::move(socket), cfg_, cache_, image_, monitor_, wheel_, sched_);
+  }
+  // The deleter keeps the pool alive for as long as any of its sessions is
+  auto pool = shared_from_this();
+  return std::shared_ptr<Session>(s, [pool](Session* p) { pool->release(p); });
+}
+
+std::size_t SessionPool::idle() const {
+  std::lock_guard<std::mutex> lk(mtx_);
+  return idle_.size();
+}
+
+// Runs when the last handler of a connection let go of it, on whichever thread
+// that was
+void SessionPool::release(Session* s) {
+  s->recycle();
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    if (idle_.size() < max_idle_) {
+      idle_.push_back(s);
+      return;
+    }
+  }
+  delete s;
+}
@@ -1,8 +1,8 @@
 #include "../headers/signals.hpp"
-#include <fmt/core.h>
+#include "../headers/util/logging.hpp"
 
 SignalHandler::SignalHandler(boost::asio::io_context& ioc)
-  : ioc_(ioc), signals_(ioc, SIGINT, SIGTERM)
+  : ioc_(ioc), signals_(ioc, SIGINT, SIGTERM, SIGHUP)
 {}
 
 void SignalHandler::register_signals() {
@@ -12,8 +12,18 @@ void SignalHandler::register_signals() {
 }
 
 void SignalHandler::on_signal(const boost::system::error_code& ec, int signo) {
-  if (!ec) {
-    fmt::print("[info] Caught signal {}, shutting down...\n", signo);
-    ioc_.stop();
+  if (ec) return;
+  if (signo == SIGHUP) {
+    if (reload_) {
+      log_info("Caught SIGHUP, starting a successor");
+      reload_();
+    } else {
+      log_info("Caught SIGHUP; no --handoff.path set, ignoring");
+    }
+    register_signals();
+    return;
   }
+  log_info("Caught signal {}, shutting down...", signo);
+  if (shutdown_) shutdown_();
+  ioc_.stop();
 }
\ No newline at end of file
@@ -0,0 +1,142 @@
+#include "../../headers/tls/tls.hpp"
+
+#include <stdexcept>
+
+#ifdef ENABLE_TLS
+#include <openssl/bio.h>
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+
+namespace tls {
+namespace {
+
+std::string last_error(const char* what) {
+  std::string out(what);
+  char buf[256];
+  while (const unsigned long e = ERR_get_error()) {
+    ERR_error_string_n(e, buf, sizeof(buf));
+    out += ": ";
+    out += buf;
+  }
+  return out;
+}
+
+} // namespace
+
+Context::Context(const std::string& cert_file, const std::string& key_file, bool ktls) : ktls_(ktls) {
+  ctx_ = SSL_CTX_new(TLS_server_method());
+  if (!ctx_) throw std::runtime_error(last_error("tls: SSL_CTX_new"));
+  SSL_CTX_set_min_proto_version(ctx_, TLS1_2_VERSION);
+  // Partial writes let a session resume a large body where the socket stopped
+  SSL_CTX_set_mode(ctx_, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+  if (ktls_) SSL_CTX_set_options(ctx_, SSL_OP_ENABLE_KTLS);
+
+  if (SSL_CTX_use_certificate_chain_file(ctx_, cert_file.c_str()) != 1 ||
+      SSL_CTX_use_PrivateKey_file(ctx_, key_file.c_str(), SSL_FILETYPE_PEM) != 1 ||
+      SSL_CTX_check_private_key(ctx_) != 1) {
+    const auto msg = last_error(("tls: cannot load '" + cert_file + "' / '" + key_file + "'").c_str());
+    SSL_CTX_free(ctx_);
+    throw std::runtime_error(msg);
+  }
+}
+
+Context::~Context() {
+  SSL_CTX_free(ctx_);
+}
+
+Connection::Connection(const Context& ctx, int fd) {
+  ssl_ = SSL_new(ctx.native());
+  if (!ssl_ || SSL_set_fd(ssl_, fd) != 1) {
+    error_ = last_error("tls: SSL_new");
+    return;
+  }
+  SSL_set_accept_state(ssl_);
+}
+
+Connection::~Connection() {
+  SSL_free(ssl_);
+}
+
+Status Connection::status_of(int ret) {
+  switch (SSL_get_error(ssl_, ret)) {
+    case SSL_ERROR_WANT_READ: return Status::WantRead;
+    case SSL_ERROR_WANT_WRITE: return Status::WantWrite;
+    case SSL_ERROR_ZERO_RETURN: return Status::Closed;
+    case SSL_ERROR_SYSCALL:
+      if (ERR_peek_error() == 0) {
+        error_ = "connection reset";
+        ERR_clear_error();
+        return Status::Closed;
+      }
+      [[fallthrough]];
+    default:
+      error_ = last_error("tls");
+      return Status::Error;
+  }
+}
+
+Status Connection::handshake() {
+  if (!ssl_) return Status::Error;
+  ERR_clear_error();
+  const int ret = SSL_do_handshake(ssl_);
+  return ret == 1 ? Status::Done : status_of(ret);
+}
+
+Status Connection::read(void* buf, std::size_t cap, std::size_t& n) {
+  ERR_clear_error();
+  n = 0;
+  const int ret = SSL_read_ex(ssl_, buf, cap, &n);
+  return ret == 1 ? Status::Done : status_of(ret);
+}
+
+Status Connection::write(const void* buf, std::size_t len, std::size_t& n) {
+  ERR_clear_error();
+  n = 0;
+  const int ret = SSL_write_ex(ssl_, buf, len, &n);
+  return ret == 1 ? Status::Done : status_of(ret);
+}
+
+bool Connection::has_pending() const {
+  return SSL_has_pending(ssl_) == 1;
+}
+
+bool Connection::ktls_send() const {
+  return BIO_get_ktls_send(SSL_get_wbio(ssl_)) != 0;
+}
+
+bool Connection::ktls_recv() const {
+  return BIO_get_ktls_recv(SSL_get_rbio(ssl_)) != 0;
+}
+
+void Connection::shutdown() {
+  if (!ssl_ || !SSL_is_init_finished(ssl_)) return;
+  ERR_clear_error();
+  SSL_shutdown(ssl_);
+  ERR_clear_error();
+}
+
+} // namespace tls
+
+#else // ENABLE_TLS
+
+namespace tls {
+
+Context::Context(const std::string&, const std::string&, bool) {
+  throw std::runtime_error("tls: built without ENABLE_TLS");
+}
+Context::~Context() = default;
+
+Connection::Connection(const Context&, int) {}
+Connection::~Connection() = default;
+Status Connection::status_of(int) { return Status::Error; }
+Status Connection::handshake() { return Status::Error; }
+Status Connection::read(void*, std::size_t, std::size_t&) { return Status::Error; }
+Status Connection::write(const void*, std::size_t, std::size_t&) { return Status::Error; }
+bool Connection::has_pending() const { return false; }
+bool Connection::ktls_send() const { return false; }
+bool Connection::ktls_recv() const { return false; }
+void Connection::shutdown() {}
+
+} // namespace tls
+
+#endif // ENABLE_TLS
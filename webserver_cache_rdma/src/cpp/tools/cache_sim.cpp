@@ -0,0 +1,341 @@
+// Replays an access trace recorded with `webserver --trace.path` against the server's
+// own LRUCache and a few textbook policies at a range of cache sizes, and prints the
+// miss-ratio curve of each: one JSON line per (policy, size) on stdout, a table on
+// stderr. Every (policy, size) pair is an independent replay, run in parallel.
+#include <fmt/core.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <list>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "../../headers/cache/lru_cache.hpp"
+#include "../../headers/util/access_trace.hpp"
+
+namespace {
+
+struct Options {
+  std::string trace;
+  std::vector<std::string> policies = {"server", "lru", "fifo", "clock"};
+  std::vector<double> sizes_mb;     // explicit sizes; otherwise min..max geometric
+  double min_mb = 1;
+  double max_mb = 0;                // 0 = the trace's footprint
+  unsigned steps = 12;
+  unsigned threads = 0;             // 0 = hardware_concurrency
+  double warmup = 0;                // leading fraction of the trace not counted
+  unsigned small_mb = 0;            // server policy: as --cache.small-mb
+  unsigned small_max_kb = 16;       // server policy: as --cache.small-max-kb
+};
+
+void print_usage(const char* argv0) {
+  fmt::print("Usage: {} --trace FILE [--policies server,lru,fifo,clock] [--sizes-mb A,B,...]\n"
+             "            [--min-mb N] [--max-mb N] [--steps N] [--threads N] [--warmup FRACTION]\n"
+             "            [--small-mb N] [--small-max-kb N]\n", argv0);
+}
+
+std::vector<std::string> split(const std::string& list) {
+  std::vector<std::string> out;
+  std::size_t pos = 0;
+  while (pos <= list.size()) {
+    std::size_t end = list.find(',', pos);
+    if (end == std::string::npos) end = list.size();
+    if (end > pos) out.push_back(list.substr(pos, end - pos));
+    pos = end + 1;
+  }
+  return out;
+}
+
+struct Trace {
+  uint32_t sample = 1;
+  std::vector<access_trace::Record> records;
+};
+
+Trace load(const std::string& path) {
+  std::FILE* f = std::fopen(path.c_str(), "rb");
+  if (!f) throw std::runtime_error("cannot open " + path);
+  std::unique_ptr<std::FILE, int (*)(std::FILE*)> guard(f, &std::fclose);
+
+  access_trace::FileHeader h{};
+  if (std::fread(&h, sizeof(h), 1, f) != 1 || std::memcmp(h.magic, access_trace::kMagic, sizeof(h.magic)) != 0)
+    throw std::runtime_error(path + " is not an access trace");
+  if (h.version != access_trace::kVersion || h.record_size != sizeof(access_trace::Record))
+    throw std::runtime_error(path + ": unsupported trace version");
+
+  Trace t;
+  t.sample = std::max<uint32_t>(1, h.sample);
+  access_trace::Record buf[4096];
+  std::size_t n;
+  while ((n = std::fread(buf, sizeof(buf[0]), std::size(buf), f)) > 0) t.records.insert(t.records.end(), buf, buf + n);
+  // Each thread's ring is drained in turn, so the file is only ordered per thread
+  std::stable_sort(t.records.begin(), t.records.end(),
+                   [](const auto& a, const auto& b) { return a.ts_ns < b.ts_ns; });
+  return t;
+}
+
+struct Result {
+  uint64_t requests = 0;
+  uint64_t misses = 0;
+  uint64_t bytes = 0;
+  uint64_t miss_bytes = 0;
+};
+
+// Policies over (key, size) with a byte budget; access() returns true on a hit and
+// admits the object on a miss. Objects larger than the whole budget are not admitted.
+class Lru {
+public:
+  explicit Lru(uint64_t capacity) : capacity_(capacity) {}
+
+  bool access(uint64_t key, uint32_t size) {
+    if (auto it = index_.find(key); it != index_.end()) {
+      order_.splice(order_.begin(), order_, it->second);
+      return true;
+    }
+    if (size > capacity_) return false;
+    while (used_ + size > capacity_) {
+      used_ -= order_.back().second;
+      index_.erase(order_.back().first);
+      order_.pop_back();
+    }
+    order_.emplace_front(key, size);
+    index_.emplace(key, order_.begin());
+    used_ += size;
+    return false;
+  }
+
+private:
+  uint64_t capacity_;
+  uint64_t used_ = 0;
+  std::list<std::pair<uint64_t, uint32_t>> order_;
+  std::unordered_map<uint64_t, std::list<std::pair<uint64_t, uint32_t>>::iterator> index_;
+};
+
+// FIFO, and CLOCK as FIFO with a second chance for entries referenced since insertion
+class Queue {
+public:
+  Queue(uint64_t capacity, bool second_chance) : capacity_(capacity), second_chance_(second_chance) {}
+
+  bool access(uint64_t key, uint32_t size) {
+    if (auto it = index_.find(key); it != index_.end()) {
+      it->second->referenced = true;
+      return true;
+    }
+    if (size > capacity_) return false;
+    while (used_ + size > capacity_) {
+      Entry e = queue_.front();
+      queue_.pop_front();
+      if (second_chance_ && e.referenced) {
+        e.referenced = false;
+        queue_.push_back(e);
+        index_[e.key] = &queue_.back();
+        continue;
+      }
+      used_ -= e.size;
+      index_.erase(e.key);
+    }
+    queue_.push_back({key, size, false});
+    index_.emplace(key, &queue_.back());
+    used_ += size;
+    return false;
+  }
+
+private:
+  struct Entry {
+    uint64_t key;
+    uint32_t size;
+    bool referenced;
+  };
+
+  uint64_t capacity_;
+  bool second_chance_;
+  uint64_t used_ = 0;
+  std::deque<Entry> queue_;   // push_back/pop_front keep references to other elements valid
+  std::unordered_map<uint64_t, Entry*> index_;
+};
+
+// The server's own cache: two tiers, CLOCK small tier, per-tier budgets. Objects carry
+// their size and no body; the key is the record's hash.
+class Server {
+public:
+  Server(uint64_t capacity, const Options& opt, uint32_t sample) : cache_(options(capacity, opt, sample)) {}
+
+  bool access(uint64_t key, uint32_t size) {
+    const std::string_view k(reinterpret_cast<const char*>(&key), sizeof(key));
+    if (cache_.get(k)) return true;
+    auto obj = std::make_shared<CachedObject>();
+    obj->body_size = size;
+    cache_.put(k, std::move(obj));
+    return false;
+  }
+
+private:
+  static LRUCache::Options options(uint64_t capacity, const Options& opt, uint32_t sample) {
+    LRUCache::Options o;
+    o.capacity_bytes = capacity;
+    o.small_capacity_bytes = (static_cast<std::size_t>(opt.small_mb) << 20) / sample;
+    o.small_max_object = static_cast<std::size_t>(opt.small_max_kb) * 1024;
+    return o;
+  }
+
+  LRUCache cache_;
+};
+
+template <typename Policy>
+Result replay(Policy& p, const Trace& t, std::size_t counted_from) {
+  Result r;
+  for (std::size_t i = 0; i < t.records.size(); ++i) {
+    const auto& rec = t.records[i];
+    const bool hit = p.access(rec.key, rec.size);
+    if (i < counted_from) continue;
+    ++r.requests;
+    r.bytes += rec.size;
+    if (!hit) {
+      ++r.misses;
+      r.miss_bytes += rec.size;
+    }
+  }
+  return r;
+}
+
+Result run(const std::string& policy, uint64_t capacity, const Trace& t, const Options& opt, std::size_t counted_from) {
+  if (policy == "server") {
+    Server p(capacity, opt, t.sample);
+    return replay(p, t, counted_from);
+  }
+  if (policy == "lru") {
+    Lru p(capacity);
+    return replay(p, t, counted_from);
+  }
+  Queue p(capacity, policy == "clock");
+  return replay(p, t, counted_from);
+}
+
+double ratio(uint64_t a, uint64_t b) {
+  return b ? static_cast<double>(a) / static_cast<double>(b) : 0.0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  Options opt;
+  try {
+    for (int i = 1; i < argc; ++i) {
+      const std::string arg = argv[i];
+      if (arg == "--trace" && i + 1 < argc) opt.trace = argv[++i];
+      else if (arg == "--policies" && i + 1 < argc) opt.policies = split(argv[++i]);
+      else if (arg == "--sizes-mb" && i + 1 < argc) {
+        for (const auto& s : split(argv[++i])) opt.sizes_mb.push_back(std::stod(s));
+      }
+      else if (arg == "--min-mb" && i + 1 < argc) opt.min_mb = std::stod(argv[++i]);
+      else if (arg == "--max-mb" && i + 1 < argc) opt.max_mb = std::stod(argv[++i]);
+      else if (arg == "--steps" && i + 1 < argc) opt.steps = static_cast<unsigned>(std::stoul(argv[++i]));
+      else if (arg == "--threads" && i + 1 < argc) opt.threads = static_cast<unsigned>(std::stoul(argv[++i]));
+      else if (arg == "--warmup" && i + 1 < argc) opt.warmup = std::stod(argv[++i]);
+      else if (arg == "--small-mb" && i + 1 < argc) opt.small_mb = static_cast<unsigned>(std::stoul(argv[++i]));
+      else if (arg == "--small-max-kb" && i + 1 < argc) opt.small_max_kb = static_cast<unsigned>(std::stoul(argv[++i]));
+      else { print_usage(argv[0]); return arg == "--help" || arg == "-h" ? 0 : 2; }
+    }
+  } catch (const std::exception&) {
+    print_usage(argv[0]);
+    return 2;
+  }
+  if (opt.trace.empty()) {
+    print_usage(argv[0]);
+    return 2;
+  }
+  for (const auto& p : opt.policies) {
+    if (p != "server" && p != "lru" && p != "fifo" && p != "clock") {
+      fmt::print(stderr, "[cache_sim] unknown policy '{}'\n", p);
+      return 2;
+    }
+  }
+
+  try {
+    const auto t0 = std::chrono::steady_clock::now();
+    const Trace trace = load(opt.trace);
+    if (trace.records.empty()) throw std::runtime_error(opt.trace + " holds no records");
+
+    // Footprint (distinct keys at their last size) and what the server saw
+    std::unordered_map<uint64_t, uint32_t> sizes;
+    uint64_t observed_hits = 0;
+    for (const auto& r : trace.records) {
+      sizes[r.key] = r.size;
+      observed_hits += r.hit;
+    }
+    uint64_t footprint = 0;
+    for (const auto& kv : sizes) footprint += kv.second;
+    const double footprint_mb = static_cast<double>(footprint) * trace.sample / (1 << 20);
+
+    // Sizes are for the whole key space; with sampling, each replay gets 1/sample
+    std::vector<double> sizes_mb = opt.sizes_mb;
+    if (sizes_mb.empty()) {
+      const double hi = opt.max_mb > 0 ? opt.max_mb : std::max(opt.min_mb, footprint_mb);
+      const unsigned steps = std::max(1u, opt.steps);
+      for (unsigned i = 0; i < steps; ++i) {
+        sizes_mb.push_back(steps == 1 ? hi : opt.min_mb * std::pow(hi / opt.min_mb, static_cast<double>(i) / (steps - 1)));
+      }
+    }
+
+    struct Job {
+      std::string policy;
+      double size_mb;
+      Result result;
+    };
+    std::vector<Job> jobs;
+    for (double mb : sizes_mb)
+      for (const auto& p : opt.policies) jobs.push_back({p, mb, {}});
+
+    const std::size_t counted_from = static_cast<std::size_t>(
+      std::clamp(opt.warmup, 0.0, 1.0) * static_cast<double>(trace.records.size()));
+    std::atomic<std::size_t> next{0};
+    const unsigned threads = std::min<unsigned>(
+      opt.threads ? opt.threads : std::max(1u, std::thread::hardware_concurrency()), static_cast<unsigned>(jobs.size()));
+    std::vector<std::thread> pool;
+    for (unsigned i = 0; i < threads; ++i) {
+      pool.emplace_back([&] {
+        for (std::size_t j; (j = next.fetch_add(1)) < jobs.size();) {
+          const auto capacity = static_cast<uint64_t>(jobs[j].size_mb * (1 << 20) / trace.sample);
+          jobs[j].result = run(jobs[j].policy, capacity, trace, opt, counted_from);
+        }
+      });
+    }
+    for (auto& t : pool) t.join();
+    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t0).count();
+
+    fmt::print("{{\"trace\":\"{}\",\"records\":{},\"sample\":{},\"keys\":{},\"footprint_mb\":{:.2f},"
+               "\"observed_miss_ratio\":{:.4f},\"replays\":{},\"threads\":{},\"elapsed_ms\":{}}}\n",
+               opt.trace, trace.records.size(), trace.sample, sizes.size() * trace.sample, footprint_mb,
+               1.0 - ratio(observed_hits, trace.records.size()), jobs.size(), threads, ms);
+    for (const auto& j : jobs) {
+      fmt::print("{{\"policy\":\"{}\",\"size_mb\":{:.2f},\"requests\":{},\"miss_ratio\":{:.4f},\"byte_miss_ratio\":{:.4f}}}\n",
+                 j.policy, j.size_mb, j.result.requests, ratio(j.result.misses, j.result.requests),
+                 ratio(j.result.miss_bytes, j.result.bytes));
+    }
+
+    // Miss ratio per size (rows) and policy (columns)
+    fmt::print(stderr, "{:>10}", "size_mb");
+    for (const auto& p : opt.policies) fmt::print(stderr, " {:>8}", p);
+    fmt::print(stderr, "\n");
+    for (std::size_t row = 0; row < sizes_mb.size(); ++row) {
+      fmt::print(stderr, "{:>10.2f}", sizes_mb[row]);
+      for (std::size_t col = 0; col < opt.policies.size(); ++col) {
+        const auto& r = jobs[row * opt.policies.size() + col].result;
+        fmt::print(stderr, " {:>8.4f}", ratio(r.misses, r.requests));
+      }
+      fmt::print(stderr, "\n");
+    }
+  } catch (const std::exception& ex) {
+    fmt::print(stderr, "[cache_sim] {}\n", ex.what());
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,146 @@
+// Packs a document root into one read-only image for `webserver --image`: every
+// regular file under the root, its MIME type, ETag and Last-Modified, and a gzip
+// variant where compression saves at least --gzip-min-saving percent. The image is
+// reopened afterwards and every path looked up once, as a check and a timing.
+#include <fmt/core.h>
+#include <zlib.h>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../../headers/fs/doc_image.hpp"
+#include "../../headers/fs/file_reader.hpp"
+#include "../../headers/http/mime.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+struct Options {
+  std::string doc_root = "./public";
+  std::string out;
+  bool gzip = true;
+  int gzip_level = 9;
+  std::size_t gzip_min_bytes = 256;
+  unsigned gzip_min_saving = 10;     // percent
+};
+
+void print_usage(const char* argv0) {
+  fmt::print("Usage: {} --out FILE [--doc-root PATH] [--no-gzip] [--gzip-level N] [--gzip-min-bytes B]\n"
+             "            [--gzip-min-saving PCT]\n", argv0);
+}
+
+// Empty if zlib fails
+std::vector<uint8_t> gzip(const std::vector<uint8_t>& in, int level) {
+  z_stream zs{};
+  if (deflateInit2(&zs, level, Z_DEFLATED, 15 + 16, 9, Z_DEFAULT_STRATEGY) != Z_OK) return {};
+  std::vector<uint8_t> out(deflateBound(&zs, static_cast<uLong>(in.size())));
+  zs.next_in = const_cast<Bytef*>(in.data());
+  zs.avail_in = static_cast<uInt>(in.size());
+  zs.next_out = out.data();
+  zs.avail_out = static_cast<uInt>(out.size());
+  const int rc = deflate(&zs, Z_FINISH);
+  out.resize(zs.total_out);
+  deflateEnd(&zs);
+  return rc == Z_STREAM_END ? out : std::vector<uint8_t>{};
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  Options opt;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--doc-root" && i + 1 < argc) opt.doc_root = argv[++i];
+    else if (arg == "--out" && i + 1 < argc) opt.out = argv[++i];
+    else if (arg == "--no-gzip") opt.gzip = false;
+    else if (arg == "--gzip-level" && i + 1 < argc) opt.gzip_level = std::stoi(argv[++i]);
+    else if (arg == "--gzip-min-bytes" && i + 1 < argc) opt.gzip_min_bytes = std::stoul(argv[++i]);
+    else if (arg == "--gzip-min-saving" && i + 1 < argc) opt.gzip_min_saving = static_cast<unsigned>(std::stoul(argv[++i]));
+    else { print_usage(argv[0]); return arg == "--help" || arg == "-h" ? 0 : 2; }
+  }
+  if (opt.out.empty()) {
+    print_usage(argv[0]);
+    return 2;
+  }
+
+  try {
+    const auto t0 = std::chrono::steady_clock::now();
+    const fs::path root = fs::weakly_canonical(opt.doc_root);
+    if (!fs::is_directory(root)) throw std::runtime_error("not a directory: " + opt.doc_root);
+    const std::string root_prefix = root.string() + "/";
+
+    std::vector<doc_image::Input> inputs;
+    std::size_t body_bytes = 0, gzip_count = 0, gzip_bytes = 0, skipped = 0;
+    for (auto it = fs::recursive_directory_iterator(root, fs::directory_options::skip_permission_denied);
+         it != fs::recursive_directory_iterator(); ++it) {
+      std::error_code ec;
+      if (!it->is_regular_file(ec)) continue;
+      // Same rule as map_url_to_fs: a link may not lead out of the root
+      const fs::path canon = fs::weakly_canonical(it->path(), ec);
+      if (ec || canon.string().compare(0, root_prefix.size(), root_prefix) != 0) {
+        ++skipped;
+        continue;
+      }
+
+      auto fr = read_file(canon.string());
+      if (!fr.ok) {
+        fmt::print(stderr, "[docpack] skipping {}: {}\n", it->path().string(), fr.error);
+        ++skipped;
+        continue;
+      }
+
+      doc_image::Input in;
+      in.path = "/" + it->path().lexically_relative(root).generic_string();
+      in.mime = std::string(mime_type(canon.string()));
+      in.etag = make_etag(fr.data.size(), fr.last_modified);
+      in.last_modified = fr.last_modified;
+      if (opt.gzip && fr.data.size() >= opt.gzip_min_bytes) {
+        auto z = gzip(fr.data, opt.gzip_level);
+        if (!z.empty() && z.size() * 100 <= fr.data.size() * (100 - opt.gzip_min_saving)) {
+          gzip_bytes += z.size();
+          ++gzip_count;
+          in.gzip = std::move(z);
+        }
+      }
+      in.body = std::move(fr.data);
+      body_bytes += in.body.size();
+      inputs.push_back(std::move(in));
+    }
+
+    std::vector<std::string> paths;
+    paths.reserve(inputs.size());
+    for (const auto& in : inputs) paths.push_back(in.path);
+    const std::size_t files = inputs.size();
+    doc_image::write(opt.out, std::move(inputs));
+    const auto t1 = std::chrono::steady_clock::now();
+
+    // Check: every path resolves, to itself
+    auto img = DocImage::open(opt.out);
+    const auto t2 = std::chrono::steady_clock::now();
+    std::size_t found = 0;
+    for (const auto& p : paths) found += img->find(p, false) != nullptr;
+    const auto t3 = std::chrono::steady_clock::now();
+    for (const auto& p : paths) found += img->find(p, false) != nullptr;
+    const auto t4 = std::chrono::steady_clock::now();
+    if (found != 2 * files) throw std::runtime_error("image check failed: some paths do not resolve");
+
+    using us = std::chrono::microseconds;
+    const auto ns_per = [files](auto d) {
+      return files ? static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count()) /
+                     static_cast<double>(files) : 0.0;
+    };
+    fmt::print("{{\"files\":{},\"skipped\":{},\"body_bytes\":{},\"gzip_files\":{},\"gzip_bytes\":{},"
+               "\"image_bytes\":{},\"pack_ms\":{},\"open_us\":{},\"first_lookup_ns\":{:.0f},\"lookup_ns\":{:.0f}}}\n",
+               files, skipped, body_bytes, gzip_count, gzip_bytes, img->size_bytes(),
+               std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count(),
+               std::chrono::duration_cast<us>(t2 - t1).count(), ns_per(t3 - t2), ns_per(t4 - t3));
+  } catch (const std::exception& ex) {
+    fmt::print(stderr, "[docpack] {}\n", ex.what());
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,169 @@
+// Per-request cost of header-name handling and MIME lookup: time and heap
+// allocations of the interned / perfect-hash versions against the map-based
+// approach they replaced (kept here as the baseline), plus a full HttpParser pass
+// over the same request for scale.
+#include <fmt/core.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "../../headers/http/headers.hpp"
+#include "../../headers/http/mime.hpp"
+#include "../../headers/http/parser.hpp"
+#include "../../headers/http/request.hpp"
+
+namespace {
+std::atomic<uint64_t> g_allocs{0};
+
+void* counted_alloc(std::size_t n) {
+  g_allocs.fetch_add(1, std::memory_order_relaxed);
+  if (void* p = std::malloc(n ? n : 1)) return p;
+  throw std::bad_alloc();
+}
+} // namespace
+
+void* operator new(std::size_t n) { return counted_alloc(n); }
+void* operator new[](std::size_t n) { return counted_alloc(n); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+
+const char kRequest[] =
+  "GET /static/app/main.JS HTTP/1.1\r\n"
+  "Host: example.com\r\n"
+  "User-Agent: Mozilla/5.0 (X11; Linux x86_64) Gecko/20100101 Firefox/128.0\r\n"
+  "Accept: */*\r\n"
+  "Accept-Encoding: gzip, deflate, br\r\n"
+  "Accept-Language: en-US,en;q=0.5\r\n"
+  "If-None-Match: W/\"2141-1729294088\"\r\n"
+  "Connection: keep-alive\r\n"
+  "\r\n";
+
+const std::vector<std::string> kPaths = {
+  "/index.html", "/static/app/main.JS", "/img/logo.png", "/img/photo.jpeg",
+  "/data/feed.json", "/fonts/inter.woff2", "/download/archive.tar.gz", "/README"
+};
+
+struct HeaderLine {
+  std::string name;
+  std::string value;
+};
+
+std::vector<HeaderLine> header_lines() {
+  std::vector<HeaderLine> out;
+  std::string_view rest(kRequest);
+  rest.remove_prefix(rest.find("\r\n") + 2);
+  while (rest.size() > 2) {
+    const auto eol = rest.find("\r\n");
+    const auto line = rest.substr(0, eol);
+    const auto colon = line.find(':');
+    out.push_back({std::string(line.substr(0, colon)), std::string(line.substr(colon + 2))});
+    rest.remove_prefix(eol + 2);
+  }
+  return out;
+}
+
+// ---- baseline: what the parser and mime_type() did before interning ----
+
+std::string baseline_mime(const std::string& path) {
+  static const std::unordered_map<std::string, std::string> m = {
+    {"html","text/html; charset=utf-8"}, {"htm","text/html; charset=utf-8"}, {"css","text/css"},
+    {"js","application/javascript"}, {"json","application/json"}, {"png","image/png"},
+    {"jpg","image/jpeg"}, {"jpeg","image/jpeg"}, {"gif","image/gif"}, {"svg","image/svg+xml"},
+    {"txt","text/plain; charset=utf-8"}, {"xml","application/xml"}, {"pdf","application/pdf"},
+    {"wasm","application/wasm"}
+  };
+  auto pos = path.find_last_of('.');
+  std::string ext = pos == std::string::npos ? std::string() : path.substr(pos + 1);
+  for (auto& c : ext) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+  auto it = m.find(ext);
+  return it != m.end() ? it->second : "application/octet-stream";
+}
+
+std::size_t baseline_headers(const std::vector<HeaderLine>& lines) {
+  std::unordered_map<std::string, std::string> headers;
+  for (const auto& l : lines) headers[header_lower(l.name)] = l.value;
+  auto it = headers.find(header_lower("Connection"));
+  return headers.size() + (it != headers.end() ? it->second.size() : 0);
+}
+
+// ---- current ----
+
+std::size_t interned_headers(const std::vector<HeaderLine>& lines) {
+  HttpRequest req;
+  for (const auto& l : lines) {
+    const HeaderId id = header_id(l.name);
+    if (id != HeaderId::Other) req.known[static_cast<std::size_t>(id)] = l.value;
+    else req.headers[header_lower(l.name)] = l.value;
+  }
+  return req.headers.size() + req.header(HeaderId::Connection).size();
+}
+
+struct Sample {
+  double ns = 0;
+  double allocs = 0;
+};
+
+template <typename Fn>
+Sample measure(std::size_t iterations, Fn&& fn) {
+  volatile std::size_t sink = 0;
+  for (std::size_t i = 0; i < iterations / 10 + 1; ++i) sink = sink + fn(i);   // warm up
+  const uint64_t a0 = g_allocs.load();
+  const auto t0 = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < iterations; ++i) sink = sink + fn(i);
+  const auto t1 = std::chrono::steady_clock::now();
+  const uint64_t a1 = g_allocs.load();
+  const double n = static_cast<double>(iterations);
+  return {std::chrono::duration<double, std::nano>(t1 - t0).count() / n, static_cast<double>(a1 - a0) / n};
+}
+
+std::string json(const char* name, const Sample& base, const Sample& cur) {
+  return fmt::format("\"{}\":{{\"baseline_ns\":{:.1f},\"ns\":{:.1f},\"baseline_allocs\":{:.2f},\"allocs\":{:.2f},"
+                     "\"saved_ns\":{:.1f},\"saved_allocs\":{:.2f}}}",
+                     name, base.ns, cur.ns, base.allocs, cur.allocs, base.ns - cur.ns, base.allocs - cur.allocs);
+}
+
+void print_usage(const char* argv0) {
+  fmt::print("Usage: {} [--iterations N]\n", argv0);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  std::size_t iterations = 1000000;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--iterations" && i + 1 < argc) iterations = std::stoull(argv[++i]);
+    else {
+      print_usage(argv[0]);
+      return arg == "--help" || arg == "-h" ? 0 : 2;
+    }
+  }
+
+  const auto lines = header_lines();
+
+  const auto mime_base = measure(iterations, [&](std::size_t i) { return baseline_mime(kPaths[i % kPaths.size()]).size(); });
+  const auto mime_cur = measure(iterations, [&](std::size_t i) { return mime_type(kPaths[i % kPaths.size()]).size(); });
+  const auto hdr_base = measure(iterations, [&](std::size_t) { return baseline_headers(lines); });
+  const auto hdr_cur = measure(iterations, [&](std::size_t) { return interned_headers(lines); });
+
+  HttpParser parser(8192, 32 * 1024);
+  const auto parse = measure(iterations, [&](std::size_t) {
+    std::size_t used = 0;
+    auto res = parser.parse(kRequest, sizeof(kRequest) - 1, used);
+    return res.request.target.size();
+  });
+
+  fmt::print("{{\"iterations\":{},{},{},\"parse\":{{\"ns\":{:.1f},\"allocs\":{:.2f}}}}}\n", iterations,
+             json("mime", mime_base, mime_cur), json("header_names", hdr_base, hdr_cur), parse.ns, parse.allocs);
+  return 0;
+}
@@ -0,0 +1,269 @@
+// Loopback throughput of the TLS listener with and without the kTLS handoff. Runs
+// the real Server in-process twice, once with --tls.no-ktls (OpenSSL encrypts every
+// response in userspace) and once with kTLS (the kernel encrypts what the session
+// writes), and drives each with keep-alive OpenSSL clients fetching one cached file.
+// A throwaway self-signed certificate is generated for the run.
+#include <boost/asio.hpp>
+#include <fmt/core.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+
+#include "../../headers/server.hpp"
+#include "../../headers/util/config.hpp"
+#include "../../headers/util/logging.hpp"
+#include "../../headers/util/metrics.hpp"
+#include "../../headers/cache/lru_cache.hpp"
+
+namespace {
+
+struct Options {
+  std::size_t size = 256 * 1024;
+  int connections = 4;
+  unsigned threads = 1;
+  double duration = 5;
+};
+
+struct Result {
+  uint64_t requests = 0;
+  uint64_t bytes = 0;
+  uint64_t errors = 0;
+  double seconds = 0;
+  uint64_t ktls_send = 0;
+  uint64_t ktls_recv = 0;
+};
+
+void print_usage(const char* argv0) {
+  fmt::print("Usage: {} [--size B] [--connections N] [--threads N] [--duration S]\n"
+             "  --threads: server I/O threads; --connections: client threads, one connection each\n", argv0);
+}
+
+bool write_self_signed(const std::string& cert_path, const std::string& key_path) {
+  EVP_PKEY* key = EVP_EC_gen("P-256");
+  X509* x = X509_new();
+  bool ok = key && x;
+  if (ok) {
+    ASN1_INTEGER_set(X509_get_serialNumber(x), 1);
+    X509_gmtime_adj(X509_getm_notBefore(x), 0);
+    X509_gmtime_adj(X509_getm_notAfter(x), 24 * 3600);
+    X509_set_pubkey(x, key);
+    X509_NAME* name = X509_get_subject_name(x);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char*>("localhost"), -1, -1, 0);
+    X509_set_issuer_name(x, name);
+    ok = X509_sign(x, key, EVP_sha256()) > 0;
+  }
+  if (ok) {
+    FILE* c = std::fopen(cert_path.c_str(), "w");
+    FILE* k = std::fopen(key_path.c_str(), "w");
+    ok = c && k && PEM_write_X509(c, x) == 1 && PEM_write_PrivateKey(k, key, nullptr, nullptr, 0, nullptr, nullptr) == 1;
+    if (c) std::fclose(c);
+    if (k) std::fclose(k);
+  }
+  X509_free(x);
+  EVP_PKEY_free(key);
+  return ok;
+}
+
+// A free loopback port for the TLS listener (the server needs a non-zero --tls.port)
+unsigned short free_port() {
+  const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t len = sizeof(addr);
+  unsigned short port = 0;
+  if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0 &&
+      ::getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len) == 0) {
+    port = ntohs(addr.sin_port);
+  }
+  ::close(fd);
+  return port;
+}
+
+// One keep-alive client: GET, then read the head and Content-Length body, until the
+// deadline passes
+void client(SSL_CTX* ctx, unsigned short port, std::chrono::steady_clock::time_point until,
+            std::atomic<uint64_t>& requests, std::atomic<uint64_t>& bytes, std::atomic<uint64_t>& errors) {
+  const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  SSL* ssl = SSL_new(ctx);
+  if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || SSL_set_fd(ssl, fd) != 1 ||
+      SSL_connect(ssl) != 1) {
+    errors.fetch_add(1);
+    SSL_free(ssl);
+    ::close(fd);
+    return;
+  }
+
+  static const std::string req = "GET /bench.bin HTTP/1.1\r\nHost: localhost\r\n\r\n";
+  std::vector<char> buf(64 * 1024);
+  std::string head;
+  uint64_t n_req = 0, n_bytes = 0;
+  while (std::chrono::steady_clock::now() < until) {
+    std::size_t w = 0;
+    if (SSL_write_ex(ssl, req.data(), req.size(), &w) != 1) break;
+
+    head.clear();
+    std::size_t body_left = 0, got = 0;
+    bool have_head = false, ok = true;
+    while (!have_head || body_left > 0) {
+      if (SSL_read_ex(ssl, buf.data(), buf.size(), &got) != 1) {
+        ok = false;
+        break;
+      }
+      n_bytes += got;
+      if (have_head) {
+        body_left -= std::min(body_left, got);
+        continue;
+      }
+      head.append(buf.data(), got);
+      const auto end = head.find("\r\n\r\n");
+      if (end == std::string::npos) continue;
+      const auto cl = head.find("Content-Length: ");
+      if (cl == std::string::npos || head.compare(0, 12, "HTTP/1.1 200") != 0) {
+        ok = false;
+        break;
+      }
+      const std::size_t length = std::stoul(head.substr(cl + 16));
+      const std::size_t have = head.size() - end - 4;
+      body_left = length - std::min(length, have);
+      have_head = true;
+    }
+    if (!ok) {
+      errors.fetch_add(1);
+      break;
+    }
+    ++n_req;
+  }
+  requests.fetch_add(n_req);
+  bytes.fetch_add(n_bytes);
+  SSL_shutdown(ssl);
+  SSL_free(ssl);
+  ::close(fd);
+}
+
+Result run(const Options& opt, const std::filesystem::path& dir, bool ktls) {
+  Config cfg;
+  cfg.port = 0;
+  cfg.threads = opt.threads;
+  cfg.doc_root = dir.string();
+  cfg.tls_port = free_port();
+  cfg.tls_cert = (dir / "cert.pem").string();
+  cfg.tls_key = (dir / "key.pem").string();
+  cfg.tls_ktls = ktls;
+  Metrics::instance().reset();
+
+  boost::asio::io_context ioc;
+  Server server{ioc, std::make_shared<const Config>(cfg), std::make_shared<LRUCache>(64u << 20)};
+  server.start();
+  std::vector<std::thread> io;
+  for (unsigned i = 0; i < opt.threads; ++i) io.emplace_back([&ioc] { ioc.run(); });
+
+  SSL_CTX* ctx = SSL_CTX_new(TLS_client_method());
+  SSL_CTX_set_verify(ctx, SSL_VERIFY_NONE, nullptr);
+
+  // One warm-up request loads the file into the cache
+  std::atomic<uint64_t> requests{0}, bytes{0}, errors{0};
+  client(ctx, server.tls_port(), std::chrono::steady_clock::now() + std::chrono::milliseconds(100),
+         requests, bytes, errors);
+  requests = 0;
+  bytes = 0;
+
+  const auto t0 = std::chrono::steady_clock::now();
+  const auto until = t0 + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                            std::chrono::duration<double>(opt.duration));
+  std::vector<std::thread> clients;
+  for (int i = 0; i < opt.connections; ++i)
+    clients.emplace_back([&] { client(ctx, server.tls_port(), until, requests, bytes, errors); });
+  for (auto& t : clients) t.join();
+  const auto t1 = std::chrono::steady_clock::now();
+
+  ioc.stop();
+  for (auto& t : io) t.join();
+  SSL_CTX_free(ctx);
+
+  Result r;
+  r.requests = requests.load();
+  r.bytes = bytes.load();
+  r.errors = errors.load();
+  r.seconds = std::chrono::duration<double>(t1 - t0).count();
+  r.ktls_send = Metrics::instance().tls_ktls_send.load();
+  r.ktls_recv = Metrics::instance().tls_ktls_recv.load();
+  return r;
+}
+
+std::string json(const char* mode, const Result& r) {
+  return fmt::format("\"{}\":{{\"requests\":{},\"errors\":{},\"req_per_s\":{:.1f},\"mb_per_s\":{:.1f},"
+                     "\"ktls_send_connections\":{},\"ktls_recv_connections\":{}}}",
+                     mode, r.requests, r.errors, static_cast<double>(r.requests) / r.seconds,
+                     static_cast<double>(r.bytes) / r.seconds / (1024.0 * 1024.0), r.ktls_send, r.ktls_recv);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  Options opt;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--size" && i + 1 < argc) opt.size = std::stoul(argv[++i]);
+    else if (arg == "--connections" && i + 1 < argc) opt.connections = std::stoi(argv[++i]);
+    else if (arg == "--threads" && i + 1 < argc) opt.threads = static_cast<unsigned>(std::stoul(argv[++i]));
+    else if (arg == "--duration" && i + 1 < argc) opt.duration = std::stod(argv[++i]);
+    else { print_usage(argv[0]); return arg == "--help" || arg == "-h" ? 0 : 2; }
+  }
+  if (opt.threads == 0) opt.threads = 1;
+
+  char dir_tmpl[] = "/tmp/tls_bench.XXXXXX";
+  if (!mkdtemp(dir_tmpl)) {
+    fmt::print(stderr, "[tls_bench] mkdtemp failed\n");
+    return 1;
+  }
+  const std::filesystem::path dir(dir_tmpl);
+  std::ofstream(dir / "bench.bin") << std::string(opt.size, 'x');
+  if (!write_self_signed((dir / "cert.pem").string(), (dir / "key.pem").string())) {
+    fmt::print(stderr, "[tls_bench] cannot create a certificate\n");
+    return 1;
+  }
+
+  LogOptions log_opt;
+  log_opt.level = LogLevel::Warn;
+  log_init(log_opt);
+
+  int rc = 0;
+  try {
+    const Result user = run(opt, dir, false);
+    const Result kernel = run(opt, dir, true);
+    fmt::print("{{\"size\":{},\"connections\":{},\"threads\":{},{},{},\"ktls_speedup\":{:.2f}}}\n",
+               opt.size, opt.connections, opt.threads, json("userspace", user), json("ktls", kernel),
+               user.requests ? static_cast<double>(kernel.requests) / static_cast<double>(user.requests) : 0.0);
+    if (kernel.ktls_send == 0)
+      fmt::print(stderr, "[tls_bench] kTLS was not engaged (no tls module?); both runs encrypted in userspace\n");
+    if (user.errors || kernel.errors) rc = 1;
+  } catch (const std::exception& ex) {
+    fmt::print(stderr, "[tls_bench] {}\n", ex.what());
+    rc = 1;
+  }
+
+  log_shutdown();
+  std::error_code ig;
+  std::filesystem::remove_all(dir, ig);
+  return rc;
+}
@@ -0,0 +1,95 @@
+// Per-request cost of the Session's tracing hooks: the sampling check on the read
+// and every mark() a cache hit goes through, with tracing off, at 1 in 100, on every
+// request, and on every request with each span kept as slow. Prints ns and
+// allocations per request for each as JSON.
+#include <fmt/core.h>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <string_view>
+
+#include "../../headers/util/metrics.hpp"
+#include "../../headers/util/tracing.hpp"
+
+namespace {
+std::atomic<uint64_t> g_allocs{0};
+
+void* counted_alloc(std::size_t n) {
+  g_allocs.fetch_add(1, std::memory_order_relaxed);
+  if (void* p = std::malloc(n ? n : 1)) return p;
+  throw std::bad_alloc();
+}
+} // namespace
+
+void* operator new(std::size_t n) { return counted_alloc(n); }
+void* operator new[](std::size_t n) { return counted_alloc(n); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+
+struct Sample {
+  double ns = 0;
+  double allocs = 0;
+};
+
+// The hooks of one keep-alive cache hit, in Session order
+Sample measure(std::size_t iterations, const tracing::Options& opt) {
+  tracing::configure(opt);
+  tracing::Span span;
+  const std::string_view target = "/static/app/main.js";
+  const auto one = [&] {
+    const uint64_t read_at = tracing::sampled() ? tracing::now() : 0;
+    if (read_at) span.begin(read_at, target);
+    span.mark(tracing::Stage::Map);
+    span.mark(tracing::Stage::Lookup);
+    span.set_status(200);
+    span.mark(tracing::Stage::Headers);
+    span.set_bytes(4096);
+    span.finish();
+  };
+  for (std::size_t i = 0; i < iterations / 10 + 1; ++i) one();   // warm up (and create the ring)
+  const uint64_t a0 = g_allocs.load();
+  const auto t0 = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < iterations; ++i) one();
+  const auto t1 = std::chrono::steady_clock::now();
+  const uint64_t a1 = g_allocs.load();
+  const double n = static_cast<double>(iterations);
+  return {std::chrono::duration<double, std::nano>(t1 - t0).count() / n, static_cast<double>(a1 - a0) / n};
+}
+
+std::string json(const char* name, const Sample& s) {
+  return fmt::format("\"{}\":{{\"ns\":{:.1f},\"allocs\":{:.2f}}}", name, s.ns, s.allocs);
+}
+
+void print_usage(const char* argv0) {
+  fmt::print("Usage: {} [--iterations N]\n", argv0);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  std::size_t iterations = 10000000;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--iterations" && i + 1 < argc) iterations = std::stoull(argv[++i]);
+    else {
+      print_usage(argv[0]);
+      return arg == "--help" || arg == "-h" ? 0 : 2;
+    }
+  }
+
+  Metrics::instance().reset();
+  const auto off = measure(iterations, {0, 1000, 128});
+  const auto sampled = measure(iterations, {100, 1000000, 128});
+  const auto all = measure(iterations, {1, 1000000, 128});
+  const auto all_kept = measure(iterations, {1, 0, 128});
+
+  fmt::print("{{\"iterations\":{},{},{},{},{}}}\n", iterations, json("off", off), json("sample_100", sampled),
+             json("sample_1", all), json("sample_1_kept", all_kept));
+  return 0;
+}
@@ -0,0 +1,139 @@
+#include "../../headers/util/access_trace.hpp"
+#include "../../headers/util/metrics.hpp"
+#include "../../headers/util/per_thread_ring.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace access_trace {
+namespace detail {
+std::atomic<uint32_t> g_sample{0};
+}
+
+namespace {
+
+class Tracer {
+public:
+  static Tracer& instance() {
+    static Tracer t;
+    return t;
+  }
+
+  ~Tracer() { shutdown(); }
+
+  void init(const Options& opt) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    if (file_) throw std::runtime_error("trace: already recording");
+    file_ = std::fopen(opt.path.c_str(), "wb");
+    if (!file_) throw std::runtime_error("trace: cannot open " + opt.path + ": " + std::strerror(errno));
+    opt_ = opt;
+    opt_.sample = std::max<uint32_t>(1, opt.sample);
+    rings_.set_capacity(std::max<std::size_t>(16, opt.ring_records));
+    base_ = std::chrono::steady_clock::now();
+
+    FileHeader h{};
+    std::memcpy(h.magic, kMagic, sizeof(kMagic));
+    h.version = kVersion;
+    h.record_size = sizeof(Record);
+    h.sample = opt_.sample;
+    h.start_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+    std::fwrite(&h, sizeof(h), 1, file_);
+
+    stopped_ = false;
+    writer_ = std::thread([this] { run(); });
+    detail::g_sample.store(opt_.sample, std::memory_order_release);
+  }
+
+  PerThreadRing<Record>& rings() { return rings_; }
+
+  void shutdown() {
+    detail::g_sample.store(0, std::memory_order_release);
+    {
+      std::lock_guard<std::mutex> lk(mtx_);
+      if (!file_ || stopped_) return;
+      stopped_ = true;
+    }
+    cv_.notify_one();
+    if (writer_.joinable()) writer_.join();
+    drain(); // whatever raced in after the writer's last pass
+    std::lock_guard<std::mutex> lk(mtx_);
+    std::fclose(file_);
+    file_ = nullptr;
+  }
+
+  uint64_t now_ns() const {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - base_).count());
+  }
+
+private:
+  void run() {
+    std::unique_lock<std::mutex> lk(mtx_);
+    while (!stopped_) {
+      cv_.wait_for(lk, std::chrono::milliseconds(std::max(1, opt_.flush_interval_ms)));
+      lk.unlock();
+      drain();
+      lk.lock();
+    }
+  }
+
+  // Records are copied out in at most two runs per ring (before and after the wrap)
+  void drain() {
+    const uint64_t written = rings_.drain([this](uint32_t, const Record* first, std::size_t n) {
+      std::fwrite(first, sizeof(Record), n, file_);
+    });
+    if (written) {
+      std::fflush(file_);
+      Metrics::instance().trace_records.fetch_add(written, std::memory_order_relaxed);
+    }
+  }
+
+  std::mutex mtx_;
+  std::condition_variable cv_;
+  Options opt_;
+  std::FILE* file_ = nullptr;
+  std::chrono::steady_clock::time_point base_;
+  PerThreadRing<Record> rings_{Options{}.ring_records};
+  std::thread writer_;
+  bool stopped_ = false;
+};
+
+} // namespace
+
+namespace detail {
+
+void append(uint64_t key, uint64_t size, bool hit, Source source) {
+  Tracer& t = Tracer::instance();
+  Record* slot = t.rings().reserve();
+  if (!slot) {
+    Metrics::instance().trace_dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  Record& rec = *slot;
+  rec.ts_ns = t.now_ns();
+  rec.key = key;
+  rec.size = static_cast<uint32_t>(std::min<uint64_t>(size, 0xffffffffu));
+  rec.hit = hit ? 1 : 0;
+  rec.source = static_cast<uint8_t>(source);
+  rec.reserved = 0;
+  t.rings().commit();
+}
+
+} // namespace detail
+
+void init(const Options& opt) {
+  Tracer::instance().init(opt);
+}
+
+void shutdown() {
+  Tracer::instance().shutdown();
+}
+
+} // namespace access_trace
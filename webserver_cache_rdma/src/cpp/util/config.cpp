@@ -5,12 +5,25 @@
 
 static void print_usage(const char* argv0) {
   fmt::print(
-    "Usage: {} [--port N] [--threads N] [--doc-root PATH]\n"
-    "            [--cache.mem-mb N]\n"
-    "            [--read-timeout-ms N] [--write-timeout-ms N] [--keepalive-timeout-ms N]\n"
+    "Usage: {} [--port N] [--threads N] [--numa] [--doc-root PATH] [--image FILE]\n"
+    "            [--cache.mem-mb N] [--cache.small-mb N] [--cache.small-max-kb N] [--cache.pin PATH[,PATH...]]\n"
+    "            [--cache.revalidate-ms N] [--cache.negative-ms N] [--cache.negative-max N]\n"
+    "            [--l2.path DIR] [--l2.capacity-mb N] [--l2.write-mb-s N]\n"
+    "            [--read-timeout-ms N] [--write-timeout-ms N] [--keepalive-timeout-ms N] [--timer.tick-ms N]\n"
     "            [--max-request-line N] [--max-header-bytes N]\n"
+    "            [--max-connections N] [--accept-lag-ms N] [--shed-latency-ms N] [--session-pool N]\n"
+    "            [--sched.slice-kb N] [--sched.slots N] [--sched.class PREFIX=WEIGHT[,...]]\n"
+    "            [--http2.disable] [--http2.max-streams N]\n"
+    "            [--tls.port N] [--tls.cert PATH] [--tls.key PATH] [--tls.no-ktls]\n"
+    "            [--handoff.path PATH] [--handoff.cache-mb N] [--handoff.drain-ms N]\n"
+    "            [--log.level debug|info|warn|error] [--log.format text|json] [--log.accept-every N]\n"
+    "            [--trace.path FILE] [--trace.sample N]\n"
+    "            [--tracing.sample N] [--tracing.slow-us N] [--tracing.ring N]\n"
     "            [--rdma.enable] [--rdma.bind IP] [--rdma.port N] [--rdma.pollers N]\n"
-    "            [--rdma.recv-bufs N] [--rdma.recv-size N] [--rdma.send-chunk N] [--rdma.max-sends N]\n",
+    "            [--rdma.poll-batch N] [--rdma.busy-poll-us N]\n"
+    "            [--rdma.recv-bufs N] [--rdma.recv-size N] [--rdma.send-chunk N] [--rdma.max-sends N]\n"
+    "            [--rdma.max-batch N]\n"
+    "            [--shm.enable] [--shm.path PATH] [--shm.ring-kb N] [--shm.busy-poll-us N] [--shm.mode OCTAL]\n",
     argv0
   );
 }
@@ -23,21 +36,83 @@ Config parse_args(int argc, char** argv) {
 
     if (arg == "--port" && i + 1 < argc) cfg.port = static_cast<unsigned short>(std::stoi(next(i)));
     else if (arg == "--threads" && i + 1 < argc) cfg.threads = static_cast<unsigned>(std::stoul(next(i)));
+    else if (arg == "--numa") cfg.numa = true;
     else if (arg == "--doc-root" && i + 1 < argc) cfg.doc_root = next(i);
+    else if (arg == "--image" && i + 1 < argc) cfg.image_path = next(i);
     else if (arg == "--cache.mem-mb" && i + 1 < argc) cfg.cache_mem_mb = static_cast<unsigned>(std::stoul(next(i)));
+    else if (arg == "--cache.small-mb" && i + 1 < argc) cfg.cache_small_mb = static_cast<unsigned>(std::stoul(next(i)));
+    else if (arg == "--cache.small-max-kb" && i + 1 < argc) cfg.cache_small_max_kb = static_cast<unsigned>(std::stoul(next(i)));
+    else if (arg == "--cache.pin" && i + 1 < argc) {
+      const std::string list = next(i);
+      std::size_t pos = 0;
+      while (pos <= list.size()) {
+        std::size_t end = list.find(',', pos);
+        if (end == std::string::npos) end = list.size();
+        if (end > pos) cfg.cache_pin.push_back(list.substr(pos, end - pos));
+        pos = end + 1;
+      }
+    }
+    else if (arg == "--cache.revalidate-ms" && i + 1 < argc) cfg.cache_revalidate_ms = static_cast<unsigned>(std::stoul(next(i)));
+    else if (arg == "--cache.negative-ms" && i + 1 < argc) cfg.cache_negative_ms = static_cast<unsigned>(std::stoul(next(i)));
+    else if (arg == "--cache.negative-max" && i + 1 < argc) cfg.cache_negative_max = static_cast<unsigned>(std::stoul(next(i)));
+    else if (arg == "--l2.path" && i + 1 < argc) cfg.l2_path = next(i);
+    else if (arg == "--l2.capacity-mb" && i + 1 < argc) cfg.l2_capacity_mb = static_cast<unsigned>(std::stoul(next(i)));
+    else if (arg == "--l2.write-mb-s" && i + 1 < argc) cfg.l2_write_mb_s = static_cast<unsigned>(std::stoul(next(i)));
     else if (arg == "--read-timeout-ms" && i + 1 < argc) cfg.read_timeout_ms = std::stoi(next(i));
     else if (arg == "--write-timeout-ms" && i + 1 < argc) cfg.write_timeout_ms = std::stoi(next(i));
     else if (arg == "--keepalive-timeout-ms" && i + 1 < argc) cfg.keepalive_timeout_ms = std::stoi(next(i));
+    else if (arg == "--timer.tick-ms" && i + 1 < argc) cfg.timer_tick_ms = std::stoi(next(i));
     else if (arg == "--max-request-line" && i + 1 < argc) cfg.max_request_line = static_cast<std::size_t>(std::stoull(next(i)));
     else if (arg == "--max-header-bytes" && i + 1 < argc) cfg.max_header_bytes = static_cast<std::size_t>(std::stoull(next(i)));
+    else if (arg == "--max-connections" && i + 1 < argc) cfg.max_connections = std::stoi(next(i));
+    else if (arg == "--accept-lag-ms" && i + 1 < argc) cfg.accept_lag_ms = std::stoi(next(i));
+    else if (arg == "--shed-latency-ms" && i + 1 < argc) cfg.shed_latency_ms = std::stoi(next(i));
+    else if (arg == "--session-pool" && i + 1 < argc) cfg.session_pool = std::stoi(next(i));
+    else if (arg == "--sched.slice-kb" && i + 1 < argc) cfg.sched_slice_kb = static_cast<unsigned>(std::stoul(next(i)));
+    else if (arg == "--sched.slots" && i + 1 < argc) cfg.sched_slots = static_cast<unsigned>(std::stoul(next(i)));
+    else if (arg == "--sched.class" && i + 1 < argc) {
+      const std::string list = next(i);
+      std::size_t pos = 0;
+      while (pos <= list.size()) {
+        std::size_t end = list.find(',', pos);
+        if (end == std::string::npos) end = list.size();
+        if (end > pos) cfg.sched_classes.push_back(list.substr(pos, end - pos));
+        pos = end + 1;
+      }
+    }
+    else if (arg == "--http2.disable") cfg.http2_enable = false;
+    else if (arg == "--http2.max-streams" && i + 1 < argc) cfg.http2_max_streams = std::stoi(next(i));
+    else if (arg == "--tls.port" && i + 1 < argc) cfg.tls_port = static_cast<unsigned short>(std::stoi(next(i)));
+    else if (arg == "--tls.cert" && i + 1 < argc) cfg.tls_cert = next(i);
+    else if (arg == "--tls.key" && i + 1 < argc) cfg.tls_key = next(i);
+    else if (arg == "--tls.no-ktls") cfg.tls_ktls = false;
+    else if (arg == "--handoff.path" && i + 1 < argc) cfg.handoff_path = next(i);
+    else if (arg == "--handoff.cache-mb" && i + 1 < argc) cfg.handoff_cache_mb = static_cast<unsigned>(std::stoul(next(i)));
+    else if (arg == "--handoff.drain-ms" && i + 1 < argc) cfg.handoff_drain_ms = std::stoi(next(i));
+    else if (arg == "--log.level" && i + 1 < argc) cfg.log_level = next(i);
+    else if (arg == "--log.format" && i + 1 < argc) cfg.log_format = next(i);
+    else if (arg == "--log.accept-every" && i + 1 < argc) cfg.log_accept_every = std::stoi(next(i));
+    else if (arg == "--trace.path" && i + 1 < argc) cfg.trace_path = next(i);
+    else if (arg == "--trace.sample" && i + 1 < argc) cfg.trace_sample = static_cast<unsigned>(std::stoul(next(i)));
+    else if (arg == "--tracing.sample" && i + 1 < argc) cfg.tracing_sample = static_cast<unsigned>(std::stoul(next(i)));
+    else if (arg == "--tracing.slow-us" && i + 1 < argc) cfg.tracing_slow_us = static_cast<unsigned>(std::stoul(next(i)));
+    else if (arg == "--tracing.ring" && i + 1 < argc) cfg.tracing_ring = static_cast<unsigned>(std::stoul(next(i)));
     else if (arg == "--rdma.enable") cfg.rdma_enable = true;
     else if (arg == "--rdma.bind" && i + 1 < argc) cfg.rdma_bind = next(i);
     else if (arg == "--rdma.port" && i + 1 < argc) cfg.rdma_port = static_cast<unsigned short>(std::stoi(next(i)));
     else if (arg == "--rdma.pollers" && i + 1 < argc) cfg.rdma_pollers = std::stoi(next(i));
+    else if (arg == "--rdma.poll-batch" && i + 1 < argc) cfg.rdma_poll_batch = std::stoi(next(i));
+    else if (arg == "--rdma.busy-poll-us" && i + 1 < argc) cfg.rdma_busy_poll_us = std::stoi(next(i));
     else if (arg == "--rdma.recv-bufs" && i + 1 < argc) cfg.rdma_recv_bufs_per_conn = std::stoi(next(i));
     else if (arg == "--rdma.recv-size" && i + 1 < argc) cfg.rdma_recv_buf_size = std::stoi(next(i));
     else if (arg == "--rdma.send-chunk" && i + 1 < argc) cfg.rdma_send_chunk = std::stoi(next(i));
     else if (arg == "--rdma.max-sends" && i + 1 < argc) cfg.rdma_max_outstanding_sends = std::stoi(next(i));
+    else if (arg == "--rdma.max-batch" && i + 1 < argc) cfg.rdma_max_batch = std::stoi(next(i));
+    else if (arg == "--shm.enable") cfg.shm_enable = true;
+    else if (arg == "--shm.path" && i + 1 < argc) cfg.shm_path = next(i);
+    else if (arg == "--shm.ring-kb" && i + 1 < argc) cfg.shm_ring_kb = std::stoi(next(i));
+    else if (arg == "--shm.busy-poll-us" && i + 1 < argc) cfg.shm_busy_poll_us = std::stoi(next(i));
+    else if (arg == "--shm.mode" && i + 1 < argc) cfg.shm_mode = static_cast<unsigned>(std::stoul(next(i), nullptr, 8)) & 0777u;
     else if (arg == "--help" || arg == "-h") {
       print_usage(argv[0]);
       std::exit(0);
@@ -0,0 +1,26 @@
+#include "../../headers/util/head_arena.hpp"
+#include "../../headers/util/read_buffer.hpp"
+
+#include <new>
+
+std::pmr::string& HeadArena::begin(std::size_t reserve) {
+  constexpr std::size_t kAlign = alignof(std::max_align_t);
+  constexpr std::size_t kArenaOffset = (sizeof(Block) + kAlign - 1) / kAlign * kAlign;
+  char* mem;
+  if (block_) {
+    block_->~Block();
+    mem = reinterpret_cast<char*>(block_);
+  } else {
+    mem = take_pool_block();
+  }
+  block_ = new (mem) Block(mem + kArenaOffset, ReadBuffer::kBlockSize - kArenaOffset);
+  block_->head.reserve(reserve);
+  return block_->head;
+}
+
+void HeadArena::reset() {
+  if (!block_) return;
+  block_->~Block();
+  give_pool_block(reinterpret_cast<char*>(block_));
+  block_ = nullptr;
+}
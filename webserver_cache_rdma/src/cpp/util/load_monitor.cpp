@@ -0,0 +1,38 @@
+#include "../../headers/util/load_monitor.hpp"
+#include "../../headers/util/metrics.hpp"
+#include <algorithm>
+
+LoadMonitor::LoadMonitor(boost::asio::io_context& ioc, std::chrono::milliseconds interval)
+  : strand_(boost::asio::make_strand(ioc)),
+    timer_(strand_),
+    interval_(interval) {}
+
+void LoadMonitor::start(std::function<void()> on_tick) {
+  on_tick_ = std::move(on_tick);
+  boost::asio::post(strand_, [this] { arm(); });
+}
+
+void LoadMonitor::stop() {
+  boost::asio::post(strand_, [this] {
+    stopped_ = true;
+    boost::system::error_code ig;
+    timer_.cancel(ig);
+  });
+}
+
+void LoadMonitor::arm() {
+  if (stopped_) return;
+  timer_.expires_after(interval_);
+  timer_.async_wait([this](const boost::system::error_code& ec) {
+    if (ec || stopped_) return;
+    const auto late = std::chrono::steady_clock::now() - timer_.expiry();
+    const int64_t sample = std::max<int64_t>(0,
+      std::chrono::duration_cast<std::chrono::microseconds>(late).count());
+    const int64_t lag = lag_us_.load(std::memory_order_relaxed);
+    const int64_t next = lag + (sample - lag) / 8;
+    lag_us_.store(next, std::memory_order_relaxed);
+    Metrics::instance().event_loop_lag_us.store(static_cast<unsigned long long>(next), std::memory_order_relaxed);
+    if (on_tick_) on_tick_();
+    arm();
+  });
+}
@@ -1 +1,219 @@
-#include "../../headers/util/logging.hpp"
\ No newline at end of file
+#include "../../headers/util/logging.hpp"
+#include "../../headers/util/metrics.hpp"
+#include "../../headers/util/per_thread_ring.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <ctime>
+#include <mutex>
+#include <thread>
+
+namespace logging_detail {
+std::atomic<uint8_t> g_min_level{static_cast<uint8_t>(LogLevel::Info)};
+}
+
+namespace {
+
+using logging_detail::Record;
+
+class Logger {
+public:
+  static Logger& instance() {
+    static Logger l;
+    return l;
+  }
+
+  ~Logger() { shutdown(); }
+
+  void init(const LogOptions& opt) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    opt_ = opt;
+    rings_.set_capacity(std::max<std::size_t>(16, opt.ring_records));
+    logging_detail::g_min_level.store(static_cast<uint8_t>(opt.level), std::memory_order_relaxed);
+  }
+
+  Record* reserve() {
+    if (!started_.load(std::memory_order_acquire)) start();
+    return rings_.reserve();
+  }
+
+  void commit(Record* rec, LogLevel level) {
+    rec->ts_ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count());
+    rec->level = level;
+    rec->thread = rings_.thread_id();
+    rings_.commit();
+  }
+
+  void shutdown() {
+    {
+      std::lock_guard<std::mutex> lk(mtx_);
+      if (stopped_.exchange(true)) return;
+    }
+    cv_.notify_one();
+    if (flusher_.joinable()) flusher_.join();
+    drain(); // whatever raced in after the flusher's last pass
+  }
+
+  bool stopped() const { return stopped_.load(std::memory_order_relaxed); }
+
+  void drop() {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    Metrics::instance().log_dropped.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+  // The flusher starts with the first record
+  void start() {
+    std::lock_guard<std::mutex> lk(mtx_);
+    if (!flusher_.joinable() && !stopped_.load(std::memory_order_relaxed)) {
+      flusher_ = std::thread([this] { run(); });
+    }
+    started_.store(true, std::memory_order_release);
+  }
+
+  void run() {
+    std::unique_lock<std::mutex> lk(mtx_);
+    while (!stopped_.load(std::memory_order_relaxed)) {
+      cv_.wait_for(lk, std::chrono::milliseconds(std::max(1, opt_.flush_interval_ms)));
+      lk.unlock();
+      drain();
+      lk.lock();
+    }
+  }
+
+  void drain() {
+    LogFormat format;
+    {
+      std::lock_guard<std::mutex> lk(mtx_);
+      format = opt_.format;
+    }
+
+    out_.clear();
+    err_.clear();
+    // Each ring is in time order; merging them keeps lines from different threads
+    // in the order they were logged
+    rings_.drain_merged([](const Record& rec) { return rec.ts_ns; }, [&](const Record& rec) {
+      std::string& dst = (format == LogFormat::Text && rec.level >= LogLevel::Warn) ? err_ : out_;
+      if (format == LogFormat::Json) append_json(dst, rec);
+      else append_text(dst, rec);
+    });
+
+    if (!out_.empty()) {
+      std::fwrite(out_.data(), 1, out_.size(), stdout);
+      std::fflush(stdout);
+    }
+    if (!err_.empty()) {
+      std::fwrite(err_.data(), 1, err_.size(), stderr);
+      std::fflush(stderr);
+    }
+  }
+
+  static const char* level_name(LogLevel l) {
+    switch (l) {
+      case LogLevel::Debug: return "debug";
+      case LogLevel::Info: return "info";
+      case LogLevel::Warn: return "warn";
+      default: return "error";
+    }
+  }
+
+  static void append_text(std::string& dst, const Record& rec) {
+    dst += '[';
+    dst += level_name(rec.level);
+    dst += "] ";
+    dst.append(rec.text, rec.len);
+    dst += '\n';
+  }
+
+  static void append_json(std::string& dst, const Record& rec) {
+    const std::time_t secs = static_cast<std::time_t>(rec.ts_ns / 1000000000ull);
+    std::tm tm{};
+    gmtime_r(&secs, &tm);
+    char ts[64];
+    std::snprintf(ts, sizeof(ts), "%04d-%02d-%02dT%02d:%02d:%02d.%06uZ",
+                  tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec,
+                  static_cast<unsigned>(rec.ts_ns % 1000000000ull / 1000));
+    dst += "{\"ts\":\"";
+    dst += ts;
+    dst += "\",\"level\":\"";
+    dst += level_name(rec.level);
+    dst += "\",\"thread\":";
+    dst += std::to_string(rec.thread);
+    dst += ",\"msg\":\"";
+    for (uint16_t i = 0; i < rec.len; ++i) {
+      const char c = rec.text[i];
+      switch (c) {
+        case '"': dst += "\\\""; break;
+        case '\\': dst += "\\\\"; break;
+        case '\n': dst += "\\n"; break;
+        case '\r': dst += "\\r"; break;
+        case '\t': dst += "\\t"; break;
+        default:
+          if (static_cast<unsigned char>(c) < 0x20) {
+            char esc[8];
+            std::snprintf(esc, sizeof(esc), "\\u%04x", static_cast<unsigned>(c));
+            dst += esc;
+          } else {
+            dst += c;
+          }
+      }
+    }
+    dst += "\"}\n";
+  }
+
+  std::mutex mtx_;
+  std::condition_variable cv_;
+  LogOptions opt_;
+  PerThreadRing<Record> rings_{LogOptions{}.ring_records};
+  std::thread flusher_;
+  std::atomic<bool> started_{false};
+  std::atomic<bool> stopped_{false};
+  std::atomic<uint64_t> dropped_{0};
+  std::string out_, err_;        // flusher-only scratch
+};
+
+} // namespace
+
+namespace logging_detail {
+
+Record* reserve() {
+  Logger& log = Logger::instance();
+  if (log.stopped()) {
+    log.drop();
+    return nullptr;
+  }
+  Record* rec = log.reserve();
+  if (!rec) log.drop();
+  return rec;
+}
+
+void commit(Record* rec, LogLevel level) {
+  Logger::instance().commit(rec, level);
+}
+
+} // namespace logging_detail
+
+void log_init(const LogOptions& opt) {
+  Logger::instance().init(opt);
+}
+
+void log_shutdown() {
+  Logger::instance().shutdown();
+}
+
+uint64_t log_dropped() {
+  return Logger::instance().dropped();
+}
+
+bool parse_log_level(const std::string& s, LogLevel& out) {
+  if (s == "debug") out = LogLevel::Debug;
+  else if (s == "info") out = LogLevel::Info;
+  else if (s == "warn") out = LogLevel::Warn;
+  else if (s == "error") out = LogLevel::Error;
+  else return false;
+  return true;
+}
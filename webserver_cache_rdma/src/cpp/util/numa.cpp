@@ -0,0 +1,151 @@
+#include "../../headers/util/numa.hpp"
+#include "../../headers/util/metrics.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include <linux/filter.h>
+#include <sched.h>
+#include <sys/socket.h>
+
+namespace numa {
+namespace detail {
+std::atomic<bool> g_multi{false};
+thread_local int t_node = -1;
+} // namespace detail
+
+namespace {
+
+Topology g_topo;
+
+// "0-3,8,10-11" -> {0,1,2,3,8,10,11}
+std::vector<int> parse_list(const std::string& s) {
+  std::vector<int> out;
+  std::stringstream ss(s);
+  std::string part;
+  while (std::getline(ss, part, ',')) {
+    if (part.empty() || part == "\n") continue;
+    try {
+      const auto dash = part.find('-');
+      const int lo = std::stoi(part.substr(0, dash));
+      const int hi = dash == std::string::npos ? lo : std::stoi(part.substr(dash + 1));
+      for (int c = lo; c <= hi; ++c) out.push_back(c);
+    } catch (const std::exception&) {
+      return {};
+    }
+  }
+  return out;
+}
+
+std::string read_line(const std::string& path) {
+  std::ifstream in(path);
+  std::string line;
+  std::getline(in, line);
+  return line;
+}
+
+} // namespace
+
+Topology Topology::detect() {
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  const bool have_mask = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+  const auto usable = [&](int cpu) { return cpu >= 0 && cpu < CPU_SETSIZE && (!have_mask || CPU_ISSET(cpu, &allowed)); };
+
+  Topology t;
+  for (int id : parse_list(read_line("/sys/devices/system/node/online"))) {
+    Node n;
+    n.id = id;
+    for (int cpu : parse_list(read_line("/sys/devices/system/node/node" + std::to_string(id) + "/cpulist"))) {
+      if (usable(cpu)) n.cpus.push_back(cpu);
+    }
+    if (!n.cpus.empty()) t.nodes.push_back(std::move(n));
+  }
+  if (t.nodes.empty()) {
+    Node n;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (have_mask ? CPU_ISSET(cpu, &allowed) : cpu < static_cast<int>(std::thread::hardware_concurrency()))
+        n.cpus.push_back(cpu);
+    }
+    t.nodes.push_back(std::move(n));
+  }
+
+  int max_cpu = 0;
+  for (const auto& n : t.nodes) max_cpu = std::max(max_cpu, n.cpus.back());
+  t.cpu_node.assign(static_cast<std::size_t>(max_cpu) + 1, -1);
+  for (std::size_t i = 0; i < t.nodes.size(); ++i) {
+    for (int cpu : t.nodes[i].cpus) t.cpu_node[static_cast<std::size_t>(cpu)] = static_cast<int>(i);
+  }
+  return t;
+}
+
+std::size_t Topology::cpus() const {
+  std::size_t n = 0;
+  for (const auto& node : nodes) n += node.cpus.size();
+  return n;
+}
+
+void init(const Topology& topo) {
+  g_topo = topo;
+  Metrics::instance().numa_nodes.store(topo.nodes.size(), std::memory_order_relaxed);
+  detail::g_multi.store(topo.nodes.size() > 1, std::memory_order_relaxed);
+}
+
+bool bind_thread(std::size_t index) {
+  if (index >= g_topo.nodes.size()) return false;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu : g_topo.nodes[index].cpus) CPU_SET(cpu, &set);
+  if (sched_setaffinity(0, sizeof(set), &set) != 0) return false;
+  detail::t_node = static_cast<int>(index);
+  return true;
+}
+
+int detail::node_of_current_cpu() {
+  const int cpu = sched_getcpu();
+  return cpu >= 0 && static_cast<std::size_t>(cpu) < g_topo.cpu_node.size()
+    ? g_topo.cpu_node[static_cast<std::size_t>(cpu)] : -1;
+}
+
+void detail::count_hit(int home) {
+  const int here = current_node();
+  if (here < 0) return;
+  auto& m = Metrics::instance();
+  (here == home ? m.numa_hits_local : m.numa_hits_remote).fetch_add(1, std::memory_order_relaxed);
+}
+
+bool steer_listeners(const Topology& topo, const std::vector<int>& fds, std::string& error) {
+  if (fds.size() < 2) return true;
+
+  // A = CPU that received the packet; one compare per run of consecutive CPUs on
+  // the same node, returning that node's socket index. An index past the group (a
+  // CPU we do not know) makes the kernel fall back to its hash.
+  std::vector<sock_filter> prog;
+  prog.push_back(BPF_STMT(BPF_LD | BPF_W | BPF_ABS, static_cast<uint32_t>(SKF_AD_OFF + SKF_AD_CPU)));
+  for (std::size_t cpu = 0; cpu < topo.cpu_node.size();) {
+    const int node = topo.cpu_node[cpu];
+    std::size_t end = cpu + 1;
+    while (end < topo.cpu_node.size() && topo.cpu_node[end] == node) ++end;
+    const bool known = node >= 0 && static_cast<std::size_t>(node) < fds.size();
+    // if (A >= end) skip the return; CPUs below this run returned already
+    prog.push_back(BPF_JUMP(BPF_JMP | BPF_JGE | BPF_K, static_cast<uint32_t>(end), 1, 0));
+    prog.push_back(BPF_STMT(BPF_RET | BPF_K, known ? static_cast<uint32_t>(node) : 0xffffffffu));
+    cpu = end;
+  }
+  prog.push_back(BPF_STMT(BPF_RET | BPF_K, 0xffffffffu));
+
+  sock_fprog fprog{};
+  fprog.len = static_cast<unsigned short>(prog.size());
+  fprog.filter = prog.data();
+  if (setsockopt(fds.front(), SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &fprog, sizeof(fprog)) != 0) {
+    error = std::strerror(errno);
+    return false;
+  }
+  return true;
+}
+
+} // namespace numa
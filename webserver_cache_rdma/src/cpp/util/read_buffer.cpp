@@ -0,0 +1,102 @@
+#include "../../headers/util/read_buffer.hpp"
+#include "../../headers/util/metrics.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace {
+
+constexpr std::size_t kBatch = 32;            // blocks moved to or from the shared list at once
+constexpr std::size_t kLocalMax = 2 * kBatch;
+constexpr std::size_t kSharedMax = 4096;      // 32 MiB of idle blocks; past that they are freed
+
+struct Shared {
+  std::mutex mtx;
+  std::vector<char*> blocks;
+};
+
+Shared& shared() {
+  static Shared* s = new Shared;   // outlives every thread's cache
+  return *s;
+}
+
+struct Local {
+  std::vector<char*> blocks;
+
+  ~Local() {
+    auto& s = shared();
+    std::lock_guard<std::mutex> lk(s.mtx);
+    for (char* b : blocks) {
+      if (s.blocks.size() < kSharedMax) s.blocks.push_back(b);
+      else ::operator delete(b);
+    }
+  }
+};
+
+thread_local Local t_local;
+
+} // namespace
+
+char* take_pool_block() {
+  auto& local = t_local.blocks;
+  if (local.empty()) {
+    auto& s = shared();
+    std::lock_guard<std::mutex> lk(s.mtx);
+    const std::size_t n = std::min(kBatch, s.blocks.size());
+    local.insert(local.end(), s.blocks.end() - static_cast<std::ptrdiff_t>(n), s.blocks.end());
+    s.blocks.resize(s.blocks.size() - n);
+  }
+  if (local.empty()) return static_cast<char*>(::operator new(ReadBuffer::kBlockSize));
+  char* b = local.back();
+  local.pop_back();
+  return b;
+}
+
+void give_pool_block(char* b) {
+  auto& local = t_local.blocks;
+  if (local.capacity() < kLocalMax + 1) local.reserve(kLocalMax + 1);
+  local.push_back(b);
+  if (local.size() <= kLocalMax) return;
+
+  auto& s = shared();
+  std::lock_guard<std::mutex> lk(s.mtx);
+  for (std::size_t i = 0; i < kBatch; ++i) {
+    char* spare = local.back();
+    local.pop_back();
+    if (s.blocks.size() < kSharedMax) s.blocks.push_back(spare);
+    else ::operator delete(spare);
+  }
+}
+
+void ReadBuffer::acquire() {
+  if (data_) return;
+  data_ = take_pool_block();
+  capacity_ = kBlockSize;
+  Metrics::instance().read_buffers_in_use.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ReadBuffer::grow(std::size_t keep, std::size_t capacity) {
+  char* bigger = static_cast<char*>(::operator new(capacity));
+  if (keep > 0) std::memcpy(bigger, data_, keep);
+  if (data_) {
+    if (capacity_ == kBlockSize) give_pool_block(data_);
+    else ::operator delete(data_);
+  } else {
+    Metrics::instance().read_buffers_in_use.fetch_add(1, std::memory_order_relaxed);
+  }
+  data_ = bigger;
+  capacity_ = capacity;
+  Metrics::instance().read_buffers_grown.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ReadBuffer::reset() {
+  if (!data_) return;
+  if (capacity_ == kBlockSize) give_pool_block(data_);
+  else ::operator delete(data_);
+  data_ = nullptr;
+  capacity_ = 0;
+  Metrics::instance().read_buffers_in_use.fetch_sub(1, std::memory_order_relaxed);
+}
@@ -0,0 +1,106 @@
+#include "../../headers/util/send_scheduler.hpp"
+#include "../../headers/util/metrics.hpp"
+
+#include <algorithm>
+
+SendScheduler::SendScheduler(const Options& opt)
+  : slice_(opt.slice_bytes),
+    slots_(std::max<std::size_t>(1, opt.slots)) {
+  for (const auto& c : opt.classes) {
+    ClassQueue q;
+    q.prefix = c.prefix;
+    q.weight = std::max<uint32_t>(1, c.weight);
+    classes_.push_back(std::move(q));
+  }
+  classes_.emplace_back();   // default class: no prefix, weight 1
+}
+
+std::size_t SendScheduler::classify(std::string_view target) const {
+  std::size_t best = classes_.size() - 1;
+  std::size_t best_len = 0;
+  for (std::size_t i = 0; i + 1 < classes_.size(); ++i) {
+    const auto& p = classes_[i].prefix;
+    if (p.size() >= best_len && target.substr(0, p.size()) == p) {
+      best = i;
+      best_len = p.size();
+    }
+  }
+  return best;
+}
+
+void SendScheduler::wait(Node& n) {
+  Node* next;
+  std::shared_ptr<void> owner;
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    ClassQueue& q = classes_[std::min(n.cls, classes_.size() - 1)];
+    n.next = nullptr;
+    n.queued = true;
+    if (q.tail) q.tail->next = &n;
+    else q.head = &n;
+    q.tail = &n;
+    ++waiting_;
+    next = next_locked(owner);
+  }
+  if (next != &n) Metrics::instance().sched_turns_queued.fetch_add(1, std::memory_order_relaxed);
+  if (next) grant(next, owner);
+}
+
+void SendScheduler::done() {
+  Node* next;
+  std::shared_ptr<void> owner;
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    --running_;
+    next = next_locked(owner);
+  }
+  if (next) grant(next, owner);
+}
+
+void SendScheduler::cancel(Node& n) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  if (!n.queued) return;
+  ClassQueue& q = classes_[std::min(n.cls, classes_.size() - 1)];
+  Node* prev = nullptr;
+  for (Node* it = q.head; it; prev = it, it = it->next) {
+    if (it != &n) continue;
+    (prev ? prev->next : q.head) = n.next;
+    if (q.tail == &n) q.tail = prev;
+    break;
+  }
+  n.next = nullptr;
+  n.queued = false;
+  --waiting_;
+}
+
+// Deficit round robin with one turn as the unit: the class under the cursor serves
+// its queue head until it has used its weight for the round or has nobody waiting.
+// The owner is locked here, under the mutex a recycled session cancels through, so a
+// node is never touched once its session has moved on.
+SendScheduler::Node* SendScheduler::next_locked(std::shared_ptr<void>& owner) {
+  while (running_ < slots_ && waiting_ > 0) {
+    ClassQueue& q = classes_[cursor_];
+    if (q.head && q.deficit > 0) {
+      Node* n = q.head;
+      q.head = n->next;
+      if (!q.head) q.tail = nullptr;
+      n->next = nullptr;
+      n->queued = false;
+      --q.deficit;
+      --waiting_;
+      owner = n->owner.lock();
+      if (!owner) continue;   // its session is gone
+      ++running_;
+      return n;
+    }
+    q.deficit = 0;   // an idle class does not save up turns
+    cursor_ = (cursor_ + 1) % classes_.size();
+    classes_[cursor_].deficit = classes_[cursor_].weight;
+  }
+  return nullptr;
+}
+
+void SendScheduler::grant(Node* n, const std::shared_ptr<void>& owner) {
+  Metrics::instance().sched_turns.fetch_add(1, std::memory_order_relaxed);
+  n->on_turn(owner, slice_);
+}
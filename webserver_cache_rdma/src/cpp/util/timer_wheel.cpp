@@ -0,0 +1,133 @@
+#include "../../headers/util/timer_wheel.hpp"
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+TimerWheel::TimerWheel(boost::asio::io_context& ioc, std::chrono::milliseconds tick)
+  : strand_(boost::asio::make_strand(ioc)),
+    timer_(strand_),
+    tick_(tick.count() > 0 ? tick : std::chrono::milliseconds(1)),
+    epoch_(std::chrono::steady_clock::now()) {
+  for (auto& level : wheel_) {
+    for (auto& s : level) s.prev = s.next = &s;
+  }
+}
+
+void TimerWheel::start() {
+  auto self = shared_from_this();
+  boost::asio::post(strand_, [self] { self->arm(); });
+}
+
+void TimerWheel::stop() {
+  auto self = shared_from_this();
+  boost::asio::post(strand_, [self] {
+    self->stopped_ = true;
+    boost::system::error_code ig;
+    self->timer_.cancel(ig);
+  });
+}
+
+void TimerWheel::unlink(Node& n) {
+  if (!n.next) return;
+  n.prev->next = n.next;
+  n.next->prev = n.prev;
+  n.prev = n.next = nullptr;
+}
+
+// Picks the level whose slot width covers the remaining time and appends there
+void TimerWheel::link_locked(Node& n) {
+  const uint64_t delta = n.expiry > now_ ? n.expiry - now_ : 0;
+  unsigned level = 0;
+  while (level + 1 < kLevels && delta >= (uint64_t{1} << (kLevelBits * (level + 1)))) ++level;
+  // A cascaded node can be due this very tick; level 0's current slot is processed
+  // right after cascading, so it still fires on time.
+  uint64_t at = std::max(n.expiry, now_);
+  if (level == kLevels - 1) {
+    const uint64_t horizon = now_ + (uint64_t{1} << (kLevelBits * kLevels)) - 1;
+    at = std::min(at, horizon); // beyond the wheel: park at the far edge, re-cascaded later
+  }
+  Slot& s = wheel_[level][(at >> (kLevelBits * level)) & (kSlots - 1)];
+  n.prev = s.prev;
+  n.next = &s;
+  s.prev->next = &n;
+  s.prev = &n;
+}
+
+void TimerWheel::schedule(Node& n, std::chrono::milliseconds after) {
+  const auto ticks = static_cast<uint64_t>((after.count() + tick_.count() - 1) / tick_.count());
+  std::lock_guard<std::mutex> lk(mtx_);
+  unlink(n);
+  ++n.generation;
+  n.expiry = now_ + std::max<uint64_t>(1, ticks);
+  link_locked(n);
+}
+
+void TimerWheel::cancel(Node& n) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  unlink(n);
+  ++n.generation;
+}
+
+uint64_t TimerWheel::generation_of(const Node& n) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  return n.generation;
+}
+
+void TimerWheel::arm() {
+  if (stopped_) return;
+  timer_.expires_at(epoch_ + tick_ * static_cast<int64_t>(now_ + 1));
+  auto self = shared_from_this();
+  timer_.async_wait([self](const boost::system::error_code& ec) {
+    if (ec || self->stopped_) return;
+    self->advance();
+    self->arm();
+  });
+}
+
+// Catches up with the clock one tick at a time, collecting due nodes under the lock
+// and running their callbacks after releasing it.
+void TimerWheel::advance() {
+  struct Due {
+    std::weak_ptr<void> owner;
+    uint64_t generation;
+    void (*fn)(const std::shared_ptr<void>&, uint64_t);
+  };
+  std::vector<Due> due;
+
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    const auto elapsed = std::chrono::steady_clock::now() - epoch_;
+    const auto target = static_cast<uint64_t>(elapsed / tick_);
+    while (now_ < target) {
+      ++now_;
+      // Cascade: each time a level wraps, spread the next slot of the level above
+      for (unsigned level = 1; level < kLevels; ++level) {
+        if ((now_ & ((uint64_t{1} << (kLevelBits * level)) - 1)) != 0) break;
+        Slot& s = wheel_[level][(now_ >> (kLevelBits * level)) & (kSlots - 1)];
+        Node* n = s.next;
+        s.prev = s.next = &s;
+        while (n != &s) {
+          Node* next = n->next;
+          n->prev = n->next = nullptr;
+          link_locked(*n);
+          n = next;
+        }
+      }
+
+      Slot& s = wheel_[0][now_ & (kSlots - 1)];
+      Node* n = s.next;
+      while (n != &s) {
+        Node* next = n->next;
+        if (n->expiry <= now_) {
+          unlink(*n);
+          due.push_back({n->owner, n->generation, n->on_expire});
+        }
+        n = next;
+      }
+    }
+  }
+
+  for (auto& d : due) {
+    if (auto owner = d.owner.lock()) d.fn(owner, d.generation);
+  }
+}
@@ -0,0 +1,170 @@
+#include "../../headers/util/tracing.hpp"
+#include "../../headers/util/metrics.hpp"
+#include "../../headers/util/per_thread_ring.hpp"
+
+#include <fmt/format.h>
+#include <algorithm>
+#include <cstdio>
+#include <chrono>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace tracing {
+namespace detail {
+std::atomic<uint32_t> g_sample{0};
+thread_local uint32_t t_reads = 0;
+} // namespace detail
+
+namespace {
+
+// The last opt.ring slow spans of one I/O thread; once full, `next` is the oldest
+struct History {
+  std::vector<Record> records;
+  std::size_t next = 0;
+};
+
+// Slow spans go into their thread's ring without a lock. They are moved into the
+// histories under mtx by the reader (/debug/traces), or by a thread that finds its
+// ring full, so the newest spans are the ones kept.
+struct Registry {
+  std::mutex mtx;
+  Options opt;
+  double ticks_per_ns = 1.0;
+  uint64_t slow_ticks = 0;
+  PerThreadRing<Record> spans{Options{}.ring};
+  std::vector<History> history;   // by thread number
+};
+
+Registry& registry() {
+  static Registry r;
+  return r;
+}
+
+void collect_locked(Registry& reg) {
+  reg.spans.drain([&reg](uint32_t id, const Record* first, std::size_t n) {
+    if (reg.history.size() <= id) reg.history.resize(id + 1);
+    History& h = reg.history[id];
+    const std::size_t cap = std::max<std::size_t>(1, reg.opt.ring);
+    for (std::size_t i = 0; i < n; ++i) {
+      if (h.records.size() < cap) {
+        h.records.push_back(first[i]);
+      } else {
+        h.records[h.next] = first[i];
+        h.next = (h.next + 1) % cap;
+      }
+    }
+  });
+}
+
+void append_escaped(std::string& dst, const char* s, std::size_t n) {
+  for (std::size_t i = 0; i < n; ++i) {
+    const char c = s[i];
+    if (c == '"' || c == '\\') {
+      dst += '\\';
+      dst += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char esc[8];
+      std::snprintf(esc, sizeof(esc), "\\u%04x", static_cast<unsigned>(c));
+      dst += esc;
+    } else {
+      dst += c;
+    }
+  }
+}
+
+// Tick rate against steady_clock over a short sleep; done once per process
+double calibrate() {
+#if defined(__x86_64__) || defined(__i386__)
+  const auto c0 = std::chrono::steady_clock::now();
+  const uint64_t t0 = now();
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  const uint64_t t1 = now();
+  const auto ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - c0).count();
+  return ns > 0 && t1 > t0 ? static_cast<double>(t1 - t0) / ns : 1.0;
+#else
+  return 1.0;
+#endif
+}
+
+} // namespace
+
+const char* stage_name(Stage s) {
+  static const char* const kNames[kStages] = {"parse", "map", "lookup", "read", "headers", "write"};
+  return kNames[static_cast<std::size_t>(s)];
+}
+
+void configure(const Options& opt) {
+  auto& reg = registry();
+  static double rate = 0;
+  if (opt.sample && rate == 0) rate = calibrate();
+  {
+    std::lock_guard<std::mutex> lk(reg.mtx);
+    reg.opt = opt;
+    reg.spans.set_capacity(std::max<std::size_t>(1, opt.ring));
+    reg.ticks_per_ns = rate ? rate : 1.0;
+    reg.slow_ticks = static_cast<uint64_t>(static_cast<double>(opt.slow_us) * 1000.0 * reg.ticks_per_ns);
+  }
+  detail::g_sample.store(opt.sample, std::memory_order_relaxed);
+}
+
+void Span::mark_final() {
+  const uint64_t t = now();
+  rec_.stage[static_cast<std::size_t>(Stage::Write)] += t - last_;
+  rec_.total = t - rec_.start;
+
+  auto& m = Metrics::instance();
+  m.traces_sampled.fetch_add(1, std::memory_order_relaxed);
+  if (rec_.total < registry().slow_ticks) return;
+  m.traces_slow.fetch_add(1, std::memory_order_relaxed);
+
+  auto& reg = registry();
+  Record* slot = reg.spans.reserve();
+  if (!slot) {
+    std::lock_guard<std::mutex> lk(reg.mtx);
+    collect_locked(reg);
+    slot = reg.spans.reserve();
+  }
+  *slot = rec_;
+  reg.spans.commit();
+}
+
+std::string render_json(std::size_t limit) {
+  auto& reg = registry();
+  Options opt;
+  double rate;
+  std::vector<Record> all;
+  {
+    std::lock_guard<std::mutex> lk(reg.mtx);
+    collect_locked(reg);
+    opt = reg.opt;
+    rate = reg.ticks_per_ns;
+    for (const auto& h : reg.history) all.insert(all.end(), h.records.begin(), h.records.end());
+  }
+  const auto end_of = [](const Record& rec) { return rec.start + rec.total; };
+  std::sort(all.begin(), all.end(), [&](const Record& a, const Record& b) { return end_of(a) > end_of(b); });
+  if (all.size() > limit) all.resize(limit);
+
+  const uint64_t t = now();
+  const auto us = [rate](uint64_t ticks) { return static_cast<double>(ticks) / rate / 1000.0; };
+  std::string out;
+  auto it = std::back_inserter(out);
+  fmt::format_to(it, "{{\"sample\":{},\"slow_us\":{},\"traces\":[", opt.sample, opt.slow_us);
+  for (std::size_t i = 0; i < all.size(); ++i) {
+    const Record& rec = all[i];
+    out += i ? ",\n{\"target\":\"" : "\n{\"target\":\"";
+    append_escaped(out, rec.target, rec.target_len);
+    fmt::format_to(it, "\",\"status\":{},\"bytes\":{},\"age_ms\":{},\"total_us\":{:.1f},\"stages_us\":{{",
+                   rec.status, rec.bytes, static_cast<uint64_t>(us(t - std::min(t, end_of(rec))) / 1000),
+                   us(rec.total));
+    for (std::size_t s = 0; s < kStages; ++s) {
+      fmt::format_to(it, "{}\"{}\":{:.1f}", s ? "," : "", stage_name(static_cast<Stage>(s)), us(rec.stage[s]));
+    }
+    out += "}}";
+  }
+  out += "]}\n";
+  return out;
+}
+
+} // namespace tracing
@@ -0,0 +1,25 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Client end of the fast-path protocol, independent of the transport underneath.
+class FastPathClient {
+public:
+  virtual ~FastPathClient() = default;
+
+  // One request message
+  virtual bool send(const void* data, std::size_t n) = 0;
+  // Next response message; false on timeout or failure
+  virtual bool recv(std::vector<uint8_t>& out, int timeout_ms) = 0;
+};
+
+std::unique_ptr<FastPathClient> connect_shm_client(const std::string& socket_path);
+
+#ifdef ENABLE_RDMA
+// recv_size must be at least the server's --rdma.send-chunk
+std::unique_ptr<FastPathClient> connect_rdma_client(const std::string& host, uint16_t port,
+                                                    std::size_t recv_size = 64 * 1024,
+                                                    int recv_bufs = 128);
+#endif
@@ -0,0 +1,69 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+// Log-linear latency histogram in the style of HdrHistogram: values below 128 are
+// exact, larger values keep 6 significant bits (< 1.6% relative error). Fixed size,
+// no allocation on record(), mergeable across threads.
+class LatencyHistogram {
+public:
+  static constexpr unsigned kSubBits = 7;
+  static constexpr std::size_t kBuckets = (64 - kSubBits + 2) << (kSubBits - 1);
+
+  void record(uint64_t v) {
+    ++counts_[index_of(v)];
+    ++total_;
+    sum_ += v;
+    max_ = std::max(max_, v);
+    min_ = std::min(min_, v);
+  }
+
+  void merge(const LatencyHistogram& o) {
+    for (std::size_t i = 0; i < kBuckets; ++i) counts_[i] += o.counts_[i];
+    total_ += o.total_;
+    sum_ += o.sum_;
+    max_ = std::max(max_, o.max_);
+    min_ = std::min(min_, o.min_);
+  }
+
+  void reset() { *this = LatencyHistogram{}; }
+
+  uint64_t count() const { return total_; }
+  uint64_t max() const { return total_ ? max_ : 0; }
+  uint64_t min() const { return total_ ? min_ : 0; }
+  double mean() const { return total_ ? static_cast<double>(sum_) / static_cast<double>(total_) : 0.0; }
+
+  // Upper edge of the bucket holding the q-quantile (q in [0, 1])
+  uint64_t percentile(double q) const {
+    if (total_ == 0) return 0;
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(q * static_cast<double>(total_) + 0.5));
+    uint64_t seen = 0;
+    for (std::size_t i = 0; i < kBuckets; ++i) {
+      seen += counts_[i];
+      if (seen >= rank) return std::min(max_, upper_of(i));
+    }
+    return max_;
+  }
+
+private:
+  static std::size_t index_of(uint64_t v) {
+    if (v < (1ull << kSubBits)) return static_cast<std::size_t>(v);
+    const unsigned msb = 63u - static_cast<unsigned>(__builtin_clzll(v));
+    const unsigned shift = msb - kSubBits + 1;
+    return (static_cast<std::size_t>(shift) << (kSubBits - 1)) + static_cast<std::size_t>(v >> shift);
+  }
+
+  static uint64_t upper_of(std::size_t idx) {
+    if (idx < (1u << kSubBits)) return idx;
+    const unsigned shift = static_cast<unsigned>(idx >> (kSubBits - 1)) - 1;
+    const uint64_t q = (idx & ((1u << (kSubBits - 1)) - 1)) + (1u << (kSubBits - 1));
+    return ((q + 1) << shift) - 1;
+  }
+
+  std::array<uint64_t, kBuckets> counts_{};
+  uint64_t total_ = 0;
+  uint64_t sum_ = 0;
+  uint64_t max_ = 0;
+  uint64_t min_ = UINT64_MAX;
+};
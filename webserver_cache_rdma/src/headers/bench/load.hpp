@@ -0,0 +1,74 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "histogram.hpp"
+
+struct LoadOptions {
+  // Target
+  std::string host = "127.0.0.1";
+  unsigned short port = 8080;
+  std::string shm_path = "/tmp/webserver-shm.sock";
+  std::string rdma_host = "127.0.0.1";
+  unsigned short rdma_port = 7471;
+
+  // Workload
+  std::size_t files = 10000;      // keys from bench_key_path(0 .. files-1)
+  double zipf = 0.99;             // 0 = uniform popularity
+  uint64_t seed = 1;
+
+  // Shape
+  unsigned threads = 1;
+  unsigned connections = 16;      // HTTP: spread over threads; fast path: one client per thread
+  unsigned pipeline = 1;          // requests in flight per connection
+  bool keepalive = true;          // HTTP only
+  unsigned batch = 1;             // fast path: paths per MGET (1 = plain GET)
+  double duration_s = 10;
+  double warmup_s = 1;
+
+  // Open loop: total requests per second spread evenly over connections (HTTP) or
+  // threads (fast path). 0 = closed loop.
+  double rate = 0;
+};
+
+struct LoadResult {
+  uint64_t requests = 0;          // completed requests (an MGET counts once)
+  uint64_t ops = 0;               // objects fetched (MGET items counted separately)
+  uint64_t errors = 0;            // transport failures and non-2xx statuses
+  uint64_t bytes = 0;             // body bytes received
+  double elapsed_s = 0;
+  double offered_rate = 0;        // opt.rate of the run, 0 for closed loop
+  LatencyHistogram latency_ns;    // per request, from intended start to last byte
+  LatencyHistogram service_ns;    // per request, from actual send to last byte
+
+  void merge(const LoadResult& o) {
+    requests += o.requests;
+    ops += o.ops;
+    errors += o.errors;
+    bytes += o.bytes;
+    latency_ns.merge(o.latency_ns);
+    service_ns.merge(o.service_ns);
+  }
+
+  // Records one completed request. In closed loop intended == actual; in open loop a
+  // request that had to wait for a free slot keeps its scheduled start, so queueing
+  // behind a slow response is charged to latency instead of silently lowering the
+  // offered load (coordinated omission).
+  template <typename TimePoint>
+  void record(TimePoint intended, TimePoint actual, TimePoint done) {
+    using std::chrono::duration_cast;
+    using std::chrono::nanoseconds;
+    latency_ns.record(static_cast<uint64_t>(duration_cast<nanoseconds>(done - intended).count()));
+    service_ns.record(static_cast<uint64_t>(duration_cast<nanoseconds>(done - actual).count()));
+  }
+};
+
+// Closed loop (rate == 0): every connection keeps `pipeline` requests outstanding and
+// issues the next one as soon as a response completes. Open loop (rate > 0): requests
+// are scheduled at fixed intervals and sent when due, `pipeline` bounding how many may
+// be outstanding per connection; late ones keep their scheduled start time.
+LoadResult run_http_load(const LoadOptions& opt);
+
+enum class FastPathKind { Shm, Rdma };
+LoadResult run_fastpath_load(const LoadOptions& opt, FastPathKind kind);
@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+// Key population shared by the doc_root generator and the load drivers: file i lives
+// at /bench/d<i/1000>/f<i>.bin, so drivers only need the file count to address it.
+std::string bench_key_path(std::size_t i);
+
+struct DocRootSpec {
+  std::string dir;
+  std::size_t files = 10000;
+  std::size_t size_min = 256;
+  std::size_t size_max = 64 * 1024;   // sizes are log-uniform in [min, max]
+  uint64_t seed = 42;
+};
+
+// Writes the files; returns total bytes written. Throws on I/O failure.
+uint64_t generate_doc_root(const DocRootSpec& spec);
+
+// Zipfian rank sampler over [0, n); s = 0 is uniform. Ranks are scattered over the key
+// space with a fixed permutation so popularity is not correlated with file index.
+class ZipfKeys {
+public:
+  ZipfKeys(std::size_t n, double s, uint64_t seed = 7);
+
+  template <typename Rng>
+  std::size_t next(Rng& rng) const {
+    const double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+    std::size_t lo = 0, hi = cdf_.size() - 1;
+    while (lo < hi) {
+      const std::size_t mid = (lo + hi) / 2;
+      if (cdf_[mid] < u) lo = mid + 1; else hi = mid;
+    }
+    return perm_[lo];
+  }
+
+  std::size_t size() const { return perm_.size(); }
+
+private:
+  std::vector<double> cdf_;
+  std::vector<std::size_t> perm_;
+};
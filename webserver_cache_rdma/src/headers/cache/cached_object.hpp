@@ -0,0 +1,72 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A cached file, immutable once built. The cache and every response in flight share
+// it through one refcount, so a hit copies a single pointer. Everything about the
+// response that does not depend on the request is rendered once, here.
+//
+// The body is a view: over `storage` for objects read from disk, or over the pages of
+// a mapped DocImage, which then owns the object.
+struct CachedObject {
+  std::vector<uint8_t> storage;     // owns the body unless it is mapped
+  const uint8_t* body = nullptr;
+  std::size_t body_size = 0;
+  std::time_t last_modified = 0;
+  std::string etag;
+  std::string_view mime;            // static string from mime_type(), or in a mapped image
+  std::string_view encoding;        // empty or "gzip"
+  bool vary = false;                // another encoding exists: send Vary: Accept-Encoding
+  int16_t node = -1;                // NUMA node (numa::current_node()) the body was read on; -1 = untracked
+  std::string headers;              // Content-Type, Content-Length, Last-Modified and ETag lines
+  std::string_view last_modified_http;  // IMF-fixdate of last_modified, inside `headers`
+
+  // Cache bookkeeping for --cache.revalidate-ms: when the file was last found to
+  // match (steady ms), and whether a check is queued
+  mutable std::atomic<int64_t> checked_ms{0};
+  mutable std::atomic<bool> revalidating{false};
+
+  CachedObject() = default;
+  CachedObject(const CachedObject&) = delete;
+  CachedObject& operator=(const CachedObject&) = delete;
+
+  const uint8_t* data() const { return body; }
+  std::size_t size() const { return body_size; }
+};
+
+using ObjectPtr = std::shared_ptr<const CachedObject>;
+
+// Builds an object around `body`. The MIME type comes from the extension of
+// `type_path`; an empty `etag` is derived from size and mtime.
+ObjectPtr make_cached_object(std::vector<uint8_t> body, std::time_t last_modified, std::string_view type_path,
+                             std::string etag = {});
+
+// Renders the request-independent headers of `obj` from its other fields, and points
+// last_modified_http into them
+void render_object_headers(CachedObject& obj);
+
+// A body alone, for generated responses (metrics, error text) on paths that send
+// objects
+ObjectPtr make_text_object(std::string_view text);
+
+// What malloc takes for an n-byte request: an 8-byte header, rounded up to 16 bytes
+// (glibc's chunk layout; other allocators are within a few bytes)
+inline std::size_t malloc_footprint(std::size_t n) {
+  return n ? (n + 8 + 15) / 16 * 16 : 0;
+}
+
+// Heap bytes behind a string, 0 while it is short enough to live inside the object
+inline std::size_t string_footprint(const std::string& s) {
+  const char* p = s.data();
+  const bool inline_buf = p >= reinterpret_cast<const char*>(&s) && p < reinterpret_cast<const char*>(&s + 1);
+  return inline_buf ? 0 : malloc_footprint(s.capacity() + 1);
+}
+
+// Memory an object takes besides its body bytes: the object and its refcount block,
+// its strings, and unused capacity of `storage`. Mapped bodies cost nothing here.
+std::size_t object_overhead(const CachedObject& obj);
@@ -0,0 +1,104 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "lru_cache.hpp"
+
+// Second-level cache on local disk. Objects evicted from memory after being hit are
+// queued here and appended by a background writer to fixed-size segment files
+// (a log); an in-memory index maps each key to its body's location. When the log
+// outgrows its capacity the oldest segment is dropped whole, together with every
+// index entry that still points into it.
+//
+// Appends are limited to a byte rate so demotions cannot wear out or saturate the
+// device; objects over the budget, or arriving while the queue is full, are not
+// written. The index lives only in memory, so segments left by a previous run are
+// deleted at startup; those of a predecessor that is still running (a handoff) are
+// left to it and removed by a later start.
+class DiskCache {
+public:
+  struct Options {
+    std::string dir;
+    std::size_t capacity_bytes = 1ull << 30;
+    std::size_t segment_bytes = 0;              // 0 = capacity / 16, at least 1 MB
+    std::size_t write_bytes_per_sec = 64ull << 20; // 0 = unlimited
+    std::size_t queue_bytes = 64ull << 20;      // demotions waiting for the writer
+  };
+
+  // Throws std::runtime_error if the directory cannot be created or cleared
+  explicit DiskCache(const Options& opt);
+  ~DiskCache();
+
+  DiskCache(const DiskCache&) = delete;
+  DiskCache& operator=(const DiskCache&) = delete;
+
+  // Reads the object back from disk; null if absent or the read fails
+  ObjectPtr get(std::string_view key);
+
+  // Queues an evicted object for writing; never blocks on I/O
+  void demote(std::string key, ObjectPtr obj);
+
+private:
+  struct Segment {
+    int fd = -1;
+    ~Segment();
+  };
+
+  struct Location {
+    uint64_t segment;
+    uint64_t offset;                // of the body within the segment
+    std::size_t size;
+    std::time_t last_modified;
+    std::string etag;
+  };
+
+  void writer_loop();
+  void append(const std::string& key, const CachedObject& e);
+  bool open_segment();
+  void drop_oldest_segment();
+  bool take_budget(std::size_t bytes);
+  std::string segment_path(uint64_t id) const;
+  void publish() const;
+
+  const Options opt_;
+
+  // Index and open segments; readers take the shared lock
+  mutable std::shared_mutex mtx_;
+  std::unordered_map<std::string, Location> index_;
+  std::map<uint64_t, std::shared_ptr<Segment>> segments_;  // oldest first
+  std::size_t used_bytes_ = 0;      // bytes in all segments, superseded records included
+  // What this instance last added to the process-wide gauges (guarded by mtx_)
+  mutable std::size_t pub_bytes_ = 0;
+  mutable std::size_t pub_items_ = 0;
+
+  // Writer state, touched only by the writer thread
+  struct SegmentLog {
+    std::vector<std::string> keys; // written into the segment, possibly superseded since
+    std::size_t bytes = 0;
+  };
+  std::unordered_map<uint64_t, SegmentLog> logs_;
+  uint64_t current_id_ = 0;
+  uint64_t current_size_ = 0;
+  double budget_tokens_ = 0;
+  std::chrono::steady_clock::time_point budget_at_{};
+
+  // Demotion queue
+  std::mutex qmtx_;
+  std::condition_variable qcv_;
+  std::deque<std::pair<std::string, ObjectPtr>> queue_;
+  std::size_t queued_bytes_ = 0;
+  bool stop_ = false;
+  std::thread writer_;
+};
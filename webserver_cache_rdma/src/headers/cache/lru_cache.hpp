@@ -1,43 +1,213 @@
 #pragma once
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include <unordered_map>
-#include <list>
 #include <memory>
 #include <shared_mutex>
 #include <vector>
 #include <string>
-#include <ctime>
+#include <string_view>
+#include <utility>
 
+#include "cached_object.hpp"
+#include "negative_cache.hpp"
+
+class DiskCache;
+
+// Size-aware two-tier cache plus a pinned set.
+//
+// - Small tier: objects up to `small_max_object` bytes live in an open-addressing
+//   table (linear probing, one slot per object, key stored once) and are evicted by
+//   CLOCK, so a hit only takes the shared lock and sets the slot's reference bit.
+// - Large tier: bigger objects are kept in LRU order. Each entry is one allocation
+//   holding its recency links, hash chain, object pointer and the key bytes; bodies
+//   are refcounted buffers that in-flight responses may hold after eviction.
+// - Pinned keys are never evicted and do not count against either tier's budget.
+//
+// Each tier has its own lock and byte budget. A budget covers the bodies and the
+// memory around them: the tier's table, each entry and key, and each object with its
+// strings (object_overhead()). Payload and overhead bytes, items, hits and evictions
+// per tier are published in Metrics.
+//
+// Entries are immutable CachedObjects. Lookups take the key as a string_view and a
+// hit only copies the object pointer under the tier lock.
+//
+// With an L2 directory configured, objects evicted from either tier after at least
+// one hit are demoted to a DiskCache, and a memory miss that hits L2 is promoted back.
+//
+// With `revalidate_after` set, a hit on an object not checked for that long is still
+// returned at once, and its key is queued for a background thread that calls
+// `reload`: an unchanged file refreshes the check time, a changed one replaces the
+// object and a vanished one drops it. No lookup ever waits on the filesystem.
+//
+// With `negative_ttl` set, targets that did not map to a file are remembered for
+// that long (negative_cache.hpp), so repeated 404s skip the filesystem too.
+//
+// With --numa there is one cache per node. Gauges in Metrics are the sum over all of
+// them, so each instance publishes changes rather than its totals; its background
+// thread runs on its node.
 class LRUCache {
 public:
-  struct Entry {
-    std::shared_ptr<std::vector<uint8_t>> body;
-    std::size_t size = 0;
-    std::time_t last_modified = 0;
-    std::string etag;
+  // Returns `current` if the file behind `key` is unchanged, a new object if it
+  // changed, and null if it is gone
+  using Reload = std::function<ObjectPtr(std::string_view key, const ObjectPtr& current)>;
+
+  struct Options {
+    std::size_t capacity_bytes = 128ull << 20;   // both tiers
+    std::size_t small_capacity_bytes = 0;        // 0 = capacity_bytes / 8
+    std::size_t small_max_object = 16 * 1024;
+    std::vector<std::string> pinned;             // cache keys (URL paths)
+
+    std::string l2_dir;                          // empty = no L2
+    std::size_t l2_capacity_bytes = 1ull << 30;
+    std::size_t l2_write_bytes_per_sec = 64ull << 20;
+
+    std::chrono::milliseconds revalidate_after{0};  // 0 = objects never go stale
+    Reload reload;
+    std::size_t revalidate_queue = 1024;            // keys waiting for the worker
+
+    std::chrono::milliseconds negative_ttl{0};      // 0 = failed lookups are not remembered
+    std::size_t negative_max = 65536;               // remembered targets
+
+    int node = -1;                               // NUMA node (numa.hpp) whose workers use this cache
   };
 
-  explicit LRUCache(std::size_t capacity_bytes)
-    : capacity_bytes_(capacity_bytes) {}
+  explicit LRUCache(std::size_t capacity_bytes);
+  explicit LRUCache(const Options& opt);
+  ~LRUCache();
+
+  // Null on a miss
+  ObjectPtr get(std::string_view key);
+  void put(std::string_view key, ObjectPtr obj);
+
+  // Cached objects, most recently used first, up to `max_bytes` of bodies.
+  // Referenced small objects come first, then the large tier in LRU order, then the
+  // rest of the small tier. Pinned objects are left out (a new process pins its own).
+  std::vector<std::pair<std::string, ObjectPtr>> snapshot(std::size_t max_bytes) const;
 
-  bool get(const std::string& key, Entry& out);
-  void put(const std::string& key, const Entry& e);
+  // Status (404 or 400) remembered for a request target that did not map to a file,
+  // 0 if none; put_negative() records one
+  int negative(std::string_view target) const { return negative_ ? negative_->find(target) : 0; }
+  void put_negative(std::string_view target, int status) { if (negative_) negative_->insert(target, status); }
 
+  bool is_pinned(std::string_view key) const { return !pinned_.empty() && pinned_.count(key) != 0; }
+
+  // Body bytes; overhead_bytes() is the rest of what the cache holds
   std::size_t size_bytes() const;
-  std::size_t capacity_bytes() const { return capacity_bytes_; }
+  std::size_t overhead_bytes() const;
+  std::size_t capacity_bytes() const { return small_capacity_ + large_capacity_; }
   std::size_t items() const;
 
 private:
-  struct Node {
+  struct SmallSlot {
+    std::size_t hash = 0;                   // 0 = empty
     std::string key;
-    Entry value;
+    ObjectPtr value;
+    mutable std::atomic<bool> referenced{false};
+    mutable std::atomic<bool> hit{false};   // read since it was stored; demoted on eviction
+
+    SmallSlot() = default;
+    SmallSlot(SmallSlot&& o) noexcept { *this = std::move(o); }
+    SmallSlot& operator=(SmallSlot&& o) noexcept {
+      hash = o.hash;
+      key = std::move(o.key);
+      value = std::move(o.value);
+      referenced.store(o.referenced.load(std::memory_order_relaxed), std::memory_order_relaxed);
+      hit.store(o.hit.load(std::memory_order_relaxed), std::memory_order_relaxed);
+      o.hash = 0;
+      return *this;
+    }
+  };
+
+  // Followed in the same allocation by the key bytes
+  struct LargeEntry {
+    LargeEntry* newer = nullptr;
+    LargeEntry* older = nullptr;
+    LargeEntry* chain = nullptr;            // next in the same bucket
+    std::size_t hash = 0;
+    ObjectPtr value;
+    std::size_t overhead = 0;               // charged at insert, refunded at erase
+    uint32_t key_len = 0;
+    bool hit = false;                       // read since it was stored; demoted on eviction
+
+    std::string_view key() const { return {reinterpret_cast<const char*>(this + 1), key_len}; }
+  };
+
+  // Background revalidation; defined in the .cpp
+  struct Revalidator;
+  void check_stale(std::string_view key, const ObjectPtr& obj);
+  void revalidate_loop();
+  ObjectPtr peek(std::string_view key) const;     // no recency update, no metrics
+  void erase(std::string_view key);
+
+  // Evicted objects bound for L2, handed over once the tier lock is released
+  using Victims = std::vector<std::pair<std::string, ObjectPtr>>;
+  void demote(Victims& victims);
+
+  // Small tier (guarded by small_mtx_)
+  std::size_t small_find(std::size_t hash, std::string_view key) const;
+  void small_insert(std::size_t hash, std::string_view key, ObjectPtr obj);
+  void small_erase(std::size_t index);
+  void small_grow();
+  void small_evict(Victims& victims);
+  bool small_remove(std::string_view key);
+
+  // Large tier (guarded by large_mtx_)
+  LargeEntry* large_find(std::size_t hash, std::string_view key) const;
+  void large_insert(std::size_t hash, std::string_view key, ObjectPtr obj);
+  void large_erase(LargeEntry* e);          // unlinks and frees
+  void large_touch(LargeEntry* e);          // moves to the most recent end
+  void large_grow();
+  void large_evict(Victims& victims);
+  bool large_remove(std::string_view key);
+  std::size_t large_table_bytes() const { return buckets_.capacity() * sizeof(LargeEntry*); }
+  std::size_t small_table_bytes() const { return slots_.capacity() * sizeof(SmallSlot); }
+
+  // What this cache last added to the process-wide gauges (guarded by the tier lock)
+  struct Published {
+    std::size_t bytes = 0;
+    std::size_t items = 0;
+    std::size_t overhead = 0;
   };
+  void publish_small() const;
+  void publish_large() const;
+  void publish_pinned() const;
+
+  static std::size_t hash_key(std::string_view key);
+
+  const std::size_t small_max_object_;
+  const std::size_t small_capacity_;
+  const std::size_t large_capacity_;
+  const std::vector<std::string> pin_keys_;
+
+  mutable std::shared_mutex small_mtx_;
+  std::vector<SmallSlot> slots_;            // size is a power of two
+  std::size_t small_items_{0};
+  std::size_t small_bytes_{0};
+  std::size_t small_overhead_{0};           // keys and objects; the table is added on top
+  std::size_t clock_hand_{0};
+
+  mutable std::shared_mutex large_mtx_;
+  std::vector<LargeEntry*> buckets_;        // size is a power of two
+  LargeEntry* newest_ = nullptr;
+  LargeEntry* oldest_ = nullptr;
+  std::size_t large_items_{0};
+  std::size_t large_bytes_{0};
+  std::size_t large_overhead_{0};           // entries and objects; the table is added on top
 
-  mutable std::shared_mutex mtx_;
-  std::size_t capacity_bytes_;
-  std::size_t used_bytes_{0};
+  mutable std::shared_mutex pinned_mtx_;
+  // One entry per pin key (views into pin_keys_), created up front so the map's shape
+  // never changes and lookups need no lock; the objects are guarded by pinned_mtx_
+  std::unordered_map<std::string_view, ObjectPtr> pinned_;
+  std::size_t pinned_bytes_{0};
+  std::size_t pinned_overhead_{0};
+  std::size_t pinned_items_{0};
 
-  std::list<Node> lru_; // front = most recent
-  std::unordered_map<std::string, std::list<Node>::iterator> map_;
+  mutable Published small_pub_, large_pub_, pinned_pub_;
 
-  void evict_if_needed();
-};
\ No newline at end of file
+  std::unique_ptr<DiskCache> l2_;
+  std::unique_ptr<Revalidator> revalidator_;
+  std::unique_ptr<NegativeCache> negative_;
+  const int node_;
+};
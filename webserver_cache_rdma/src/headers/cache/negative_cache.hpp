@@ -0,0 +1,51 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Short-lived memory of targets that did not map to a file: a 404 for a missing one,
+// a 400 for one that resolves outside the document root. A repeat of such a request
+// is answered from here without the canonicalisation and stat calls of
+// map_url_to_fs. Entries expire after `ttl`, so a file created meanwhile is served
+// at most one TTL late.
+//
+// Keys are raw request targets. The table is split into shards, each with its own
+// lock and an equal share of `max_entries`; a full shard first drops its expired
+// entries and, if that frees nothing, starts over empty. Lookups compare the stored
+// key and never allocate.
+class NegativeCache {
+public:
+  NegativeCache(int64_t ttl_ms, std::size_t max_entries);
+  ~NegativeCache();
+
+  // The status remembered for `target`, 0 if none or expired
+  int find(std::string_view target) const;
+  void insert(std::string_view target, int status);
+
+  std::size_t items() const;
+
+private:
+  struct Entry {
+    std::string key;
+    int64_t expires_ms = 0;
+    int status = 0;
+  };
+
+  // Keyed by the target's hash; a colliding target replaces the entry
+  struct Shard {
+    mutable std::mutex mtx;
+    std::unordered_map<std::size_t, Entry> map;
+  };
+
+  static constexpr std::size_t kShards = 16;
+
+  Shard& shard_for(std::size_t hash) const { return shards_[(hash >> 4) % kShards]; }
+
+  const int64_t ttl_ms_;
+  const std::size_t shard_max_;
+  mutable std::array<Shard, kShards> shards_;
+};
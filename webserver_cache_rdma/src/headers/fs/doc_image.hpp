@@ -0,0 +1,132 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../cache/cached_object.hpp"
+
+// Read-only packed document root: built by `docpack`, mapped by the server with
+// --image and served from directly, without the memory cache or the filesystem.
+//
+// File layout (native byte order; offsets count from the start of the file):
+//   Header
+//   uint32_t seeds[bucket_count]    per-bucket seed of the path index
+//   uint32_t slots[table_size]      entry index per slot, kNoEntry if unused
+//   Entry entries[count]            sorted by path
+//   strings                         path, MIME type and ETag of each entry
+//   bodies                          identity and gzip bodies; page-aligned from one
+//                                   page up, smaller ones packed on cache lines
+//
+// The path index is a hash-and-displace perfect hash: the unseeded hash of a path
+// picks a bucket, the bucket's seed picks the slot, so a lookup is two hashes, two
+// loads and one comparison, and never a syscall.
+namespace doc_image {
+
+constexpr char kMagic[8] = {'W', 'S', 'D', 'O', 'C', 'I', 'M', 'G'};
+constexpr uint32_t kVersion = 1;
+constexpr std::size_t kBodyAlign = 4096;
+constexpr std::size_t kSmallBodyAlign = 64;
+constexpr uint32_t kNoEntry = 0xffffffffu;
+
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t count;
+  uint32_t bucket_count;
+  uint32_t table_size;
+  uint64_t seeds_offset;
+  uint64_t slots_offset;
+  uint64_t entries_offset;
+  uint64_t file_size;
+  uint64_t reserved;
+};
+static_assert(sizeof(Header) == 64, "doc_image::Header is part of the file format");
+
+struct Entry {
+  uint64_t strings_offset;  // path, MIME type, ETag, back to back
+  uint64_t body_offset;
+  uint64_t body_size;
+  uint64_t gzip_offset;
+  uint64_t gzip_size;       // 0 = no gzip variant
+  int64_t last_modified;
+  uint16_t path_len;
+  uint16_t mime_len;
+  uint16_t etag_len;
+  uint16_t reserved0;
+  uint32_t reserved1;
+};
+static_assert(sizeof(Entry) == 64, "doc_image::Entry is part of the file format");
+
+// FNV-1a over the exact bytes (paths are case-sensitive), mixed with the seed
+inline uint32_t hash(std::string_view s, uint32_t seed) {
+  uint32_t h = 2166136261u ^ (seed * 0x9e3779b9u);
+  for (char c : s) {
+    h ^= static_cast<uint8_t>(c);
+    h *= 16777619u;
+  }
+  return h ^ (h >> 15);
+}
+
+// One file to pack. `gzip` is left empty when compression did not pay off.
+struct Input {
+  std::string path;              // cache key form: "/dir/file.html"
+  std::string mime;
+  std::string etag;
+  std::time_t last_modified = 0;
+  std::vector<uint8_t> body;
+  std::vector<uint8_t> gzip;
+};
+
+// Builds the index and writes the image to `out_path` (through a temporary file
+// renamed into place). Throws std::runtime_error on I/O errors, duplicate paths or
+// strings too long for the format.
+void write(const std::string& out_path, std::vector<Input> inputs);
+
+} // namespace doc_image
+
+class DocImage : public std::enable_shared_from_this<DocImage> {
+public:
+  // Maps the file and checks the header and every entry against its size; throws
+  // std::runtime_error if it is not a valid image
+  static std::shared_ptr<DocImage> open(const std::string& path);
+  ~DocImage();
+
+  DocImage(const DocImage&) = delete;
+  DocImage& operator=(const DocImage&) = delete;
+
+  // The object for a key in cache key form, or null. With `gzip`, the compressed
+  // variant when the file has one. The object aliases the image's refcount and its
+  // body points into the mapping; it is built on the first lookup and kept.
+  ObjectPtr find(std::string_view key, bool gzip) const;
+
+  // find() for a request target: canonical targets are used as they are, anything
+  // else is normalized first (without touching the filesystem)
+  ObjectPtr find_target(const std::string& target, bool gzip) const;
+
+  std::size_t count() const { return count_; }
+  std::size_t size_bytes() const { return size_; }
+
+private:
+  DocImage() = default;
+  const CachedObject* object(uint32_t index, bool gzip) const;
+
+  void* map_ = nullptr;
+  std::size_t size_ = 0;
+  const uint8_t* base_ = nullptr;
+  uint32_t count_ = 0;
+  uint32_t bucket_count_ = 0;
+  uint32_t table_size_ = 0;
+  const uint32_t* seeds_ = nullptr;
+  const uint32_t* slots_ = nullptr;
+  const doc_image::Entry* entries_ = nullptr;
+  // Two per entry (identity, gzip)
+  std::unique_ptr<std::atomic<const CachedObject*>[]> objects_;
+};
+
+// Whether an Accept-Encoding value admits gzip: listed (or "*") without q=0
+bool accepts_gzip(std::string_view accept_encoding);
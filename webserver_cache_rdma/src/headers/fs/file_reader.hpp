@@ -13,6 +13,15 @@ struct FileReadResult {
 
 FileReadResult read_file(const std::string& path);
 
+// Size and mtime of a regular file, without reading it; ok is false for anything else
+struct FileStat {
+  bool ok = false;
+  std::size_t size = 0;
+  std::time_t last_modified = 0;
+};
+
+FileStat stat_file(const std::string& path);
+
 inline std::string make_etag(std::size_t size, std::time_t mtime) {
   return "W/\"" + std::to_string(size) + "-" + std::to_string(static_cast<long long>(mtime)) + "\"";
-}
\ No newline at end of file
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include <string_view>
 
 struct PathMapResult {
   bool ok = false;
@@ -7,6 +8,18 @@ struct PathMapResult {
   std::string fs_path;
   std::string cache_key;
   std::string error;
+  bool outside_root = false;   // the target resolves outside doc_root (a 400)
 };
 
-PathMapResult map_url_to_fs(const std::string& doc_root, const std::string& url_path);
\ No newline at end of file
+PathMapResult map_url_to_fs(const std::string& doc_root, const std::string& url_path);
+
+// `url_path` itself when it is already in the form map_url_to_fs gives cache keys
+// (absolute, no query, no empty, "." or ".." segments, no trailing slash), else an
+// empty view. Only keys that passed map_url_to_fs are ever cached, so a hit on this
+// key can skip the filesystem checks.
+std::string_view direct_cache_key(std::string_view url_path);
+
+// The cache key map_url_to_fs would give `url_path`, computed from the string alone
+// (query dropped, "." and ".." resolved, "/" -> "/index.html"); for lookups that
+// never touch the filesystem, such as a packed image
+std::string url_cache_key(const std::string& url_path);
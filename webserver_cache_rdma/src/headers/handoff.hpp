@@ -0,0 +1,72 @@
+#pragma once
+#include <boost/asio.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <thread>
+
+#include "cache/lru_cache.hpp"
+
+class Server;
+
+// Zero-downtime restart. A running server listens on a Unix socket (--handoff.path).
+// A successor started with the same path connects to it and receives:
+//
+//   1. the listening TCP sockets (HTTP, and TLS if enabled), passed with SCM_RIGHTS,
+//      so both processes accept from the same kernel queues and no connection is
+//      refused during the switch;
+//   2. the hottest cache objects (up to --handoff.cache-mb), so it starts warm.
+//
+// Once the successor accepts on the inherited socket it reports ready. The old
+// process then stops accepting, answers in-flight requests with `Connection:
+// close`, and exits when its sessions are gone or the drain timeout passes.
+namespace handoff {
+
+// What a successor got from its predecessor. `listen_fd` is -1 when no process was
+// listening on the path, in which case the server binds its port itself;
+// `tls_listen_fd` is -1 when the predecessor had no TLS listener.
+struct Inherited {
+  int listen_fd = -1;
+  int tls_listen_fd = -1;
+  int channel = -1;            // kept open until ready() is sent
+  std::size_t objects = 0;
+  std::size_t bytes = 0;
+};
+
+// Successor side: connects to `path` and, if a predecessor answers, takes over its
+// listener and fills `cache`. Throws std::runtime_error if the exchange breaks off.
+Inherited inherit(const std::string& path, LRUCache& cache);
+
+// Successor side: tells the predecessor it is accepting, then closes the channel
+void ready(Inherited& inherited);
+
+// Starts a copy of this process (same argv, binary looked up again, so an upgraded
+// executable is picked up); it takes over through the handoff path
+bool spawn_successor(char** argv);
+
+// Predecessor side: serves one successor at a time on `path`
+class Listener {
+public:
+  Listener(boost::asio::io_context& ioc, Server& server, std::string path,
+           std::size_t cache_bytes, std::chrono::milliseconds drain_timeout);
+  ~Listener();
+
+  void start();
+
+private:
+  void do_accept();
+  void serve(int fd);
+
+  boost::asio::io_context& ioc_;
+  Server& server_;
+  std::string path_;
+  std::size_t cache_bytes_;
+  std::chrono::milliseconds drain_timeout_;
+  boost::asio::local::stream_protocol::acceptor acceptor_;
+
+  std::thread worker_;         // the blocking exchange with a successor
+  std::atomic<bool> busy_{false};
+};
+
+} // namespace handoff
@@ -1,9 +1,41 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <algorithm>
+#include <array>
+#include <cstdint>
+#include "../util/perfect_hash.hpp"
 
 inline std::string header_lower(const std::string& s) {
   std::string out = s;
   std::transform(out.begin(), out.end(), out.begin(), [](unsigned char c){ return static_cast<char>(std::tolower(c)); });
   return out;
-}
\ No newline at end of file
+}
+
+// Request headers the server acts on. The parser stores them by id in
+// HttpRequest::known instead of lowercasing the name into the header map.
+enum class HeaderId : uint8_t {
+  Connection,
+  Host,
+  Range,
+  IfNoneMatch,
+  AcceptEncoding,
+  Upgrade,
+  Http2Settings,
+  Other
+};
+
+constexpr std::size_t kKnownHeaders = static_cast<std::size_t>(HeaderId::Other);
+
+constexpr std::array<std::string_view, kKnownHeaders> kKnownHeaderNames = {
+  "connection", "host", "range", "if-none-match", "accept-encoding", "upgrade", "http2-settings"
+};
+
+inline constexpr auto kKnownHeaderTable = make_perfect_hash<16>(kKnownHeaderNames);
+static_assert(kKnownHeaderTable.seed != 0, "no perfect hash seed for the known header names");
+
+// Case-insensitive; HeaderId::Other for anything not listed above
+constexpr HeaderId header_id(std::string_view name) {
+  const int i = kKnownHeaderTable.find(kKnownHeaderNames, name);
+  return i < 0 ? HeaderId::Other : static_cast<HeaderId>(i);
+}
@@ -1,4 +1,6 @@
 #pragma once
-#include <string>
+#include <string_view>
 
-std::string mime_type(const std::string& path);
\ No newline at end of file
+// Content type for a file path by extension (case-insensitive); the view points
+// at static storage
+std::string_view mime_type(std::string_view path);
@@ -1,7 +1,6 @@
 #pragma once
-#include <string>
-#include <unordered_map>
-#include <vector>
+#include <cstddef>
+#include <string_view>
 #include "request.hpp"
 
 enum class ParseState {
@@ -15,18 +14,29 @@ struct ParseResult {
   HttpRequest request;
 };
 
+// Parses request heads in place, out of the caller's receive buffer: the parser
+// keeps no copy of the bytes, only how far it has already searched for the end of
+// the head, so a connection between requests owns no buffer on its account.
 class HttpParser {
 public:
   HttpParser(std::size_t max_start_line, std::size_t max_headers_bytes)
     : max_start_line_(max_start_line), max_headers_bytes_(max_headers_bytes) {}
 
-  ParseResult parse(const char* data, std::size_t n);
-  void reset();
+  // Parses the request at the front of [data, data + n), the bytes received and not
+  // yet consumed. On Done, `consumed` is the length of its head and the next call
+  // starts after it; otherwise nothing is consumed and the caller passes the same
+  // bytes again, with more appended. A head that is malformed, or that has no end
+  // within max_head_bytes(), is BadRequest.
+  ParseResult parse(const char* data, std::size_t n, std::size_t& consumed);
+  void reset() { scanned_ = 0; }
+
+  // Longest head accepted, request line and terminator included
+  std::size_t max_head_bytes() const { return max_start_line_ + max_headers_bytes_ + 4; }
 
 private:
-  std::string buf_;
   std::size_t max_start_line_;
   std::size_t max_headers_bytes_;
+  std::size_t scanned_ = 0;         // bytes at the front known not to end the head
 
-  bool try_parse(HttpRequest& out);
-};
\ No newline at end of file
+  bool parse_head(std::string_view head, HttpRequest& out) const;
+};
@@ -1,13 +1,19 @@
 #pragma once
+#include <array>
 #include <string>
 #include <unordered_map>
+#include "headers.hpp"
 
 struct HttpRequest {
   std::string method;
   std::string target;
   std::string version;
-  std::unordered_map<std::string, std::string> headers;
+  std::array<std::string, kKnownHeaders> known;          // by HeaderId; empty = absent
+  std::unordered_map<std::string, std::string> headers;  // all other headers, lowercased names
   bool keep_alive = true;
 
+  const std::string& header(HeaderId id) const { return known[static_cast<std::size_t>(id)]; }
+
+  // Any header by name, case-insensitive
   std::string header(const std::string& name) const;
-};
\ No newline at end of file
+};
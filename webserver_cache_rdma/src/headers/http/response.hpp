@@ -1,5 +1,8 @@
 #pragma once
+#include <charconv>
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include "../util/time.hpp"
 
@@ -21,4 +24,48 @@ struct HttpResponse {
     h += "\r\n";
     return h;
   }
-};
\ No newline at end of file
+};
+
+// Header writers for the session's hot path: they append straight into a
+// caller-owned string (any allocator) instead of going through HttpResponse's map.
+
+inline std::string_view reason_phrase(int status) {
+  switch (status) {
+    case 101: return "Switching Protocols";
+    case 200: return "OK";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 503: return "Service Unavailable";
+    default: return "Internal Server Error";
+  }
+}
+
+template <typename String>
+inline void append_header(String& out, std::string_view name, std::string_view value) {
+  out.append(name.data(), name.size());
+  out.append(": ", 2);
+  out.append(value.data(), value.size());
+  out.append("\r\n", 2);
+}
+
+template <typename String>
+inline void append_header(String& out, std::string_view name, uint64_t value) {
+  char num[24];
+  const auto res = std::to_chars(num, num + sizeof(num), value);
+  append_header(out, name, std::string_view(num, static_cast<std::size_t>(res.ptr - num)));
+}
+
+// Status line plus Date
+template <typename String>
+inline void append_status_line(String& out, int status) {
+  char num[12];
+  const auto res = std::to_chars(num, num + sizeof(num), status);
+  const auto reason = reason_phrase(status);
+  out.append("HTTP/1.1 ", 9);
+  out.append(num, static_cast<std::size_t>(res.ptr - num));
+  out.append(" ", 1);
+  out.append(reason.data(), reason.size());
+  out.append("\r\n", 2);
+  append_header(out, "Date", cached_http_date());
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// HTTP/2 framing (RFC 7540 section 4 and 6): constants and the 9-byte frame header.
+namespace h2 {
+
+constexpr std::string_view kClientPreface = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+constexpr std::size_t kFrameHeaderSize = 9;
+constexpr uint32_t kDefaultMaxFrame = 16384;     // also the largest frame we accept
+constexpr int64_t kDefaultWindow = 65535;
+constexpr int64_t kMaxWindow = 0x7fffffff;
+
+enum class FrameType : uint8_t {
+  Data = 0x0,
+  Headers = 0x1,
+  Priority = 0x2,
+  RstStream = 0x3,
+  Settings = 0x4,
+  PushPromise = 0x5,
+  Ping = 0x6,
+  GoAway = 0x7,
+  WindowUpdate = 0x8,
+  Continuation = 0x9
+};
+
+namespace flags {
+constexpr uint8_t EndStream = 0x1;
+constexpr uint8_t Ack = 0x1;
+constexpr uint8_t EndHeaders = 0x4;
+constexpr uint8_t Padded = 0x8;
+constexpr uint8_t Priority = 0x20;
+}
+
+enum class ErrorCode : uint32_t {
+  NoError = 0x0,
+  ProtocolError = 0x1,
+  InternalError = 0x2,
+  FlowControlError = 0x3,
+  StreamClosed = 0x5,
+  FrameSizeError = 0x6,
+  RefusedStream = 0x7,
+  Cancel = 0x8,
+  CompressionError = 0x9
+};
+
+enum class Setting : uint16_t {
+  HeaderTableSize = 0x1,
+  EnablePush = 0x2,
+  MaxConcurrentStreams = 0x3,
+  InitialWindowSize = 0x4,
+  MaxFrameSize = 0x5,
+  MaxHeaderListSize = 0x6
+};
+
+struct FrameHeader {
+  uint32_t length;
+  FrameType type;
+  uint8_t flags;
+  uint32_t stream_id;
+};
+
+inline uint32_t read_u32(const uint8_t* p) {
+  return (uint32_t{p[0]} << 24) | (uint32_t{p[1]} << 16) | (uint32_t{p[2]} << 8) | uint32_t{p[3]};
+}
+
+inline void write_u32(uint8_t* p, uint32_t v) {
+  p[0] = static_cast<uint8_t>(v >> 24);
+  p[1] = static_cast<uint8_t>(v >> 16);
+  p[2] = static_cast<uint8_t>(v >> 8);
+  p[3] = static_cast<uint8_t>(v);
+}
+
+inline FrameHeader read_frame_header(const uint8_t* p) {
+  FrameHeader h;
+  h.length = (uint32_t{p[0]} << 16) | (uint32_t{p[1]} << 8) | uint32_t{p[2]};
+  h.type = static_cast<FrameType>(p[3]);
+  h.flags = p[4];
+  h.stream_id = read_u32(p + 5) & 0x7fffffffu;
+  return h;
+}
+
+inline void write_frame_header(uint8_t* p, uint32_t length, FrameType type, uint8_t fl, uint32_t stream_id) {
+  p[0] = static_cast<uint8_t>(length >> 16);
+  p[1] = static_cast<uint8_t>(length >> 8);
+  p[2] = static_cast<uint8_t>(length);
+  p[3] = static_cast<uint8_t>(type);
+  p[4] = fl;
+  write_u32(p + 5, stream_id & 0x7fffffffu);
+}
+
+// Appends a complete frame (header plus payload) to `out`
+inline void append_frame(std::string& out, FrameType type, uint8_t fl, uint32_t stream_id,
+                         const void* payload, std::size_t length) {
+  uint8_t hdr[kFrameHeaderSize];
+  write_frame_header(hdr, static_cast<uint32_t>(length), type, fl, stream_id);
+  out.append(reinterpret_cast<const char*>(hdr), sizeof(hdr));
+  if (length) out.append(static_cast<const char*>(payload), length);
+}
+
+} // namespace h2
@@ -0,0 +1,119 @@
+#pragma once
+#include <boost/asio.hpp>
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "frame.hpp"
+#include "hpack.hpp"
+#include "../session.hpp"
+#include "../util/config.hpp"
+#include "../util/handler_alloc.hpp"
+#include "../util/load_monitor.hpp"
+#include "../util/timer_wheel.hpp"
+#include "../cache/lru_cache.hpp"
+#include "../fs/doc_image.hpp"
+#include "../http/request.hpp"
+
+// HTTP/2 over cleartext TCP (h2c). A Session hands its socket over when a
+// connection opens with the HTTP/2 preface (prior knowledge) or after answering an
+// `Upgrade: h2c` request with 101. Requests are served from the same cache and
+// document root as HTTP/1.1; each stream's body goes out as DATA frames that point
+// straight into the cached buffer, paced by the peer's stream and connection windows.
+class H2Session : public std::enable_shared_from_this<H2Session> {
+public:
+  H2Session(SessionSocket socket, std::shared_ptr<const Config> cfg, std::shared_ptr<LRUCache> cache,
+            std::shared_ptr<const DocImage> image, std::shared_ptr<const LoadMonitor> monitor, std::shared_ptr<TimerWheel> wheel);
+  ~H2Session();
+
+  // Prior knowledge; `early` is everything read so far, starting with the preface
+  void start(std::string_view early);
+
+  // After a 101: `upgrade` is answered on stream 1 and `settings` is the decoded
+  // HTTP2-Settings payload. `early` holds any bytes read after the upgrade request.
+  void start_upgraded(const HttpRequest& upgrade, const std::string& settings, std::string_view early);
+
+  // Decodes an HTTP2-Settings header value; false if it is not a valid payload
+  static bool decode_settings_header(std::string_view b64, std::string& payload);
+
+private:
+  struct Stream {
+    int64_t send_window = 0;
+    ObjectPtr body;
+    std::size_t offset = 0;
+    bool queued = false;              // in ready_
+  };
+
+  void begin();
+  void start_read();
+  void on_read(boost::system::error_code ec, std::size_t n);
+  bool process_input();
+  bool handle_frame(const h2::FrameHeader& h, const uint8_t* p);
+  bool on_header_block();
+  bool apply_settings(const uint8_t* p, std::size_t n);
+
+  void respond(uint32_t stream_id, std::string_view method, const std::string& path);
+  int lookup(const std::string& path, ObjectPtr& obj, std::string& error);
+
+  void send_window_update(uint32_t stream_id, uint32_t increment);
+  void reset_stream(uint32_t stream_id, h2::ErrorCode code);
+  bool connection_error(h2::ErrorCode code);
+  void enqueue_ready(uint32_t stream_id);
+
+  void flush();
+  void on_write(boost::system::error_code ec);
+
+  enum class Deadline { Read, Write, Idle };
+  void update_deadline();
+  static void on_deadline(const std::shared_ptr<void>& owner, uint64_t generation);
+  void close();
+
+  SessionSocket socket_;
+  std::shared_ptr<const Config> cfg_;
+  std::shared_ptr<LRUCache> cache_;
+  std::shared_ptr<const DocImage> image_;
+  std::shared_ptr<const LoadMonitor> monitor_;
+  std::shared_ptr<TimerWheel> wheel_;
+
+  // Input
+  std::vector<uint8_t> inbuf_;
+  std::string rx_;                    // bytes not yet parsed into frames
+  bool preface_done_ = false;
+  bool reading_ = false;
+  h2::HpackDecoder hpack_;
+  std::string hblock_;                // header block being assembled from CONTINUATIONs
+  uint32_t hblock_stream_ = 0;        // 0 = not inside a header block
+  uint32_t last_stream_id_ = 0;
+  bool peer_goaway_ = false;
+
+  // Peer settings and windows
+  uint32_t peer_max_frame_ = h2::kDefaultMaxFrame;
+  int64_t peer_initial_window_ = h2::kDefaultWindow;
+  int64_t conn_send_window_ = h2::kDefaultWindow;
+
+  // Streams with response data still to send, and the round-robin order among them
+  std::map<uint32_t, Stream> streams_;
+  std::deque<uint32_t> ready_;
+
+  // Output: control and HEADERS frames accumulate in ctrl_ (reading pauses while it
+  // holds too much); flush() gathers them with DATA frames into one write
+  std::string ctrl_;
+  std::string wctrl_;
+  std::vector<std::array<uint8_t, h2::kFrameHeaderSize>> wdata_hdrs_;
+  std::vector<ObjectPtr> wbodies_;
+  std::vector<boost::asio::const_buffer> wbufs_;
+  bool writing_ = false;
+  bool closing_ = false;              // GOAWAY queued; close once it is written
+  bool draining_ = false;             // GOAWAY(NO_ERROR) sent for a handoff; no new streams
+
+  HandlerMemory read_mem_;
+  HandlerMemory write_mem_;
+  TimerWheel::Node deadline_;
+  Deadline deadline_kind_ = Deadline::Idle;
+  bool closed_ = false;
+};
@@ -0,0 +1,59 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// HPACK (RFC 7541). Request header blocks are decoded in full, with the dynamic
+// table and Huffman strings. Responses are encoded against the static table only
+// (indexed :status for common codes, literals without indexing otherwise), so the
+// encoder keeps no state and never touches the client's dynamic table.
+namespace h2 {
+
+struct HeaderField {
+  std::string name;
+  std::string value;
+};
+
+class HpackDecoder {
+public:
+  explicit HpackDecoder(std::size_t max_table_size = 4096) : max_size_(max_table_size), limit_(max_table_size) {}
+
+  // Decodes one complete header block. False on a compression error (the
+  // connection must then be torn down), or when the decoded list exceeds
+  // `max_list_bytes` (counted as RFC 7540 does: name + value + 32 per field).
+  bool decode(const uint8_t* p, std::size_t n, std::size_t max_list_bytes, std::vector<HeaderField>& out);
+
+private:
+  bool field_at(uint64_t index, const HeaderField*& out) const;
+  void insert(HeaderField f);
+  void evict_to(std::size_t size);
+
+  std::deque<HeaderField> dynamic_;   // front = newest
+  std::size_t size_ = 0;
+  std::size_t max_size_;              // current, set by the encoder's size updates
+  std::size_t limit_;                 // our SETTINGS_HEADER_TABLE_SIZE
+};
+
+namespace hpack {
+
+// Static-table indices of the names we send; the encoder uses them as name references
+enum class Name : uint8_t {
+  ContentLength = 28,
+  ContentType = 31,
+  Date = 33,
+  ETag = 34,
+  LastModified = 44,
+  RetryAfter = 53
+};
+
+void encode_status(std::string& out, int status);
+void encode_header(std::string& out, Name name, std::string_view value);
+
+// Huffman-decodes `n` bytes, appending to `out`; false on invalid code or padding
+bool huffman_decode(const uint8_t* p, std::size_t n, std::string& out);
+
+} // namespace hpack
+} // namespace h2
@@ -10,6 +10,8 @@
 
 #include "../util/config.hpp"
 #include "../cache/lru_cache.hpp"
+#include "transport.hpp"
+#include "protocol_session.hpp"
 
 namespace rdma_fast {
 
@@ -38,21 +40,27 @@ struct WorkBase {
 
 struct RecvWork : WorkBase {
   using WorkBase::WorkBase;
+  uint64_t seq = 0;        // position among this connection's receives
+  uint32_t len = 0;
+  bool ok = true;          // false for a flushed or failed receive
 };
 
 struct SendWork : WorkBase {
   using WorkBase::WorkBase;
 };
 
-class Connection : public std::enable_shared_from_this<Connection> {
+// RDMA transport: SEND/RECV on an RC queue pair. Protocol handling lives in
+// ProtocolSession; this class only moves messages and enforces send credit.
+class Connection : public Transport, public std::enable_shared_from_this<Connection> {
 public:
   Connection(RDMAServer* srv,
              rdma_cm_id* id,
              ibv_pd* pd,
              ibv_cq* cq,
              const Config& cfg,
-             std::shared_ptr<LRUCache> cache);
-  ~Connection();
+             std::shared_ptr<LRUCache> cache,
+             std::shared_ptr<const DocImage> image);
+  ~Connection() override;
 
   // Setup RECVs and ready to accept
   bool init();
@@ -60,37 +68,31 @@ public:
   // Post RECV buffers (called on init and after each completion)
   bool post_recvs(int count);
 
-  // Called by poller on completions
-  void on_recv_complete(RecvWork* w, uint32_t byte_len);
-  void on_send_complete(SendWork* w);
+  // Called by poller on completions; a failed receive still takes its turn, so later
+  // ones are not held back by the gap
+  void on_recv_complete(RecvWork* w, uint32_t byte_len, bool ok = true);
+  // A failed send (ok=false) still returns its buffer and credit
+  void on_send_complete(SendWork* w, bool ok = true);
 
   // Cleanup
   void close();
 
   uint32_t qp_num() const { return id_->qp ? id_->qp->qp_num : 0; }
 
-private:
-  // Protocol handling
-  void handle_ping();
-  void handle_get(const std::string& url_path);
-
-  // Send helpers
-  bool send_header(uint16_t status, uint64_t content_len, uint32_t chunk);
-  bool send_body_chunks(const std::shared_ptr<std::vector<uint8_t>>& body, uint32_t chunk);
-
-  // Flow control
-  void try_post_more_sends_locked();
+  // Transport
+  std::size_t max_message() const override { return send_buf_size_; }
+  SendStatus try_send(const ConstBuf* bufs, std::size_t count) override;
 
-  // Utilities
-  Buffer* make_buffer(size_t n);
-  void reclaim(Buffer* b);
+private:
+  // Parses and serves one received request, then reposts its buffer
+  void serve_recv_(RecvWork* w);
 
   RDMAServer* server_;
   rdma_cm_id* id_;
   ibv_pd* pd_;
   ibv_cq* cq_;
   Config cfg_;
-  std::shared_ptr<LRUCache> cache_;
+  ProtocolSession session_;
 
   std::mutex mtx_;
   bool closed_ = false;
@@ -98,14 +100,26 @@ private:
   // Pools
   std::vector<std::unique_ptr<Buffer>> recv_pool_;
   int recv_inflight_ = 0;
-
-  // Pending sends
-  struct SendItem {
-    std::unique_ptr<Buffer> buf;
-  };
-  std::deque<SendItem> send_queue_;
+  uint64_t next_post_seq_ = 0;
+  // Receives not reposted while the session was backlogged; reposted once a send
+  // completion finds it drained. The client's sends stall on receiver-not-ready meanwhile.
+  int recv_deferred_ = 0;
+
+  // With several pollers on the shared CQ, completions of one QP can be picked up by
+  // different threads. Requests are served strictly in receive order, one at a time,
+  // by whichever poller holds the next one; later ones wait here. At most
+  // rdma_recv_bufs_per_conn receives exist, so seq modulo that indexes a free slot.
+  std::mutex order_mtx_;
+  std::vector<RecvWork*> arrived_;
+  uint64_t next_serve_seq_ = 0;
+  bool serving_ = false;
+
+  // Registered send buffers, reused across SENDs; at most max_outstanding_sends exist
+  std::size_t send_buf_size_ = 0;
+  std::vector<std::unique_ptr<Buffer>> send_bufs_;
+  std::vector<Buffer*> send_free_;
   int sends_inflight_ = 0;
 };
 
 } // namespace rdma_fast
-#endif
\ No newline at end of file
+#endif
@@ -1,6 +1,7 @@
 #pragma once
 #include <cstdint>
 #include <cstddef>
+#include <cstring>
 #include <string>
 #include <vector>
 
@@ -11,12 +12,13 @@ namespace rdma_fast {
 enum class Op : uint8_t {
   GET = 1,
   PING = 2,
+  MGET = 3,
 };
 
 #pragma pack(push, 1)
 struct ReqHeader {
   uint8_t op;         // Op
-  uint16_t path_len;  // bytes
+  uint16_t path_len;  // payload bytes (GET path, MGET path list)
 };
 
 struct RespHeader {
@@ -24,11 +26,21 @@ struct RespHeader {
   uint64_t content_len;   // total payload bytes (0 on errors or PING)
   uint32_t chunk_size;    // size of subsequent SEND chunks (<= content_len)
 };
+
+// MGET payload: uint16 count, then count x {uint16 len, path bytes}.
+// The reply is one byte stream {RespHeader, MgetItem[count], bodies in request order}
+// packed back to back into messages of at most chunk_size bytes; content_len counts
+// everything after the RespHeader.
+struct MgetItem {
+  uint16_t status;
+  uint64_t len;
+};
 #pragma pack(pop)
 
 struct Request {
   Op op;
-  std::string path; // for GET
+  std::string path;               // for GET
+  std::vector<std::string> paths; // for MGET
 };
 
 inline bool parse_request(const char* data, std::size_t len, Request& out) {
@@ -38,14 +50,54 @@ inline bool parse_request(const char* data, std::size_t len, Request& out) {
   if (sizeof(ReqHeader) + path_len > len) return false;
 
   out.op = static_cast<Op>(h->op);
+  out.path.clear();
+  out.paths.clear();
   if (out.op == Op::GET) {
     out.path.assign(data + sizeof(ReqHeader), data + sizeof(ReqHeader) + path_len);
-  } else {
-    out.path.clear();
+  } else if (out.op == Op::MGET) {
+    const char* p = data + sizeof(ReqHeader);
+    const char* end = p + path_len;
+    uint16_t count = 0;
+    if (end - p < 2) return false;
+    std::memcpy(&count, p, 2);
+    p += 2;
+    out.paths.reserve(count);
+    for (uint16_t i = 0; i < count; ++i) {
+      uint16_t n = 0;
+      if (end - p < 2) return false;
+      std::memcpy(&n, p, 2);
+      p += 2;
+      if (end - p < n) return false;
+      out.paths.emplace_back(p, n);
+      p += n;
+    }
   }
   return true;
 }
 
+inline std::vector<uint8_t> make_get_request(const std::string& path) {
+  std::vector<uint8_t> v(sizeof(ReqHeader) + path.size());
+  ReqHeader h{static_cast<uint8_t>(Op::GET), static_cast<uint16_t>(path.size())};
+  std::memcpy(v.data(), &h, sizeof(h));
+  std::memcpy(v.data() + sizeof(h), path.data(), path.size());
+  return v;
+}
+
+inline std::vector<uint8_t> make_mget_request(const std::vector<std::string>& paths) {
+  std::vector<uint8_t> v(sizeof(ReqHeader) + 2);
+  const uint16_t count = static_cast<uint16_t>(paths.size());
+  std::memcpy(v.data() + sizeof(ReqHeader), &count, 2);
+  for (const auto& p : paths) {
+    const uint16_t n = static_cast<uint16_t>(p.size());
+    const auto* nb = reinterpret_cast<const uint8_t*>(&n);
+    v.insert(v.end(), nb, nb + 2);
+    v.insert(v.end(), p.begin(), p.end());
+  }
+  ReqHeader h{static_cast<uint8_t>(Op::MGET), static_cast<uint16_t>(v.size() - sizeof(ReqHeader))};
+  std::memcpy(v.data(), &h, sizeof(h));
+  return v;
+}
+
 inline std::vector<uint8_t> make_resp_header(uint16_t status, uint64_t content_len, uint32_t chunk) {
   std::vector<uint8_t> v(sizeof(RespHeader));
   auto* h = reinterpret_cast<RespHeader*>(v.data());
@@ -0,0 +1,86 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "transport.hpp"
+#include "protocol.hpp"
+#include "../util/config.hpp"
+#include "../cache/lru_cache.hpp"
+#include "../fs/doc_image.hpp"
+
+namespace rdma_fast {
+
+// Transport-independent half of a fast-path connection: parses requests, serves them
+// from the shared cache (or the packed image) and streams responses in chunks as the transport grants credit.
+// Responses carry no request id, so the transport must deliver on_message calls one
+// at a time and in receive order (the RDMA Connection orders completions picked up by
+// different pollers; the shm ring has a single consumer). on_writable and close may
+// run on other threads at the same time.
+class ProtocolSession {
+public:
+  ProtocolSession(Transport& t, const Config& cfg, std::shared_ptr<LRUCache> cache,
+                  std::shared_ptr<const DocImage> image);
+
+  // One received message (a whole request)
+  void on_message(const char* data, std::size_t len);
+
+  // The transport has send credit again
+  void on_writable();
+
+  // More responses are queued than the transport has taken. The transport stops
+  // taking requests (RDMA holds back receive buffers, shm leaves the ring unread)
+  // until on_writable() has drained the queue, so a client that pipelines without
+  // reading cannot grow it without bound.
+  bool backlogged() const { return backlogged_.load(std::memory_order_acquire); }
+
+  // Drop anything still queued; further output is discarded
+  void close();
+
+private:
+  enum class OutKind { Head, Body, Batch };
+
+  struct Out {
+    OutKind kind = OutKind::Head;
+    RespHeader head{};
+    ObjectPtr body;
+    std::size_t off = 0;
+    std::size_t end = 0;
+    uint32_t chunk = 0;
+
+    // Batch: prefix (RespHeader + item table) then parts, packed into chunk-sized messages
+    std::vector<uint8_t> prefix;
+    std::vector<ObjectPtr> parts;
+    std::size_t seg = 0; // 0 = prefix, i + 1 = parts[i]
+  };
+
+  void handle_ping();
+  void handle_get(const std::string& url_path);
+  void handle_mget(const std::vector<std::string>& paths);
+
+  // Resolves a path through the cache (reading and caching it on a miss)
+  uint16_t lookup(const std::string& url_path, ObjectPtr& body);
+  uint32_t chunk_for(uint64_t total) const;
+
+  void queue_header(uint16_t status, uint64_t content_len, uint32_t chunk);
+  void queue_body(ObjectPtr body, uint32_t chunk);
+  SendStatus send_batch_part(Out& o);
+  // Sends what the transport takes, then updates backlogged_
+  void pump_locked();
+  void pump_queue_locked();
+
+  Transport& t_;
+  Config cfg_;
+  std::shared_ptr<LRUCache> cache_;
+  std::shared_ptr<const DocImage> image_;
+
+  std::mutex mtx_;
+  std::deque<Out> out_;
+  bool closed_ = false;
+  std::atomic<bool> backlogged_{false};   // out_ over the limit, updated under mtx_
+};
+
+} // namespace rdma_fast
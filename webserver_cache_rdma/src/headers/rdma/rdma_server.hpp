@@ -14,6 +14,7 @@
 
 #include "../util/config.hpp"
 #include "../cache/lru_cache.hpp"
+#include "../fs/doc_image.hpp"
 
 namespace rdma_fast {
 
@@ -22,13 +23,16 @@ struct RDMAConfig {
   uint16_t port = 7471;
   int cq_depth = 512;
   int poller_threads = 1;
+  int poll_batch = 32;      // work completions drained per ibv_poll_cq call
+  int busy_poll_us = 50;    // keep spinning this long after the last completion (0 = event-driven only)
 };
 
 class Connection;
 
 class RDMAServer {
 public:
-  RDMAServer(const RDMAConfig& cfg, const Config& app_cfg, std::shared_ptr<LRUCache> cache);
+  RDMAServer(const RDMAConfig& cfg, const Config& app_cfg, std::shared_ptr<LRUCache> cache,
+             std::shared_ptr<const DocImage> image = {});
   ~RDMAServer();
 
   void start();
@@ -40,10 +44,13 @@ public:
 private:
   void cm_event_loop_();
   void cq_poller_loop_();
+  int drain_cq_(std::vector<ibv_wc>& wcs);
+  bool wait_cq_event_();
 
   RDMAConfig cfg_;
   Config app_cfg_{};
   std::shared_ptr<LRUCache> cache_{};
+  std::shared_ptr<const DocImage> image_{};
 
   std::atomic<bool> running_{false};
 
@@ -53,6 +60,7 @@ private:
   ibv_pd* pd_ = nullptr;
   ibv_comp_channel* comp_ch_ = nullptr;
   ibv_cq* cq_ = nullptr;
+  std::atomic<bool> cq_ready_{false}; // set by the CM thread once pd/channel/cq exist
 
   std::thread cm_thread_;
   std::vector<std::thread> pollers_;
@@ -0,0 +1,201 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "transport.hpp"
+#include "protocol_session.hpp"
+#include "../util/config.hpp"
+#include "../cache/lru_cache.hpp"
+
+// Shared-memory stand-in for the RDMA fast path, for clients on the same host.
+//
+// A client connects to a Unix socket; the server answers with a memfd holding two
+// single-producer/single-consumer rings (requests, responses) plus two eventfds used
+// as doorbells, all passed with SCM_RIGHTS. The same fast-path protocol runs over the
+// rings, so protocol, chunking and flow control are exercised without RDMA hardware.
+namespace rdma_fast {
+namespace shm {
+
+struct RingHeader {
+  alignas(64) std::atomic<uint64_t> head;        // consumer position
+  alignas(64) std::atomic<uint64_t> tail;        // producer position
+  alignas(64) std::atomic<uint32_t> consumer_waiting;
+  std::atomic<uint32_t> producer_waiting;
+  uint64_t capacity;                             // data bytes, power of two
+};
+
+// One side's view of a ring living in shared memory. Records are
+// {uint32 len, uint32 reserved, payload} padded to 8 bytes; a len of
+// kWrap marks the unused tail of the buffer.
+//
+// The peer can write anything into the mapping, so each side keeps its own
+// capacity and its own position (head for the consumer, tail for the producer) and
+// only publishes them to the header. Everything read from the peer is checked
+// before use: a record that is too long, claims more than was published, or runs
+// past the end of the buffer marks the ring corrupt and is never handed out.
+class Ring {
+public:
+  static constexpr uint32_t kWrap = 0xFFFFFFFFu;
+
+  Ring() = default;
+  Ring(void* base, uint64_t capacity);
+
+  static std::size_t footprint(uint64_t capacity);
+  void init(uint64_t capacity); // creator only
+
+  std::size_t max_message() const { return static_cast<std::size_t>(cap_ / 4); }
+
+  // Producer
+  bool try_write(const ConstBuf* bufs, std::size_t count);
+
+  // Consumer: the message stays valid until pop(). False when there is none, or
+  // when the peer broke the ring (see corrupt()).
+  bool peek(const char*& data, std::size_t& len);
+  void pop();
+  bool empty() const;
+  bool corrupt() const { return corrupt_; }
+
+  RingHeader* header() const { return hdr_; }
+
+private:
+  RingHeader* hdr_ = nullptr;
+  char* data_ = nullptr;
+  uint64_t cap_ = 0;
+  uint64_t mask_ = 0;
+  uint64_t head_ = 0;      // consumer position; only ever stored to the header
+  uint64_t tail_ = 0;      // producer position; likewise
+  std::size_t peeked_ = 0; // bytes consumed by pop()
+  bool corrupt_ = false;
+};
+
+struct Hello {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t ring_capacity;
+};
+constexpr uint32_t kHelloMagic = 0x53484d31; // "SHM1"
+
+// Wakes whoever sleeps on `efd` if the peer advertised it is waiting.
+void notify_if_waiting(std::atomic<uint32_t>& waiting, int efd);
+
+// Advertise that we are about to sleep, then re-check `ready` so a peer that
+// published just before the flag was visible is not missed.
+template <typename Ready>
+inline bool arm_wait(std::atomic<uint32_t>& waiting, Ready ready) {
+  waiting.store(1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (ready()) {
+    waiting.store(0, std::memory_order_relaxed);
+    return false;
+  }
+  return true;
+}
+
+void drain_eventfd(int efd);
+uint64_t ring_capacity_for(int kb);
+
+} // namespace shm
+
+// Server side of one shared-memory client.
+class ShmConnection : public Transport {
+public:
+  ShmConnection(int sock, int memfd, void* base, std::size_t map_len, uint64_t ring_capacity,
+                int server_efd, int client_efd,
+                const Config& cfg, std::shared_ptr<LRUCache> cache, std::shared_ptr<const DocImage> image);
+  ~ShmConnection() override;
+
+  // Drains requests and flushes deferred output; true if any request was handled
+  bool service();
+  // The client wrote a malformed request ring; the connection must be dropped
+  bool broken() const { return req_.corrupt(); }
+
+  int sock() const { return sock_; }
+  int server_efd() const { return server_efd_; }
+
+  std::size_t max_message() const override { return resp_.max_message(); }
+  SendStatus try_send(const ConstBuf* bufs, std::size_t count) override;
+
+private:
+  int sock_;
+  int memfd_;
+  void* base_;
+  std::size_t map_len_;
+  int server_efd_;
+  int client_efd_;
+  shm::Ring req_;
+  shm::Ring resp_;
+  ProtocolSession session_;
+};
+
+class ShmServer {
+public:
+  ShmServer(const Config& cfg, std::shared_ptr<LRUCache> cache, std::shared_ptr<const DocImage> image = {});
+  ~ShmServer();
+
+  // Throws std::runtime_error if another server answers on the socket path, unless
+  // `take_over` (a handoff successor replacing its predecessor's socket)
+  void start(bool take_over = false);
+  // Removes the socket path only if it is still the one this server bound
+  void stop();
+
+private:
+  void loop_();
+  void accept_();
+  void drop_(int sock);
+  void drop_broken_(const std::shared_ptr<ShmConnection>& conn);
+
+  Config cfg_;
+  std::shared_ptr<LRUCache> cache_;
+  std::shared_ptr<const DocImage> image_;
+  uint64_t ring_capacity_ = 0;
+
+  std::atomic<bool> running_{false};
+  int listen_fd_ = -1;
+  uint64_t bound_dev_ = 0;
+  uint64_t bound_ino_ = 0;
+  int epoll_fd_ = -1;
+  int stop_efd_ = -1;
+  std::thread thread_;
+
+  // Keyed by both the client socket and the server doorbell fd
+  std::unordered_map<int, std::shared_ptr<ShmConnection>> conns_;
+};
+
+// Client end, used by co-located sidecars and the benchmark harness.
+class ShmClient {
+public:
+  ShmClient() = default;
+  ~ShmClient();
+  ShmClient(const ShmClient&) = delete;
+  ShmClient& operator=(const ShmClient&) = delete;
+
+  bool connect(const std::string& socket_path);
+  void close();
+
+  std::size_t max_message() const { return req_.max_message(); }
+
+  // Blocks while the request ring is full
+  bool send(const void* data, std::size_t n);
+  // Next response message; false on timeout or disconnect
+  bool recv(std::vector<uint8_t>& out, int timeout_ms = -1);
+
+private:
+  bool wait_(int timeout_ms);
+
+  int sock_ = -1;
+  int memfd_ = -1;
+  void* base_ = nullptr;
+  std::size_t map_len_ = 0;
+  int server_efd_ = -1;
+  int client_efd_ = -1;
+  shm::Ring req_;
+  shm::Ring resp_;
+};
+
+} // namespace rdma_fast
@@ -0,0 +1,32 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace rdma_fast {
+
+struct ConstBuf {
+  const void* data = nullptr;
+  std::size_t size = 0;
+};
+
+enum class SendStatus {
+  Ok,
+  WouldBlock, // no send credit; ProtocolSession::on_writable() follows once there is
+  Closed,
+};
+
+// Reliable, ordered, message-oriented channel that carries the fast-path protocol.
+// Implemented by the RDMA Connection (SEND/RECV on an RC QP) and by the shared-memory
+// ring transport for same-host clients.
+class Transport {
+public:
+  virtual ~Transport() = default;
+
+  // Largest payload a single message may carry.
+  virtual std::size_t max_message() const = 0;
+
+  // Gathers `bufs` into one message. The bytes are copied before returning.
+  virtual SendStatus try_send(const ConstBuf* bufs, std::size_t count) = 0;
+};
+
+} // namespace rdma_fast
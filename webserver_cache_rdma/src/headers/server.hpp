@@ -1,24 +1,71 @@
 #pragma once
 #include <boost/asio.hpp>
+#include <chrono>
+#include <functional>
 #include <memory>
 #include <string>
 
 #include "util/config.hpp"
+#include "util/load_monitor.hpp"
+#include "util/timer_wheel.hpp"
+#include "util/send_scheduler.hpp"
+#include "util/logging.hpp"
+#include "session_pool.hpp"
 #include "cache/lru_cache.hpp"
+#include "fs/doc_image.hpp"
+#include "tls/tls.hpp"
 
 class Server {
 public:
-  Server(boost::asio::io_context& ioc, const Config& cfg, std::shared_ptr<LRUCache> cache);
+  // With `image`, files are served from it instead of the cache and doc_root.
+  // `listen_fd` / `tls_listen_fd` >= 0 adopt listening sockets inherited from a
+  // predecessor instead of binding the ports. With `tls_port` set, the TLS context is
+  // loaded here; throws std::runtime_error on any setup failure. With --numa every
+  // node runs its own Server, and the listeners bind with SO_REUSEPORT to share the
+  // ports.
+  Server(boost::asio::io_context& ioc, std::shared_ptr<const Config> cfg, std::shared_ptr<LRUCache> cache,
+         std::shared_ptr<const DocImage> image = {}, int listen_fd = -1, int tls_listen_fd = -1);
   void start();
 
+  // Stops accepting, lets sessions finish with `Connection: close`, and calls `done`
+  // once none are left or `timeout` has passed
+  void drain(std::chrono::milliseconds timeout, std::function<void()> done);
+  int listen_handle() { return http_.acceptor.native_handle(); }
+  int tls_listen_handle() { return https_ ? https_->acceptor.native_handle() : -1; }
+
   std::shared_ptr<LRUCache> cache() const { return cache_; }
-  const Config& config() const { return cfg_; }
+  const Config& config() const { return *cfg_; }
+  unsigned short port() const { return http_.acceptor.local_endpoint().port(); }
+  unsigned short tls_port() const { return https_ ? https_->acceptor.local_endpoint().port() : 0; }
 
 private:
-  void do_accept();
+  struct Listener {
+    explicit Listener(boost::asio::io_context& ioc) : acceptor(ioc) {}
+    boost::asio::ip::tcp::acceptor acceptor;
+    bool tls = false;
+    bool accepting = false;
+  };
+
+  static void open_listener(Listener& l, unsigned short port, int inherited_fd, bool reuse_port);
+  void do_accept(Listener& l);
+  bool should_pause_accept() const;
+  void on_monitor_tick();
+  void check_drained(std::chrono::steady_clock::time_point deadline, std::function<void()> done);
 
   boost::asio::io_context& ioc_;
-  boost::asio::ip::tcp::acceptor acceptor_;
-  Config cfg_;
+  Listener http_;
+  std::unique_ptr<Listener> https_;     // with --tls.port
+  std::shared_ptr<const Config> cfg_;   // shared, read-only, with every session
   std::shared_ptr<LRUCache> cache_;
-};
\ No newline at end of file
+  std::shared_ptr<const DocImage> image_;
+  std::unique_ptr<tls::Context> tls_;
+
+  // Accepting, pausing and resuming all happen on the monitor's strand
+  std::shared_ptr<LoadMonitor> monitor_;
+  std::shared_ptr<TimerWheel> wheel_;   // read/write/idle deadlines of all sessions
+  std::shared_ptr<SendScheduler> sched_; // turns for large bodies
+  std::shared_ptr<SessionPool> sessions_;
+  bool draining_ = false;
+  LogSampler accept_log_;
+  boost::asio::steady_timer drain_timer_;
+};
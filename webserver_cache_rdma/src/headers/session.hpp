@@ -1,57 +1,168 @@
 #pragma once
 #include <boost/asio.hpp>
+#include <array>
+#include <cstddef>
 #include <memory>
+#include <memory_resource>
 #include <vector>
 #include <string>
-#include <deque>
 
 #include "util/config.hpp"
+#include "util/handler_alloc.hpp"
+#include "util/head_arena.hpp"
+#include "util/load_monitor.hpp"
+#include "util/read_buffer.hpp"
+#include "util/timer_wheel.hpp"
+#include "util/send_scheduler.hpp"
+#include "util/tracing.hpp"
 #include "cache/lru_cache.hpp"
+#include "fs/doc_image.hpp"
 #include "http/request.hpp"
 #include "http/response.hpp"
 #include "http/parser.hpp"
+#include "tls/tls.hpp"
 
+class SessionPool;
+
+// Sockets are bound to their strand by type: with the type-erased any_io_executor,
+// every operation would box a copy of the strand on the heap.
+using SessionStrand = boost::asio::strand<boost::asio::io_context::executor_type>;
+using SessionSocket = boost::asio::basic_stream_socket<boost::asio::ip::tcp, SessionStrand>;
+
+// One HTTP/1.1 connection. Sessions are created and recycled by a SessionPool; the
+// per-request scratch (handler memory, the read buffer, the response head) is kept
+// or pooled, so a keep-alive request served from cache does not need the heap.
 class Session : public std::enable_shared_from_this<Session> {
 public:
-  Session(boost::asio::ip::tcp::socket socket, const Config& cfg, std::shared_ptr<LRUCache> cache);
+  Session(SessionSocket socket, std::shared_ptr<const Config> cfg,
+          std::shared_ptr<LRUCache> cache, std::shared_ptr<const DocImage> image,
+          std::shared_ptr<const LoadMonitor> monitor,
+          std::shared_ptr<TimerWheel> wheel, std::shared_ptr<SendScheduler> sched);
+  ~Session();
   void start();
+  // Runs the TLS handshake first; requests and responses then go over TLS
+  void start_tls(const tls::Context& ctx);
 
 private:
+  friend class SessionPool;
+
+  // Takes a new connection; only valid on a recycled session
+  void reuse(SessionSocket socket);
+  // Drops all per-connection state once the last reference is gone
+  void recycle();
+
   void start_read();
   void on_read(boost::system::error_code ec, std::size_t n);
 
+  // Reads are a non-blocking read into the pooled buffer, tried right away; when
+  // the socket has nothing, the buffer goes back to the pool (unless it holds part
+  // of a head) and the session waits for readability holding no buffer
+  void read_socket();
+  // Makes room after the unparsed bytes: a block from the pool, or a bigger buffer
+  // for a head that has filled its block
+  void reserve_input();
+  // Drops the first `n` unparsed bytes, returning the buffer once it is empty
+  void consume_input(std::size_t n);
+
+  // TLS steps: each retries itself once the socket is ready for what OpenSSL asked
+  // for. Reads always go through OpenSSL (a plain recvmsg once the kernel holds the
+  // receive keys); writes only when the kernel does not encrypt them.
+  void tls_handshake();
+  void tls_read();
+  void tls_write(bool keep_alive);
+
+  // Hands the connection to an H2Session: on the prior-knowledge preface, or once
+  // the 101 for an h2c upgrade has been written
+  void switch_to_h2();
+  bool try_h2c_upgrade(const HttpRequest& req);
+
   void handle_next_in_queue();
   void handle_request_and_respond(const HttpRequest& req);
-  void respond_with_error(int status, const std::string& message, bool keep_alive);
+  void respond_with_error(int status, std::string_view message, bool keep_alive);
+  void respond_shed(bool keep_alive);
 
-  void write_response(std::unique_ptr<std::string> head,
-                      std::shared_ptr<const std::vector<uint8_t>> body,
-                      bool keep_alive);
+  // Starts a new response head, replacing the previous one
+  std::pmr::string& begin_head(int status);
+  // Same, without the status line, for a head serialized elsewhere
+  std::pmr::string& begin_raw(int status);
+  void write_response(ObjectPtr body, bool keep_alive);
+  void on_write(bool keep_alive, boost::system::error_code ec);
 
-  void on_write(std::unique_ptr<std::string> head,
-                std::shared_ptr<const std::vector<uint8_t>> body,
-                bool keep_alive,
-                boost::system::error_code ec,
-                std::size_t n);
+  // Bodies over one slice go out in scheduler turns: each turn is one non-blocking
+  // write of at most a slice, and a full socket waits for writability before the
+  // next turn is asked for
+  void wait_writable();
+  static void on_turn(const std::shared_ptr<void>& owner, std::size_t budget);
+  void write_turn(std::size_t budget);
 
-  void arm_idle_timer();
-  void cancel_timers();
+  enum class Deadline { Read, Write, Idle };
+  void set_deadline(Deadline kind);
+  static void on_deadline(const std::shared_ptr<void>& owner, uint64_t generation);
   void close();
 
-  boost::asio::ip::tcp::socket socket_;
-  Config cfg_;
+  SessionSocket socket_;
+  std::shared_ptr<const Config> cfg_;
   std::shared_ptr<LRUCache> cache_;
+  std::shared_ptr<const DocImage> image_;
+  std::shared_ptr<const LoadMonitor> monitor_;
+  std::shared_ptr<TimerWheel> wheel_;
+  std::shared_ptr<SendScheduler> sched_;
 
-  std::vector<char> inbuf_;
+  ReadBuffer rbuf_;
+  std::size_t rlen_ = 0;            // unparsed bytes at the front of rbuf_
   HttpParser parser_;
 
-  std::deque<HttpRequest> pending_;
+  // Parsed requests waiting for their turn. Slots are kept once used (a deque frees
+  // and allocates a node per request this size), so queueing does not allocate once a
+  // connection has seen as many pipelined requests as it ever holds.
+  struct PendingQueue {
+    std::vector<HttpRequest> items;
+    std::size_t head = 0;
+
+    bool empty() const { return head == items.size(); }
+    HttpRequest& front() { return items[head]; }
+    void pop_front() { ++head; }
+    void clear() { items.clear(); head = 0; }
+    void push_back(HttpRequest&& req) {
+      if (empty()) clear();
+      items.push_back(std::move(req));
+    }
+  };
+  PendingQueue pending_;
+  bool reading_ = false;
   bool writing_ = false;
   bool closing_after_ = false;
+  bool bad_request_ = false;        // a 400 is owed once the in-flight write is done
+
+  struct H2Upgrade {
+    HttpRequest request;
+    std::string settings;           // decoded HTTP2-Settings payload
+  };
+  std::unique_ptr<H2Upgrade> h2_upgrade_; // set while the 101 is being written
+
+  // At most one read and one write are outstanding, each with its own block
+  HandlerMemory read_mem_;
+  HandlerMemory write_mem_;
+
+  // The response being written: head (and any small generated body) in a pooled
+  // block held until the write completes, file body shared with the cache
+  HeadArena head_;
+  ObjectPtr body_;
+
+  std::unique_ptr<tls::Connection> tls_;
+  std::array<boost::asio::const_buffer, 2> tls_out_;  // what tls_write() has left to send
+
+  // A response sent in turns: bytes of head and body written so far
+  SendScheduler::Node turn_;
+  std::size_t sent_ = 0;
+  bool turn_keep_alive_ = false;
+
+  // Stage timing of the current request, when it is sampled
+  tracing::Span span_;
+  uint64_t read_at_ = 0;            // when a sampled read completed; 0 = none pending
 
-  boost::asio::steady_timer read_timer_;
-  boost::asio::steady_timer write_timer_;
-  boost::asio::steady_timer idle_timer_;
+  TimerWheel::Node deadline_;
+  Deadline deadline_kind_ = Deadline::Read;
 
   bool closed_ = false;
-};
\ No newline at end of file
+};
@@ -0,0 +1,42 @@
+#pragma once
+#include <boost/asio.hpp>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "session.hpp"
+#include "util/config.hpp"
+#include "util/load_monitor.hpp"
+#include "util/timer_wheel.hpp"
+#include "util/send_scheduler.hpp"
+#include "cache/lru_cache.hpp"
+#include "fs/doc_image.hpp"
+
+// Keeps closed sessions, with their buffers and handler memory, for the next
+// connection. acquire() hands out a shared_ptr whose deleter puts the session back
+// (up to `max_idle` are kept; the rest are freed).
+class SessionPool : public std::enable_shared_from_this<SessionPool> {
+public:
+  SessionPool(std::shared_ptr<const Config> cfg, std::shared_ptr<LRUCache> cache,
+              std::shared_ptr<const DocImage> image, std::shared_ptr<const LoadMonitor> monitor, std::shared_ptr<TimerWheel> wheel,
+              std::shared_ptr<SendScheduler> sched, std::size_t max_idle);
+  ~SessionPool();
+
+  std::shared_ptr<Session> acquire(SessionSocket socket);
+
+  std::size_t idle() const;
+
+private:
+  void release(Session* s);
+
+  std::shared_ptr<const Config> cfg_;
+  std::shared_ptr<LRUCache> cache_;
+  std::shared_ptr<const DocImage> image_;
+  std::shared_ptr<const LoadMonitor> monitor_;
+  std::shared_ptr<TimerWheel> wheel_;
+  std::shared_ptr<SendScheduler> sched_;
+  std::size_t max_idle_;
+
+  mutable std::mutex mtx_;
+  std::vector<Session*> idle_;
+};
@@ -1,14 +1,23 @@
 #pragma once
 #include <boost/asio.hpp>
+#include <functional>
 
 class SignalHandler {
 public:
   explicit SignalHandler(boost::asio::io_context& ioc);
   void register_signals();
 
+  // SIGHUP runs `fn` instead of being ignored
+  void on_reload(std::function<void()> fn) { reload_ = std::move(fn); }
+
+  // SIGINT/SIGTERM also run `fn`, for io_contexts other than the one given here
+  void on_shutdown(std::function<void()> fn) { shutdown_ = std::move(fn); }
+
 private:
   void on_signal(const boost::system::error_code& ec, int signo);
 
   boost::asio::io_context& ioc_;
   boost::asio::signal_set signals_;
+  std::function<void()> reload_;
+  std::function<void()> shutdown_;
 };
\ No newline at end of file
@@ -0,0 +1,76 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+// Built-in TLS for the HTTP listener (effective if compiled with ENABLE_TLS).
+//
+// OpenSSL runs the handshake in userspace directly on the session's descriptor.
+// With kTLS enabled it then installs the traffic keys on the socket (TCP_ULP "tls"),
+// after which the kernel frames and encrypts records: the session writes response
+// heads and cached bodies to the socket exactly as over plaintext, without an
+// encryption copy in userspace. Directions the kernel or OpenSSL cannot offload
+// (e.g. TLS 1.3 receive on OpenSSL 3.0, or no tls module) go through SSL_read /
+// SSL_write instead.
+
+struct ssl_ctx_st;
+struct ssl_st;
+
+namespace tls {
+
+// Certificate, key and protocol settings shared by all TLS connections
+class Context {
+public:
+  // Throws std::runtime_error if the certificate or key cannot be loaded, or when
+  // built without ENABLE_TLS
+  Context(const std::string& cert_file, const std::string& key_file, bool ktls);
+  ~Context();
+
+  Context(const Context&) = delete;
+  Context& operator=(const Context&) = delete;
+
+  ssl_ctx_st* native() const { return ctx_; }
+  bool ktls() const { return ktls_; }
+
+private:
+  ssl_ctx_st* ctx_ = nullptr;
+  bool ktls_ = false;
+};
+
+// Outcome of one non-blocking step; WantRead / WantWrite mean "wait for the socket
+// and call again with the same arguments"
+enum class Status { Done, WantRead, WantWrite, Closed, Error };
+
+// The TLS state of one connection over a non-blocking socket it does not own
+class Connection {
+public:
+  Connection(const Context& ctx, int fd);
+  ~Connection();
+
+  Connection(const Connection&) = delete;
+  Connection& operator=(const Connection&) = delete;
+
+  Status handshake();
+  Status read(void* buf, std::size_t cap, std::size_t& n);
+  Status write(const void* buf, std::size_t len, std::size_t& n);
+
+  // Decrypted or undecoded bytes OpenSSL holds that the socket will not signal
+  bool has_pending() const;
+
+  // Whether the kernel took over sending / receiving records after the handshake
+  bool ktls_send() const;
+  bool ktls_recv() const;
+
+  // Sends close_notify if the socket takes it right away; never waits
+  void shutdown();
+
+  // Text of the last failure, for logging
+  const std::string& error() const { return error_; }
+
+private:
+  Status status_of(int ret);
+
+  ssl_st* ssl_ = nullptr;
+  std::string error_;
+};
+
+} // namespace tls
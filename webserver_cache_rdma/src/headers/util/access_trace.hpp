@@ -0,0 +1,87 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Binary access trace for sizing the cache offline (--trace.path, replayed by
+// cache_sim). Each cache lookup appends one fixed-size record to the calling thread's
+// single-producer ring; a background thread drains the rings into the file. As with
+// the logger, recording takes no lock, makes no syscall and never allocates; a full
+// ring drops the record and counts it in trace_dropped.
+//
+// With --trace.sample N only keys whose hash falls in 1/N of the hash space are
+// recorded (spatial sampling): every access to a sampled key is kept, so replaying
+// at cache size S/N estimates the miss ratio at size S.
+namespace access_trace {
+
+constexpr char kMagic[8] = {'W', 'S', 'T', 'R', 'A', 'C', 'E', '1'};
+constexpr uint32_t kVersion = 1;
+
+enum class Source : uint8_t { Http = 0, H2 = 1, FastPath = 2 };
+
+// File: one FileHeader, then Records until the end (native byte order)
+struct FileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t record_size;
+  uint32_t sample;          // 1 in `sample` of the key space was recorded
+  uint32_t reserved;
+  int64_t start_ns;         // wall clock of the first record's time base
+};
+static_assert(sizeof(FileHeader) == 32, "access_trace::FileHeader is part of the file format");
+
+struct Record {
+  uint64_t ts_ns;           // since FileHeader::start_ns
+  uint64_t key;             // key_hash() of the cache key
+  uint32_t size;            // body bytes, saturated at 4 GiB - 1
+  uint8_t hit;              // 1 if the memory cache served it
+  uint8_t source;           // Source
+  uint16_t reserved;
+};
+static_assert(sizeof(Record) == 24, "access_trace::Record is part of the file format");
+
+struct Options {
+  std::string path;
+  uint32_t sample = 1;
+  std::size_t ring_records = 65536;   // per thread, rounded up to a power of two
+  int flush_interval_ms = 50;
+};
+
+// Opens (truncates) the trace file and starts the writer; throws std::runtime_error
+void init(const Options& opt);
+
+// Drains all rings, closes the file and stops the writer (idempotent)
+void shutdown();
+
+// 64-bit FNV-1a with a final mix, so that sampling can use any bits
+inline uint64_t key_hash(std::string_view key) {
+  uint64_t h = 14695981039346656037ull;
+  for (char c : key) {
+    h ^= static_cast<uint8_t>(c);
+    h *= 1099511628211ull;
+  }
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdull;
+  h ^= h >> 33;
+  return h;
+}
+
+namespace detail {
+extern std::atomic<uint32_t> g_sample;   // 0 = not recording
+void append(uint64_t key, uint64_t size, bool hit, Source source);
+} // namespace detail
+
+inline bool enabled() {
+  return detail::g_sample.load(std::memory_order_relaxed) != 0;
+}
+
+inline void record(std::string_view key, uint64_t size, bool hit, Source source) {
+  const uint32_t sample = detail::g_sample.load(std::memory_order_relaxed);
+  if (sample == 0) return;
+  const uint64_t h = key_hash(key);
+  if (sample > 1 && (h >> 32) % sample != 0) return;
+  detail::append(h, size, hit, source);
+}
+
+} // namespace access_trace
@@ -1,14 +1,28 @@
 #pragma once
 #include <string>
 #include <cstdint>
+#include <vector>
 
 struct Config {
   unsigned short port = 8080;
   unsigned threads = 0; // 0 -> hardware_concurrency
+  bool numa = false;    // one server, thread group and cache shard per NUMA node
   std::string doc_root = "./public";
+  std::string image_path;             // packed doc_root from docpack; replaces doc_root when set
 
   // Cache
   unsigned cache_mem_mb = 128;
+  unsigned cache_small_mb = 0;        // small-object tier budget; 0 = 1/8 of cache_mem_mb
+  unsigned cache_small_max_kb = 16;   // objects up to this size go to the small tier
+  std::vector<std::string> cache_pin; // URL paths loaded at startup and never evicted
+  unsigned cache_revalidate_ms = 0;   // hits older than this re-stat the file in the background; 0 = never
+  unsigned cache_negative_ms = 1000;  // how long a target that mapped to no file is answered from memory; 0 = off
+  unsigned cache_negative_max = 65536;  // such targets remembered per cache
+
+  // L2 disk cache for objects evicted from memory
+  std::string l2_path;                // empty = off
+  unsigned l2_capacity_mb = 1024;
+  unsigned l2_write_mb_s = 64;        // demotion write budget; 0 = unlimited
 
   // Limits
   std::size_t max_request_line = 8192;
@@ -18,18 +32,69 @@ struct Config {
   int read_timeout_ms = 5000;
   int write_timeout_ms = 5000;
   int keepalive_timeout_ms = 10000;
+  int timer_tick_ms = 100;            // timeout granularity of the session timer wheel
+
+  // Overload protection
+  int max_connections = 10000;        // accept pauses at this many open sessions; 0 = no limit
+  int accept_lag_ms = 50;             // accept pauses while event-loop lag exceeds this; 0 = off
+  int shed_latency_ms = 0;            // answer 503 while event-loop lag exceeds this; 0 = off
+  int session_pool = 1024;            // closed sessions kept for reuse
+
+  // Fair sending of large bodies (SendScheduler)
+  unsigned sched_slice_kb = 64;       // bytes per turn; bigger responses are sent in turns; 0 = off
+  unsigned sched_slots = 0;           // turns running at once; 0 = half the worker threads, at least 1
+  std::vector<std::string> sched_classes;  // "PREFIX=WEIGHT"
+
+  // HTTP/2 (h2c: prior knowledge or Upgrade)
+  bool http2_enable = true;
+  int http2_max_streams = 100;        // concurrent streams per connection
+
+  // TLS listener (effective if compiled with ENABLE_TLS)
+  unsigned short tls_port = 0;        // 0 = off
+  std::string tls_cert;               // PEM certificate chain
+  std::string tls_key;                // PEM private key
+  bool tls_ktls = true;               // hand the record layer to the kernel after the handshake
+
+  // Zero-downtime reload: listener and hot cache handed to a successor process
+  std::string handoff_path;           // Unix socket; empty = off
+  unsigned handoff_cache_mb = 256;    // cache contents streamed to the successor
+  int handoff_drain_ms = 30000;       // how long the old process waits for sessions to finish
+
+  // Logging
+  std::string log_level = "info";     // debug | info | warn | error
+  std::string log_format = "text";    // text | json
+  int log_accept_every = 1000;        // log one accepted connection in N
+
+  // Access trace for offline cache sizing (cache_sim)
+  std::string trace_path;             // empty = off
+  unsigned trace_sample = 1;          // record 1 in N of the key space
+
+  // Per-request stage timing, served at /debug/traces
+  unsigned tracing_sample = 0;        // trace 1 in N HTTP/1.1 requests; 0 = off
+  unsigned tracing_slow_us = 1000;    // keep spans at least this long
+  unsigned tracing_ring = 128;        // slow spans kept per I/O thread
 
   // RDMA (effective if compiled with ENABLE_RDMA)
   bool rdma_enable = false;
   std::string rdma_bind = "0.0.0.0";
   unsigned short rdma_port = 7471;
   int rdma_pollers = 1;
+  int rdma_poll_batch = 32;           // work completions per ibv_poll_cq
+  int rdma_busy_poll_us = 50;         // spin after activity before sleeping on the channel
 
   // RDMA protocol/tuning
   int rdma_recv_bufs_per_conn = 64;
   int rdma_recv_buf_size = 4096;      // bytes per posted RECV
   int rdma_send_chunk = 32768;        // bytes per SEND chunk of body
   int rdma_max_outstanding_sends = 64;
+  int rdma_max_batch = 256;           // paths per MGET request
+
+  // Shared-memory transport for same-host clients (same protocol as RDMA)
+  bool shm_enable = false;
+  std::string shm_path = "/tmp/webserver-shm.sock";
+  int shm_ring_kb = 1024;             // per direction, rounded up to a power of two
+  int shm_busy_poll_us = 50;
+  unsigned shm_mode = 0600;           // permissions of the socket path; anyone who can connect can send requests
 };
 
 Config parse_args(int argc, char** argv);
\ No newline at end of file
@@ -0,0 +1,91 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+
+// Recycled storage for the completion handlers of one kind of operation (a session's
+// reads, or its writes). Asio asks the handler's associated allocator for the memory
+// of each pending operation; with only one such operation outstanding at a time, one
+// block covers it and nothing reaches the heap once the block exists. The block is
+// allocated on first use and sized to the largest operation seen so far, so a
+// connection holds only what its own operations need. Requests over kMaxBlock, or
+// that arrive while the block is taken, fall back to operator new.
+class HandlerMemory {
+public:
+  static constexpr std::size_t kMaxBlock = 512;
+
+  HandlerMemory() = default;
+  ~HandlerMemory() { ::operator delete(block_); }
+  HandlerMemory(const HandlerMemory&) = delete;
+  HandlerMemory& operator=(const HandlerMemory&) = delete;
+
+  void* allocate(std::size_t size) {
+    if (in_use_ || size > kMaxBlock) return ::operator new(size);
+    if (size > capacity_) {
+      ::operator delete(block_);
+      capacity_ = (size + 63) / 64 * 64;
+      block_ = ::operator new(capacity_);
+    }
+    in_use_ = true;
+    return block_;
+  }
+
+  void deallocate(void* p) {
+    if (p == block_) {
+      in_use_ = false;
+      return;
+    }
+    ::operator delete(p);
+  }
+
+private:
+  void* block_ = nullptr;
+  std::size_t capacity_ = 0;
+  bool in_use_ = false;
+};
+
+template <typename T>
+class HandlerAllocator {
+public:
+  using value_type = T;
+
+  explicit HandlerAllocator(HandlerMemory& mem) : mem_(&mem) {}
+  template <typename U>
+  HandlerAllocator(const HandlerAllocator<U>& other) noexcept : mem_(other.mem_) {}
+
+  T* allocate(std::size_t n) const { return static_cast<T*>(mem_->allocate(sizeof(T) * n)); }
+  void deallocate(T* p, std::size_t) const { mem_->deallocate(p); }
+
+  bool operator==(const HandlerAllocator& o) const noexcept { return mem_ == o.mem_; }
+  bool operator!=(const HandlerAllocator& o) const noexcept { return mem_ != o.mem_; }
+
+private:
+  template <typename> friend class HandlerAllocator;
+  HandlerMemory* mem_;
+};
+
+// Wraps a handler so asio's associated_allocator finds the HandlerMemory
+template <typename Handler>
+class CustomAllocHandler {
+public:
+  using allocator_type = HandlerAllocator<Handler>;
+
+  CustomAllocHandler(HandlerMemory& mem, Handler h) : mem_(mem), handler_(std::move(h)) {}
+
+  allocator_type get_allocator() const noexcept { return allocator_type(mem_); }
+
+  template <typename... Args>
+  void operator()(Args&&... args) {
+    handler_(std::forward<Args>(args)...);
+  }
+
+private:
+  HandlerMemory& mem_;
+  Handler handler_;
+};
+
+template <typename Handler>
+inline CustomAllocHandler<std::decay_t<Handler>> make_custom_alloc_handler(HandlerMemory& mem, Handler&& h) {
+  return CustomAllocHandler<std::decay_t<Handler>>(mem, std::forward<Handler>(h));
+}
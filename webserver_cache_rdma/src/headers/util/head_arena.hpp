@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+#include <memory_resource>
+#include <string>
+
+// The head of the response being written, built in a block from the read buffer
+// pool. The block is taken when a head is started and given back once the response
+// is out, so a connection between responses holds only a pointer. The arena and the
+// string sit at the front of the block; a head that outgrows the rest of it goes on
+// to the heap.
+class HeadArena {
+public:
+  HeadArena() = default;
+  ~HeadArena() { reset(); }
+  HeadArena(const HeadArena&) = delete;
+  HeadArena& operator=(const HeadArena&) = delete;
+
+  // Starts an empty head with room for `reserve` bytes, replacing any previous one
+  std::pmr::string& begin(std::size_t reserve);
+  // Gives the block back
+  void reset();
+
+  explicit operator bool() const { return block_ != nullptr; }
+  std::pmr::string& operator*() const { return block_->head; }
+  std::pmr::string* operator->() const { return &block_->head; }
+
+private:
+  struct Block {
+    Block(void* buf, std::size_t size) : arena(buf, size), head(&arena) {}
+
+    std::pmr::monotonic_buffer_resource arena;
+    std::pmr::string head;
+  };
+  Block* block_ = nullptr;
+};
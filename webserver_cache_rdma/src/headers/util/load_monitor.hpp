@@ -0,0 +1,49 @@
+#pragma once
+#include <boost/asio.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+
+// Event-loop lag probe. A timer is due every `interval`; how late its handler runs is
+// how long a freshly queued handler waits for a worker thread, which tracks the depth
+// of the io_context queues. The lag is smoothed (EWMA, 1/8) and read lock-free by
+// sessions deciding whether to shed.
+class LoadMonitor {
+public:
+  LoadMonitor(boost::asio::io_context& ioc, std::chrono::milliseconds interval);
+
+  // `on_tick` runs on the monitor's strand after every sample
+  void start(std::function<void()> on_tick);
+  void stop();
+
+  int64_t lag_us() const { return lag_us_.load(std::memory_order_relaxed); }
+
+  // Shedding is on while the smoothed lag exceeds `target`; 0 disables it
+  void set_shed_target(std::chrono::milliseconds target) { shed_target_us_ = target.count() * 1000; }
+  bool shedding() const { return shed_target_us_ > 0 && lag_us() > shed_target_us_; }
+
+  // Set once a successor has taken over the listener; sessions stop keeping
+  // connections alive so the process can exit
+  void set_draining() { draining_.store(true, std::memory_order_relaxed); }
+  bool draining() const { return draining_.load(std::memory_order_relaxed); }
+
+  boost::asio::strand<boost::asio::io_context::executor_type>& strand() { return strand_; }
+
+private:
+  void arm();
+
+  using Strand = boost::asio::strand<boost::asio::io_context::executor_type>;
+  // Bound to the strand by type, so a tick does not box a copy of it on the heap
+  using Timer = boost::asio::basic_waitable_timer<std::chrono::steady_clock,
+    boost::asio::wait_traits<std::chrono::steady_clock>, Strand>;
+
+  Strand strand_;
+  Timer timer_;
+  std::chrono::milliseconds interval_;
+  std::function<void()> on_tick_;
+  std::atomic<int64_t> lag_us_{0};
+  int64_t shed_target_us_ = 0;
+  std::atomic<bool> draining_{false};
+  bool stopped_ = false;
+};
@@ -1,12 +1,99 @@
 #pragma once
 #include <fmt/core.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <utility>
 
-inline void log_info(const char* fmt, auto&&... args) {
-  fmt::print(fmt, std::forward<decltype(args)>(args)...);
+// Asynchronous logger. Each thread formats straight into a slot of its own
+// single-producer ring; a background flusher drains every ring and does the I/O.
+// Nothing on the logging path takes a lock or makes a syscall, and a full ring drops
+// the record (counted in log_dropped and /metrics) instead of waiting.
+
+enum class LogLevel : uint8_t { Debug, Info, Warn, Error };
+enum class LogFormat : uint8_t { Text, Json };
+
+struct LogOptions {
+  LogLevel level = LogLevel::Info;
+  LogFormat format = LogFormat::Text;
+  std::size_t ring_records = 4096;   // per thread, rounded up to a power of two
+  int flush_interval_ms = 10;
+};
+
+// Call once before the worker threads start; later calls only change the level.
+void log_init(const LogOptions& opt);
+
+// Drains all rings and stops the flusher (idempotent). Records logged afterwards
+// are dropped.
+void log_shutdown();
+
+uint64_t log_dropped();
+
+bool parse_log_level(const std::string& s, LogLevel& out);
+
+namespace logging_detail {
+
+constexpr std::size_t kMaxMessage = 232;
+
+struct Record {
+  uint64_t ts_ns;          // wall clock, ns since epoch
+  LogLevel level;
+  uint8_t pad;
+  uint16_t len;
+  uint32_t thread;
+  char text[kMaxMessage];
+};
+
+extern std::atomic<uint8_t> g_min_level;
+
+// The calling thread's next free slot, or nullptr when its ring is full
+Record* reserve();
+void commit(Record* r, LogLevel level);
+
+} // namespace logging_detail
+
+inline bool log_enabled(LogLevel level) {
+  return static_cast<uint8_t>(level) >= logging_detail::g_min_level.load(std::memory_order_relaxed);
+}
+
+// Messages are single lines without a level prefix or trailing newline; the
+// flusher adds those (or the JSON envelope). Longer messages are truncated.
+template <typename... Args>
+inline void log_at(LogLevel level, fmt::format_string<Args...> fmt, Args&&... args) {
+  if (!log_enabled(level)) return;
+  logging_detail::Record* r = logging_detail::reserve();
+  if (!r) return;
+  const auto res = fmt::format_to_n(r->text, logging_detail::kMaxMessage, fmt, std::forward<Args>(args)...);
+  r->len = static_cast<uint16_t>(std::min<std::size_t>(res.size, logging_detail::kMaxMessage));
+  logging_detail::commit(r, level);
+}
+
+template <typename... Args>
+inline void log_debug(fmt::format_string<Args...> fmt, Args&&... args) {
+  log_at(LogLevel::Debug, fmt, std::forward<Args>(args)...);
+}
+template <typename... Args>
+inline void log_info(fmt::format_string<Args...> fmt, Args&&... args) {
+  log_at(LogLevel::Info, fmt, std::forward<Args>(args)...);
+}
+template <typename... Args>
+inline void log_warn(fmt::format_string<Args...> fmt, Args&&... args) {
+  log_at(LogLevel::Warn, fmt, std::forward<Args>(args)...);
 }
-inline void log_warn(const char* fmt, auto&&... args) {
-  fmt::print(stderr, fmt, std::forward<decltype(args)>(args)...);
+template <typename... Args>
+inline void log_error(fmt::format_string<Args...> fmt, Args&&... args) {
+  log_at(LogLevel::Error, fmt, std::forward<Args>(args)...);
 }
-inline void log_error(const char* fmt, auto&&... args) {
-  fmt::print(stderr, fmt, std::forward<decltype(args)>(args)...);
-}
\ No newline at end of file
+
+// Lets one call in `every` through; for per-connection events on hot paths.
+class LogSampler {
+public:
+  explicit LogSampler(uint64_t every) : every_(every ? every : 1) {}
+  bool sample() { return n_.fetch_add(1, std::memory_order_relaxed) % every_ == 0; }
+  uint64_t every() const { return every_; }
+
+private:
+  uint64_t every_;
+  std::atomic<uint64_t> n_{0};
+};
@@ -1,5 +1,6 @@
 #pragma once
 #include <atomic>
+#include <cstddef>
 #include <string>
 
 struct Metrics {
@@ -11,11 +12,107 @@ struct Metrics {
   std::atomic<unsigned long long> cache_misses{0};
   std::atomic<unsigned long long> bytes_served{0};
 
+  // Cache tiers: byte and item gauges, hits and evictions per tier. *_bytes counts
+  // bodies, *_overhead_bytes the table, entries, keys and object headers around them;
+  // both count against *_capacity_bytes.
+  std::atomic<unsigned long long> cache_small_bytes{0};
+  std::atomic<unsigned long long> cache_small_overhead_bytes{0};
+  std::atomic<unsigned long long> cache_small_capacity_bytes{0};
+  std::atomic<unsigned long long> cache_small_items{0};
+  std::atomic<unsigned long long> cache_small_hits{0};
+  std::atomic<unsigned long long> cache_small_evictions{0};
+  std::atomic<unsigned long long> cache_large_bytes{0};
+  std::atomic<unsigned long long> cache_large_overhead_bytes{0};
+  std::atomic<unsigned long long> cache_large_capacity_bytes{0};
+  std::atomic<unsigned long long> cache_large_items{0};
+  std::atomic<unsigned long long> cache_large_hits{0};
+  std::atomic<unsigned long long> cache_large_evictions{0};
+  std::atomic<unsigned long long> cache_pinned_bytes{0};
+  std::atomic<unsigned long long> cache_pinned_overhead_bytes{0};
+  std::atomic<unsigned long long> cache_pinned_items{0};
+  std::atomic<unsigned long long> cache_pinned_hits{0};
+
+  // L2 disk cache: demotions written, dropped (write budget or full queue),
+  // objects lost with dropped segments
+  std::atomic<unsigned long long> cache_l2_bytes{0};
+  std::atomic<unsigned long long> cache_l2_capacity_bytes{0};
+  std::atomic<unsigned long long> cache_l2_items{0};
+  std::atomic<unsigned long long> cache_l2_hits{0};
+  std::atomic<unsigned long long> cache_l2_demotions{0};
+  std::atomic<unsigned long long> cache_l2_dropped{0};
+  std::atomic<unsigned long long> cache_l2_bytes_written{0};
+  std::atomic<unsigned long long> cache_l2_evictions{0};
+  std::atomic<unsigned long long> cache_l2_read_errors{0};
+  std::atomic<unsigned long long> cache_revalidations{0};
+  std::atomic<unsigned long long> cache_revalidation_reloads{0};
+  std::atomic<unsigned long long> cache_revalidation_removals{0};
+  std::atomic<unsigned long long> cache_revalidations_dropped{0};
+  std::atomic<unsigned long long> cache_negative_hits{0};
+  std::atomic<unsigned long long> cache_negative_items{0};
+  std::atomic<unsigned long long> numa_nodes{0};
+  std::atomic<unsigned long long> numa_hits_local{0};
+  std::atomic<unsigned long long> numa_hits_remote{0};
+  std::atomic<unsigned long long> sched_bulk_responses{0};
+  std::atomic<unsigned long long> sched_turns{0};
+  std::atomic<unsigned long long> sched_turns_queued{0};
+
+  // Packed doc_root image (--image): entries and mapped bytes, lookups served from it
+  // (gzip variants counted again in image_gzip_hits) and paths it does not contain
+  std::atomic<unsigned long long> image_entries{0};
+  std::atomic<unsigned long long> image_bytes{0};
+  std::atomic<unsigned long long> image_hits{0};
+  std::atomic<unsigned long long> image_gzip_hits{0};
+  std::atomic<unsigned long long> image_misses{0};
+
+  // Overload protection
+  std::atomic<unsigned long long> active_connections{0}; // gauge
+  std::atomic<unsigned long long> connections_shed{0};   // requests answered 503 under overload
+  std::atomic<unsigned long long> accept_pauses{0};
+  std::atomic<unsigned long long> connection_timeouts{0}; // read, write or idle deadline hit
+  std::atomic<unsigned long long> event_loop_lag_us{0};  // gauge, smoothed
+  std::atomic<unsigned long long> sessions_reused{0};    // connections served by a pooled session
+  std::atomic<unsigned long long> read_buffers_in_use{0}; // gauge: connections holding unparsed bytes
+  std::atomic<unsigned long long> read_buffers_grown{0};  // heads that outgrew a pooled block
+
+  // HTTP/2
+  std::atomic<unsigned long long> h2_connections{0};
+  std::atomic<unsigned long long> h2_streams{0};
+
+  // TLS: completed handshakes, and how many of those the kernel took over
+  std::atomic<unsigned long long> tls_handshakes{0};
+  std::atomic<unsigned long long> tls_handshake_errors{0};
+  std::atomic<unsigned long long> tls_ktls_send{0};
+  std::atomic<unsigned long long> tls_ktls_recv{0};
+
+  // Logger: records dropped because a thread's ring was full
+  std::atomic<unsigned long long> log_dropped{0};
+
+  // Access trace (--trace.path): records written, and dropped because a ring was full
+  std::atomic<unsigned long long> trace_records{0};
+  std::atomic<unsigned long long> trace_dropped{0};
+
+  // Request tracing (--tracing.sample): spans finished, and kept as slow
+  std::atomic<unsigned long long> traces_sampled{0};
+  std::atomic<unsigned long long> traces_slow{0};
+
   // RDMA counters
   std::atomic<unsigned long long> rdma_reqs{0};
   std::atomic<unsigned long long> rdma_ok{0};
   std::atomic<unsigned long long> rdma_err{0};
   std::atomic<unsigned long long> rdma_bytes{0};
+  std::atomic<unsigned long long> rdma_batch_items{0};
+
+  // Shared-memory transport
+  std::atomic<unsigned long long> shm_accepted{0};
+  std::atomic<unsigned long long> shm_rejected{0};   // clients dropped for a malformed ring
+
+  // RDMA completion queue poller
+  std::atomic<unsigned long long> rdma_cq_polls{0};
+  std::atomic<unsigned long long> rdma_cq_empty_polls{0};
+  std::atomic<unsigned long long> rdma_cq_completions{0};
+  std::atomic<unsigned long long> rdma_cq_wakeups{0};
+  std::atomic<unsigned long long> rdma_cq_wakeup_ns{0}; // channel wakeup -> first completion, summed
+  std::atomic<unsigned long long> rdma_cq_errors{0};    // completions with a non-success status
 
   static Metrics& instance() {
     static Metrics m;
@@ -30,10 +127,80 @@ struct Metrics {
     cache_hits = 0;
     cache_misses = 0;
     bytes_served = 0;
+    cache_small_bytes = 0;
+    cache_small_overhead_bytes = 0;
+    cache_small_capacity_bytes = 0;
+    cache_small_items = 0;
+    cache_small_hits = 0;
+    cache_small_evictions = 0;
+    cache_large_bytes = 0;
+    cache_large_overhead_bytes = 0;
+    cache_large_capacity_bytes = 0;
+    cache_large_items = 0;
+    cache_large_hits = 0;
+    cache_large_evictions = 0;
+    cache_pinned_bytes = 0;
+    cache_pinned_overhead_bytes = 0;
+    cache_pinned_items = 0;
+    cache_pinned_hits = 0;
+    cache_l2_bytes = 0;
+    cache_l2_capacity_bytes = 0;
+    cache_l2_items = 0;
+    cache_l2_hits = 0;
+    cache_l2_demotions = 0;
+    cache_l2_dropped = 0;
+    cache_l2_bytes_written = 0;
+    cache_l2_evictions = 0;
+    cache_l2_read_errors = 0;
+    cache_revalidations = 0;
+    cache_revalidation_reloads = 0;
+    cache_revalidation_removals = 0;
+    cache_revalidations_dropped = 0;
+    cache_negative_hits = 0;
+    cache_negative_items = 0;
+    numa_nodes = 0;
+    numa_hits_local = 0;
+    numa_hits_remote = 0;
+    sched_bulk_responses = 0;
+    sched_turns = 0;
+    sched_turns_queued = 0;
+    image_entries = 0;
+    image_bytes = 0;
+    image_hits = 0;
+    image_gzip_hits = 0;
+    image_misses = 0;
+    active_connections = 0;
+    connections_shed = 0;
+    accept_pauses = 0;
+    connection_timeouts = 0;
+    event_loop_lag_us = 0;
+    sessions_reused = 0;
+    read_buffers_in_use = 0;
+    read_buffers_grown = 0;
+    h2_connections = 0;
+    h2_streams = 0;
+    tls_handshakes = 0;
+    tls_handshake_errors = 0;
+    tls_ktls_send = 0;
+    tls_ktls_recv = 0;
+    log_dropped = 0;
+    trace_records = 0;
+    trace_dropped = 0;
+    traces_sampled = 0;
+    traces_slow = 0;
     rdma_reqs = 0;
     rdma_ok = 0;
     rdma_err = 0;
     rdma_bytes = 0;
+    rdma_batch_items = 0;
+    shm_accepted = 0;
+    shm_rejected = 0;
+    rdma_cq_polls = 0;
+    rdma_cq_empty_polls = 0;
+    rdma_cq_completions = 0;
+    rdma_cq_wakeups = 0;
+    rdma_cq_wakeup_ns = 0;
+    rdma_cq_errors = 0;
   }
 
   std::string render_text() const {
@@ -45,9 +212,88 @@ struct Metrics {
       "cache_hits " + std::to_string(cache_hits.load()) + "\n" +
       "cache_misses " + std::to_string(cache_misses.load()) + "\n" +
       "bytes_served " + std::to_string(bytes_served.load()) + "\n" +
+      "cache_small_bytes " + std::to_string(cache_small_bytes.load()) + "\n" +
+      "cache_small_overhead_bytes " + std::to_string(cache_small_overhead_bytes.load()) + "\n" +
+      "cache_small_capacity_bytes " + std::to_string(cache_small_capacity_bytes.load()) + "\n" +
+      "cache_small_items " + std::to_string(cache_small_items.load()) + "\n" +
+      "cache_small_hits " + std::to_string(cache_small_hits.load()) + "\n" +
+      "cache_small_evictions " + std::to_string(cache_small_evictions.load()) + "\n" +
+      "cache_large_bytes " + std::to_string(cache_large_bytes.load()) + "\n" +
+      "cache_large_overhead_bytes " + std::to_string(cache_large_overhead_bytes.load()) + "\n" +
+      "cache_large_capacity_bytes " + std::to_string(cache_large_capacity_bytes.load()) + "\n" +
+      "cache_large_items " + std::to_string(cache_large_items.load()) + "\n" +
+      "cache_large_hits " + std::to_string(cache_large_hits.load()) + "\n" +
+      "cache_large_evictions " + std::to_string(cache_large_evictions.load()) + "\n" +
+      "cache_pinned_bytes " + std::to_string(cache_pinned_bytes.load()) + "\n" +
+      "cache_pinned_overhead_bytes " + std::to_string(cache_pinned_overhead_bytes.load()) + "\n" +
+      "cache_pinned_items " + std::to_string(cache_pinned_items.load()) + "\n" +
+      "cache_pinned_hits " + std::to_string(cache_pinned_hits.load()) + "\n" +
+      "cache_l2_bytes " + std::to_string(cache_l2_bytes.load()) + "\n" +
+      "cache_l2_capacity_bytes " + std::to_string(cache_l2_capacity_bytes.load()) + "\n" +
+      "cache_l2_items " + std::to_string(cache_l2_items.load()) + "\n" +
+      "cache_l2_hits " + std::to_string(cache_l2_hits.load()) + "\n" +
+      "cache_l2_demotions " + std::to_string(cache_l2_demotions.load()) + "\n" +
+      "cache_l2_dropped " + std::to_string(cache_l2_dropped.load()) + "\n" +
+      "cache_l2_bytes_written " + std::to_string(cache_l2_bytes_written.load()) + "\n" +
+      "cache_l2_evictions " + std::to_string(cache_l2_evictions.load()) + "\n" +
+      "cache_l2_read_errors " + std::to_string(cache_l2_read_errors.load()) + "\n" +
+      "cache_revalidations " + std::to_string(cache_revalidations.load()) + "\n" +
+      "cache_revalidation_reloads " + std::to_string(cache_revalidation_reloads.load()) + "\n" +
+      "cache_revalidation_removals " + std::to_string(cache_revalidation_removals.load()) + "\n" +
+      "cache_revalidations_dropped " + std::to_string(cache_revalidations_dropped.load()) + "\n" +
+      "cache_negative_hits " + std::to_string(cache_negative_hits.load()) + "\n" +
+      "cache_negative_items " + std::to_string(cache_negative_items.load()) + "\n" +
+      "numa_nodes " + std::to_string(numa_nodes.load()) + "\n" +
+      "numa_hits_local " + std::to_string(numa_hits_local.load()) + "\n" +
+      "numa_hits_remote " + std::to_string(numa_hits_remote.load()) + "\n" +
+      "sched_bulk_responses " + std::to_string(sched_bulk_responses.load()) + "\n" +
+      "sched_turns " + std::to_string(sched_turns.load()) + "\n" +
+      "sched_turns_queued " + std::to_string(sched_turns_queued.load()) + "\n" +
+      "image_entries " + std::to_string(image_entries.load()) + "\n" +
+      "image_bytes " + std::to_string(image_bytes.load()) + "\n" +
+      "image_hits " + std::to_string(image_hits.load()) + "\n" +
+      "image_gzip_hits " + std::to_string(image_gzip_hits.load()) + "\n" +
+      "image_misses " + std::to_string(image_misses.load()) + "\n" +
+      "active_connections " + std::to_string(active_connections.load()) + "\n" +
+      "connections_shed " + std::to_string(connections_shed.load()) + "\n" +
+      "accept_pauses " + std::to_string(accept_pauses.load()) + "\n" +
+      "connection_timeouts " + std::to_string(connection_timeouts.load()) + "\n" +
+      "event_loop_lag_us " + std::to_string(event_loop_lag_us.load()) + "\n" +
+      "sessions_reused " + std::to_string(sessions_reused.load()) + "\n" +
+      "read_buffers_in_use " + std::to_string(read_buffers_in_use.load()) + "\n" +
+      "read_buffers_grown " + std::to_string(read_buffers_grown.load()) + "\n" +
+      "h2_connections " + std::to_string(h2_connections.load()) + "\n" +
+      "h2_streams " + std::to_string(h2_streams.load()) + "\n" +
+      "tls_handshakes " + std::to_string(tls_handshakes.load()) + "\n" +
+      "tls_handshake_errors " + std::to_string(tls_handshake_errors.load()) + "\n" +
+      "tls_ktls_send " + std::to_string(tls_ktls_send.load()) + "\n" +
+      "tls_ktls_recv " + std::to_string(tls_ktls_recv.load()) + "\n" +
+      "log_dropped " + std::to_string(log_dropped.load()) + "\n" +
+      "trace_records " + std::to_string(trace_records.load()) + "\n" +
+      "trace_dropped " + std::to_string(trace_dropped.load()) + "\n" +
+      "traces_sampled " + std::to_string(traces_sampled.load()) + "\n" +
+      "traces_slow " + std::to_string(traces_slow.load()) + "\n" +
       "rdma_requests " + std::to_string(rdma_reqs.load()) + "\n" +
       "rdma_ok " + std::to_string(rdma_ok.load()) + "\n" +
       "rdma_err " + std::to_string(rdma_err.load()) + "\n" +
-      "rdma_bytes " + std::to_string(rdma_bytes.load()) + "\n";
+      "rdma_bytes " + std::to_string(rdma_bytes.load()) + "\n" +
+      "rdma_batch_items " + std::to_string(rdma_batch_items.load()) + "\n" +
+      "shm_accepted " + std::to_string(shm_accepted.load()) + "\n" +
+      "shm_rejected " + std::to_string(shm_rejected.load()) + "\n" +
+      "rdma_cq_polls " + std::to_string(rdma_cq_polls.load()) + "\n" +
+      "rdma_cq_empty_polls " + std::to_string(rdma_cq_empty_polls.load()) + "\n" +
+      "rdma_cq_completions " + std::to_string(rdma_cq_completions.load()) + "\n" +
+      "rdma_cq_wakeups " + std::to_string(rdma_cq_wakeups.load()) + "\n" +
+      "rdma_cq_wakeup_ns_total " + std::to_string(rdma_cq_wakeup_ns.load()) + "\n" +
+      "rdma_cq_errors " + std::to_string(rdma_cq_errors.load()) + "\n";
   }
-};
\ No newline at end of file
+};
+
+// Moves a process-wide gauge from one instance's last report to `now`, so caches
+// that exist once per shard each add their share; unsigned arithmetic makes a
+// decrease wrap into the right value
+inline void move_gauge(std::atomic<unsigned long long>& gauge, std::size_t& last, std::size_t now) {
+  if (now == last) return;
+  gauge.fetch_add(static_cast<unsigned long long>(now) - last, std::memory_order_relaxed);
+  last = now;
+}
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// NUMA topology and placement, read from sysfs (no libnuma).
+//
+// With --numa, main runs one Server per node: its own io_context, worker threads
+// pinned to the node's CPUs, and its own cache shard. The listeners of all nodes
+// share the port through SO_REUSEPORT, and a classic BPF program on the group hands
+// each new connection to the listener of the node whose CPU took its packets, so a
+// connection is served by the node that owns its RX queue. Memory follows from the
+// kernel's default first-touch policy: bodies are read into memory by threads of the
+// shard's node, so they land on it.
+//
+// Hits are counted as local or remote by comparing the node an object was built on
+// with the node of the thread serving it. That works with or without --numa, so the
+// counters also show what an unpinned server pays.
+namespace numa {
+
+struct Node {
+  int id = 0;
+  std::vector<int> cpus;          // those this process may run on
+};
+
+struct Topology {
+  std::vector<Node> nodes;        // only nodes with usable CPUs, by id
+  std::vector<int> cpu_node;      // CPU number -> index into nodes, -1 if unknown
+
+  // Falls back to a single node holding every allowed CPU when sysfs has no topology
+  static Topology detect();
+  std::size_t cpus() const;
+};
+
+// Makes `topo` the process topology; call once at startup, before any worker runs
+void init(const Topology& topo);
+
+// Pins the calling thread to the CPUs of nodes[index] of the process topology; false
+// if the kernel refused
+bool bind_thread(std::size_t index);
+
+// Attaches a reuseport program to the group `fds` belong to, steering a connection
+// to fds[i] when the CPU that received it is on nodes[i]. `fds` must be in the order
+// they were bound. False (and the kernel's hash stays in use) if it cannot attach.
+bool steer_listeners(const Topology& topo, const std::vector<int>& fds, std::string& error);
+
+namespace detail {
+extern std::atomic<bool> g_multi;    // more than one node
+extern thread_local int t_node;      // set by bind_thread, -1 otherwise
+int node_of_current_cpu();
+void count_hit(int home);
+} // namespace detail
+
+// Index of the node the calling thread runs on; -1 on single-node hosts
+inline int current_node() {
+  if (!detail::g_multi.load(std::memory_order_relaxed)) return -1;
+  return detail::t_node >= 0 ? detail::t_node : detail::node_of_current_cpu();
+}
+
+// Counts a hit on an object built on node `home` (-1 = not tracked)
+inline void record_hit(int home) {
+  if (home >= 0) detail::count_hit(home);
+}
+
+} // namespace numa
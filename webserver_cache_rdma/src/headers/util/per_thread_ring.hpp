@@ -0,0 +1,169 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Per-thread single-producer rings of T and the registry that finds them all; the
+// logger, the access trace and the slow-span history are built on it. A thread gets
+// its ring on its first reserve(). Writing a record takes no lock, makes no syscall
+// and never allocates; a full ring refuses the record instead of waiting. One
+// consumer at a time drains the rings, and a ring whose thread has exited is
+// drained one last time and freed.
+//
+// The calling thread's ring is found through a thread_local per record type, so
+// there is one registry per T.
+template <typename T>
+class PerThreadRing {
+public:
+  struct Ring {
+    Ring(std::size_t records, uint32_t id) : slots(new T[records]), mask(records - 1), id(id) {}
+
+    std::unique_ptr<T[]> slots;
+    std::size_t mask;
+    uint32_t id;                                // threads are numbered in order of first use
+    std::atomic<bool> orphaned{false};          // owning thread has exited
+    alignas(64) std::atomic<uint64_t> head{0};  // written by the producer
+    alignas(64) std::atomic<uint64_t> tail{0};  // written by the consumer
+  };
+
+  explicit PerThreadRing(std::size_t records) { set_capacity(records); }
+  PerThreadRing(const PerThreadRing&) = delete;
+  PerThreadRing& operator=(const PerThreadRing&) = delete;
+
+  // Records per ring for threads that attach from now on, rounded up to a power of two
+  void set_capacity(std::size_t records) {
+    std::size_t n = 1;
+    while (n < records) n <<= 1;
+    std::lock_guard<std::mutex> lk(mtx_);
+    capacity_ = n;
+  }
+
+  // The calling thread's next free slot, or nullptr when its ring is full. The slot
+  // is published by commit().
+  T* reserve() {
+    Ring& r = local();
+    const uint64_t head = r.head.load(std::memory_order_relaxed);
+    if (head - r.tail.load(std::memory_order_acquire) > r.mask) return nullptr;
+    return &r.slots[head & r.mask];
+  }
+
+  void commit() {
+    Ring& r = *t_local_.ring;
+    r.head.store(r.head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+  // The calling thread's number
+  uint32_t thread_id() { return local().id; }
+
+  std::size_t rings() const {
+    std::lock_guard<std::mutex> lk(mtx_);
+    return rings_.size();
+  }
+
+  // Consumer side; callers serialize the drains. Hands the new records of each ring
+  // to f(ring id, first, n) in at most two runs (before and after the wrap) and
+  // returns how many there were.
+  template <typename F>
+  uint64_t drain(F&& f) {
+    snapshot();
+    uint64_t total = 0;
+    for (const auto& r : draining_) {
+      // Orphaned is read before head: a ring marked orphaned has no writes after it
+      const bool orphaned = r->orphaned.load(std::memory_order_acquire);
+      const uint64_t head = r->head.load(std::memory_order_acquire);
+      uint64_t tail = r->tail.load(std::memory_order_relaxed);
+      while (tail != head) {
+        const std::size_t at = tail & r->mask;
+        const std::size_t run = std::min<uint64_t>(head - tail, r->mask + 1 - at);
+        f(r->id, &r->slots[at], run);
+        tail += run;
+        total += run;
+      }
+      r->tail.store(tail, std::memory_order_release);
+      if (orphaned) forget(r);
+    }
+    draining_.clear();
+    return total;
+  }
+
+  // Same, one record at a time and merged across rings: f(rec) sees the smallest
+  // key(rec) first. Each ring is already in key order as long as its thread writes
+  // keys that only grow, such as timestamps.
+  template <typename Key, typename F>
+  uint64_t drain_merged(Key&& key, F&& f) {
+    snapshot();
+    cursors_.clear();
+    for (const auto& r : draining_) {
+      const bool orphaned = r->orphaned.load(std::memory_order_acquire);
+      cursors_.push_back({r.get(), r->tail.load(std::memory_order_relaxed),
+                          r->head.load(std::memory_order_acquire), orphaned});
+    }
+    uint64_t total = 0;
+    for (;;) {
+      Cursor* next = nullptr;
+      for (auto& c : cursors_) {
+        if (c.tail != c.head && (!next || key(c.front()) < key(next->front()))) next = &c;
+      }
+      if (!next) break;
+      f(next->front());
+      ++next->tail;
+      ++total;
+    }
+    for (std::size_t i = 0; i < draining_.size(); ++i) {
+      draining_[i]->tail.store(cursors_[i].tail, std::memory_order_release);
+      if (cursors_[i].orphaned) forget(draining_[i]);
+    }
+    draining_.clear();
+    return total;
+  }
+
+private:
+  // Marks the ring orphaned when its thread exits; the next drain frees it
+  struct Local {
+    std::shared_ptr<Ring> ring;
+    ~Local() {
+      if (ring) ring->orphaned.store(true, std::memory_order_release);
+    }
+  };
+
+  struct Cursor {
+    Ring* ring;
+    uint64_t tail;
+    uint64_t head;
+    bool orphaned;
+
+    const T& front() const { return ring->slots[tail & ring->mask]; }
+  };
+
+  Ring& local() {
+    if (!t_local_.ring) {
+      std::lock_guard<std::mutex> lk(mtx_);
+      t_local_.ring = std::make_shared<Ring>(capacity_, next_id_++);
+      rings_.push_back(t_local_.ring);
+    }
+    return *t_local_.ring;
+  }
+
+  void snapshot() {
+    std::lock_guard<std::mutex> lk(mtx_);
+    draining_ = rings_;
+  }
+
+  void forget(const std::shared_ptr<Ring>& r) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    rings_.erase(std::remove(rings_.begin(), rings_.end(), r), rings_.end());
+  }
+
+  static inline thread_local Local t_local_;
+
+  mutable std::mutex mtx_;
+  std::vector<std::shared_ptr<Ring>> rings_;
+  std::size_t capacity_ = 1;
+  uint32_t next_id_ = 0;
+  std::vector<std::shared_ptr<Ring>> draining_;  // consumer-only scratch
+  std::vector<Cursor> cursors_;                  // consumer-only scratch
+};
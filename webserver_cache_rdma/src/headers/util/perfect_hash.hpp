@@ -0,0 +1,68 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Compile-time perfect hashing for small fixed key sets (MIME extensions, known
+// header names). The builder searches for a seed under which every key lands in its
+// own slot of a power-of-two table; a lookup is then one case-folding hash, one slot
+// read and one comparison. Keys must be lowercase; lookups ignore ASCII case.
+
+constexpr char ascii_lower(char c) {
+  return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+constexpr bool iequals_lower(std::string_view lower, std::string_view s) {
+  if (lower.size() != s.size()) return false;
+  for (std::size_t i = 0; i < s.size(); ++i)
+    if (lower[i] != ascii_lower(s[i])) return false;
+  return true;
+}
+
+// FNV-1a over the lowercased bytes, mixed with the seed
+constexpr uint32_t ihash(std::string_view s, uint32_t seed) {
+  uint32_t h = 2166136261u ^ (seed * 0x9e3779b9u);
+  for (char c : s) {
+    h ^= static_cast<uint8_t>(ascii_lower(c));
+    h *= 16777619u;
+  }
+  return h ^ (h >> 15);
+}
+
+template <std::size_t TableSize>
+struct PerfectHash {
+  static_assert((TableSize & (TableSize - 1)) == 0, "table size must be a power of two");
+  static constexpr uint8_t kEmpty = 0xff;
+
+  uint32_t seed = 0;                    // 0 = no seed found
+  std::array<uint8_t, TableSize> slot{};
+
+  // Index of `s` in the key array, or -1
+  template <std::size_t N>
+  constexpr int find(const std::array<std::string_view, N>& keys, std::string_view s) const {
+    const uint8_t i = slot[ihash(s, seed) & (TableSize - 1)];
+    return (i != kEmpty && iequals_lower(keys[i], s)) ? i : -1;
+  }
+};
+
+template <std::size_t TableSize, std::size_t N>
+constexpr PerfectHash<TableSize> make_perfect_hash(const std::array<std::string_view, N>& keys) {
+  static_assert(N < PerfectHash<TableSize>::kEmpty, "too many keys");
+  PerfectHash<TableSize> ph;
+  for (uint32_t seed = 1; seed < 100000; ++seed) {
+    for (auto& s : ph.slot) s = PerfectHash<TableSize>::kEmpty;
+    bool ok = true;
+    for (std::size_t k = 0; k < N && ok; ++k) {
+      auto& s = ph.slot[ihash(keys[k], seed) & (TableSize - 1)];
+      if (s != PerfectHash<TableSize>::kEmpty) ok = false;
+      else s = static_cast<uint8_t>(k);
+    }
+    if (ok) {
+      ph.seed = seed;
+      return ph;
+    }
+  }
+  ph.seed = 0;
+  return ph;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <cstddef>
+#include <utility>
+
+// Receive buffer for a connection, held only while it has bytes waiting to be
+// parsed. Between requests the connection gives it back and waits for readability
+// without one, so an idle keep-alive connection costs no buffer at all.
+//
+// Buffers are blocks of kBlockSize from a pool: each thread keeps a few free blocks
+// of its own and trades batches with a shared list under a mutex, so taking and
+// returning a block is usually a thread-local push or pop, even when connections
+// move between threads. A head that outgrows its block moves to a heap buffer of
+// the size it needs, which is freed instead of pooled.
+class ReadBuffer {
+public:
+  static constexpr std::size_t kBlockSize = 8192;
+
+  ReadBuffer() = default;
+  ~ReadBuffer() { reset(); }
+  ReadBuffer(const ReadBuffer&) = delete;
+  ReadBuffer& operator=(const ReadBuffer&) = delete;
+  ReadBuffer(ReadBuffer&& o) noexcept
+    : data_(std::exchange(o.data_, nullptr)), capacity_(std::exchange(o.capacity_, 0)) {}
+  ReadBuffer& operator=(ReadBuffer&& o) noexcept {
+    if (this != &o) {
+      reset();
+      data_ = std::exchange(o.data_, nullptr);
+      capacity_ = std::exchange(o.capacity_, 0);
+    }
+    return *this;
+  }
+
+  // Takes a block from the pool; a no-op while one is held
+  void acquire();
+  // Moves to a buffer of `capacity` bytes, keeping the first `keep`
+  void grow(std::size_t keep, std::size_t capacity);
+  // Gives the buffer back
+  void reset();
+
+  explicit operator bool() const { return data_ != nullptr; }
+  char* data() const { return data_; }
+  std::size_t capacity() const { return capacity_; }
+
+private:
+  char* data_ = nullptr;
+  std::size_t capacity_ = 0;
+};
+
+// Blocks of ReadBuffer::kBlockSize straight from the pool, for other storage a
+// connection needs only for a moment (the head of the response being written)
+char* take_pool_block();
+void give_pool_block(char* b);
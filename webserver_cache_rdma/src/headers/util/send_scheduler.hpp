@@ -0,0 +1,81 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Fair sharing of the worker threads between connections sending large bodies, one
+// per io_context. A response no bigger than one slice is written in one go, as
+// before; a bigger one is sent slice by slice, and each slice is a turn granted here.
+//
+// Turns go to classes by deficit round robin: every round a class may take `weight`
+// turns, and its waiting connections take them in FIFO order, so bandwidth is split
+// by weight between classes and evenly between the connections of a class. A turn
+// is one non-blocking write of at most `slice_bytes`, started once the socket is
+// writable; at most `slots` turns run at once, which leaves the other threads to
+// small requests however many downloads are running. Classes are picked by the
+// longest matching path prefix; unmatched targets share a default class of weight 1.
+class SendScheduler {
+public:
+  struct Class {
+    std::string prefix;
+    uint32_t weight = 1;
+  };
+
+  struct Options {
+    std::size_t slice_bytes = 64 * 1024;   // 0 = off: every response is one write
+    std::size_t slots = 1;                 // turns running at once
+    std::vector<Class> classes;
+  };
+
+  // A waiting connection; intrusive and owned by its session
+  struct Node {
+    Node* next = nullptr;
+    bool queued = false;
+    std::size_t cls = 0;                   // from classify()
+    std::weak_ptr<void> owner;             // turns of dead owners are skipped
+    // Runs on the thread that granted the turn, with the bytes the turn may send;
+    // the owner must call done() once its write is issued
+    void (*on_turn)(const std::shared_ptr<void>& owner, std::size_t budget) = nullptr;
+  };
+
+  explicit SendScheduler(const Options& opt);
+
+  bool enabled() const { return slice_ > 0; }
+  std::size_t slice_bytes() const { return slice_; }
+  bool has_classes() const { return classes_.size() > 1; }
+  std::size_t classify(std::string_view target) const;
+
+  // Queues `n` for its next turn (possibly granting it right away)
+  void wait(Node& n);
+  // Ends the turn the caller was granted
+  void done();
+  // Drops `n` from its queue if it is still waiting
+  void cancel(Node& n);
+
+private:
+  struct ClassQueue {
+    std::string prefix;
+    uint32_t weight = 1;
+    Node* head = nullptr;
+    Node* tail = nullptr;
+    uint64_t deficit = 0;                  // turns left this round
+  };
+
+  // Picks the next live waiter while a slot is free, taking the slot and a reference
+  // to its owner; called with mtx_ held
+  Node* next_locked(std::shared_ptr<void>& owner);
+  void grant(Node* n, const std::shared_ptr<void>& owner);
+
+  const std::size_t slice_;
+  const std::size_t slots_;
+
+  std::mutex mtx_;
+  std::vector<ClassQueue> classes_;        // configured ones, then the default class
+  std::size_t cursor_ = 0;                 // class whose round is in progress
+  std::size_t waiting_ = 0;
+  std::size_t running_ = 0;
+};
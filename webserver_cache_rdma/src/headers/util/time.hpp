@@ -1,20 +1,55 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <chrono>
+#include <cstdint>
 #include <ctime>
+#include <time.h>
 
-inline std::string format_http_date(std::time_t t) {
-  char buf[64]{0};
+// Writes the IMF-fixdate for `t` into `buf` and returns its length (29 for any
+// four-digit year)
+inline std::size_t format_http_date(std::time_t t, char* buf, std::size_t cap) {
   std::tm gm{};
 #if defined(_WIN32)
   gmtime_s(&gm, &t);
 #else
   gmtime_r(&t, &gm);
 #endif
-  std::strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &gm);
-  return std::string(buf);
+  return std::strftime(buf, cap, "%a, %d %b %Y %H:%M:%S GMT", &gm);
+}
+
+inline std::string format_http_date(std::time_t t) {
+  char buf[64]{0};
+  return std::string(buf, format_http_date(t, buf, sizeof(buf)));
 }
 
 inline std::string now_http_date() {
   return format_http_date(std::time(nullptr));
-}
\ No newline at end of file
+}
+
+// Monotonic milliseconds for expiry checks on hot paths; the coarse clock is a plain
+// read of the vDSO page, a few ms behind the precise one
+inline int64_t coarse_now_ms() {
+#ifdef CLOCK_MONOTONIC_COARSE
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+#else
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// The current Date header value, formatted at most once a second per thread. The
+// view stays valid until the calling thread's next call.
+inline std::string_view cached_http_date() {
+  thread_local std::time_t last = -1;
+  thread_local char buf[64];
+  thread_local std::size_t len = 0;
+  const std::time_t now = std::time(nullptr);
+  if (now != last) {
+    len = format_http_date(now, buf, sizeof(buf));
+    last = now;
+  }
+  return {buf, len};
+}
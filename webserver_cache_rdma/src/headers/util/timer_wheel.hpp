@@ -0,0 +1,69 @@
+#pragma once
+#include <boost/asio.hpp>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+// Hierarchical timing wheel shared by all sessions of an io_context. Deadlines are
+// rounded up to whole ticks, so a timer fires between `timeout` and `timeout + tick`
+// after it was set. Each timer is an intrusive node owned by its user: schedule,
+// reschedule and cancel are O(1) list splices, with no allocation and no
+// per-timer handler.
+//
+// Four levels of 64 slots; level L slots are 64^L ticks wide. Level 0 is
+// processed every tick, and a higher-level slot is redistributed downwards each
+// time the level below wraps.
+class TimerWheel : public std::enable_shared_from_this<TimerWheel> {
+public:
+  struct Node {
+    Node* prev = nullptr;
+    Node* next = nullptr;
+    uint64_t expiry = 0;              // absolute tick
+    uint64_t generation = 0;          // bumped by every schedule/cancel
+    std::weak_ptr<void> owner;        // expired timers of dead owners are skipped
+    void (*on_expire)(const std::shared_ptr<void>& owner, uint64_t generation) = nullptr;
+  };
+
+  TimerWheel(boost::asio::io_context& ioc, std::chrono::milliseconds tick);
+
+  void start();
+  void stop();
+
+  // (Re)arms `n` to expire after `after`. The callback runs on the wheel's strand
+  // with the generation it was armed with; owners compare it to the node's current
+  // generation (via generation_of) to ignore a deadline that was moved meanwhile.
+  void schedule(Node& n, std::chrono::milliseconds after);
+  void cancel(Node& n);
+  uint64_t generation_of(const Node& n);
+
+  std::chrono::milliseconds tick() const { return tick_; }
+
+private:
+  static constexpr unsigned kLevelBits = 6;
+  static constexpr unsigned kSlots = 1u << kLevelBits;
+  static constexpr unsigned kLevels = 4;
+
+  using Slot = Node;                  // sentinel of a circular list
+
+  void link_locked(Node& n);
+  static void unlink(Node& n);
+  void advance();
+  void arm();
+
+  using Strand = boost::asio::strand<boost::asio::io_context::executor_type>;
+  // Bound to the strand by type, so a tick does not box a copy of it on the heap
+  using Timer = boost::asio::basic_waitable_timer<std::chrono::steady_clock,
+    boost::asio::wait_traits<std::chrono::steady_clock>, Strand>;
+
+  Strand strand_;
+  Timer timer_;
+  std::chrono::milliseconds tick_;
+  std::chrono::steady_clock::time_point epoch_;
+  bool stopped_ = false;
+
+  std::mutex mtx_;
+  uint64_t now_ = 0;                  // ticks processed so far
+  std::array<std::array<Slot, kSlots>, kLevels> wheel_;
+};
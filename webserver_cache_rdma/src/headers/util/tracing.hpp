@@ -0,0 +1,123 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Per-request stage timing for HTTP/1.1 (--tracing.sample). One read in N starts a
+// Span for the next request it completes: each mark() charges the time since the
+// previous mark to a stage. Finished spans slower than --tracing.slow-us are copied
+// into the calling thread's ring of recent slow requests, which GET /debug/traces
+// renders as JSON.
+//
+// Timestamps are TSC ticks on x86 (converted with a rate calibrated in configure())
+// and steady_clock nanoseconds elsewhere. Requests that are not sampled cost one
+// relaxed load per read and one predictable branch per mark; no clock is read.
+namespace tracing {
+
+// In request order. Time not covered by a more specific mark lands in the next one.
+enum class Stage : uint8_t {
+  Parse,    // read completed -> handler: parsing, and the rest of a split request
+  Map,      // cache key form, or URL -> filesystem path
+  Lookup,   // memory cache
+  Read,     // disk read on a miss, building the object and inserting it
+  Headers,  // response head
+  Write,    // socket (or TLS) write until completion
+};
+constexpr std::size_t kStages = 6;
+
+const char* stage_name(Stage s);
+
+struct Options {
+  uint32_t sample = 0;          // 1 in N requests; 0 = off
+  uint32_t slow_us = 1000;      // spans at least this long are kept
+  std::size_t ring = 128;       // slow spans kept per thread
+};
+
+// Call once at startup, before any I/O thread runs
+void configure(const Options& opt);
+
+// Timestamp in ticks; never 0
+inline uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+namespace detail {
+extern std::atomic<uint32_t> g_sample;
+extern thread_local uint32_t t_reads;
+} // namespace detail
+
+// Whether the calling thread's next read starts a span
+inline bool sampled() {
+  const uint32_t n = detail::g_sample.load(std::memory_order_relaxed);
+  return n != 0 && ++detail::t_reads % n == 0;
+}
+
+struct Record {
+  uint64_t start = 0;                   // ticks
+  uint64_t total = 0;
+  uint64_t stage[kStages] = {};
+  uint64_t bytes = 0;                   // body bytes
+  uint16_t status = 0;
+  uint8_t target_len = 0;
+  char target[96];                      // truncated
+};
+
+class Span {
+public:
+  // `start` is when the request's bytes arrived; the time since is Parse
+  void begin(uint64_t start, std::string_view target) {
+    const uint64_t t = now();
+    rec_ = Record{};
+    rec_.start = start <= t ? start : t;
+    rec_.stage[static_cast<std::size_t>(Stage::Parse)] = t - rec_.start;
+    rec_.target_len = static_cast<uint8_t>(std::min(target.size(), sizeof(rec_.target)));
+    std::memcpy(rec_.target, target.data(), rec_.target_len);
+    last_ = t;
+    active_ = true;
+  }
+
+  void mark(Stage s) {
+    if (!active_) return;
+    const uint64_t t = now();
+    rec_.stage[static_cast<std::size_t>(s)] += t - last_;
+    last_ = t;
+  }
+
+  void set_status(int status) { rec_.status = static_cast<uint16_t>(status); }
+  void set_bytes(uint64_t bytes) { rec_.bytes = bytes; }
+
+  // Charges the rest to Write and keeps the span if it was slow
+  void finish() {
+    if (!active_) return;
+    active_ = false;
+    mark_final();
+  }
+
+  void cancel() { active_ = false; }
+  bool active() const { return active_; }
+
+private:
+  void mark_final();
+
+  Record rec_;
+  uint64_t last_ = 0;
+  bool active_ = false;
+};
+
+// Recent slow spans from every thread, newest first, as one JSON document
+std::string render_json(std::size_t limit = 256);
+
+} // namespace tracing